@@ -0,0 +1,165 @@
+/*
+	Per-callsign cost of the DXCC lookups of src/cty.c: uncached, from the
+	LRU cache with a few hundred stations heard again and again (a busy
+	FT8 band), and with every call different (the cache misses). A scan of
+	every prefix and exact call for the longest match is timed alongside,
+	as what the lookup costs without the trie.
+
+	The country file is the one given, or a synthetic one of ENTITIES
+	entities with a few prefixes each and EXACT exact calls; the callsigns
+	looked up are made from its prefixes.
+
+	gcc -O2 -Isrc -o cty_bench misc/cty_bench.c src/cty.c -pthread
+	./cty_bench [cty.dat]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cty.h"
+
+#define ENTITIES 400
+#define EXACT 24000
+#define CORPUS 50000
+#define HEARD 300
+#define LOOKUPS 1000000
+#define SCANS 20000
+#define CTY_PATH "/tmp/cty_bench.dat"
+
+static char corpus[CORPUS][16];
+static char (*aliases)[16];
+static int n_aliases;
+
+static double now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void random_prefix(char *prefix){
+	int len = 1 + rand() % 3;
+	for (int i = 0; i < len; i++)
+		prefix[i] = i == len - 1 && len > 1 ? '0' + rand() % 10 : 'A' + rand() % 26;
+	prefix[len] = 0;
+}
+
+static void write_cty(const char *path){
+	FILE *pf = fopen(path, "w");
+	int exact_per_entity = EXACT / ENTITIES;
+
+	for (int e = 0; e < ENTITIES; e++){
+		char prefix[8];
+		random_prefix(prefix);
+		fprintf(pf, "Entity %d:  %d:  %d:  EU:  %.2f:  %.2f:  %.1f:  %s:\n    %s",
+			e, 1 + rand() % 40, 1 + rand() % 90, rand() % 180 - 90.0, rand() % 360 - 180.0,
+			rand() % 24 - 12.0, prefix, prefix);
+		for (int i = rand() % 6; i > 0; i--){
+			random_prefix(prefix);
+			fprintf(pf, ",%s", prefix);
+		}
+		for (int i = 0; i < exact_per_entity; i++)
+			fprintf(pf, ",=%s%d%c%c%c", prefix, rand() % 10, 'A' + rand() % 26, 'A' + rand() % 26, 'A' + rand() % 26);
+		fprintf(pf, ";\n");
+	}
+	fclose(pf);
+}
+
+// the prefixes and exact calls of the file, for the callsigns and the scan
+static void read_aliases(const char *path){
+	FILE *pf = fopen(path, "r");
+	char line[4096];
+	int cap = 1024;
+
+	aliases = malloc(cap * sizeof(*aliases));
+	while (fgets(line, sizeof(line), pf)){
+		// the header lines have the 8 fields, the alias lines are indented
+		if (line[0] != ' ' && line[0] != '\t')
+			continue;
+		for (char *alias = strtok(line, ", \t\r\n;"); alias; alias = strtok(NULL, ", \t\r\n;")){
+			char *end = strpbrk(alias, "([<{~");
+			if (end)
+				*end = 0;
+			if (n_aliases == cap){
+				cap *= 2;
+				aliases = realloc(aliases, cap * sizeof(*aliases));
+			}
+			snprintf(aliases[n_aliases++], sizeof(aliases[0]), "%s", alias);
+		}
+	}
+	fclose(pf);
+}
+
+// the longest prefix of call in aliases, or an exact call
+static int scan_lookup(const char *call){
+	int best = -1, best_len = 0;
+	for (int i = 0; i < n_aliases; i++){
+		const char *a = aliases[i];
+		if (a[0] == '='){
+			if (!strcmp(a + 1, call))
+				return i;
+			continue;
+		}
+		int len = strlen(a);
+		if (len > best_len && !strncmp(a, call, len)){
+			best = i;
+			best_len = len;
+		}
+	}
+	return best;
+}
+
+int main(int argc, char **argv){
+	const char *path = argc > 1 ? argv[1] : CTY_PATH;
+	double t;
+	long found = 0;
+
+	srand(1);
+	if (argc < 2)
+		write_cty(CTY_PATH);
+	t = now();
+	if (cty_load(path))
+		return 1;
+	printf("loaded in %.1f ms\n", (now() - t) * 1000);
+	read_aliases(path);
+
+	// calls with the prefixes of the file, a few of them the exact calls, and some /P and DL/
+	for (int i = 0; i < CORPUS; i++){
+		const char *a = aliases[rand() % n_aliases];
+		if (a[0] == '=')
+			snprintf(corpus[i], sizeof(corpus[i]), "%s", a + 1);
+		else
+			snprintf(corpus[i], sizeof(corpus[i]), "%s%d%c%c%s", a, rand() % 10,
+				'A' + rand() % 26, 'A' + rand() % 26, rand() % 20 ? "" : "/P");
+	}
+
+	t = now();
+	for (int i = 0; i < LOOKUPS; i++)
+		found += cty_lookup_uncached(corpus[i % CORPUS]) != NULL;
+	double uncached = (now() - t) / LOOKUPS;
+
+	t = now();
+	for (int i = 0; i < LOOKUPS; i++)
+		found += cty_lookup(corpus[rand() % HEARD]) != NULL;
+	double heard = (now() - t) / LOOKUPS;
+
+	t = now();
+	for (int i = 0; i < LOOKUPS; i++)
+		found += cty_lookup(corpus[rand() % CORPUS]) != NULL;
+	double stream = (now() - t) / LOOKUPS;
+
+	t = now();
+	for (int i = 0; i < SCANS; i++)
+		found += scan_lookup(corpus[i % CORPUS]) >= 0;
+	double scan = (now() - t) / SCANS;
+
+	int hits, misses;
+	cty_cache_stats(&hits, &misses);
+	printf("%d prefixes and exact calls, %d callsigns (%ld found)\n", n_aliases, CORPUS, found);
+	printf("per lookup: scan %.0f ns, trie %.0f ns, cached with %d stations heard %.0f ns,"
+		" cached with all %d %.0f ns (%d hits, %d misses)\n",
+		scan * 1e9, uncached * 1e9, HEARD, heard * 1e9, CORPUS, stream * 1e9, hits, misses);
+	if (argc < 2)
+		remove(CTY_PATH);
+	return 0;
+}
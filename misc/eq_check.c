@@ -0,0 +1,159 @@
+/*
+	The parametric EQ of src/para_eq.c against a double precision cascade of
+	the same peaking sections: whether the output depends on how the audio
+	is cut into blocks, the frequency response, the biggest step at a block
+	edge, and the time apply_eq() takes per block.
+
+	gcc -O3 -Isrc $(pkg-config --cflags glib-2.0) -o eq_check misc/eq_check.c src/para_eq.c -lm
+	./eq_check
+*/
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "para_eq.h"
+
+#define RATE 96000.0
+#define BLOCK 1024
+#define DELAY (NUM_BANDS - 1)   // apply_eq()'s pipeline delay
+#define RUNS 20000
+
+// para_eq.c's globals, which sbitx.c defines
+parametriceq eq;
+int eq_is_enabled, rx_eq_is_enabled;
+
+static const EQBand bands[NUM_BANDS] = {
+	{100, 6, 1}, {400, -6, 1}, {1000, 3, 0.5}, {2500, 8, 1}, {4000, -10, 2}
+};
+
+static double now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// an EQ with the bands above and nothing worked out yet
+static void eq_setup(parametriceq *e){
+	memset(e, 0, sizeof(*e));
+	memcpy(e->bands, bands, sizeof(bands));
+	atomic_store_explicit(&e->changes, 1, memory_order_release);
+}
+
+// x through apply_eq() in blocks of block samples
+static void eq_run(int32_t *x, int n, int block){
+	parametriceq e;
+	eq_setup(&e);
+	for (int i = 0; i < n; i += block)
+		apply_eq(&e, x + i, n - i < block ? n - i : block, RATE);
+}
+
+// the same peaking sections in double precision, one after another
+static void reference(double *x, int n){
+	for (int k = 0; k < NUM_BANDS; k++){
+		if (bands[k].gain == 0)
+			continue;
+		double A = pow(10, bands[k].gain / 40);
+		double w = 2 * M_PI * bands[k].frequency / RATE;
+		double alpha = sin(w) * sinh(log(2) / 2 * bands[k].bandwidth * w / sin(w));
+		double a0 = 1 + alpha / A;
+		double b0 = (1 + alpha * A) / a0, b1 = -2 * cos(w) / a0, b2 = (1 - alpha * A) / a0;
+		double a1 = -2 * cos(w) / a0, a2 = (1 - alpha / A) / a0;
+		double z1 = 0, z2 = 0;
+		for (int i = 0; i < n; i++){
+			double y = b0 * x[i] + z1;
+			z1 = b1 * x[i] - a1 * y + z2;
+			z2 = b2 * x[i] - a2 * y;
+			x[i] = y;
+		}
+	}
+}
+
+int main(int argc, char **argv){
+	const int n = (int)RATE;
+	int32_t *one = malloc(n * sizeof(int32_t)), *blocks = malloc(n * sizeof(int32_t));
+	int32_t *odd = malloc(n * sizeof(int32_t));
+	double *ref = malloc(n * sizeof(double));
+
+	// a second of white noise: in one pass, in blocks, and in blocks of an odd length
+	srand(1);
+	for (int i = 0; i < n; i++){
+		one[i] = blocks[i] = odd[i] = (rand() / (double)RAND_MAX - 0.5) * 2e8;
+		ref[i] = one[i];
+	}
+	eq_run(one, n, n);
+	eq_run(blocks, n, BLOCK);
+	eq_run(odd, n, 333);
+	int differ = 0;
+	for (int i = 0; i < n; i++)
+		differ += (one[i] != blocks[i]) + (one[i] != odd[i]);
+	printf("continuity: %d samples differ between one pass and blocks of %d and 333\n", differ, BLOCK);
+
+	reference(ref, n);
+	double error = 0, power = 0;
+	for (int i = 0; i < n - DELAY; i++){
+		double d = one[i + DELAY] - ref[i];
+		error += d * d;
+		power += ref[i] * ref[i];
+	}
+	printf("against the double cascade, %d samples late: error %.1f dB\n\n", DELAY, 10 * log10(error / power));
+
+	// the gain of a tone, over the second half of half a second of it
+	static const double freqs[] = {50, 100, 200, 400, 700, 1000, 1500, 2500, 4000, 6000, 10000};
+	printf("  f Hz    eq dB   ref dB\n");
+	for (int j = 0; j < (int)(sizeof(freqs) / sizeof(freqs[0])); j++){
+		const int m = n / 2;
+		for (int i = 0; i < m; i++){
+			one[i] = 1e8 * sin(2 * M_PI * freqs[j] * i / RATE);
+			ref[i] = one[i];
+		}
+		eq_run(one, m, BLOCK);
+		reference(ref, m);
+		double pe = 0, pr = 0, p0 = 1e16 / 2 * (m / 2);
+		for (int i = m / 2; i < m; i++){
+			pe += (double)one[i] * one[i];
+			pr += ref[i] * ref[i];
+		}
+		printf("%6.0f %8.2f %8.2f\n", freqs[j], 10 * log10(pe / p0), 10 * log10(pr / p0));
+	}
+
+	// a 1 kHz tone should step as much across a block edge as anywhere else
+	const int m = 4 * BLOCK;
+	for (int i = 0; i < m; i++)
+		one[i] = 1e8 * sin(2 * M_PI * 1000 * i / RATE);
+	eq_run(one, m, BLOCK);
+	double edge = 0, inside = 0;
+	for (int i = BLOCK + 1; i < m; i++){
+		double step = fabs((double)one[i] - one[i - 1]);
+		if (i % BLOCK == 0)
+			edge = fmax(edge, step);
+		else
+			inside = fmax(inside, step);
+	}
+	printf("\n1 kHz: biggest step %.4g at a block edge, %.4g elsewhere\n", edge, inside);
+
+	// the time per block, and with a band changed before every block; each
+	// run starts from the same noise, so that it neither dies away nor clips
+	parametriceq e;
+	eq_setup(&e);
+	double t = now();
+	for (int r = 0; r < RUNS; r++){
+		memcpy(one, blocks, BLOCK * sizeof(int32_t));
+		apply_eq(&e, one, BLOCK, RATE);
+	}
+	double steady = (now() - t) / RUNS;
+	t = now();
+	for (int r = 0; r < RUNS; r++){
+		memcpy(one, blocks, BLOCK * sizeof(int32_t));
+		atomic_fetch_add_explicit(&e.changes, 1, memory_order_release);
+		apply_eq(&e, one, BLOCK, RATE);
+	}
+	double changing = (now() - t) / RUNS;
+	printf("per %d-sample block: %.1f us, %.1f us with a band change every block\n",
+		BLOCK, steady * 1e6, changing * 1e6);
+	return 0;
+}
@@ -0,0 +1,513 @@
+/*
+	The logbook's queries against a synthetic log, before and after the
+	logbook model of src/logbook_model.c and the ADIF import.
+
+	Opening the window used to fetch the newest 10000 QSOs, every column,
+	and copy them into the list store (logbook_fill()); every key typed in
+	the search box did it again with callsign_recv LIKE 'query%'. The model
+	reads the ids and callsigns of all the QSOs once, filters them in
+	memory, and fetches the 64 rows of a page when the view shows them.
+	The time the list store took is not counted here, only sqlite's.
+
+	Then the same number of QSOs are imported from an ADIF file into a new
+	log on disk, parsed by src/adif.c: one INSERT statement at a time, each
+	its own transaction (the way logbook_add() writes a QSO), and bound
+	into a prepared insert, committed every IMPORT_BATCH rows, as
+	import_adif() does (without its duplicate check).
+
+	The searches compare LIKE '%query%' over the text columns with the
+	FTS5 word and trigram indexes that logbook_fts_open() creates, queried
+	as logbook_search_ids() does.
+
+	gcc -O2 -Isrc -o logbook_bench misc/logbook_bench.c src/adif.c -lsqlite3 -lm
+	./logbook_bench [qsos]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sqlite3.h>
+#include "adif.h"
+
+#define CALLS 20000
+#define PAGE_ROWS 64
+#define RUNS 20
+#define IMPORT_BATCH 10000
+#define EXEC_RECORDS 2000
+#define ADIF_PATH "/tmp/logbook_bench.adi"
+#define DB_PATH "/tmp/logbook_bench.db"
+
+struct key {
+	int id;
+	char call[16];
+};
+
+static char calls[CALLS][10];
+static const char *modes[] = {"FT8", "FT4", "CW", "USB", "LSB"};
+static const char *comments[] = {"", "", "", "nice signal", "POTA K-1234", "599 TU", "QSL via bureau"};
+#define N_MODES 5
+#define N_COMMENTS 7
+
+static double now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void random_call(char *call){
+	static const char *prefixes[] = {"K", "W", "N", "VE", "G", "DL", "F", "JA", "VK", "VU", "EA", "I"};
+	sprintf(call, "%s%d%c%c%c", prefixes[rand() % 12], rand() % 10,
+		'A' + rand() % 26, 'A' + rand() % 26, 'A' + rand() % 26);
+}
+
+// the schema of data/create_db.sql
+static void create_table(sqlite3 *db){
+	sqlite3_exec(db, "CREATE TABLE logbook (id INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL, mode TEXT, freq TEXT,"
+		" qso_date TEXT, qso_time TEXT, callsign_sent TEXT, rst_sent TEXT, exch_sent TEXT DEFAULT \"\","
+		" callsign_recv TEXT, rst_recv TEXT, exch_recv TEXT DEFAULT \"\", tx_id TEXT DEFAULT \"\","
+		" tx_power TEXT DEFAULT \"\", vswr TEXT DEFAULT \"\", xota TEXT DEFAULT \"\", xota_loc TEXT DEFAULT \"\","
+		" comments TEXT DEFAULT \"\");"
+		"CREATE INDEX callIx ON logbook(callsign_recv);"
+		"CREATE INDEX gridIx ON logbook(exch_recv);", NULL, NULL, NULL);
+}
+
+static void create_log(sqlite3 *db, int qsos){
+	sqlite3_stmt *insert;
+	time_t start = 1600000000;
+
+	create_table(db);
+	sqlite3_prepare_v2(db, "INSERT INTO logbook (mode, freq, qso_date, qso_time, callsign_sent, rst_sent,"
+		" exch_sent, callsign_recv, rst_recv, exch_recv, tx_power, vswr, comments)"
+		" VALUES (?, '14074000', ?, ?, 'N0CALL', '-10', 'FN31', ?, '-12', ?, '40', '1.2', ?);", -1, &insert, NULL);
+	sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+	for (int i = 0; i < qsos; i++){
+		time_t when = start + i * 600L;
+		struct tm *tm = gmtime(&when);
+		char date_str[20], time_str[10], grid[8];
+		int c = rand() % CALLS;
+
+		strftime(date_str, sizeof(date_str), "%Y-%m-%d", tm);
+		strftime(time_str, sizeof(time_str), "%H%M", tm);
+		sprintf(grid, "%c%c%d%d", 'A' + c % 18, 'A' + c / 18 % 18, c % 10, c / 10 % 10);
+		sqlite3_bind_text(insert, 1, modes[rand() % N_MODES], -1, SQLITE_STATIC);
+		sqlite3_bind_text(insert, 2, date_str, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(insert, 3, time_str, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(insert, 4, calls[c], -1, SQLITE_STATIC);
+		sqlite3_bind_text(insert, 5, grid, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(insert, 6, comments[rand() % N_COMMENTS], -1, SQLITE_STATIC);
+		sqlite3_step(insert);
+		sqlite3_reset(insert);
+	}
+	sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+	sqlite3_finalize(insert);
+}
+
+// what logbook_fill(0, 10000, query) asked sqlite for, and copied out of it
+static int old_fill(sqlite3 *db, const char *query){
+	char statement[200], cell[16][1000];
+	sqlite3_stmt *stmt;
+	int rows = 0;
+
+	if (query)
+		snprintf(statement, sizeof(statement), "select * from logbook "
+			"where callsign_recv LIKE '%s%%' ORDER BY id DESC LIMIT 10000;", query);
+	else
+		strcpy(statement, "select * from logbook ORDER BY id DESC LIMIT 10000;");
+	sqlite3_prepare_v2(db, statement, -1, &stmt, NULL);
+	while (sqlite3_step(stmt) == SQLITE_ROW){
+		int num_cols = sqlite3_column_count(stmt);
+		for (int i = 0; i < num_cols && i < 16; i++){
+			const char *text = (const char *)sqlite3_column_text(stmt, i);
+			strcpy(cell[i], text ? text : "");
+		}
+		rows++;
+	}
+	sqlite3_finalize(stmt);
+	return rows;
+}
+
+// logbook_model_reload(): the ids and callsigns of all the QSOs
+static int model_keys(sqlite3 *db, struct key *keys){
+	sqlite3_stmt *stmt;
+	int n = 0;
+
+	sqlite3_prepare_v2(db, "SELECT id, callsign_recv FROM logbook ORDER BY id DESC", -1, &stmt, NULL);
+	while (sqlite3_step(stmt) == SQLITE_ROW){
+		const char *call = (const char *)sqlite3_column_text(stmt, 1);
+		keys[n].id = sqlite3_column_int(stmt, 0);
+		snprintf(keys[n].call, sizeof(keys[n].call), "%s", call ? call : "");
+		n++;
+	}
+	sqlite3_finalize(stmt);
+	return n;
+}
+
+// apply_filter(): the visible rows, from the keys
+static int model_filter(const struct key *keys, int n_keys, int *visible, const char *filter){
+	int n = 0;
+	size_t len = filter ? strlen(filter) : 0;
+
+	for (int i = 0; i < n_keys; i++)
+		if (!len || !strncasecmp(keys[i].call, filter, len))
+			visible[n++] = i;
+	return n;
+}
+
+// page_fetch(): the cells of PAGE_ROWS visible rows
+static int model_page(sqlite3_stmt *page, const struct key *keys, const int *visible, int n_visible){
+	char cell[14][1000];
+	int rows = 0;
+
+	for (int r = 0; r < PAGE_ROWS; r++)
+		sqlite3_bind_int(page, r + 1, r < n_visible ? keys[visible[r]].id : -1);
+	while (sqlite3_step(page) == SQLITE_ROW){
+		for (int i = 0; i < 14; i++){
+			const char *text = (const char *)sqlite3_column_text(page, i);
+			strcpy(cell[i], text ? text : "");
+		}
+		rows++;
+	}
+	sqlite3_reset(page);
+	return rows;
+}
+
+// an ADIF file of n FT8 and CW QSOs, as another logger would write it
+static void write_adif(const char *path, int n){
+	FILE *pf = fopen(path, "w");
+	time_t start = 1500000000;
+
+	fprintf(pf, "generated by logbook_bench\n<ADIF_VER:5>3.1.4 <EOH>\n");
+	for (int i = 0; i < n; i++){
+		time_t when = start + i * 300L;
+		struct tm *tm = gmtime(&when);
+		char date_str[10], time_str[8], grid[8];
+		const char *call = calls[rand() % CALLS];
+		const char *comment = comments[rand() % N_COMMENTS];
+		int cw = rand() % 4 == 0;
+
+		strftime(date_str, sizeof(date_str), "%Y%m%d", tm);
+		strftime(time_str, sizeof(time_str), "%H%M%S", tm);
+		sprintf(grid, "%c%c%d%d", 'A' + rand() % 18, 'A' + rand() % 18, rand() % 10, rand() % 10);
+		fprintf(pf, "<CALL:%d>%s <QSO_DATE:8>%s <TIME_ON:6>%s <BAND:3>20m <FREQ:9>%s <MODE:%d>%s ",
+			(int)strlen(call), call, date_str, time_str, cw ? "14.025000" : "14.074000",
+			cw ? 2 : 3, cw ? "CW" : "FT8");
+		fprintf(pf, "<RST_SENT:3>%s <RST_RCVD:3>%s <STATION_CALLSIGN:6>N0CALL ",
+			cw ? "599" : "-10", cw ? "579" : "-15");
+		if (!cw)
+			fprintf(pf, "<GRIDSQUARE:4>%s <MY_GRIDSQUARE:4>FN31 ", grid);
+		if (comment[0])
+			fprintf(pf, "<COMMENT:%d>%s ", (int)strlen(comment), comment);
+		fprintf(pf, "<EOR>\n");
+	}
+	fclose(pf);
+}
+
+struct import {
+	sqlite3 *db;
+	sqlite3_stmt *insert;
+	int imported, in_batch, limit;
+};
+
+static const char *field(const adif_record *rec, const char *name, char *buf, int len){
+	int value_len = 0;
+	const char *value = adif_get(rec, name, &value_len);
+	if (value_len >= len)
+		value_len = len - 1;
+	memcpy(buf, value ? value : "", value_len);
+	buf[value_len] = 0;
+	return buf;
+}
+
+// one INSERT statement per QSO, in its own transaction, as logbook_add() writes them
+static int import_exec(const adif_record *rec, void *user){
+	struct import *imp = user;
+	char statement[1000], call[20], date[12], time[8], freq[16], mode[10], rst_sent[8], rst_recv[8],
+		grid[8], my_grid[8], comment[100];
+	const char *d = field(rec, "QSO_DATE", date, sizeof(date));
+
+	field(rec, "FREQ", freq, sizeof(freq));
+	snprintf(statement, sizeof(statement), "INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent,"
+		" rst_sent, exch_sent, callsign_recv, rst_recv, exch_recv, comments)"
+		" VALUES('%ld', '%s', '%.4s-%.2s-%.2s', '%.4s', 'N0CALL', '%s', '%s', '%s', '%s', '%s', '%s');",
+		lround(atof(freq) * 1000000.0), field(rec, "MODE", mode, sizeof(mode)), d, d + 4, d + 6,
+		field(rec, "TIME_ON", time, sizeof(time)), field(rec, "RST_SENT", rst_sent, sizeof(rst_sent)),
+		field(rec, "MY_GRIDSQUARE", my_grid, sizeof(my_grid)), field(rec, "CALL", call, sizeof(call)),
+		field(rec, "RST_RCVD", rst_recv, sizeof(rst_recv)), field(rec, "GRIDSQUARE", grid, sizeof(grid)),
+		field(rec, "COMMENT", comment, sizeof(comment)));
+	sqlite3_exec(imp->db, statement, NULL, NULL, NULL);
+	return ++imp->imported == imp->limit;
+}
+
+static void bind(sqlite3_stmt *stmt, int col, const adif_record *rec, const char *name){
+	int len = 0;
+	const char *value = adif_get(rec, name, &len);
+	sqlite3_bind_text(stmt, col, value ? value : "", len, SQLITE_STATIC);
+}
+
+// import_record(): the values bound from the file into one prepared insert, IMPORT_BATCH rows a transaction
+static int import_prepared(const adif_record *rec, void *user){
+	struct import *imp = user;
+	char date[11], time[5], freq[16], mhz[20];
+	int len;
+	const char *value = adif_get(rec, "QSO_DATE", &len);
+
+	snprintf(date, sizeof(date), "%.4s-%.2s-%.2s", value, value + 4, value + 6);
+	snprintf(time, sizeof(time), "%.4s", adif_get(rec, "TIME_ON", &len));
+	snprintf(freq, sizeof(freq), "%ld", lround(atof(field(rec, "FREQ", mhz, sizeof(mhz))) * 1000000.0));
+	sqlite3_bind_text(imp->insert, 1, freq, -1, SQLITE_TRANSIENT);
+	bind(imp->insert, 2, rec, "MODE");
+	sqlite3_bind_text(imp->insert, 3, date, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(imp->insert, 4, time, -1, SQLITE_TRANSIENT);
+	bind(imp->insert, 5, rec, "STATION_CALLSIGN");
+	bind(imp->insert, 6, rec, "RST_SENT");
+	bind(imp->insert, 7, rec, "MY_GRIDSQUARE");
+	bind(imp->insert, 8, rec, "CALL");
+	bind(imp->insert, 9, rec, "RST_RCVD");
+	bind(imp->insert, 10, rec, "GRIDSQUARE");
+	bind(imp->insert, 11, rec, "COMMENT");
+	sqlite3_step(imp->insert);
+	sqlite3_reset(imp->insert);
+	imp->imported++;
+	if (++imp->in_batch == IMPORT_BATCH){
+		sqlite3_exec(imp->db, "COMMIT; BEGIN;", NULL, NULL, NULL);
+		imp->in_batch = 0;
+	}
+	return 0;
+}
+
+// import \a path into a new log at \a db_path; returns the records per second
+static double import(const char *path, const char *db_path, bool prepared, int limit){
+	struct import imp;
+	double t;
+
+	memset(&imp, 0, sizeof(imp));
+	imp.limit = limit;
+	unlink(db_path);
+	sqlite3_open(db_path, &imp.db);
+	create_table(imp.db);
+	t = now();
+	if (prepared){
+		sqlite3_prepare_v2(imp.db, "INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent, rst_sent,"
+			" exch_sent, callsign_recv, rst_recv, exch_recv, comments) VALUES (?,?,?,?,?,?,?,?,?,?,?);",
+			-1, &imp.insert, NULL);
+		sqlite3_exec(imp.db, "BEGIN;", NULL, NULL, NULL);
+		adif_parse_file(path, import_prepared, NULL, &imp);
+		sqlite3_exec(imp.db, "COMMIT;", NULL, NULL, NULL);
+		sqlite3_finalize(imp.insert);
+	} else
+		adif_parse_file(path, import_exec, NULL, &imp);
+	t = now() - t;
+	sqlite3_close(imp.db);
+	unlink(db_path);
+	return imp.imported / t;
+}
+
+// callsign_trigrams() and callsign_similarity() of src/logbook.c
+static int callsign_trigrams(const char *call, char trigrams[][3], int max){
+	char padded[24];
+	int n = 0;
+
+	snprintf(padded, sizeof(padded), "  %.20s ", call);
+	for (int i = 0; padded[i + 2] && n < max; i++){
+		char t[3] = {toupper(padded[i]), toupper(padded[i + 1]), toupper(padded[i + 2])};
+		int j;
+		for (j = 0; j < n && memcmp(trigrams[j], t, 3); j++)
+			;
+		if (j == n)
+			memcpy(trigrams[n++], t, 3);
+	}
+	return n;
+}
+
+static void callsign_similarity(sqlite3_context *context, int argc, sqlite3_value **argv){
+	char a[24][3], b[24][3];
+	const char *call_a = (const char *)sqlite3_value_text(argv[0]);
+	const char *call_b = (const char *)sqlite3_value_text(argv[1]);
+
+	(void)argc;
+	if (!call_a || !call_b){
+		sqlite3_result_double(context, 0);
+		return;
+	}
+	int n_a = callsign_trigrams(call_a, a, 24);
+	int n_b = callsign_trigrams(call_b, b, 24);
+	int common = 0;
+	for (int i = 0; i < n_a; i++)
+		for (int j = 0; j < n_b; j++)
+			if (!memcmp(a[i], b[j], 3)){
+				common++;
+				break;
+			}
+	sqlite3_result_double(context, n_a + n_b ? 2.0 * common / (n_a + n_b) : 0);
+}
+
+// the FTS5 query of logbook_search_parse() for the trigrams of a single word
+static void trigram_query(const char *call, char *buf, int len){
+	char trigrams[24][3];
+	int n_trigrams = callsign_trigrams(call, trigrams, 24);
+	int n_inner = 0, n = 0;
+
+	buf[0] = 0;
+	for (int i = 0; i < n_trigrams; i++)
+		if (!memchr(trigrams[i], ' ', 3))
+			memcpy(trigrams[n_inner++], trigrams[i], 3);
+	for (int i = 0; i < n_inner; i++){
+		if (n_inner < 4)
+			n += snprintf(buf + n, len - n, "%s\"%.3s\"", n ? " OR " : "", trigrams[i]);
+		else
+			for (int j = i + 1; j < n_inner; j++)
+				n += snprintf(buf + n, len - n, "%s(\"%.3s\" \"%.3s\")", n ? " OR " : "", trigrams[i], trigrams[j]);
+	}
+}
+
+// the search indexes and triggers of logbook_fts_open()
+static void create_fts(sqlite3 *db){
+	sqlite3_create_function(db, "callsign_similarity", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+		NULL, callsign_similarity, NULL, NULL);
+	sqlite3_exec(db, "BEGIN;"
+		"CREATE VIRTUAL TABLE logbook_fts USING fts5(callsign_recv, exch_sent, exch_recv, comments, xota_loc,"
+		" content='logbook', content_rowid='id');"
+		"CREATE VIRTUAL TABLE logbook_calls USING fts5(callsign_recv, content='logbook', content_rowid='id',"
+		" tokenize='trigram');"
+		"INSERT INTO logbook_fts(logbook_fts) VALUES ('rebuild');"
+		"INSERT INTO logbook_calls(logbook_calls) VALUES ('rebuild');"
+		"COMMIT;", NULL, NULL, NULL);
+}
+
+static int count_rows(sqlite3_stmt *stmt){
+	int n = 0;
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+		n++;
+	sqlite3_reset(stmt);
+	return n;
+}
+
+// what the search box found before: the query anywhere in the text columns
+static int search_like(sqlite3 *db, const char *query){
+	char pattern[40];
+	sqlite3_stmt *stmt;
+
+	snprintf(pattern, sizeof(pattern), "%%%s%%", query);
+	sqlite3_prepare_v2(db, "SELECT id FROM logbook WHERE callsign_recv LIKE ?1 OR exch_sent LIKE ?1"
+		" OR exch_recv LIKE ?1 OR comments LIKE ?1 OR xota_loc LIKE ?1", -1, &stmt, NULL);
+	sqlite3_bind_text(stmt, 1, pattern, -1, SQLITE_STATIC);
+	int n = count_rows(stmt);
+	sqlite3_finalize(stmt);
+	return n;
+}
+
+// logbook_search_ids() for a single word: the word as a prefix, and similar callsigns
+static int search_fts(sqlite3 *db, const char *query){
+	char words[100], trigrams[1300];
+	sqlite3_stmt *stmt;
+
+	snprintf(words, sizeof(words), "\"%s\"*", query);
+	trigram_query(query, trigrams, sizeof(trigrams));
+	sqlite3_prepare_v2(db, "SELECT id FROM logbook WHERE id IN ("
+		"SELECT rowid FROM logbook_fts WHERE logbook_fts MATCH ?1 UNION "
+		"SELECT rowid FROM logbook_calls WHERE logbook_calls MATCH ?2"
+		" AND callsign_similarity(callsign_recv, ?3) >= 0.6)", -1, &stmt, NULL);
+	sqlite3_bind_text(stmt, 1, words, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, trigrams, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, query, -1, SQLITE_STATIC);
+	int n = count_rows(stmt);
+	sqlite3_finalize(stmt);
+	return n;
+}
+
+int main(int argc, char **argv){
+	int qsos = argc > 1 ? atoi(argv[1]) : 100000;
+	static const char *typed[] = {"K", "K1", "K1A", "K1AB"};
+	char page_sql[1000];
+	sqlite3 *db;
+	sqlite3_stmt *page;
+	double t;
+	int rows = 0;
+
+	srand(1);
+	for (int i = 0; i < CALLS; i++)
+		random_call(calls[i]);
+	sqlite3_open(":memory:", &db);
+	create_log(db, qsos);
+
+	strcpy(page_sql, "SELECT id, qso_date || ' ' || qso_time, freq, mode, callsign_recv, rst_sent, exch_sent,"
+		" rst_recv, exch_recv, tx_power, vswr, xota, xota_loc, comments FROM logbook WHERE id IN (");
+	for (int r = 0; r < PAGE_ROWS; r++)
+		strcat(page_sql, r ? ",?" : "?");
+	strcat(page_sql, ");");
+	sqlite3_prepare_v2(db, page_sql, -1, &page, NULL);
+	struct key *keys = malloc(qsos * sizeof(struct key));
+	int *visible = malloc(qsos * sizeof(int));
+
+	printf("%d QSOs\n", qsos);
+	t = now();
+	for (int r = 0; r < RUNS; r++)
+		rows = old_fill(db, NULL);
+	double old_open = (now() - t) / RUNS;
+	t = now();
+	int n_keys = 0, n_visible = 0;
+	for (int r = 0; r < RUNS; r++){
+		n_keys = model_keys(db, keys);
+		n_visible = model_filter(keys, n_keys, visible, NULL);
+		model_page(page, keys, visible, n_visible);
+	}
+	double model_open = (now() - t) / RUNS;
+	printf("open the logbook: fill %.1f ms (%d rows), model %.1f ms (%d keys and a page)\n",
+		old_open * 1000, rows, model_open * 1000, n_keys);
+
+	// typing K1AB into the search box, one key at a time
+	double old_typed = 0, model_typed = 0;
+	for (int r = 0; r < RUNS; r++){
+		for (int k = 0; k < 4; k++){
+			t = now();
+			old_fill(db, typed[k]);
+			old_typed += now() - t;
+			t = now();
+			n_visible = model_filter(keys, n_keys, visible, typed[k]);
+			model_page(page, keys, visible, n_visible);
+			model_typed += now() - t;
+		}
+	}
+	printf("per key typed in the search box: fill %.2f ms, model %.2f ms\n",
+		old_typed / (RUNS * 4) * 1000, model_typed / (RUNS * 4) * 1000);
+
+	free(keys);
+	free(visible);
+	sqlite3_finalize(page);
+
+	// searches: a call, a grid, a word of a comment, a reference, a call with one character wrong
+	char wrong[10];
+	strcpy(wrong, calls[5]);
+	wrong[strlen(wrong) - 1] = wrong[strlen(wrong) - 1] == 'Z' ? 'A' : wrong[strlen(wrong) - 1] + 1;
+	const char *searches[] = {calls[7], "HA70", "signal", "K-1234", wrong};
+	t = now();
+	create_fts(db);
+	printf("search indexes built in %.0f ms\n", (now() - t) * 1000);
+	for (int i = 0; i < 5; i++){
+		int like_rows = 0, fts_rows = 0;
+		t = now();
+		for (int r = 0; r < RUNS; r++)
+			like_rows = search_like(db, searches[i]);
+		double like = (now() - t) / RUNS;
+		t = now();
+		for (int r = 0; r < RUNS; r++)
+			fts_rows = search_fts(db, searches[i]);
+		double fts = (now() - t) / RUNS;
+		printf("search %-8s LIKE %6.2f ms (%d rows), FTS5 %6.2f ms (%d rows)\n",
+			searches[i], like * 1000, like_rows, fts * 1000, fts_rows);
+	}
+	sqlite3_close(db);
+
+	// importing an ADIF file into a log on disk
+	write_adif(ADIF_PATH, qsos);
+	printf("import: %.0f records/s one insert at a time (the first %d), %.0f records/s prepared and batched\n",
+		import(ADIF_PATH, DB_PATH, false, EXEC_RECORDS), EXEC_RECORDS, import(ADIF_PATH, DB_PATH, true, 0));
+	unlink(ADIF_PATH);
+	return 0;
+}
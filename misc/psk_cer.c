@@ -0,0 +1,165 @@
+/*
+	PSK31 and PSK63 character error rate against SNR: a text goes through the
+	modem's own transmitter, white noise is added, and what the receiver
+	prints at the pitch is compared with it. The SNR is in 3 kHz, as fldigi
+	and WSJT-X give it.
+
+	gcc -O2 -Isrc -o psk_cer misc/psk_cer.c src/modem_psk.c src/modem_bank.c -lfftw3f -lm
+	./psk_cer [baud [offset in Hz from the pitch]]
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdr.h"
+#include "sdr_ui.h"
+#include "modem_psk.h"
+
+#define RATE 96000
+#define PITCH 1000
+#define MAX_SECS 120
+
+static const char *text =
+	"CQ CQ CQ DE N0CALL N0CALL PSE K the quick brown fox jumps over the lazy dog 0123456789 ";
+
+// sbitx_gtk.c's side of the modem: the settings, the text to send, and
+// the console, of which only what the receiver prints is kept
+static char rx_text[4096];
+static int rx_len;
+static int baud = 31;
+static int pitch = PITCH;
+static const char *tx_text;
+static int tx_pos;
+static int tx_done;
+
+void write_console(sbitx_style style, const char *s){
+	int n = strlen(s);
+	if (style != STYLE_FLDIGI_RX || rx_len + n >= (int)sizeof(rx_text))
+		return;
+	memcpy(rx_text + rx_len, s, n + 1);
+	rx_len += n;
+}
+
+const char *field_str(const char *label){
+	return "OFF";
+}
+
+int field_int(char *label){
+	return !strcmp(label, "PSK") ? baud : 0;
+}
+
+int get_pitch(){
+	return pitch;
+}
+
+int get_tx_data_byte(char *c){
+	if (!tx_text[tx_pos])
+		return 0;
+	*c = tx_text[tx_pos++];
+	return 1;
+}
+
+void tx_off(){
+	tx_done = 1;
+}
+
+// a sample of white gaussian noise, of unit variance
+static double gauss(){
+	double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+	return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+// the edit distance between a and b
+static int distance(const char *a, const char *b){
+	int n = strlen(a), m = strlen(b);
+	int *d = malloc((m + 1) * sizeof(int));
+	for (int j = 0; j <= m; j++)
+		d[j] = j;
+	for (int i = 1; i <= n; i++){
+		int diag = d[0];
+		d[0] = i;
+		for (int j = 1; j <= m; j++){
+			int up = d[j];
+			int c = diag + (a[i - 1] != b[j - 1]);
+			if (up + 1 < c)
+				c = up + 1;
+			if (d[j - 1] + 1 < c)
+				c = d[j - 1] + 1;
+			d[j] = c;
+			diag = up;
+		}
+	}
+	int r = d[m];
+	free(d);
+	return r;
+}
+
+// the transmitted text at the pitch plus offset_hz, rendered once per baud rate
+static float signal[RATE * MAX_SECS];
+static int signal_len;
+
+static void transmit(float offset_hz){
+	static char macro[256];
+	snprintf(macro, sizeof(macro), "%s^r", text);
+	tx_text = macro;
+	tx_pos = 0;
+	tx_done = 0;
+	pitch = PITCH + offset_hz;
+	psk_init();
+	psk_poll(strlen(macro), 1);
+	signal_len = 0;
+	while (!tx_done && signal_len < RATE * MAX_SECS){
+		for (int i = 0; i < RATE / 10 && signal_len < RATE * MAX_SECS; i++)
+			signal[signal_len++] = psk_tx_get_sample();
+		psk_poll(strlen(tx_text + tx_pos), 1);
+	}
+	pitch = PITCH;
+}
+
+// the characters received wrong, with the signal snr_db above the noise in 3 kHz
+static int receive(double snr_db){
+	// the carrier's power, and noise of that power over 3 kHz of the 48
+	const double power = (1.0 / 8) * (1.0 / 8) / 2;
+	const double sigma = sqrt(power / pow(10, snr_db / 10) * (RATE / 2) / 3000);
+	int32_t block[1024];
+
+	rx_len = 0;
+	rx_text[0] = 0;
+	psk_init();
+	psk_poll(0, 0);
+	// a second of noise after the signal, for the receiver to flush
+	for (int i = 0; i < signal_len + RATE; i += 1024){
+		for (int j = 0; j < 1024; j++){
+			double s = (i + j < signal_len ? signal[i + j] : 0) + sigma * gauss();
+			block[j] = s * 2e8;
+		}
+		psk_rx(block, 1024);
+	}
+	return distance(text, rx_text);
+}
+
+int main(int argc, char **argv){
+	float offset_hz = 0;
+	if (argc > 1)
+		baud = atoi(argv[1]) == 63 ? 63 : 31;
+	if (argc > 2)
+		offset_hz = atof(argv[2]);
+
+	srand(1);
+	transmit(offset_hz);
+	printf("PSK%d, %+.0f Hz from the pitch, %d characters\n", baud, offset_hz, (int)strlen(text));
+	printf("SNR dB   CER\n");
+	for (int snr = 10; snr >= -14; snr -= 2){
+		int errors = receive(snr);
+		printf("%+5d %6.1f%%\n", snr, 100.0 * errors / strlen(text));
+	}
+
+	char report[2000];
+	psk_report(report, sizeof(report));
+	printf("%s", report);
+	return 0;
+}
@@ -0,0 +1,166 @@
+/*
+	Per-decode cost of the logbook lookups, from sqlite as logbook.c did
+	them before the QSO index and from src/qso_index.c.
+
+	A synthetic log of QSOS contacts with CALLS stations is put in an
+	in-memory sqlite database (with the callIx and gridIx indexes that
+	logbook_open() creates) and in the index. Every decode then looks up
+	the last QSO with a callsign and with a grid, as sbitx_ft8_decode()
+	does, and a contest dupe check counts the QSOs in the last minute.
+	Half the callsigns looked up are in the log.
+
+	gcc -O2 -Isrc -o qso_index_bench misc/qso_index_bench.c src/qso_index.c -lsqlite3 -pthread
+	./qso_index_bench [qsos]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sqlite3.h>
+#include "qso_index.h"
+
+#define CALLS 20000
+#define DECODES 200000
+
+static char calls[CALLS][10];
+static char grids[CALLS][6];
+
+static double now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void random_call(char *call){
+	static const char *prefixes[] = {"K", "W", "N", "VE", "G", "DL", "F", "JA", "VK", "VU", "EA", "I"};
+	sprintf(call, "%s%d%c%c%c", prefixes[rand() % 12], rand() % 10,
+		'A' + rand() % 26, 'A' + rand() % 26, 'A' + rand() % 26);
+}
+
+// the statements logbook_last_qso(), logbook_grid_last_qso() and
+// logbook_count_dup() ran for every lookup
+static const char *last_sql =
+	"SELECT unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) FROM logbook WHERE callsign_recv=?"
+	" ORDER BY unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) DESC";
+static const char *grid_sql =
+	"SELECT unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) FROM logbook WHERE exch_recv=?"
+	" ORDER BY unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) DESC";
+
+static time_t sql_time(sqlite3_stmt *stmt, const char *key){
+	time_t ret = 0;
+	sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+		ret = sqlite3_column_int64(stmt, 0);
+	sqlite3_reset(stmt);
+	return ret;
+}
+
+static int sql_dupes(sqlite3 *db, const char *call, time_t since){
+	char statement[1000], date_str[20], time_str[10];
+	sqlite3_stmt *stmt;
+	struct tm *tmp = gmtime(&since);
+	int rec = 0;
+
+	strftime(date_str, sizeof(date_str), "%Y-%m-%d", tmp);
+	strftime(time_str, sizeof(time_str), "%H%M", tmp);
+	snprintf(statement, sizeof(statement), "select * from logbook where "
+		"callsign_recv=\"%s\" AND qso_date >= \"%s\" AND qso_time >= \"%s\"", call, date_str, time_str);
+	sqlite3_prepare_v2(db, statement, -1, &stmt, NULL);
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+		rec++;
+	sqlite3_finalize(stmt);
+	return rec;
+}
+
+int main(int argc, char **argv){
+	int qsos = argc > 1 ? atoi(argv[1]) : 100000;
+	sqlite3 *db;
+	sqlite3_stmt *insert, *last_stmt, *grid_stmt;
+	time_t start = 1600000000;
+
+	srand(1);
+	for (int i = 0; i < CALLS; i++){
+		random_call(calls[i]);
+		sprintf(grids[i], "%c%c%d%d", 'A' + rand() % 18, 'A' + rand() % 18, rand() % 10, rand() % 10);
+	}
+
+	sqlite3_open(":memory:", &db);
+	sqlite3_exec(db, "CREATE TABLE logbook (id INTEGER PRIMARY KEY, freq TEXT, mode TEXT, qso_date TEXT, "
+		"qso_time TEXT, callsign_recv TEXT, exch_recv TEXT);"
+		"CREATE INDEX gridIx ON logbook (exch_recv);"
+		"CREATE INDEX callIx ON logbook (callsign_recv);", NULL, NULL, NULL);
+	sqlite3_prepare_v2(db, "INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_recv, exch_recv) "
+		"VALUES ('14074000', 'FT8', ?, ?, ?, ?);", -1, &insert, NULL);
+
+	double t = now();
+	sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+	for (int i = 0; i < qsos; i++){
+		time_t when = start + i * 600L;
+		struct tm *tm = gmtime(&when);
+		char date_str[20], time_str[10];
+		int c = rand() % CALLS;
+
+		strftime(date_str, sizeof(date_str), "%Y-%m-%d", tm);
+		strftime(time_str, sizeof(time_str), "%H%M", tm);
+		sqlite3_bind_text(insert, 1, date_str, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(insert, 2, time_str, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(insert, 3, calls[c], -1, SQLITE_STATIC);
+		sqlite3_bind_text(insert, 4, grids[c], -1, SQLITE_STATIC);
+		sqlite3_step(insert);
+		sqlite3_reset(insert);
+		qso_index_add(calls[c], grids[c], 5, "FT8", when / 60 * 60, NULL);
+	}
+	sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+	qso_index_set_ready(true);
+	int n_calls, n_grids, n_qsos;
+	qso_index_stats(&n_calls, &n_grids, &n_qsos);
+	printf("%d QSOs, %d calls, %d grids, logged in %.0f ms\n", n_qsos, n_calls, n_grids, (now() - t) * 1000);
+
+	sqlite3_prepare_v2(db, last_sql, -1, &last_stmt, NULL);
+	sqlite3_prepare_v2(db, grid_sql, -1, &grid_stmt, NULL);
+
+	// the decodes: every other one from a station in the log
+	static char heard[DECODES][10];
+	static int heard_grid[DECODES];
+	for (int i = 0; i < DECODES; i++){
+		heard_grid[i] = rand() % CALLS;
+		if (i & 1)
+			strcpy(heard[i], calls[rand() % CALLS]);
+		else
+			random_call(heard[i]);
+	}
+
+	time_t end = start + qsos * 600L;
+	long check = 0;
+	t = now();
+	for (int i = 0; i < DECODES; i++)
+		check += sql_time(last_stmt, heard[i]) + sql_time(grid_stmt, grids[heard_grid[i]]);
+	double sql_decode = (now() - t) / DECODES;
+	t = now();
+	for (int i = 0; i < DECODES; i++)
+		check -= qso_index_last_qso(heard[i], -1) + qso_index_grid_last_qso(grids[heard_grid[i]], -1);
+	double index_decode = (now() - t) / DECODES;
+
+	int dupes = DECODES / 20;
+	t = now();
+	for (int i = 0; i < dupes; i++)
+		check += sql_dupes(db, heard[i], end - 60);
+	double sql_dupe = (now() - t) / dupes;
+	t = now();
+	for (int i = 0; i < dupes; i++)
+		check -= qso_index_count_since(heard[i], end - 60);
+	double index_dupe = (now() - t) / dupes;
+
+	printf("per decode (last QSO with the call and with the grid): sqlite %.2f us, index %.2f us\n",
+		sql_decode * 1e6, index_decode * 1e6);
+	printf("per dupe check: sqlite %.2f us, index %.2f us\n", sql_dupe * 1e6, index_dupe * 1e6);
+	if (check)
+		printf("the index and sqlite disagree\n");
+
+	sqlite3_finalize(insert);
+	sqlite3_finalize(last_stmt);
+	sqlite3_finalize(grid_stmt);
+	sqlite3_close(db);
+	return 0;
+}
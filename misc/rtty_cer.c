@@ -0,0 +1,255 @@
+/*
+	RTTY character error rate against SNR, and the CPU time per channel of
+	the skimmer: Baudot text is keyed as continuous phase FSK at 96 kHz,
+	white noise is added, and src/modem_rtty.c receives it. The SNR is in
+	3 kHz, as fldigi gives it. Each rate is the average over both
+	polarities.
+
+	gcc -O2 -Isrc -o rtty_cer misc/rtty_cer.c src/modem_rtty.c src/modem_bank.c -lfftw3f -lm
+	./rtty_cer
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdr.h"
+#include "sdr_ui.h"
+#include "modem_rtty.h"
+
+#define RATE 96000
+#define PITCH 1000
+#define MAX_SECS 60
+#define SIGNALS 8
+
+static const char *text =
+	"CQ CQ CQ DE N0CALL N0CALL PSE K THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 ";
+
+// the settings, and the console of sbitx_gtk.c; only what the receiver
+// prints is kept
+static char rx_text[8192];
+static int rx_len;
+static int baud = 45;
+static const char *skim = "OFF";
+
+void write_console(sbitx_style style, const char *s){
+	int n = strlen(s);
+	if (style != STYLE_FLDIGI_RX || rx_len + n >= (int)sizeof(rx_text))
+		return;
+	memcpy(rx_text + rx_len, s, n + 1);
+	rx_len += n;
+}
+
+const char *field_str(const char *label){
+	return !strcmp(label, "RTTY_SKIM") ? skim : "";
+}
+
+int field_int(char *label){
+	return !strcmp(label, "RTTY") ? baud : 0;
+}
+
+int get_pitch(){
+	return PITCH;
+}
+
+// ITA2, with the US figures; 27 is FIGS and 31 is LTRS
+static const char letters[32] = {
+	0, 'E', '\n', 'A', ' ', 'S', 'I', 'U', '\r', 'D', 'R', 'J', 'N', 'F', 'C', 'K',
+	'T', 'Z', 'L', 'W', 'H', 'Y', 'P', 'Q', 'O', 'B', 'G', 0, 'M', 'X', 'V', 0
+};
+static const char figures[32] = {
+	0, '3', '\n', '-', ' ', '\a', '8', '7', '\r', '$', '4', '\'', ',', '!', ':', '(',
+	'5', '"', ')', '2', '#', '6', '0', '1', '9', '?', '&', 0, '.', '/', ';', 0
+};
+
+// a transmitter: the bits of the text in half bits, 1 for mark
+struct fsk {
+	unsigned char half[40000];
+	int n;
+	double phase;
+};
+
+static void fsk_bits(struct fsk *f, int bit, int halves){
+	for (int i = 0; i < halves && f->n < (int)sizeof(f->half); i++)
+		f->half[f->n++] = bit;
+}
+
+// the text, between idle_bits of mark, one start bit and 1.5 stop bits a character
+static void fsk_text(struct fsk *f, const char *s, int idle_bits){
+	int figs = -1;
+	f->n = 0;
+	fsk_bits(f, 1, 2 * idle_bits);
+	for (; *s; s++){
+		int code = -1, want = 0;
+		for (int k = 0; k < 32 && code < 0; k++)
+			if (letters[k] == *s)
+				code = k;
+		for (int k = 0; k < 32 && code < 0; k++)
+			if (figures[k] == *s){
+				code = k;
+				want = 1;
+			}
+		if (code < 0)
+			continue;
+		int seq[2], n = 0;
+		if (letters[code] != figures[code] && want != figs){
+			seq[n++] = want ? 27 : 31;
+			figs = want;
+		}
+		seq[n++] = code;
+		// the receiver goes back to letters on a space
+		if (*s == ' ')
+			figs = 0;
+		for (int i = 0; i < n; i++){
+			fsk_bits(f, 0, 2);
+			for (int b = 0; b < 5; b++)
+				fsk_bits(f, (seq[i] >> b) & 1, 2);
+			fsk_bits(f, 1, 3);
+		}
+	}
+	fsk_bits(f, 1, 2 * idle_bits);
+}
+
+// add the keyed carrier, at freq Hz with the shift, to out
+static int fsk_render(struct fsk *f, float *out, int max, float freq, int shift, float rate, int reverse){
+	double half_len = RATE / rate / 2;
+	int n = 0;
+	for (int h = 0; h < f->n; h++){
+		int mark = f->half[h] != reverse;
+		double step = 2 * M_PI * (freq + (mark ? 0.5 : -0.5) * shift) / RATE;
+		for (; n < max && n < (h + 1) * half_len; n++){
+			f->phase += step;
+			out[n] += sin(f->phase) / 8;
+		}
+	}
+	return n;
+}
+
+// a sample of white gaussian noise, of unit variance
+static double gauss(){
+	double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+	return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+// the edit distance between a and b
+static int distance(const char *a, const char *b){
+	int n = strlen(a), m = strlen(b);
+	int *d = malloc((m + 1) * sizeof(int));
+	for (int j = 0; j <= m; j++)
+		d[j] = j;
+	for (int i = 1; i <= n; i++){
+		int diag = d[0];
+		d[0] = i;
+		for (int j = 1; j <= m; j++){
+			int up = d[j];
+			int c = diag + (a[i - 1] != b[j - 1]);
+			if (up + 1 < c)
+				c = up + 1;
+			if (d[j - 1] + 1 < c)
+				c = d[j - 1] + 1;
+			d[j] = c;
+			diag = up;
+		}
+	}
+	int r = d[m];
+	free(d);
+	return r;
+}
+
+static float audio[RATE * MAX_SECS];
+
+// noise at snr_db for a carrier of 1/8, and the receiver over len samples
+// and a second after
+static void receive(int len, double snr_db){
+	const double power = (1.0 / 8) * (1.0 / 8) / 2;
+	const double sigma = sqrt(power / pow(10, snr_db / 10) * (RATE / 2) / 3000);
+	int32_t block[1024];
+
+	for (int i = 0; i < len + RATE; i += 1024){
+		for (int j = 0; j < 1024; j++){
+			double s = (i + j < len ? audio[i + j] : 0) + sigma * gauss();
+			block[j] = s * 2e8;
+		}
+		rtty_rx(block, 1024);
+	}
+}
+
+// the characters of the text received wrong at the pitch; the receiver
+// needs a few characters to find the signal and settle on the polarity
+// (RY reads as well upside down, so it needs other text for that), so
+// the text comes after a preamble and is compared with the end of what
+// was printed
+static int errors(int rate, int shift, int reverse, double snr_db){
+	static struct fsk f;
+	char tx[256];
+
+	baud = rate;
+	skim = "OFF";
+	rx_len = 0;
+	rx_text[0] = 0;
+	rtty_init();
+	rtty_poll();
+
+	snprintf(tx, sizeof(tx), "RYRYRYRYRY VVV VVV VVV DE N0CALL N0CALL %s", text);
+	memset(audio, 0, sizeof(audio));
+	f.phase = 0;
+	fsk_text(&f, tx, 20);
+	int len = fsk_render(&f, audio, RATE * MAX_SECS, PITCH, shift, rate == 45 ? 45.45f : rate, reverse);
+	receive(len, snr_db);
+
+	int n = strlen(text), best = n;
+	for (int start = rx_len - n - 10; start <= rx_len - n + 10; start++){
+		int e = distance(text, rx_text + (start < 0 ? 0 : start));
+		if (e < best)
+			best = e;
+	}
+	return best;
+}
+
+int main(int argc, char **argv){
+	static const int rates[] = {45, 50, 75, 45, 45};
+	static const int shifts[] = {170, 170, 170, 425, 850};
+	const int modes = sizeof(rates) / sizeof(rates[0]);
+
+	srand(1);
+	printf("character error rate, %d characters\n", (int)strlen(text));
+	printf("SNR dB");
+	for (int m = 0; m < modes; m++)
+		printf("  %5s/%d", rates[m] == 45 ? "45.45" : (rates[m] == 50 ? "50" : "75"), shifts[m]);
+	printf("\n");
+	for (int snr = 6; snr >= -10; snr -= 2){
+		printf("%+5d ", snr);
+		for (int m = 0; m < modes; m++){
+			int e = errors(rates[m], shifts[m], 0, snr) + errors(rates[m], shifts[m], 1, snr);
+			printf("  %8.1f%%", 100.0 * e / (2 * strlen(text)));
+		}
+		printf("\n");
+	}
+
+	// the skimmer on signals all over the passband
+	static struct fsk f;
+	baud = 45;
+	skim = "ON";
+	rx_len = 0;
+	rtty_init();
+	rtty_poll();
+	memset(audio, 0, sizeof(audio));
+	int len = 0;
+	for (int s = 0; s < SIGNALS; s++){
+		char tx[128];
+		snprintf(tx, sizeof(tx), "RYRYRYRYRY\nSIGNAL %d DE N%dCALL\nSIGNAL %d DE N%dCALL\n", s, s, s, s);
+		f.phase = s;
+		fsk_text(&f, tx, 20 + 10 * s);
+		int n = fsk_render(&f, audio, RATE * MAX_SECS, 450 + 320 * s, 170, 45.45f, s == 3);
+		if (n > len)
+			len = n;
+	}
+	receive(len, 10);
+	char report[4000];
+	rtty_report(report, sizeof(report));
+	printf("\n%d signals, 10 dB\n%s%s", SIGNALS, rx_text, report);
+	return 0;
+}
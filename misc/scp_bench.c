@@ -0,0 +1,92 @@
+/*
+	Latency of the super check partial lookups of src/scp.c, the way
+	the \scp command reports it, over a synthetic master call file of
+	MASTER calls, LOGGED calls in the QSO index and HEARD calls heard
+	this session. For comparison, the same 2 to 4 character pieces are
+	looked for with strstr() in every call made, one after another.
+
+	gcc -O2 -Isrc -o scp_bench misc/scp_bench.c src/scp.c src/qso_index.c -pthread
+	./scp_bench [master calls]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scp.h"
+#include "qso_index.h"
+
+#define LOGGED 20000
+#define HEARD 500
+#define SCANS 2000
+#define MASTER_PATH "/tmp/scp_bench.scp"
+
+static char (*calls)[SCP_CALL_LEN];
+static int n_calls;
+
+static double now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void random_call(char *call){
+	static const char *prefixes[] = {"K", "W", "N", "AA", "VE", "G", "DL", "F", "JA", "VK", "VU", "EA", "I", "PY"};
+	int suffix = 1 + rand() % 3;
+	int n = sprintf(call, "%s%d", prefixes[rand() % 14], rand() % 10);
+	for (int i = 0; i < suffix; i++)
+		call[n++] = 'A' + rand() % 26;
+	call[n] = 0;
+}
+
+static const char *new_call(){
+	random_call(calls[n_calls]);
+	return calls[n_calls++];
+}
+
+int main(int argc, char **argv){
+	int master = argc > 1 ? atoi(argv[1]) : 40000;
+	char report[300], partial[5];
+	scp_match matches[SCP_MAX_MATCHES];
+	long found = 0;
+
+	srand(1);
+	calls = malloc((master + LOGGED + HEARD) * sizeof(*calls));
+	FILE *pf = fopen(MASTER_PATH, "w");
+	fprintf(pf, "# generated by scp_bench\n");
+	for (int i = 0; i < master; i++)
+		fprintf(pf, "%s\n", new_call());
+	fclose(pf);
+	for (int i = 0; i < LOGGED; i++)
+		qso_index_add(new_call(), "", 5, "CW", 1600000000 + i * 600L, NULL);
+	qso_index_set_ready(true);
+
+	double t = now();
+	scp_build(MASTER_PATH);
+	printf("built in %.0f ms\n", (now() - t) * 1000);
+	for (int i = 0; i < HEARD; i++)
+		scp_add(new_call(), SCP_HEARD);
+
+	scp_benchmark(report, sizeof(report));
+	printf("%s", report);
+
+	t = now();
+	for (int i = 0; i < SCANS; i++){
+		const char *call = calls[(i * 7919L) % n_calls];
+		int len = strlen(call), q_len = SCP_MIN_PARTIAL + i % 3;
+		if (q_len > len)
+			q_len = len;
+		memcpy(partial, call + (i / 3) % (len - q_len + 1), q_len);
+		partial[q_len] = 0;
+		for (int c = 0; c < n_calls; c++)
+			found += strstr(calls[c], partial) != NULL;
+	}
+	printf("strstr() over the %d calls made (with repeats): %.0f us a query, %ld matches\n", n_calls, (now() - t) / SCANS * 1e6, found);
+	found = scp_query("K1A", matches, SCP_MAX_MATCHES);
+	printf("K1A:");
+	for (int i = 0; i < found; i++)
+		printf(" %s", matches[i].call);
+	printf("\n");
+	remove(MASTER_PATH);
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "adif.h"
+
+/*!
+	Parse the ADIF text in \a buf (\a len bytes), calling \a record_cb
+	for every record (fields up to <EOR>). The header, if any, is skipped:
+	by the spec, a file that doesn't start with '<' has one, ending with <EOH>.
+	Returns the number of records, or -1 if \a record_cb stopped the parse.
+*/
+int adif_parse(const char *buf, size_t len, adif_record_cb record_cb, adif_progress_cb progress_cb, void *user)
+{
+	const char *p = buf;
+	const char *end = buf + len;
+	adif_record rec;
+	int records = 0;
+	int in_header = len > 0 && buf[0] != '<';
+
+	rec.n_fields = 0;
+	while (p < end) {
+		p = memchr(p, '<', end - p);
+		if (!p)
+			break;
+		const char *name = ++p;
+		while (p < end && *p != ':' && *p != '>')
+			p++;
+		if (p >= end)
+			break;
+		int name_len = p - name;
+
+		if (*p == '>') {
+			// a tag without data: <EOR> or <EOH>
+			p++;
+			if (name_len == 3 && !strncasecmp(name, "EOH", 3)) {
+				in_header = 0;
+				rec.n_fields = 0;
+			} else if (name_len == 3 && !strncasecmp(name, "EOR", 3) && !in_header) {
+				if (rec.n_fields) {
+					records++;
+					if (record_cb(&rec, user))
+						return -1;
+					if (progress_cb && records % ADIF_PROGRESS_RECORDS == 0)
+						progress_cb(p - buf, len, records, user);
+				}
+				rec.n_fields = 0;
+			}
+			continue;
+		}
+
+		// <NAME:length[:type]>value
+		int value_len = 0;
+		for (p++; p < end && isdigit((unsigned char)*p); p++)
+			value_len = value_len * 10 + (*p - '0');
+		while (p < end && *p != '>')
+			p++;
+		if (p >= end)
+			break;
+		p++;
+		if (value_len > end - p)
+			value_len = end - p;
+		if (!in_header && rec.n_fields < ADIF_MAX_FIELDS) {
+			adif_field *f = &rec.fields[rec.n_fields++];
+			f->name = name;
+			f->name_len = name_len;
+			f->value = p;
+			f->value_len = value_len;
+		}
+		p += value_len;
+	}
+	if (progress_cb)
+		progress_cb(len, len, records, user);
+	return records;
+}
+
+/*!
+	Map the file at \a path into memory and parse it with adif_parse().
+	Returns the number of records, or -1 on error.
+*/
+int adif_parse_file(const char *path, adif_record_cb record_cb, adif_progress_cb progress_cb, void *user)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	const char *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (buf == MAP_FAILED) {
+		perror(path);
+		return -1;
+	}
+	madvise((void *)buf, st.st_size, MADV_SEQUENTIAL);
+	int ret = adif_parse(buf, st.st_size, record_cb, progress_cb, user);
+	munmap((void *)buf, st.st_size);
+	return ret;
+}
+
+/*!
+	Find field \a name (case-insensitive) in \a rec. Returns a pointer to its
+	value (not null-terminated) and sets \a len, or returns NULL if not present.
+*/
+const char *adif_get(const adif_record *rec, const char *name, int *len)
+{
+	int name_len = strlen(name);
+	for (int i = 0; i < rec->n_fields; i++) {
+		const adif_field *f = &rec->fields[i];
+		if (f->name_len == name_len && !strncasecmp(f->name, name, name_len)) {
+			if (len)
+				*len = f->value_len;
+			return f->value;
+		}
+	}
+	if (len)
+		*len = 0;
+	return NULL;
+}
+
+/*!
+	Append "<NAME:len>value " to \a buf (size \a len); returns the number of bytes written.
+	Nothing is written for an empty value.
+*/
+int adif_write_field(char *buf, int len, const char *name, const char *value, int value_len)
+{
+	if (value_len <= 0)
+		return 0;
+	int n = snprintf(buf, len, "<%s:%d>", name, value_len);
+	if (n < 0 || n + value_len + 1 >= len)
+		return 0;
+	memcpy(buf + n, value, value_len);
+	buf[n + value_len] = ' ';
+	return n + value_len + 1;
+}
@@ -0,0 +1,39 @@
+#ifndef ADIF_H
+#define ADIF_H
+
+#include <stddef.h>
+
+/*
+	Streaming ADIF tokenizer. Field names and values point straight into
+	the input buffer (they are not null-terminated: use the lengths).
+*/
+
+#define ADIF_MAX_FIELDS 128
+
+typedef struct {
+	const char *name;
+	int name_len;
+	const char *value;
+	int value_len;
+} adif_field;
+
+typedef struct {
+	adif_field fields[ADIF_MAX_FIELDS];
+	int n_fields;
+} adif_record;
+
+// return nonzero to stop parsing
+typedef int (*adif_record_cb)(const adif_record *rec, void *user);
+// called every ADIF_PROGRESS_RECORDS records, and once at the end
+typedef void (*adif_progress_cb)(size_t done_bytes, size_t total_bytes, int records, void *user);
+
+#define ADIF_PROGRESS_RECORDS 5000
+// stdio buffer size for writing ADIF files
+#define ADIF_IO_BUFFER (1 << 20)
+
+int adif_parse(const char *buf, size_t len, adif_record_cb record_cb, adif_progress_cb progress_cb, void *user);
+int adif_parse_file(const char *path, adif_record_cb record_cb, adif_progress_cb progress_cb, void *user);
+const char *adif_get(const adif_record *rec, const char *name, int *len);
+int adif_write_field(char *buf, int len, const char *name, const char *value, int value_len);
+
+#endif /* ADIF_H */
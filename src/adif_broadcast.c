@@ -419,20 +419,26 @@ static int format_adif_for_broadcast(sqlite3_stmt *stmt, char *buf, int buf_size
 	return offset;
 }
 
-static sqlite3_stmt* get_last_qso(sqlite3 *db) {
+// the QSO with \a id, or the last one if \a id is 0
+static sqlite3_stmt* get_qso(sqlite3 *db, long long id) {
 	if (!db)
 		return NULL;
 
 	sqlite3_stmt *stmt = NULL;
-	const char *query =
+	const char *query = id ?
+		"SELECT id,mode,freq,qso_date,qso_time,callsign_sent,rst_sent,exch_sent,"
+		"callsign_recv,rst_recv,exch_recv,tx_id,comments,tx_power,vswr,xota,xota_loc "
+		"FROM logbook WHERE id = ?" :
 		"SELECT id,mode,freq,qso_date,qso_time,callsign_sent,rst_sent,exch_sent,"
 		"callsign_recv,rst_recv,exch_recv,tx_id,comments,tx_power,vswr,xota,xota_loc "
 		"FROM logbook ORDER BY id DESC LIMIT 1";
 
 	if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
-		printf("ADIF Broadcast: Failed to query last QSO: %s\n", sqlite3_errmsg(db));
+		printf("ADIF Broadcast: Failed to query QSO: %s\n", sqlite3_errmsg(db));
 		return NULL;
 	}
+	if (id)
+		sqlite3_bind_int64(stmt, 1, id);
 
 	if (sqlite3_step(stmt) != SQLITE_ROW) {
 		sqlite3_finalize(stmt);
@@ -443,6 +449,10 @@ static sqlite3_stmt* get_last_qso(sqlite3 *db) {
 }
 
 int adif_broadcast_qso(void) {
+	return adif_broadcast_qso_id(0);
+}
+
+int adif_broadcast_qso_id(long long id) {
 	// Check if broadcasting is enabled
 	const char *enabled = field_str("ADIF_ENABLE");
 	if (!enabled || strcmp(enabled, "ON") != 0) {
@@ -468,8 +478,8 @@ int adif_broadcast_qso(void) {
 		return -1;
 	}
 
-	// Get last QSO from database
-	sqlite3_stmt *stmt = get_last_qso(db);
+	// Get the QSO from database
+	sqlite3_stmt *stmt = get_qso(db, id);
 	if (!stmt) {
 		sqlite3_close(db);
 		return -1;
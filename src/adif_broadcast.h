@@ -7,6 +7,9 @@ int adif_broadcast_init(void);
 // Broadcast the most recently logged QSO
 int adif_broadcast_qso(void);
 
+// Broadcast the QSO with logbook row id \a id
+int adif_broadcast_qso_id(long long id);
+
 // Cleanup broadcast socket (called on exit)
 void adif_broadcast_close(void);
 
@@ -7,8 +7,8 @@
 // envelope power (PEP). This is achieved by controlling envelope overshoot that
 // normally occurs when clipped audio is filtered.
 //
-// Processing chain:
-// - Input audio arrives as int32 and is normalized to float in [-1, +1]
+// Processing chain (each stage runs over a whole block before the next):
+// - Input audio arrives as float (or int32) and is normalized to [-1, +1]
 // - Automatically adjust audio input levels into working range
 // - Compute analytic signal using Hilbert (HILBERT_TAPS):
 //     I = delayed real sample
@@ -24,12 +24,12 @@
 //     Use delayed filtered I and filtered Q
 //     envelope2 = sqrt(i2_delayed*i2_delayed + q2_delayed*q2_delayed)
 // - Vector look-ahead limiter (configurable up to LOOKAHEAD_MAX_SAMPLES):
-//     Maintain lookahead buffers for I, Q and envelope; compute peak over window,
+//     Maintain lookahead buffers for I and envelope; compute peak over window,
 //     derive a target gain (ceiling = envelope_limit) and smooth it with attack/release.
 //     Apply the SAME time-aligned gain to the delayed I and Q to preserve phase.
 // - Collapse analytic pair to real transmit waveform (use limited I for SSB)
 // - Post-limiter 6th-order lowpass (3 biquad stages) @ 3 kHz applied to the real output
-// - Convert float back to int32 before returning processed data
+// - Scale back to the caller's units (or convert to int32) before returning
 // - Statistics (peaks, average power, AGC gain, min limiter gain) accumulated for monitoring
 //
 // Key configuration parameters (see cessb.h)
@@ -173,35 +173,51 @@ static float apply_input_agc(input_agc_t *agc, float input) {
 
 // ============================================================================
 // FIR FILTER PROCESSING
+// The filters work a block at a time on a buffer holding their history and
+// then the block, one tap (or pair of taps) across every sample in turn, so
+// the inner loops are plain multiply-adds that -O3 vectorises.
+// The Hilbert taps are odd-symmetric and zero at even distances from the
+// centre, the overshoot taps even-symmetric, so each pair of taps takes a
+// single multiply and the Hilbert's zero taps are skipped altogether.
 // ============================================================================
 
-static float apply_fir_filter(const float *coeffs, float *delay, int *index, int num_taps,
-                              float input) {
-    delay[*index] = input;
+// x holds HILBERT_TAPS - 1 samples of history and then num_samples more;
+// out[i] is the Hilbert transform of x[i + HILBERT_DELAY_LEN]
+static void apply_hilbert_block(const float *x, float *out, int num_samples) {
+    const float *centre = x + HILBERT_DELAY_LEN;
 
-    float output = 0.0f;
-    int idx = *index;
-
-    for (int i = 0; i < num_taps; i++) {
-        output += coeffs[i] * delay[idx];
-        idx--;
-        if (idx < 0) idx = num_taps - 1;
+    for (int i = 0; i < num_samples; i++) {
+        out[i] = 0.0f;
+    }
+    for (int m = 1; m <= HILBERT_DELAY_LEN; m += 2) {
+        float h = hilbert_coeffs[HILBERT_DELAY_LEN - m];
+        for (int i = 0; i < num_samples; i++) {
+            out[i] += h * (centre[i + m] - centre[i - m]);
+        }
     }
-
-    (*index)++;
-    if (*index >= num_taps) *index = 0;
-
-    return output;
 }
 
-static float get_delayed_sample(float *delay, int *index, int delay_length, float input) {
-    float output = delay[*index];
-    delay[*index] = input;
+// x holds OVERSHOOT_FILTER_TAPS - 1 samples of history and then num_samples
+// more; out[i] is the filter's output for the last of x[i + 1 .. i + taps]
+static void apply_overshoot_block(const float *x, float *out, int num_samples) {
+    const float *centre = x + OVERSHOOT_DELAY_LEN;
 
-    (*index)++;
-    if (*index >= delay_length) *index = 0;
+    float h = overshoot_coeffs[OVERSHOOT_DELAY_LEN];
+    for (int i = 0; i < num_samples; i++) {
+        out[i] = h * centre[i];
+    }
+    for (int m = 1; m <= OVERSHOOT_DELAY_LEN; m++) {
+        h = overshoot_coeffs[OVERSHOOT_DELAY_LEN - m];
+        for (int i = 0; i < num_samples; i++) {
+            out[i] += h * (centre[i + m] + centre[i - m]);
+        }
+    }
+}
 
-    return output;
+// Keep the last history_len samples of a history-then-block buffer as the
+// next block's history
+static void save_history(float *history, const float *x, int history_len, int num_samples) {
+    memcpy(history, x + num_samples, history_len * sizeof(float));
 }
 
 // ============================================================================
@@ -236,9 +252,7 @@ static float apply_biquad_cascade(const float coeffs[][5], biquad_state_t *state
 
 static void lookahead_limiter_init_vec(lookahead_limiter_t *lim, float sample_rate) {
     memset(lim->delay_i, 0, sizeof(lim->delay_i));
-    memset(lim->delay_q, 0, sizeof(lim->delay_q));
     memset(lim->envelope, 0, sizeof(lim->envelope));
-    lim->write_index = 0;
     lim->lookahead_samples = LOOKAHEAD_DEFAULT_SAMPLES;
     lim->current_gain = 1.0f;
     lim->peak_hold = 0.0f;
@@ -247,52 +261,69 @@ static void lookahead_limiter_init_vec(lookahead_limiter_t *lim, float sample_ra
     lim->release_coeff = time_constant_to_coeff(LOOKAHEAD_DEFAULT_RELEASE_MS, sample_rate);
 }
 
-static float find_peak_in_window_vec(lookahead_limiter_t *lim) {
-    float peak = 0.0f;
+// peak[i] = the largest of e[i .. i + len - 1] for each of the num_samples,
+// at three comparisons a sample whatever the length (van Herk / Gil-Werman):
+// the window always spans the end of one len-long segment and the start of
+// the next, so its peak is the larger of a running peak back from the end of
+// the one and a running peak on from the start of the other
+static void find_peak_in_windows(const float *e, float *peak, int num_samples, int len) {
+    int total = num_samples + len - 1;
+    float ahead[CESSB_MAX_BLOCK + LOOKAHEAD_MAX_SAMPLES];
+    float behind[CESSB_MAX_BLOCK + LOOKAHEAD_MAX_SAMPLES];
 
-    int start_index = lim->write_index - lim->lookahead_samples + 1;
-    if (start_index < 0) start_index += LOOKAHEAD_MAX_SAMPLES;
-
-    int idx = start_index;
-    for (int i = 0; i < lim->lookahead_samples; i++) {
-        if (lim->envelope[idx] > peak) peak = lim->envelope[idx];
-        idx++;
-        if (idx >= LOOKAHEAD_MAX_SAMPLES) idx = 0;
+    for (int k = 0; k < total; k++) {
+        behind[k] = (k % len == 0 || e[k] > behind[k - 1]) ? e[k] : behind[k - 1];
+    }
+    for (int k = total - 1; k >= 0; k--) {
+        ahead[k] = (k == total - 1 || k % len == len - 1 || e[k] > ahead[k + 1])
+                   ? e[k] : ahead[k + 1];
+    }
+    for (int i = 0; i < num_samples; i++) {
+        peak[i] = ahead[i] > behind[i + len - 1] ? ahead[i] : behind[i + len - 1];
     }
-    return peak;
 }
 
-static void lookahead_limiter_process_vec(lookahead_limiter_t *lim,
-                                          float input_i, float input_q, float envelope, float limit,
-                                          float *out_i, float *out_q) {
-    lim->delay_i[lim->write_index] = input_i;
-    lim->delay_q[lim->write_index] = input_q;
-    lim->envelope[lim->write_index] = envelope;
+// The limiter for a block: each output is the input from lookahead_samples
+// earlier, at a gain that has been steered by the peak envelope over the
+// lookahead_samples since, up to and including this one
+static void lookahead_limiter_process_block(lookahead_limiter_t *lim, const float *input_i,
+                                            const float *envelope, float limit, float *out,
+                                            int num_samples, float *min_gain) {
+    float delay_i[LOOKAHEAD_MAX_SAMPLES + CESSB_MAX_BLOCK];
+    float env[LOOKAHEAD_MAX_SAMPLES + CESSB_MAX_BLOCK];
+    float peak[CESSB_MAX_BLOCK];
+    int len = lim->lookahead_samples;
 
-    int read_index = lim->write_index - lim->lookahead_samples;
-    if (read_index < 0) read_index += LOOKAHEAD_MAX_SAMPLES;
+    memcpy(delay_i, lim->delay_i, sizeof(lim->delay_i));
+    memcpy(env, lim->envelope, sizeof(lim->envelope));
+    memcpy(delay_i + LOOKAHEAD_MAX_SAMPLES, input_i, num_samples * sizeof(float));
+    memcpy(env + LOOKAHEAD_MAX_SAMPLES, envelope, num_samples * sizeof(float));
 
-    float peak_envelope = find_peak_in_window_vec(lim);
+    find_peak_in_windows(env + LOOKAHEAD_MAX_SAMPLES - len + 1, peak, num_samples, len);
 
-    float target_gain = 1.0f;
-    if (peak_envelope > limit && peak_envelope > 1e-10f) {
-        target_gain = limit / peak_envelope;
-    }
+    float gain = lim->current_gain;
+    for (int i = 0; i < num_samples; i++) {
+        float target_gain = 1.0f;
+        if (peak[i] > limit && peak[i] > 1e-10f) {
+            target_gain = limit / peak[i];
+        }
 
-    if (target_gain < lim->current_gain) {
-        lim->current_gain += lim->attack_coeff * (target_gain - lim->current_gain);
-    } else {
-        lim->current_gain += lim->release_coeff * (target_gain - lim->current_gain);
-    }
+        if (target_gain < gain) {
+            gain += lim->attack_coeff * (target_gain - gain);
+        } else {
+            gain += lim->release_coeff * (target_gain - gain);
+        }
 
-    if (lim->current_gain < 0.0f) lim->current_gain = 0.0f;
-    if (lim->current_gain > 1.0f) lim->current_gain = 1.0f;
+        if (gain < 0.0f) gain = 0.0f;
+        if (gain > 1.0f) gain = 1.0f;
+        if (gain < *min_gain) *min_gain = gain;
 
-    *out_i = lim->delay_i[read_index] * lim->current_gain;
-    *out_q = lim->delay_q[read_index] * lim->current_gain;
+        out[i] = delay_i[LOOKAHEAD_MAX_SAMPLES + i - len] * gain;
+    }
+    lim->current_gain = gain;
 
-    lim->write_index++;
-    if (lim->write_index >= LOOKAHEAD_MAX_SAMPLES) lim->write_index = 0;
+    save_history(lim->delay_i, delay_i, LOOKAHEAD_MAX_SAMPLES, num_samples);
+    save_history(lim->envelope, env, LOOKAHEAD_MAX_SAMPLES, num_samples);
 }
 
 // ============================================================================
@@ -307,15 +338,6 @@ void cessb_init(cessb_state_t *state, float sample_rate) {
     state->envelope_limit = CESSB_ENVELOPE_LIMIT;
     state->sample_rate = sample_rate;
 
-    state->hilbert_index = 0;
-    state->delay_index = 0;
-
-    state->overshoot_i_index = 0;
-    state->overshoot_q_index = 0;
-
-    state->delay2_i_index = 0;
-    state->delay2_q_index = 0;
-
     // Initialize input AGC
     input_agc_init(&state->input_agc, sample_rate);
 
@@ -483,77 +505,83 @@ static inline void rec_note_block(int num_samples) {
 // MAIN CESSB PROCESSING (float version - internal)
 // ============================================================================
 
-void cessb_process(cessb_state_t *state, float *samples, int num_samples) {
-    if (!state->enabled) {
-        return;
-    }
-
-    int hilbert_delay_len = HILBERT_DELAY_LEN;
-    int overshoot_delay_len = OVERSHOOT_DELAY_LEN;
-
+// One block of at most CESSB_MAX_BLOCK samples, each stage run over the
+// whole block before the next
+static void cessb_process_block(cessb_state_t *state, float *samples, int num_samples) {
+    float x[HILBERT_TAPS - 1 + CESSB_MAX_BLOCK];
+    float q[CESSB_MAX_BLOCK];
+    float clipped_i[OVERSHOOT_FILTER_TAPS - 1 + CESSB_MAX_BLOCK];
+    float clipped_q[OVERSHOOT_FILTER_TAPS - 1 + CESSB_MAX_BLOCK];
+    float filtered_i[OVERSHOOT_DELAY_LEN + CESSB_MAX_BLOCK];
+    float filtered_q[OVERSHOOT_DELAY_LEN + CESSB_MAX_BLOCK];
+    float envelope2[CESSB_MAX_BLOCK];
+    float limited_i[CESSB_MAX_BLOCK];
+    float *ci = clipped_i + OVERSHOOT_FILTER_TAPS - 1;
+    float *cq = clipped_q + OVERSHOOT_FILTER_TAPS - 1;
+    float *fi = filtered_i + OVERSHOOT_DELAY_LEN;
+    float *fq = filtered_q + OVERSHOOT_DELAY_LEN;
+
+    // STAGE 1: Hilbert envelope detection, I being the input delayed to match
+    memcpy(x, state->hilbert_delay, sizeof(state->hilbert_delay));
+    memcpy(x + HILBERT_TAPS - 1, samples, num_samples * sizeof(float));
+    apply_hilbert_block(x, q, num_samples);
+    const float *i_delayed = x + HILBERT_DELAY_LEN;
+    save_history(state->hilbert_delay, x, HILBERT_TAPS - 1, num_samples);
+
+    // STAGE 2: Hard clip based on envelope
+    memcpy(clipped_i, state->overshoot_i_delay, sizeof(state->overshoot_i_delay));
+    memcpy(clipped_q, state->overshoot_q_delay, sizeof(state->overshoot_q_delay));
+    float peak_after_clip = state->peak_after_clip;
     for (int i = 0; i < num_samples; i++) {
-        float sample = samples[i];
-
-        // STAGE 1: Hilbert envelope detection
-        float q = apply_fir_filter(hilbert_coeffs, state->hilbert_delay,
-                                   &state->hilbert_index, HILBERT_TAPS, sample);
+        float envelope = sqrtf(i_delayed[i] * i_delayed[i] + q[i] * q[i]);
 
-        float i_delayed = get_delayed_sample(state->delay_line, &state->delay_index,
-                                             hilbert_delay_len, sample);
-
-        float envelope = sqrtf(i_delayed * i_delayed + q * q);
-
-        // STAGE 2: Hard clip based on envelope
-        float clipped_i;
-        float clipped_q;
         if (envelope > state->clip_level && envelope > 1e-10f) {
             float gain = state->clip_level / envelope;
-            clipped_i = i_delayed * gain;
-            clipped_q = q * gain;
+            ci[i] = i_delayed[i] * gain;
+            cq[i] = q[i] * gain;
         } else {
-            clipped_i = i_delayed;
-            clipped_q = q;
+            ci[i] = i_delayed[i];
+            cq[i] = q[i];
         }
 
-        float abs_clip = sqrtf(clipped_i * clipped_i + clipped_q * clipped_q);
-        if (abs_clip > state->peak_after_clip) {
-            state->peak_after_clip = abs_clip;
-        }
+        float abs_clip = sqrtf(ci[i] * ci[i] + cq[i] * cq[i]);
+        if (abs_clip > peak_after_clip) peak_after_clip = abs_clip;
+    }
+    state->peak_after_clip = peak_after_clip;
 
-        // STAGE 3: Overshoot control filter — operate on both I and Q
-        float filtered_i =
-            apply_fir_filter(overshoot_coeffs, state->overshoot_i_delay,
-                             &state->overshoot_i_index, OVERSHOOT_FILTER_TAPS, clipped_i);
-        float filtered_q =
-            apply_fir_filter(overshoot_coeffs, state->overshoot_q_delay,
-                             &state->overshoot_q_index, OVERSHOOT_FILTER_TAPS, clipped_q);
-
-        float abs_filt = sqrtf(filtered_i * filtered_i + filtered_q * filtered_q);
-        if (abs_filt > state->peak_after_overshoot) {
-            state->peak_after_overshoot = abs_filt;
-        }
+    // STAGE 3: Overshoot control filter — operate on both I and Q
+    memcpy(filtered_i, state->delay2_i, sizeof(state->delay2_i));
+    memcpy(filtered_q, state->delay2_q, sizeof(state->delay2_q));
+    apply_overshoot_block(clipped_i, fi, num_samples);
+    apply_overshoot_block(clipped_q, fq, num_samples);
+    save_history(state->overshoot_i_delay, clipped_i, OVERSHOOT_FILTER_TAPS - 1, num_samples);
+    save_history(state->overshoot_q_delay, clipped_q, OVERSHOOT_FILTER_TAPS - 1, num_samples);
 
-        // STAGE 4: Second envelope detection — use delayed I and Q
-        float i2_delayed = get_delayed_sample(state->delay2_i, &state->delay2_i_index,
-                                              overshoot_delay_len, filtered_i);
-        float q2_delayed = get_delayed_sample(state->delay2_q, &state->delay2_q_index,
-                                              overshoot_delay_len, filtered_q);
-        float envelope2 = sqrtf(i2_delayed * i2_delayed + q2_delayed * q2_delayed);
+    float peak_after_overshoot = state->peak_after_overshoot;
+    for (int i = 0; i < num_samples; i++) {
+        float abs_filt = sqrtf(fi[i] * fi[i] + fq[i] * fq[i]);
+        if (abs_filt > peak_after_overshoot) peak_after_overshoot = abs_filt;
+    }
+    state->peak_after_overshoot = peak_after_overshoot;
 
-        // STAGE 5: Look-ahead limiter (for I and Q)
-        float limited_i, limited_q;
-        lookahead_limiter_process_vec(&state->lookahead, i2_delayed, q2_delayed, envelope2,
-                                      state->envelope_limit, &limited_i, &limited_q);
+    // STAGE 4: Second envelope detection — use delayed I and Q
+    const float *i2_delayed = filtered_i;
+    const float *q2_delayed = filtered_q;
+    for (int i = 0; i < num_samples; i++) {
+        envelope2[i] = sqrtf(i2_delayed[i] * i2_delayed[i] + q2_delayed[i] * q2_delayed[i]);
+    }
 
-        if (state->lookahead.current_gain < state->min_limiter_gain) {
-            state->min_limiter_gain = state->lookahead.current_gain;
-        }
+    // STAGE 5: Look-ahead limiter (for I and Q)
+    lookahead_limiter_process_block(&state->lookahead, i2_delayed, envelope2,
+                                    state->envelope_limit, limited_i, num_samples,
+                                    &state->min_limiter_gain);
+    save_history(state->delay2_i, filtered_i, OVERSHOOT_DELAY_LEN, num_samples);
+    save_history(state->delay2_q, filtered_q, OVERSHOOT_DELAY_LEN, num_samples);
 
-        // STAGE 6: Post-limiter lowpass filter
+    // STAGE 6: Post-limiter lowpass filter
+    for (int i = 0; i < num_samples; i++) {
         float output = apply_biquad_cascade(post_lpf_coeffs, state->post_lpf_state,
-                                            POST_LPF_BIQUAD_STAGES, limited_i);
-
-        state->sample_count++;
+                                            POST_LPF_BIQUAD_STAGES, limited_i[i]);
 
         // Measure output
         float abs_out = fabsf(output);
@@ -564,28 +592,44 @@ void cessb_process(cessb_state_t *state, float *samples, int num_samples) {
 
         samples[i] = output;
     }
+    state->sample_count += num_samples;
+}
+
+void cessb_process(cessb_state_t *state, float *samples, int num_samples) {
+    if (!state->enabled) {
+        return;
+    }
+
+    for (int i = 0; i < num_samples; i += CESSB_MAX_BLOCK) {
+        int n = num_samples - i < CESSB_MAX_BLOCK ? num_samples - i : CESSB_MAX_BLOCK;
+        cessb_process_block(state, samples + i, n);
+    }
 }
 
 // ============================================================================
-// MAIN CESSB PROCESSING (int32 version - public API)
+// MAIN CESSB PROCESSING (public API)
 // ============================================================================
 
-void cessb_process_int32(cessb_state_t *state, int32_t *samples, int num_samples) {
-    if (num_samples < 0 || num_samples > 1024 || !state->enabled) return;
+// For the float TX chain: full_scale is int32 full scale in the caller's
+// units, and the output comes back in the same units
+void cessb_process_float(cessb_state_t *state, float *samples, int num_samples,
+                         float full_scale) {
+    if (num_samples < 0 || num_samples > CESSB_MAX_BLOCK || !state->enabled) return;
 
 #if REC_AUDIO
+    int32_t rec_buffer[CESSB_MAX_BLOCK];
     rec_open_segment();
     if (!rec_done && rec_in_file) {
-        (void)fwrite(samples, sizeof(int32_t), num_samples, rec_in_file);
+        for (int i = 0; i < num_samples; i++) {
+            rec_buffer[i] = (int32_t)(samples[i] / full_scale * 2147483647.0f);
+        }
+        (void)fwrite(rec_buffer, sizeof(int32_t), num_samples, rec_in_file);
     }
 #endif
 
-    float temp_buffer[1024];
-
-    // Convert int32 to float normalized to [-1, 1]
+    // Normalize to [-1, 1] and apply input AGC to normalize levels
     for (int i = 0; i < num_samples; i++) {
-        float s = (float)samples[i] / 2147483648.0f;
-        temp_buffer[i] = s;
+        float s = samples[i] / full_scale;
 
         // Track peak input (before AGC)
         float abs_s = fabsf(s);
@@ -593,41 +637,57 @@ void cessb_process_int32(cessb_state_t *state, int32_t *samples, int num_samples
             state->peak_input = abs_s;
         }
         state->average_power_in += s * s;
-    }
 
-    // Apply input AGC to normalize levels
-    for (int i = 0; i < num_samples; i++) {
-        temp_buffer[i] = apply_input_agc(&state->input_agc, temp_buffer[i]);
+        samples[i] = apply_input_agc(&state->input_agc, s);
 
         // Track peak after AGC
-        float abs_agc = fabsf(temp_buffer[i]);
+        float abs_agc = fabsf(samples[i]);
         if (abs_agc > state->peak_after_agc) {
             state->peak_after_agc = abs_agc;
         }
     }
 
     // Run CESSB processing
-    cessb_process(state, temp_buffer, num_samples);
+    cessb_process(state, samples, num_samples);
 
-    // Convert float back to int32 and
-    // scale output to match downstream limiter threshold (0.04 float equivalent)
+    // Scale output to match downstream limiter threshold (0.04 float equivalent)
     // Without this, CESSB output would be clipped by downstream processing
     for (int i = 0; i < num_samples; i++) {
-        float out = temp_buffer[i] * 0.04f * 2147483647.0f;
-        // we will never come close to these limits
-        if (out > 2147483647.0f) out = 2147483647.0f;
-        if (out < -2147483648.0f) out = -2147483648.0f;
-        samples[i] = (int32_t)out;
+        samples[i] *= 0.04f * full_scale;
     }
 
 #if REC_AUDIO
     if (!rec_done && rec_out_file) {
-        (void)fwrite(samples, sizeof(int32_t), num_samples, rec_out_file);
+        for (int i = 0; i < num_samples; i++) {
+            rec_buffer[i] = (int32_t)(samples[i] / full_scale * 2147483647.0f);
+        }
+        (void)fwrite(rec_buffer, sizeof(int32_t), num_samples, rec_out_file);
     }
     rec_note_block(num_samples);
 #endif
 }
 
+void cessb_process_int32(cessb_state_t *state, int32_t *samples, int num_samples) {
+    if (num_samples < 0 || num_samples > CESSB_MAX_BLOCK || !state->enabled) return;
+
+    float temp_buffer[CESSB_MAX_BLOCK];
+
+    for (int i = 0; i < num_samples; i++) {
+        temp_buffer[i] = (float)samples[i];
+    }
+
+    cessb_process_float(state, temp_buffer, num_samples, 2147483648.0f);
+
+    // Convert float back to int32
+    for (int i = 0; i < num_samples; i++) {
+        float out = temp_buffer[i];
+        // we will never come close to these limits
+        if (out > 2147483647.0f) out = 2147483647.0f;
+        if (out < -2147483648.0f) out = -2147483648.0f;
+        samples[i] = (int32_t)out;
+    }
+}
+
 // ============================================================================
 // STATISTICS
 // ============================================================================
@@ -33,6 +33,10 @@
 // Envelope limit: final limiter ceiling
 #define CESSB_ENVELOPE_LIMIT 0.93f
 
+// --- Block Processing ---
+// Samples worked on at a time; longer calls are split into blocks this size
+#define CESSB_MAX_BLOCK 1024
+
 // --- Filter Parameters ---
 // Hilbert transform filter length (must be odd)
 #define HILBERT_TAPS 127
@@ -77,11 +81,11 @@ typedef struct {
 } biquad_state_t;
 
 // Look-ahead limiter state (vector version for I/Q)
+// Only I goes on to the transmitter, so only I is delayed; the gain comes
+// from the envelope of both
 typedef struct {
-    float delay_i[LOOKAHEAD_MAX_SAMPLES];
-    float delay_q[LOOKAHEAD_MAX_SAMPLES];
+    float delay_i[LOOKAHEAD_MAX_SAMPLES];   // the last samples in, oldest first
     float envelope[LOOKAHEAD_MAX_SAMPLES];
-    int write_index;
     int lookahead_samples;
     float current_gain;
     float peak_hold;
@@ -111,25 +115,19 @@ typedef struct {
     // Input AGC (NEW)
     input_agc_t input_agc;
 
-    // Hilbert transform state
-    float hilbert_delay[HILBERT_TAPS];
-    int hilbert_index;
+    // The filters' histories, the last samples of the previous block
+    // oldest first, which also supply the delayed I for each envelope
 
-    // Delay line for I channel (matches Hilbert group delay)
-    float delay_line[HILBERT_DELAY_LEN];
-    int delay_index;
+    // Hilbert transform input
+    float hilbert_delay[HILBERT_TAPS - 1];
 
-    // Overshoot control filter state (I and Q branches)
-    float overshoot_i_delay[OVERSHOOT_FILTER_TAPS];
-    float overshoot_q_delay[OVERSHOOT_FILTER_TAPS];
-    int overshoot_i_index;
-    int overshoot_q_index;
+    // Overshoot control filter input (I and Q branches)
+    float overshoot_i_delay[OVERSHOOT_FILTER_TAPS - 1];
+    float overshoot_q_delay[OVERSHOOT_FILTER_TAPS - 1];
 
-    // Second delay lines for envelope detection after overshoot filter
+    // Overshoot filter output, to delay it for the second envelope detection
     float delay2_i[OVERSHOOT_DELAY_LEN];
     float delay2_q[OVERSHOOT_DELAY_LEN];
-    int delay2_i_index;
-    int delay2_q_index;
 
     // Look-ahead limiter
     lookahead_limiter_t lookahead;
@@ -187,6 +185,8 @@ float cessb_get_agc_gain(cessb_state_t *state);  // For metering display
 // Main processing functions
 void cessb_process(cessb_state_t *state, float *samples, int num_samples);
 void cessb_process_int32(cessb_state_t *state, int32_t *samples, int num_samples);
+void cessb_process_float(cessb_state_t *state, float *samples, int num_samples,
+                         float full_scale);
 
 // Statistics
 void cessb_get_stats(cessb_state_t *state, float *peak_reduction_db,
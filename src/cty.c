@@ -0,0 +1,556 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "cty.h"
+
+#define CTY_CALL_LEN 20
+#define CTY_TRIE_CHARS 37	// A-Z, 0-9 and /
+
+struct trie_node {
+	int32_t child[CTY_TRIE_CHARS];	// node index, or 0 for none (node 0 is the root)
+	int32_t info;			// index in infos[] of the longest prefix ending here, or -1
+};
+
+struct exact_entry {
+	char call[CTY_CALL_LEN];
+	int32_t info;
+};
+
+struct cache_entry {
+	char call[CTY_CALL_LEN];
+	const cty_info *info;		// NULL if there is no match
+	int prev, next;			// LRU list, most recent first
+	int chain;			// next entry in the same hash bucket
+};
+
+static cty_info *infos = NULL;		// entities, plus copies with zone/location overrides
+static int infos_n = 0, infos_cap = 0;
+static int *entities = NULL;		// index in infos[] of each entity, without overrides
+static int entities_n = 0, entities_cap = 0;
+static struct trie_node *nodes = NULL;
+static int nodes_n = 0, nodes_cap = 0;
+static struct exact_entry *exact = NULL;
+static int exact_size = 0, exact_used = 0;
+static bool loaded = false;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct cache_entry cache[CTY_CACHE_SIZE];
+static int cache_bucket[CTY_CACHE_SIZE * 2];
+static int cache_used = 0, cache_head = -1, cache_tail = -1;
+static int cache_hits = 0, cache_misses = 0;
+
+static uint32_t call_hash(const char *key)
+{
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	while (*key) {
+		h ^= (uint8_t)*key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static int trie_char(char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A';
+	if (c >= '0' && c <= '9')
+		return 26 + c - '0';
+	if (c == '/')
+		return 36;
+	return -1;
+}
+
+static int node_new()
+{
+	if (nodes_n == nodes_cap) {
+		nodes_cap = nodes_cap ? nodes_cap * 2 : 4096;
+		nodes = realloc(nodes, nodes_cap * sizeof(struct trie_node));
+	}
+	memset(&nodes[nodes_n], 0, sizeof(struct trie_node));
+	nodes[nodes_n].info = -1;
+	return nodes_n++;
+}
+
+static void trie_add(const char *prefix, int info)
+{
+	int n = 0;
+	for (; *prefix; prefix++) {
+		int c = trie_char(*prefix);
+		if (c < 0)
+			return;
+		if (!nodes[n].child[c]) {
+			int child = node_new(); // may move nodes[]
+			nodes[n].child[c] = child;
+		}
+		n = nodes[n].child[c];
+	}
+	nodes[n].info = info;
+}
+
+// The info of the longest prefix of \a call in the trie, or -1.
+static int trie_longest(const char *call)
+{
+	int n = 0, ret = -1;
+	if (!nodes_n)
+		return -1;
+	for (; *call; call++) {
+		int c = trie_char(*call);
+		if (c < 0 || !nodes[n].child[c])
+			break;
+		n = nodes[n].child[c];
+		if (nodes[n].info >= 0)
+			ret = nodes[n].info;
+	}
+	return ret;
+}
+
+static void exact_add(const char *call, int info)
+{
+	if (strlen(call) >= CTY_CALL_LEN)
+		return;
+	if ((exact_used + 1) * 4 >= exact_size * 3) {
+		struct exact_entry *old = exact;
+		int old_size = exact_size;
+		exact_size = old_size ? old_size * 2 : 8192;
+		exact = calloc(exact_size, sizeof(struct exact_entry));
+		for (int i = 0; i < old_size; i++) {
+			if (!old[i].call[0])
+				continue;
+			int j = call_hash(old[i].call) & (exact_size - 1);
+			while (exact[j].call[0])
+				j = (j + 1) & (exact_size - 1);
+			exact[j] = old[i];
+		}
+		free(old);
+	}
+	int i = call_hash(call) & (exact_size - 1);
+	while (exact[i].call[0] && strcmp(exact[i].call, call))
+		i = (i + 1) & (exact_size - 1);
+	if (!exact[i].call[0])
+		exact_used++;
+	strcpy(exact[i].call, call);
+	exact[i].info = info;
+}
+
+static int exact_find(const char *call)
+{
+	if (!exact_size)
+		return -1;
+	int i = call_hash(call) & (exact_size - 1);
+	while (exact[i].call[0]) {
+		if (!strcmp(exact[i].call, call))
+			return exact[i].info;
+		i = (i + 1) & (exact_size - 1);
+	}
+	return -1;
+}
+
+static int info_new(const cty_info *from)
+{
+	if (infos_n == infos_cap) {
+		infos_cap = infos_cap ? infos_cap * 2 : 512;
+		infos = realloc(infos, infos_cap * sizeof(cty_info));
+	}
+	infos[infos_n] = *from;
+	return infos_n++;
+}
+
+static void cache_clear()
+{
+	pthread_mutex_lock(&cache_mutex);
+	for (int i = 0; i < CTY_CACHE_SIZE * 2; i++)
+		cache_bucket[i] = -1;
+	cache_used = 0;
+	cache_head = cache_tail = -1;
+	cache_hits = cache_misses = 0;
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+static void cty_free()
+{
+	// the override copies share the strings of their entity
+	for (int i = 0; i < entities_n; i++) {
+		free((char *)infos[entities[i]].country);
+		free((char *)infos[entities[i]].prefix);
+	}
+	free(infos);
+	free(entities);
+	free(nodes);
+	free(exact);
+	infos = NULL;
+	entities = NULL;
+	nodes = NULL;
+	exact = NULL;
+	infos_n = infos_cap = entities_n = entities_cap = nodes_n = nodes_cap = exact_size = exact_used = 0;
+	loaded = false;
+}
+
+/*!
+	Parse one alias from the list of an entity: a prefix, or =CALL for an
+	exact call, optionally followed by overrides of the entity's values:
+	(CQ zone) [ITU zone] <lat/long> {continent} ~UTC offset~
+*/
+static void add_alias(char *alias, int entity)
+{
+	char *p = alias;
+	bool is_exact = (*p == '=');
+	if (is_exact)
+		p++;
+	char *end = p + strcspn(p, "([<{~");
+	char mod = *end;
+	*end = 0;
+	if (!*p)
+		return;
+
+	int info = entity;
+	if (mod) {
+		cty_info over = infos[entity];
+		char *m = end + 1;
+		while (mod) {
+			switch (mod) {
+			case '(':
+				over.cq_zone = atoi(m);
+				break;
+			case '[':
+				over.itu_zone = atoi(m);
+				break;
+			case '<': {
+				float lat, lon;
+				if (sscanf(m, "%f/%f", &lat, &lon) == 2) {
+					over.latitude = lat;
+					over.longitude = -lon;
+				}
+			} break;
+			case '{':
+				strncpy(over.continent, m, 2);
+				over.continent[2] = 0;
+				break;
+			case '~':
+				over.utc_offset = -atof(m);
+				break;
+			}
+			m += strcspn(m, ")]>}~");
+			if (*m)
+				m++;
+			mod = *m;
+			if (mod)
+				m++;
+		}
+		info = info_new(&over);
+	}
+	if (is_exact)
+		exact_add(p, info);
+	else
+		trie_add(p, info);
+}
+
+static char *trim(char *s)
+{
+	while (isspace((unsigned char)*s))
+		s++;
+	char *end = s + strlen(s);
+	while (end > s && isspace((unsigned char)end[-1]))
+		*--end = 0;
+	return s;
+}
+
+// WAE-only entities whose DXCC entity doesn't have a prefix of theirs
+static const char *wae_parents[][2] = {
+	{"4U1V", "OE"},		// Vienna Intl Ctr, Austria
+	{NULL, NULL}
+};
+
+/*!
+	The DXCC entity that the WAE-only entity with primary prefix \a prefix
+	is part of: GM/s is in GM, IT9 in I. Call before any WAE-only aliases
+	go into the trie. Returns the index in infos[], or -1.
+*/
+static int wae_parent(const char *prefix)
+{
+	for (int i = 0; wae_parents[i][0]; i++)
+		if (!strcmp(prefix, wae_parents[i][0])) {
+			prefix = wae_parents[i][1];
+			break;
+		}
+	int info = trie_longest(prefix); // stops at the lower case of GM/s
+	return info >= 0 && infos[info].is_dxcc ? entities[infos[info].entity] : -1;
+}
+
+/*!
+	Load the country file at \a path, replacing what was loaded before.
+	Call this before any lookups. Returns 0 on success, -1 on error.
+*/
+int cty_load(const char *path)
+{
+	FILE *pf = fopen(path, "r");
+	if (!pf) {
+		perror(path);
+		return -1;
+	}
+	fseek(pf, 0, SEEK_END);
+	long len = ftell(pf);
+	rewind(pf);
+	char *buf = malloc(len + 1);
+	len = fread(buf, 1, len, pf);
+	buf[len] = 0;
+	fclose(pf);
+
+	cty_free();
+	cache_clear();
+	node_new(); // the root
+
+	// the WAE-only entities, whose aliases wait until all of the DXCC ones are in
+	struct {
+		int entity;
+		char *aliases;
+	} *wae = NULL;
+	int wae_n = 0;
+
+	// Each record is a header of 8 fields ending with ':', and then
+	// the list of aliases, separated by commas and ending with ';'
+	char *p = buf;
+	while (*p) {
+		char *fields[8];
+		int f;
+		for (f = 0; f < 8; f++) {
+			char *colon = strchr(p, ':');
+			if (!colon)
+				break;
+			*colon = 0;
+			fields[f] = trim(p);
+			p = colon + 1;
+		}
+		char *semicolon = strchr(p, ';');
+		if (f < 8 || !semicolon)
+			break;
+		*semicolon = 0;
+
+		cty_info entity;
+		memset(&entity, 0, sizeof(entity));
+		entity.country = strdup(fields[0]);
+		entity.cq_zone = atoi(fields[1]);
+		entity.itu_zone = atoi(fields[2]);
+		strncpy(entity.continent, fields[3], 2);
+		entity.latitude = atof(fields[4]);
+		entity.longitude = -atof(fields[5]);
+		entity.utc_offset = -atof(fields[6]);
+		// a * marks entities that are only on the DARC WAEDC list
+		entity.is_dxcc = fields[7][0] != '*';
+		entity.prefix = strdup(entity.is_dxcc ? fields[7] : fields[7] + 1);
+		entity.entity = entities_n;
+		int e = info_new(&entity);
+		if (entities_n == entities_cap) {
+			entities_cap = entities_cap ? entities_cap * 2 : 512;
+			entities = realloc(entities, entities_cap * sizeof(int));
+		}
+		entities[entities_n++] = e;
+
+		if (entity.is_dxcc) {
+			for (char *alias = strtok(p, ", \t\r\n"); alias; alias = strtok(NULL, ", \t\r\n"))
+				add_alias(alias, e);
+		} else {
+			wae = realloc(wae, (wae_n + 1) * sizeof(*wae));
+			wae[wae_n].entity = e;
+			wae[wae_n++].aliases = p;
+		}
+		p = semicolon + 1;
+	}
+
+	// answer the WAE-only aliases with their DXCC entity, at the WAE
+	// entity's zones and location, so the DXCC counts and headings are right
+	int parents[wae_n + 1];
+	for (int i = 0; i < wae_n; i++)
+		parents[i] = wae_parent(infos[wae[i].entity].prefix);
+	for (int i = 0; i < wae_n; i++) {
+		const cty_info *w = &infos[wae[i].entity];
+		if (parents[i] < 0) {
+			printf("%s: no DXCC entity for %s (%s)\n", path, w->prefix, w->country);
+			continue;
+		}
+		cty_info at = infos[parents[i]];
+		at.cq_zone = w->cq_zone;
+		at.itu_zone = w->itu_zone;
+		memcpy(at.continent, w->continent, sizeof(at.continent));
+		at.latitude = w->latitude;
+		at.longitude = w->longitude;
+		at.utc_offset = w->utc_offset;
+		int e = info_new(&at);
+		for (char *alias = strtok(wae[i].aliases, ", \t\r\n"); alias; alias = strtok(NULL, ", \t\r\n"))
+			add_alias(alias, e);
+	}
+	free(wae);
+	free(buf);
+	loaded = infos_n > 0;
+	printf("%s: %d entities and overrides, %d prefix trie nodes, %d exact calls\n",
+		path, infos_n, nodes_n, exact_used);
+	return loaded ? 0 : -1;
+}
+
+bool cty_loaded()
+{
+	return loaded;
+}
+
+int cty_entity_count()
+{
+	return entities_n;
+}
+
+// The entity numbered \a entity (cty_info.entity), without any overrides.
+const cty_info *cty_entity(int entity)
+{
+	if (entity < 0 || entity >= entities_n)
+		return NULL;
+	return &infos[entities[entity]];
+}
+
+/*!
+	Copy \a callsign into \a dst uppercased, without the <> around a hashed
+	callsign in an FTx message, stopping at a space.
+	Returns the length, or 0 if it's empty or too long.
+*/
+static int normalize(char *dst, const char *callsign)
+{
+	int n = 0;
+	for (const char *p = callsign; *p && *p != ' '; p++) {
+		if (*p == '<' || *p == '>')
+			continue;
+		if (n >= CTY_CALL_LEN - 1)
+			return 0;
+		dst[n++] = toupper(*p);
+	}
+	dst[n] = 0;
+	return n;
+}
+
+// Suffixes that don't change the location: portable, mobile etc.
+static bool is_plain_suffix(const char *s)
+{
+	static const char *suffixes[] = {"P", "M", "MM", "AM", "A", "QRP", "QRPP", "LH", "LGT", NULL};
+	if (isdigit((unsigned char)s[0]) && !s[1])
+		return true; // a call area; the country is the same
+	for (int i = 0; suffixes[i]; i++)
+		if (!strcmp(s, suffixes[i]))
+			return true;
+	return false;
+}
+
+const cty_info *cty_lookup_uncached(const char *callsign)
+{
+	char call[CTY_CALL_LEN];
+	char *parts[3];
+	int n_parts = 0;
+
+	if (!loaded || !normalize(call, callsign))
+		return NULL;
+	int info = exact_find(call);
+	if (info >= 0)
+		return &infos[info];
+	if (!strchr(call, '/')) {
+		info = trie_longest(call);
+		return info >= 0 ? &infos[info] : NULL;
+	}
+
+	// With a /, the location is in the shorter part: DL/K1ABC, K1ABC/VE3;
+	// but K1ABC/P is still K1ABC.
+	for (char *p = strtok(call, "/"); p && n_parts < 3; p = strtok(NULL, "/"))
+		parts[n_parts++] = p;
+	while (n_parts > 1 && is_plain_suffix(parts[n_parts - 1]))
+		n_parts--;
+	if (!n_parts)
+		return NULL;
+	const char *where = parts[0];
+	if (n_parts == 1) {
+		if ((info = exact_find(where)) >= 0)
+			return &infos[info];
+	} else if (strlen(parts[1]) < strlen(parts[0])) {
+		where = parts[1];
+	}
+	info = trie_longest(where);
+	return info >= 0 ? &infos[info] : NULL;
+}
+
+static void cache_unlink(int i)
+{
+	if (cache[i].prev >= 0)
+		cache[cache[i].prev].next = cache[i].next;
+	else
+		cache_head = cache[i].next;
+	if (cache[i].next >= 0)
+		cache[cache[i].next].prev = cache[i].prev;
+	else
+		cache_tail = cache[i].prev;
+}
+
+static void cache_push_front(int i)
+{
+	cache[i].prev = -1;
+	cache[i].next = cache_head;
+	if (cache_head >= 0)
+		cache[cache_head].prev = i;
+	cache_head = i;
+	if (cache_tail < 0)
+		cache_tail = i;
+}
+
+/*!
+	Find the DXCC entity of \a callsign, and its zones and location
+	(with the overrides for that call or prefix applied).
+	Returns NULL if the country file isn't loaded or nothing matches.
+*/
+const cty_info *cty_lookup(const char *callsign)
+{
+	char call[CTY_CALL_LEN];
+	const cty_info *ret;
+
+	if (!loaded || !normalize(call, callsign))
+		return NULL;
+	uint32_t bucket = call_hash(call) & (CTY_CACHE_SIZE * 2 - 1);
+
+	pthread_mutex_lock(&cache_mutex);
+	for (int i = cache_bucket[bucket]; i >= 0; i = cache[i].chain)
+		if (!strcmp(cache[i].call, call)) {
+			cache_unlink(i);
+			cache_push_front(i);
+			cache_hits++;
+			ret = cache[i].info;
+			pthread_mutex_unlock(&cache_mutex);
+			return ret;
+		}
+	cache_misses++;
+	ret = cty_lookup_uncached(call);
+
+	// reuse the least recently used entry when the cache is full
+	int i;
+	if (cache_used < CTY_CACHE_SIZE) {
+		i = cache_used++;
+	} else {
+		i = cache_tail;
+		cache_unlink(i);
+		int *link = &cache_bucket[call_hash(cache[i].call) & (CTY_CACHE_SIZE * 2 - 1)];
+		while (*link != i)
+			link = &cache[*link].chain;
+		*link = cache[i].chain;
+	}
+	strcpy(cache[i].call, call);
+	cache[i].info = ret;
+	cache[i].chain = cache_bucket[bucket];
+	cache_bucket[bucket] = i;
+	cache_push_front(i);
+	pthread_mutex_unlock(&cache_mutex);
+	return ret;
+}
+
+void cty_cache_stats(int *hits, int *misses)
+{
+	pthread_mutex_lock(&cache_mutex);
+	if (hits)
+		*hits = cache_hits;
+	if (misses)
+		*misses = cache_misses;
+	pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,42 @@
+#ifndef CTY_H
+#define CTY_H
+
+#include <stdbool.h>
+
+/*
+	DXCC entity lookup from a country file in the CTY.DAT format
+	(https://www.country-files.com/cty-dat-format/).
+	The prefixes are compiled into a trie when the file is loaded, so that
+	a lookup is one step per character of the callsign, and the exact
+	calls (the =CALL entries) go into a hash table that is checked first.
+	Recent answers are kept in a small LRU cache keyed by callsign.
+	Entities marked with a * in the file are only on the DARC WAEDC list;
+	they are kept, with is_dxcc false, but their prefixes and calls are
+	answered with the DXCC entity they are part of.
+*/
+
+typedef struct {
+	int entity;		// the entity's position in the file, from 0
+	const char *country;	// entity name
+	const char *prefix;	// primary prefix of the entity
+	char continent[3];	// AF, AN, AS, EU, NA, OC, SA
+	int cq_zone;
+	int itu_zone;
+	float latitude;		// degrees, + is north
+	float longitude;	// degrees, + is east (the opposite of the file)
+	float utc_offset;	// hours
+	bool is_dxcc;		// false for the WAE-only entities
+} cty_info;
+
+#define CTY_CACHE_SIZE 1024
+#define CTY_FILE "data/cty.dat"
+
+int cty_load(const char *path);
+bool cty_loaded();
+int cty_entity_count();
+const cty_info *cty_entity(int entity);
+const cty_info *cty_lookup(const char *callsign);
+const cty_info *cty_lookup_uncached(const char *callsign);
+void cty_cache_stats(int *hits, int *misses);
+
+#endif /* CTY_H */
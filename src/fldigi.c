@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "fldigi.h"
+
+/*
+	fldigi speaks XML-RPC over HTTP/1.1, and keeps the connection open
+	between calls unless it is told otherwise, so the client thread
+	connects once and sends every call down the same socket; a reply is
+	read up to its Content-Length. If fldigi closes the connection after
+	a reply (Connection: close, or no Content-Length), the next call just
+	makes a new one. If a call fails on a connection that has been used
+	before, fldigi may just have closed it, so the call is tried once
+	more on a new one. If that fails too, fldigi isn't there: we wait
+	before trying again, doubling the wait each time up to
+	FLDIGI_BACKOFF_MAX_MS, and only while fldigi is in use at all.
+	The first request connects, like fldigi_set_mode() does. Requests
+	queued when the connection can't be made are dropped, and until it
+	is made fldigi_request() refuses new ones, so the caller can tell.
+	The tx/rx state is polled while in use, and kept here for
+	modem_poll() to pick up. A main.tx or main.rx that is
+	queued changes the kept state at once, and a poll already on the way
+	then doesn't overwrite it.
+*/
+
+#define FLDIGI_REPLY_LEN 32768
+
+struct fldigi_request {
+	char method[32];
+	char param[FLDIGI_PARAM_LEN];
+};
+
+static pthread_mutex_t fldigi_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fldigi_cond;
+static struct fldigi_request queue[FLDIGI_QUEUE];
+static int queue_head = 0, queue_count = 0;
+static char trx_state[8] = "RX";
+static unsigned int trx_changes = 0;
+
+// set from the audio thread, so these are not under the mutex
+static _Atomic(const char *) mode_wanted = NULL;
+static atomic_int carrier_wanted = -1;
+static atomic_uint activity = 0;
+static atomic_bool connected = false;
+static atomic_bool unreachable = false;	// the last attempt to connect failed
+
+// only touched by the client thread, after fldigi_start()
+static char fldigi_host[64];
+static int fldigi_port;
+static int fldigi_socket = -1;
+static bool fldigi_started = false;
+
+static long fldigi_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/* ---- Base64 Encoding/Decoding Table --- */
+static char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* decodeblock - decode 4 '6-bit' characters into 3 8-bit binary bytes */
+static void decodeblock(unsigned char in[], char *clrstr) {
+  unsigned char out[4];
+  out[0] = in[0] << 2 | in[1] >> 4;
+  out[1] = in[1] << 4 | in[2] >> 2;
+  out[2] = in[2] << 6 | in[3] >> 0;
+  out[3] = '\0';
+  strcat(clrstr, (char *)out);
+}
+
+static void b64_decode(char *b64src, char *clrdst) {
+  int c, phase, i;
+  unsigned char in[4];
+  char *p;
+
+  clrdst[0] = '\0';
+  phase = 0; i=0;
+  while(b64src[i]) {
+    c = (int) b64src[i];
+    if(c == '=') {
+      decodeblock(in, clrdst);
+      break;
+    }
+    p = strchr(b64, c);
+    if(p) {
+      in[phase] = p - b64;
+      phase = (phase + 1) % 4;
+      if(phase == 0) {
+        decodeblock(in, clrdst);
+        in[0]=in[1]=in[2]=in[3]=0;
+      }
+    }
+    i++;
+  }
+}
+
+static int fldigi_connect()
+{
+	struct sockaddr_in addr;
+	struct timeval timeout;
+	int one = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(fldigi_port);
+	addr.sin_addr.s_addr = inet_addr(fldigi_host);
+
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	if (s < 0)
+		return -1;
+	timeout.tv_sec = FLDIGI_TIMEOUT_MS / 1000;
+	timeout.tv_usec = (FLDIGI_TIMEOUT_MS % 1000) * 1000;
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+	setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+	if (connect(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+/*!
+	Send one HTTP request down fldigi_socket and read the reply, leaving
+	its body (null-terminated) in \a body. Returns the length of the body,
+	or -1 if the connection failed; fldigi_socket is then closed.
+*/
+static int fldigi_exchange(const char *request, char *body, int body_len)
+{
+	static char buff[FLDIGI_REPLY_LEN];
+	int len = strlen(request), n = 0;
+	int header_len = -1, content_len = -1;
+	bool keep_alive = true;
+
+	while (n < len) {
+		int e = send(fldigi_socket, request + n, len - n, MSG_NOSIGNAL);
+		if (e <= 0)
+			goto failed;
+		n += e;
+	}
+
+	n = 0;
+	while (header_len < 0 || n < header_len + content_len) {
+		if (n >= (int)sizeof(buff) - 1)
+			goto failed;
+		int e = recv(fldigi_socket, buff + n, sizeof(buff) - 1 - n, 0);
+		if (e <= 0) {
+			// without a Content-Length, the body ends when fldigi closes
+			if (e == 0 && header_len >= 0 && content_len < 0)
+				break;
+			goto failed;
+		}
+		n += e;
+		buff[n] = 0;
+		if (header_len >= 0)
+			continue;
+
+		char *end = strstr(buff, "\r\n\r\n");
+		if (end)
+			header_len = end + 4 - buff;
+		else if ((end = strstr(buff, "\n\n")))
+			header_len = end + 2 - buff;
+		else
+			continue;
+
+		for (char *line = buff; line && line < buff + header_len; ) {
+			if (!strncasecmp(line, "Content-Length:", 15))
+				content_len = atoi(line + 15);
+			else if (!strncasecmp(line, "Connection:", 11)) {
+				char *v = line + 11;
+				while (*v == ' ')
+					v++;
+				if (!strncasecmp(v, "close", 5))
+					keep_alive = false;
+			}
+			line = strchr(line, '\n');
+			if (line)
+				line++;
+		}
+		if (content_len < 0) {
+			keep_alive = false;
+			content_len = sizeof(buff);
+		}
+	}
+
+	n -= header_len;
+	if (n > content_len)
+		n = content_len;
+	if (n > body_len - 1)
+		n = body_len - 1;
+	memcpy(body, buff + header_len, n);
+	body[n] = 0;
+	if (!keep_alive) {
+		close(fldigi_socket);
+		fldigi_socket = -1;
+	}
+	return n;
+
+failed:
+	close(fldigi_socket);
+	fldigi_socket = -1;
+	return -1;
+}
+
+// copy \a text into \a xml with the characters that XML reserves escaped
+static void xml_escape(const char *text, char *xml)
+{
+	for (; *text; text++) {
+		switch (*text) {
+		case '<': strcpy(xml, "&lt;"); xml += 4; break;
+		case '>': strcpy(xml, "&gt;"); xml += 4; break;
+		case '&': strcpy(xml, "&amp;"); xml += 5; break;
+		default: *xml++ = *text;
+		}
+	}
+	*xml = 0;
+}
+
+/*!
+	Call \a method with one parameter: \a param as a string, or as an i4
+	if \a is_int. The value returned by fldigi goes into \a result, decoded
+	if it is base64. Returns 0, 1 if fldigi returned a fault, or -1 if
+	the connection failed; fldigi_socket is then closed. It is also
+	closed after a reply if fldigi asked for that, without it being a
+	failure.
+*/
+static int fldigi_call(const char *method, const char *param, bool is_int, char *result)
+{
+	static char value[FLDIGI_PARAM_LEN * 5];
+	static char xml[FLDIGI_PARAM_LEN * 5 + 512], q[FLDIGI_PARAM_LEN * 5 + 1024];
+	static char body[FLDIGI_REPLY_LEN];
+
+	*result = 0;
+	xml_escape(param, value);
+	sprintf(xml,
+"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+"<methodCall><methodName>%s</methodName>\n"
+"<params>\n<param><value><%s>%s</%s></value></param> </params></methodCall>\n",
+		method, is_int ? "i4" : "string", value, is_int ? "i4" : "string");
+
+	sprintf(q,
+		"POST / HTTP/1.1\r\n"
+		"Host: %s:%d\r\n"
+		"User-Agent: sbitx/v0.01\r\n"
+		"Connection: keep-alive\r\n"
+		"Content-Length: %d\r\n"
+		"Content-Type: text/xml\r\n\r\n"
+		"%s",
+		fldigi_host, fldigi_port, (int)strlen(xml), xml);
+
+	int n = -1;
+	for (int attempt = 0; attempt < 2 && n < 0; attempt++) {
+		bool reused = fldigi_socket >= 0;
+		if (!reused && (fldigi_socket = fldigi_connect()) < 0)
+			return -1;
+		n = fldigi_exchange(q, body, sizeof(body));
+		if (n < 0 && !reused)
+			return -1;
+	}
+	if (n < 0)
+		return -1;
+
+	if (strstr(body, "<fault>")) {
+		printf("fldigi: %s failed\n", method);
+		return 1;
+	}
+
+	//now check if we got the data in base64
+	char *p = strstr(body, "<base64>");
+	if (p) {
+		p += strlen("<base64>");
+		char *r = strchr(p, '<');
+		if (r) {
+			*r = 0;
+			b64_decode(p, result);
+		}
+	}
+	//maybe it is not base64 encoded
+	else if ((p = strstr(body, "<value>"))) {
+		p += strlen("<value>");
+		if (!strncmp(p, "<string>", 8))
+			p += 8;
+		char *r = strchr(p, '<');
+		if (r) {
+			*r = 0;
+			strcpy(result, p);
+		}
+	}
+	return 0;
+}
+
+// drop whatever is queued, as there is no one to send it to
+static void queue_drop()
+{
+	pthread_mutex_lock(&fldigi_mutex);
+	if (queue_count) {
+		printf("fldigi: not connected, %d requests dropped\n", queue_count);
+		//a main.tx that was dropped never reached fldigi
+		strcpy(trx_state, "RX");
+		trx_changes++;
+	}
+	queue_count = 0;
+	pthread_mutex_unlock(&fldigi_mutex);
+}
+
+static bool queue_pop(struct fldigi_request *req)
+{
+	bool popped = false;
+	pthread_mutex_lock(&fldigi_mutex);
+	if (queue_count) {
+		*req = queue[queue_head];
+		queue_head = (queue_head + 1) % FLDIGI_QUEUE;
+		queue_count--;
+		popped = true;
+	}
+	pthread_mutex_unlock(&fldigi_mutex);
+	return popped;
+}
+
+/*!
+	One pass of the client over a live connection: the settings that
+	changed, the queued requests, and the poll if it is due.
+	Returns -1 if the connection was lost on the way; fldigi closing it
+	after a reply is not a loss, the next call connects again.
+*/
+static int fldigi_service(bool active, long *next_poll)
+{
+	static char result[FLDIGI_REPLY_LEN];
+	static char mode_sent[32] = "";
+	static int carrier_sent = -1;
+	struct fldigi_request req;
+
+	// a new connection may be to a fldigi that was restarted
+	if (!atomic_load(&connected)) {
+		mode_sent[0] = 0;
+		carrier_sent = -1;
+		atomic_store(&connected, true);
+	}
+
+	const char *mode = atomic_load(&mode_wanted);
+	if (mode && strcmp(mode, mode_sent)) {
+		if (fldigi_call("modem.set_by_name", mode, false, result) < 0)
+			return -1;
+		//a fault would only be repeated, so it counts as sent too
+		strncpy(mode_sent, mode, sizeof(mode_sent) - 1);
+		*next_poll = fldigi_now() + FLDIGI_POLL_MS;
+	}
+
+	int carrier = atomic_load(&carrier_wanted);
+	if (carrier >= 0 && carrier != carrier_sent) {
+		char param[16];
+		sprintf(param, "%d", carrier);
+		if (fldigi_call("modem.set_carrier", param, true, result) < 0)
+			return -1;
+		carrier_sent = carrier;
+	}
+
+	while (queue_pop(&req)) {
+		if (fldigi_call(req.method, req.param, false, result) < 0)
+			return -1;
+	}
+
+	pthread_mutex_lock(&fldigi_mutex);
+	unsigned int changes = trx_changes;
+	pthread_mutex_unlock(&fldigi_mutex);
+
+	if (!active || fldigi_now() < *next_poll)
+		return 0;
+	*next_poll = fldigi_now() + FLDIGI_POLL_MS;
+
+	int e = fldigi_call("main.get_trx_state", "", false, result);
+	if (!e) {
+		pthread_mutex_lock(&fldigi_mutex);
+		if (changes == trx_changes)
+			strncpy(trx_state, result, sizeof(trx_state) - 1);
+		pthread_mutex_unlock(&fldigi_mutex);
+	}
+	return e < 0 ? -1 : 0;
+}
+
+static void *fldigi_thread(void *arg)
+{
+	(void)arg;
+	unsigned int activity_seen = 0;
+	long last_active = fldigi_now() - FLDIGI_IDLE_MS;
+	long retry_at = 0, next_poll = 0;
+	int backoff = FLDIGI_BACKOFF_MIN_MS;
+
+	while (1) {
+		//sleep until there is a request, or for a tenth of the poll
+		pthread_mutex_lock(&fldigi_mutex);
+		if (!queue_count) {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			ts.tv_nsec += FLDIGI_POLL_MS * 100000L;
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&fldigi_cond, &fldigi_mutex, &ts);
+		}
+		pthread_mutex_unlock(&fldigi_mutex);
+
+		long now = fldigi_now();
+		unsigned int a = atomic_load(&activity);
+		if (a != activity_seen) {
+			activity_seen = a;
+			last_active = now;
+		}
+		bool active = now - last_active < FLDIGI_IDLE_MS;
+
+		//after a graceful close, fldigi_service() connects again as it needs to
+		if (fldigi_socket < 0 && !atomic_load(&connected)) {
+			if (!active || now < retry_at) {
+				queue_drop();
+				continue;
+			}
+			fldigi_socket = fldigi_connect();
+			if (fldigi_socket < 0) {
+				retry_at = now + backoff;
+				backoff = backoff * 2 > FLDIGI_BACKOFF_MAX_MS ? FLDIGI_BACKOFF_MAX_MS : backoff * 2;
+				atomic_store(&unreachable, true);
+				queue_drop();
+				continue;
+			}
+			printf("fldigi: connected to %s:%d\n", fldigi_host, fldigi_port);
+			backoff = FLDIGI_BACKOFF_MIN_MS;
+			atomic_store(&unreachable, false);
+		}
+
+		if (fldigi_service(active, &next_poll) < 0) {
+			puts("fldigi: connection lost");
+			atomic_store(&connected, false);
+			atomic_store(&unreachable, true);
+			queue_drop();
+			retry_at = fldigi_now() + backoff;
+		}
+	}
+	return NULL;
+}
+
+/*!
+	Start the client thread, talking to fldigi at \a host (a dotted
+	address) and \a port. It only connects once fldigi is in use, with the
+	first fldigi_set_mode() or fldigi_request().
+*/
+void fldigi_start(const char *host, int port)
+{
+	pthread_t thread;
+	pthread_condattr_t attr;
+
+	if (fldigi_started)
+		return;
+	strncpy(fldigi_host, host, sizeof(fldigi_host) - 1);
+	fldigi_port = port;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&fldigi_cond, &attr);
+	pthread_condattr_destroy(&attr);
+	if (pthread_create(&thread, NULL, fldigi_thread, NULL)) {
+		puts("fldigi: unable to start the client thread");
+		return;
+	}
+	pthread_detach(thread);
+	fldigi_started = true;
+}
+
+/*!
+	Ask for fldigi's modem to be \a mode (as named by modem.set_by_name).
+	\a mode is kept, not copied, so it has to be a string constant. Calling
+	this also marks fldigi as in use, so it is called with every block
+	received in a mode that fldigi demodulates. Safe from the audio thread.
+*/
+void fldigi_set_mode(const char *mode)
+{
+	atomic_store(&mode_wanted, mode);
+	atomic_fetch_add(&activity, 1);
+}
+
+// Ask for fldigi's audio carrier to be \a pitch Hz. Safe from the audio thread.
+void fldigi_set_carrier(int pitch)
+{
+	atomic_store(&carrier_wanted, pitch);
+}
+
+/*!
+	Queue a call of \a method, with \a param as its string parameter.
+	This marks fldigi as in use, so the client thread connects if it
+	hasn't. Returns 0, or -1 if the last attempt to connect failed (it is
+	tried again, backing off) or the queue is full.
+*/
+int fldigi_request(const char *method, const char *param)
+{
+	atomic_fetch_add(&activity, 1);
+	if (!fldigi_started || atomic_load(&unreachable))
+		return -1;
+
+	pthread_mutex_lock(&fldigi_mutex);
+	if (queue_count == FLDIGI_QUEUE) {
+		pthread_mutex_unlock(&fldigi_mutex);
+		return -1;
+	}
+	struct fldigi_request *req = queue + (queue_head + queue_count) % FLDIGI_QUEUE;
+	strncpy(req->method, method, sizeof(req->method) - 1);
+	req->method[sizeof(req->method) - 1] = 0;
+	strncpy(req->param, param, sizeof(req->param) - 1);
+	req->param[sizeof(req->param) - 1] = 0;
+	queue_count++;
+	if (!strcmp(method, "main.tx") || !strcmp(method, "main.rx")) {
+		strcpy(trx_state, method[5] == 't' ? "TX" : "RX");
+		trx_changes++;
+	}
+	pthread_cond_signal(&fldigi_cond);
+	pthread_mutex_unlock(&fldigi_mutex);
+	return 0;
+}
+
+bool fldigi_connected()
+{
+	return atomic_load(&connected);
+}
+
+// Whether fldigi was last known to be receiving.
+bool fldigi_in_rx()
+{
+	pthread_mutex_lock(&fldigi_mutex);
+	bool rx = !strcmp(trx_state, "RX");
+	pthread_mutex_unlock(&fldigi_mutex);
+	return rx;
+}
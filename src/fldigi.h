@@ -0,0 +1,34 @@
+#ifndef FLDIGI_H
+#define FLDIGI_H
+
+#include <stdbool.h>
+
+/*
+	Client for fldigi's XML-RPC interface, which we use to transmit
+	RTTY (modem_rtty.c receives it). All the talking to fldigi is done
+	by a thread of its own over one kept-alive connection; the rest of
+	sbitx only queues requests and reads what that thread last heard, so
+	a slow or absent fldigi never holds up the audio or the UI.
+	The mode and the carrier are settings rather than requests: only the
+	latest of each is kept and sent when it differs from what fldigi has,
+	so they can be set from the audio thread, which doesn't take locks.
+*/
+
+#define FLDIGI_HOST "127.0.0.1"
+#define FLDIGI_PORT 7362
+#define FLDIGI_QUEUE 64			// queued requests
+#define FLDIGI_PARAM_LEN 256
+#define FLDIGI_POLL_MS 250			// tx/rx state, while fldigi is in use
+#define FLDIGI_IDLE_MS 2000		// no longer in use after this long without fldigi_set_mode() or fldigi_request()
+#define FLDIGI_BACKOFF_MIN_MS 250
+#define FLDIGI_BACKOFF_MAX_MS 8000
+#define FLDIGI_TIMEOUT_MS 1000	// for one reply
+
+void fldigi_start(const char *host, int port);
+void fldigi_set_mode(const char *mode);
+void fldigi_set_carrier(int pitch);
+int fldigi_request(const char *method, const char *param);
+bool fldigi_connected();
+bool fldigi_in_rx();
+
+#endif /* FLDIGI_H */
@@ -21,25 +21,35 @@
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <ctype.h>
+#include <stdarg.h>
 #include <arpa/inet.h>
 #include <gtk/gtk.h>
 #include "sdr.h"
 #include "sdr_ui.h"
 #include "logbook.h"
+#include "logbook_model.h"
+#include "qso_index.h"
+#include "worked.h"
+#include "cty.h"
+#include "scp.h"
+#include "adif.h"
 #include "adif_broadcast.h"
 
 #include <sqlite3.h>
 
 static int rc;
 static sqlite3* db = NULL;
-GtkListStore* list_store = NULL;
+static LogbookModel* log_model = NULL;
+static char logbook_search_text[32]; // what is in the logbook window search box
 GtkTreeSelection* selection = NULL;
 GtkWidget* logbook_window = NULL;
 GtkWidget* tree_view = NULL;
 
-int logbook_fill(int from_id, int count, const char* query);
 void logbook_refill(const char* query);
-void clear_tree(GtkListStore* list_store);
+static void logbook_index_build(sqlite3* conn, bool worked);
+static void logbook_index_add_row(sqlite3_stmt* stmt);
+static void logbook_index_add_fields(const char* const names[], const char* const values[], int n);
+static void logbook_worked_row(sqlite3_stmt* stmt, int delta);
 
 int logbook_has_power_swr_xota() {
 	static int ret = -1;
@@ -59,6 +69,357 @@ int logbook_has_power_swr_xota() {
 	return ret;
 }
 
+/*
+	Full-text and fuzzy search. logbook_fts is an FTS5 index over the text
+	columns of the logbook (so that comments, exchanges and xOTA references
+	can be searched by word or word prefix); logbook_calls is a trigram index
+	of callsign_recv, used both for callsign prefixes and to find the
+	candidates for a fuzzy match, which callsign_similarity() then checks.
+	Both are external-content tables: they keep only the index, and the
+	triggers below keep them in sync with the logbook table, whoever writes it.
+	If this sqlite has no FTS5, searches only match callsign prefixes, as before.
+*/
+
+#define SEARCH_SIMILARITY 0.6
+
+static bool logbook_fts_ok = false;
+
+struct logbook_search {
+	char prefix[34];	// callsign LIKE pattern
+	char words[200];	// FTS5 query: all the words, as prefixes
+	char trigrams[1300];	// FTS5 query: any 1 (or 2) of the trigrams of the callsign
+	char call[16];		// the callsign to compare against, for a fuzzy match
+};
+
+// Collect the trigrams of \a call, padded the way pg_trgm does ("  K1ABC "); returns how many.
+static int callsign_trigrams(const char* call, char trigrams[][3], int max)
+{
+	char padded[24];
+	int n = 0;
+
+	snprintf(padded, sizeof(padded), "  %.20s ", call);
+	for (int i = 0; padded[i + 2] && n < max; i++) {
+		char t[3] = {toupper(padded[i]), toupper(padded[i + 1]), toupper(padded[i + 2])};
+		int j;
+		for (j = 0; j < n && memcmp(trigrams[j], t, 3); j++)
+			;
+		if (j == n)
+			memcpy(trigrams[n++], t, 3);
+	}
+	return n;
+}
+
+/*!
+	SQL function callsign_similarity(a, b): the fraction of trigrams that
+	two callsigns share (Dice coefficient), from 0 to 1. One wrong or
+	missing character in a 5 or 6 character callsign scores 0.6 to 0.75.
+*/
+static void callsign_similarity(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+	char a[24][3], b[24][3];
+	const char* call_a = sqlite3_value_text(argv[0]);
+	const char* call_b = sqlite3_value_text(argv[1]);
+
+	if (!call_a || !call_b) {
+		sqlite3_result_double(context, 0);
+		return;
+	}
+	int n_a = callsign_trigrams(call_a, a, 24);
+	int n_b = callsign_trigrams(call_b, b, 24);
+	int common = 0;
+	for (int i = 0; i < n_a; i++)
+		for (int j = 0; j < n_b; j++)
+			if (!memcmp(a[i], b[j], 3)) {
+				common++;
+				break;
+			}
+	sqlite3_result_double(context, n_a + n_b ? 2.0 * common / (n_a + n_b) : 0);
+}
+
+// The indexed columns, as they are named in the logbook table, and with new. and old.
+static void logbook_fts_columns(const char** cols, const char** new_cols, const char** old_cols)
+{
+	*cols = logbook_has_power_swr_xota() ?
+		"callsign_recv, exch_sent, exch_recv, comments, xota_loc" :
+		"callsign_recv, exch_sent, exch_recv, comments";
+	*new_cols = logbook_has_power_swr_xota() ?
+		"new.callsign_recv, new.exch_sent, new.exch_recv, new.comments, new.xota_loc" :
+		"new.callsign_recv, new.exch_sent, new.exch_recv, new.comments";
+	*old_cols = logbook_has_power_swr_xota() ?
+		"old.callsign_recv, old.exch_sent, old.exch_recv, old.comments, old.xota_loc" :
+		"old.callsign_recv, old.exch_sent, old.exch_recv, old.comments";
+}
+
+// format arguments: cols, new_cols
+#define LOGBOOK_FTS_INSERT_TRIGGER \
+	"CREATE TRIGGER IF NOT EXISTS logbook_search_ai AFTER INSERT ON logbook BEGIN" \
+	" INSERT INTO logbook_fts(rowid, %s) VALUES (new.id, %s);" \
+	" INSERT INTO logbook_calls(rowid, callsign_recv) VALUES (new.id, new.callsign_recv);" \
+	" END;"
+
+/*!
+	Create the search indexes and their triggers on \a conn if any of them
+	are missing, and (re)index what is already in the log.
+*/
+static void logbook_fts_open(sqlite3* conn)
+{
+	sqlite3_stmt* stmt;
+	char* err = NULL;
+	char sql[2500];
+	int count = 0;
+
+	sqlite3_create_function(conn, "callsign_similarity", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+		NULL, callsign_similarity, NULL, NULL);
+
+	if (sqlite3_prepare_v2(conn, "SELECT count(*) FROM sqlite_master WHERE name IN ('logbook_fts',"
+			"'logbook_calls', 'logbook_search_ai', 'logbook_search_ad', 'logbook_search_au');",
+			-1, &stmt, NULL) == SQLITE_OK) {
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+			count = sqlite3_column_int(stmt, 0);
+		sqlite3_finalize(stmt);
+	}
+	if (count == 5) {
+		logbook_fts_ok = true;
+		return;
+	}
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	const char *cols, *new_cols, *old_cols;
+	logbook_fts_columns(&cols, &new_cols, &old_cols);
+	snprintf(sql, sizeof(sql),
+		"BEGIN;"
+		"CREATE VIRTUAL TABLE IF NOT EXISTS logbook_fts USING fts5(%s, content='logbook', content_rowid='id');"
+		"CREATE VIRTUAL TABLE IF NOT EXISTS logbook_calls USING fts5(callsign_recv, content='logbook', content_rowid='id', tokenize='trigram');"
+		LOGBOOK_FTS_INSERT_TRIGGER
+		"CREATE TRIGGER IF NOT EXISTS logbook_search_ad AFTER DELETE ON logbook BEGIN"
+		" INSERT INTO logbook_fts(logbook_fts, rowid, %s) VALUES ('delete', old.id, %s);"
+		" INSERT INTO logbook_calls(logbook_calls, rowid, callsign_recv) VALUES ('delete', old.id, old.callsign_recv);"
+		" END;"
+		"CREATE TRIGGER IF NOT EXISTS logbook_search_au AFTER UPDATE ON logbook BEGIN"
+		" INSERT INTO logbook_fts(logbook_fts, rowid, %s) VALUES ('delete', old.id, %s);"
+		" INSERT INTO logbook_calls(logbook_calls, rowid, callsign_recv) VALUES ('delete', old.id, old.callsign_recv);"
+		" INSERT INTO logbook_fts(rowid, %s) VALUES (new.id, %s);"
+		" INSERT INTO logbook_calls(rowid, callsign_recv) VALUES (new.id, new.callsign_recv);"
+		" END;"
+		"INSERT INTO logbook_fts(logbook_fts) VALUES ('rebuild');"
+		"INSERT INTO logbook_calls(logbook_calls) VALUES ('rebuild');"
+		"COMMIT;",
+		cols, cols, new_cols, cols, old_cols, cols, old_cols, cols, new_cols);
+	if (sqlite3_exec(conn, sql, NULL, NULL, &err) != SQLITE_OK) {
+		fprintf(stderr, "Logbook search index not available: %s\n", err);
+		sqlite3_free(err);
+		sqlite3_exec(conn, "ROLLBACK;", NULL, NULL, NULL);
+		return;
+	}
+	logbook_fts_ok = true;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	printf("Logbook search index built in %ld ms\n",
+		(t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000);
+}
+
+/*!
+	Stop indexing new QSOs, for a bulk import: indexing them all at once
+	afterwards, with logbook_fts_resume(), is several times faster.
+	Edits and deletes are still indexed as they happen.
+	Returns the id of the last QSO that is indexed.
+*/
+static sqlite3_int64 logbook_fts_suspend(sqlite3* conn)
+{
+	sqlite3_stmt* stmt;
+	sqlite3_int64 last_id = 0;
+
+	sqlite3_exec(conn, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+	sqlite3_exec(conn, "DROP TRIGGER IF EXISTS logbook_search_ai;", NULL, NULL, NULL);
+	if (sqlite3_prepare_v2(conn, "SELECT max(id) FROM logbook;", -1, &stmt, NULL) == SQLITE_OK) {
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+			last_id = sqlite3_column_int64(stmt, 0);
+		sqlite3_finalize(stmt);
+	}
+	sqlite3_exec(conn, "COMMIT;", NULL, NULL, NULL);
+	return last_id;
+}
+
+// Index the QSOs added after \a last_id, and go back to indexing them as they are added.
+static void logbook_fts_resume(sqlite3* conn, sqlite3_int64 last_id)
+{
+	const char *cols, *new_cols, *old_cols;
+	char sql[1000];
+	char* err = NULL;
+
+	logbook_fts_columns(&cols, &new_cols, &old_cols);
+	snprintf(sql, sizeof(sql),
+		"BEGIN IMMEDIATE;"
+		"INSERT INTO logbook_fts(rowid, %s) SELECT id, %s FROM logbook WHERE id > %lld;"
+		"INSERT INTO logbook_calls(rowid, callsign_recv) SELECT id, callsign_recv FROM logbook WHERE id > %lld;"
+		LOGBOOK_FTS_INSERT_TRIGGER
+		"COMMIT;",
+		cols, cols, (long long)last_id, (long long)last_id, cols, new_cols);
+	if (sqlite3_exec(conn, sql, NULL, NULL, &err) != SQLITE_OK) {
+		fprintf(stderr, "Failed to update the logbook search index: %s\n", err);
+		sqlite3_free(err);
+		sqlite3_exec(conn, "ROLLBACK;", NULL, NULL, NULL);
+	}
+}
+
+/*!
+	Turn what was typed in a search box into the parameters of logbook_search_where().
+*/
+static void logbook_search_parse(const char* query, struct logbook_search* s)
+{
+	char word[34];
+	int words_len = 0, n;
+
+	memset(s, 0, sizeof(*s));
+	// callsign prefix: the whole query, without LIKE wildcards
+	n = 0;
+	for (const char* p = query; *p && n < sizeof(s->prefix) - 2; p++)
+		if (*p != '%' && *p != '_')
+			s->prefix[n++] = *p;
+	s->prefix[n] = '%';
+	if (!logbook_fts_ok)
+		return;
+
+	// every word (letters, digits, / and -) must be there, at least as a prefix: "w1aw"* "k-1234"*
+	int n_words = 0;
+	for (const char* p = query; *p; ) {
+		n = 0;
+		while (*p && !isalnum(*p) && *p != '/' && *p != '-')
+			p++;
+		while (*p && (isalnum(*p) || *p == '/' || *p == '-')) {
+			if (n < sizeof(word) - 1)
+				word[n++] = *p;
+			p++;
+		}
+		word[n] = 0;
+		if (!n)
+			continue;
+		// single letters would match a good part of the log
+		if (n > 1 && words_len < sizeof(s->words))
+			words_len += snprintf(s->words + words_len, sizeof(s->words) - words_len,
+				"%s\"%s\"*", words_len ? " " : "", word);
+		if (!n_words++)
+			strncpy(s->call, word, sizeof(s->call) - 1);
+	}
+
+	// a single word could be a misremembered callsign
+	if (n_words != 1 || strlen(s->call) < 3) {
+		s->call[0] = 0;
+		return;
+	}
+	char trigrams[24][3];
+	int n_trigrams = callsign_trigrams(s->call, trigrams, 24);
+	int n_inner = 0, len = 0;
+	// only the trigrams without padding are in the index
+	for (int i = 0; i < n_trigrams; i++)
+		if (!memchr(trigrams[i], ' ', 3))
+			memcpy(trigrams[n_inner++], trigrams[i], 3);
+	// A call of 6 or more characters that is similar enough shares at least
+	// 2 of them: asking for any 2 instead of any 1 skips most of the calls
+	// that only have the same prefix.
+	for (int i = 0; i < n_inner; i++) {
+		if (n_inner < 4 && len < sizeof(s->trigrams))
+			len += snprintf(s->trigrams + len, sizeof(s->trigrams) - len,
+				"%s\"%.3s\"", len ? " OR " : "", trigrams[i]);
+		else
+			for (int j = i + 1; j < n_inner && len < sizeof(s->trigrams); j++)
+				len += snprintf(s->trigrams + len, sizeof(s->trigrams) - len,
+					"%s(\"%.3s\" \"%.3s\")", len ? " OR " : "", trigrams[i], trigrams[j]);
+	}
+	if (len >= sizeof(s->trigrams))
+		s->trigrams[0] = 0;
+}
+
+/*!
+	Write into \a buf the SQL condition for the logbook rows that match \a s:
+	a callsign that starts with the query, the words of the query in any
+	of the text columns, or a callsign that is similar to the query.
+	The parameters are bound by logbook_search_bind().
+*/
+static void logbook_search_where(const struct logbook_search* s, char* buf, int len)
+{
+	char ids[600];
+	int n = 0;
+
+	if (!logbook_fts_ok) {
+		snprintf(buf, len, "callsign_recv LIKE :prefix");
+		return;
+	}
+	// a UNION of rowid lists, so that sqlite looks up just those rows
+	ids[0] = 0;
+	// the trigram index only helps with 3 characters or more
+	bool short_prefix = s->prefix[0] && strlen(s->prefix) < 4;
+	if (s->prefix[0] && !short_prefix)
+		n += snprintf(ids + n, sizeof(ids) - n,
+			"SELECT rowid FROM logbook_calls WHERE callsign_recv LIKE :prefix");
+	if (s->words[0])
+		n += snprintf(ids + n, sizeof(ids) - n,
+			"%sSELECT rowid FROM logbook_fts WHERE logbook_fts MATCH :words", n ? " UNION " : "");
+	if (s->trigrams[0])
+		n += snprintf(ids + n, sizeof(ids) - n,
+			"%sSELECT rowid FROM logbook_calls WHERE logbook_calls MATCH :trigrams"
+			" AND callsign_similarity(callsign_recv, :call) >= %g", n ? " UNION " : "", SEARCH_SIMILARITY);
+
+	if (short_prefix && n)
+		snprintf(buf, len, "(callsign_recv LIKE :prefix OR id IN (%s))", ids);
+	else if (short_prefix)
+		snprintf(buf, len, "callsign_recv LIKE :prefix");
+	else if (n)
+		snprintf(buf, len, "id IN (%s)", ids);
+	else
+		snprintf(buf, len, "0");
+}
+
+static void logbook_search_bind(sqlite3_stmt* stmt, const struct logbook_search* s)
+{
+	int i;
+	if ((i = sqlite3_bind_parameter_index(stmt, ":prefix")))
+		sqlite3_bind_text(stmt, i, s->prefix, -1, SQLITE_STATIC);
+	if ((i = sqlite3_bind_parameter_index(stmt, ":words")))
+		sqlite3_bind_text(stmt, i, s->words, -1, SQLITE_STATIC);
+	if ((i = sqlite3_bind_parameter_index(stmt, ":trigrams")))
+		sqlite3_bind_text(stmt, i, s->trigrams, -1, SQLITE_STATIC);
+	if ((i = sqlite3_bind_parameter_index(stmt, ":call")))
+		sqlite3_bind_text(stmt, i, s->call, -1, SQLITE_STATIC);
+}
+
+/*!
+	Find the ids of the QSOs matching \a query (see logbook_search_where()).
+	Returns how many there are; \a ids is set to a new array of them,
+	to be freed with g_free().
+*/
+int logbook_search_ids(const char* query, int** ids)
+{
+	struct logbook_search s;
+	sqlite3_stmt* stmt;
+	char statement[800];
+	int n = 0, cap = 256;
+
+	*ids = NULL;
+	logbook_open();
+	if (!logbook_fts_ok || !query || !query[0])
+		return 0;
+	logbook_search_parse(query, &s);
+	s.prefix[0] = 0; // the logbook model matches callsign prefixes itself
+	strcpy(statement, "SELECT id FROM logbook WHERE ");
+	logbook_search_where(&s, statement + strlen(statement), sizeof(statement) - strlen(statement));
+	if (sqlite3_prepare_v2(db, statement, -1, &stmt, NULL) != SQLITE_OK) {
+		fprintf(stderr, "Logbook search: %s\n", sqlite3_errmsg(db));
+		return 0;
+	}
+	logbook_search_bind(stmt, &s);
+	*ids = g_new(int, cap);
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		if (n == cap) {
+			cap *= 2;
+			*ids = g_renew(int, *ids, cap);
+		}
+		(*ids)[n++] = sqlite3_column_int(stmt, 0);
+	}
+	sqlite3_finalize(stmt);
+	return n;
+}
+
 /*!
 	Writes the output into a temporary file and copies the file path into
 	\a result_file, a string with length \a result_file_len.
@@ -67,45 +428,42 @@ int logbook_has_power_swr_xota() {
 	- If \a from_id is negative: writes the next 50 records with a higher id than that
 	- If \a from_id is positive: writes 50 records prior to it (those with a lower id)
 	- If \a from_id is \c 0: writes the most-recent 50 records
+	If \a query is not null, only the records matching it are written: see logbook_search_where().
 */
 int logbook_query(char* query, int from_id, char* result_file, int result_file_len)
 {
 	sqlite3_stmt* stmt;
-	char statement[200], param[2000];
+	struct logbook_search search;
+	char statement[800], param[2000];
+	int len;
 
 	logbook_open();
 
-	// add to the bottom of the logbook
-	if (from_id > 0) {
-		if (query)
-			snprintf(statement, sizeof(statement), "select * from logbook "
-							   "where (callsign_recv LIKE '%s%%' AND id < %d) ",
-				query, from_id);
-		else
-			snprintf(statement, sizeof(statement), "select * from logbook where id < %d ", from_id);
+	len = snprintf(statement, sizeof(statement), "select * from logbook where ");
+	if (query) {
+		logbook_search_parse(query, &search);
+		logbook_search_where(&search, statement + len, sizeof(statement) - len);
+		len = strlen(statement);
+		len += snprintf(statement + len, sizeof(statement) - len, " AND ");
 	}
+	// add to the bottom of the logbook
+	if (from_id > 0)
+		len += snprintf(statement + len, sizeof(statement) - len, "id < %d ", from_id);
 	// last 50 QSOs
-	else if (from_id == 0) {
-		if (query)
-			snprintf(statement, sizeof(statement), "select * from logbook "
-							   "where callsign_recv LIKE '%s%%' ",
-				query);
-		else
-			strncpy(statement, "select * from logbook ", sizeof(statement));
-	}
+	else if (from_id == 0)
+		len += snprintf(statement + len, sizeof(statement) - len, "1 ");
 	// latest QSOs after from_id (top of the log)
-	else {
-		if (query)
-			snprintf(statement, sizeof(statement), "select * from logbook "
-							   "where (callsign_recv LIKE '%s%%' AND id > %d) ",
-				query, -from_id);
-		else
-			snprintf(statement, sizeof(statement), "select * from logbook where id > %d ", -from_id);
-	}
-	strcat(statement, "ORDER BY id DESC LIMIT 50;");
+	else
+		len += snprintf(statement + len, sizeof(statement) - len, "id > %d ", -from_id);
+	snprintf(statement + len, sizeof(statement) - len, "ORDER BY id DESC LIMIT 50;");
 
 	// printf("[%s]\n", statement);
-	sqlite3_prepare_v2(db, statement, -1, &stmt, NULL);
+	if (sqlite3_prepare_v2(db, statement, -1, &stmt, NULL) != SQLITE_OK) {
+		fprintf(stderr, "logbook_query: %s\n", sqlite3_errmsg(db));
+		return -1;
+	}
+	if (query)
+		logbook_search_bind(stmt, &search);
 
  	const char *output_path = "/tmp/sbitx_result_rows.txt";
 	strncpy(result_file, output_path, result_file_len);
@@ -152,6 +510,9 @@ int logbook_count_dup(const char* callsign, int last_seconds)
 	sqlite3_stmt* stmt;
 
 	time_t log_time = time_sbitx() - last_seconds;
+	if (qso_index_ready())
+		return qso_index_count_since(callsign, log_time);
+
 	struct tm* tmp = gmtime(&log_time);
 	snprintf(date_str, sizeof(date_str), "%04d-%02d-%02d", tmp->tm_year + 1900, tmp->tm_mon + 1, tmp->tm_mday);
 	snprintf(time_str, sizeof(time_str), "%02d%02d", tmp->tm_hour, tmp->tm_min);
@@ -205,6 +566,8 @@ static sqlite3_stmt* logbook_last_qso_stmt = NULL;
 time_t logbook_last_qso(const char* callsign, int len)
 {
 	time_t ret = 0;
+	if (qso_index_ready())
+		return qso_index_last_qso(callsign, len);
 	if (!logbook_last_qso_stmt) {
 		const char* statement = "SELECT unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) FROM logbook WHERE callsign_recv=?"
 			" ORDER BY unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) DESC";
@@ -236,6 +599,8 @@ time_t logbook_grid_last_qso(const char *id, int len)
 	time_t ret = 0;
 	if (len < 4 || !strncmp(id, "RR73", 4) || !strncmp(id, "R+", 2) || !strncmp(id, "R-", 2) || !(isalpha(id[0]) && isalpha(id[1])))
 		return ret; // that's not a grid
+	if (qso_index_ready())
+		return qso_index_grid_last_qso(id, len);
 	if (!logbook_grid_last_qso_stmt) {
 		const char* statement = "SELECT unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) FROM logbook WHERE exch_recv=?"
 			" ORDER BY unixepoch(qso_date ||' ' || substr(qso_time, 1, 2) || ':' || substr(qso_time, 3, 2)) DESC";
@@ -260,6 +625,8 @@ int logbook_prev_log(const char* callsign, char* result)
 {
 	char statement[1000], param[2000];
 	sqlite3_stmt* stmt;
+	if (qso_index_ready())
+		return qso_index_prev_log(callsign, result, 1000);
 	snprintf(statement, sizeof(statement), "select * from logbook where "
 					   "callsign_recv=\"%s\" ORDER BY id DESC",
 		callsign);
@@ -317,6 +684,341 @@ int row_count_callback(void* data, int argc, char** argv, char** azColName)
 	return 0;
 }
 
+/*
+	All writes to the logbook table go through a single writer thread, with
+	its own database connection and cached prepared statements. The database
+	is in WAL mode, so the GUI and decoder threads can keep reading through
+	the main connection while a write is in progress; and they never wait
+	for the SD card, because they only put a request on the queue.
+	Whatever has queued up while the previous batch was being written
+	is committed together in one transaction.
+
+	The QSO index is brought up to date when an insert is queued, not when
+	it is written, so that a dupe check straight after logging sees it.
+	Once a batch is written, the GUI thread is told what changed, and
+	broadcasts each new QSO.
+*/
+
+enum logbook_write_op {
+	LOGBOOK_WRITE_INSERT,
+	LOGBOOK_WRITE_UPDATE,
+	LOGBOOK_WRITE_DELETE
+};
+
+#define LOGBOOK_WRITE_MAX_ARGS 15
+#define LOGBOOK_MAX_COLUMNS 32
+
+struct logbook_write {
+	enum logbook_write_op op;
+	char* args[LOGBOOK_WRITE_MAX_ARGS]; // bound in order to the statement for op
+	int n_args;
+	struct logbook_write* next;
+};
+
+static pthread_t writer_thread;
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_cond = PTHREAD_COND_INITIALIZER;
+static struct logbook_write *writer_head = NULL, *writer_tail = NULL;
+static bool writer_running = false;
+static bool writer_stop = false;
+static sqlite3* writer_db = NULL;
+static sqlite3_stmt *insert_stmt = NULL, *update_stmt = NULL, *delete_stmt = NULL, *row_stmt = NULL;
+
+// the columns an insert's arguments go to, in order
+static const char* insert_columns[LOGBOOK_WRITE_MAX_ARGS] = { "freq", "mode", "qso_date", "qso_time",
+	"callsign_sent", "rst_sent", "exch_sent", "callsign_recv", "rst_recv", "exch_recv", "comments",
+	"tx_power", "vswr", "xota", "xota_loc" };
+// the columns of the logbook table, in the order "select *" returns them
+static char table_columns[LOGBOOK_MAX_COLUMNS][20];
+static int n_table_columns = 0;
+
+// what a batch wrote, for the GUI thread
+struct logbook_written {
+	int n;
+	struct {
+		enum logbook_write_op op;
+		sqlite3_int64 id;
+	} rows[];
+};
+
+static gboolean logbook_written_idle(gpointer data)
+{
+	struct logbook_written* written = data;
+
+	for (int i = 0; i < written->n; i++) {
+		switch (written->rows[i].op) {
+		case LOGBOOK_WRITE_INSERT:
+			// Broadcast ADIF record via UDP if enabled
+			adif_broadcast_qso_id(written->rows[i].id);
+			if (log_model)
+				logbook_model_row_inserted(log_model, written->rows[i].id);
+			break;
+		case LOGBOOK_WRITE_UPDATE:
+			if (log_model)
+				logbook_model_row_changed(log_model, written->rows[i].id);
+			break;
+		default:
+			if (log_model)
+				logbook_model_row_deleted(log_model, written->rows[i].id);
+			break;
+		}
+	}
+	free(written);
+	return FALSE;
+}
+
+/*!
+	Add a queued insert to the QSO index, as logbook_index_add_row()
+	will find it in the table once it is written.
+*/
+static void logbook_index_add_write(const struct logbook_write* w)
+{
+	const char* names[LOGBOOK_MAX_COLUMNS];
+	const char* values[LOGBOOK_MAX_COLUMNS];
+
+	for (int i = 0; i < n_table_columns; i++) {
+		names[i] = table_columns[i];
+		values[i] = "";
+		for (int j = 0; j < w->n_args; j++)
+			if (!strcmp(table_columns[i], insert_columns[j]))
+				values[i] = w->args[j];
+	}
+	logbook_index_add_fields(names, values, n_table_columns);
+}
+
+/*!
+	Set the sqlite synchronous mode on \a conn from the LOGBOOK_SYNC setting:
+	FULL syncs on every commit; NORMAL (the default) only at checkpoints,
+	so a power cut can lose the last few QSOs but never corrupt the log;
+	OFF leaves it all to the OS.
+*/
+static void logbook_set_durability(sqlite3* conn)
+{
+	const char* sync = field_str("LOGBOOK_SYNC");
+	char statement[50];
+	if (!sync || (strcmp(sync, "FULL") && strcmp(sync, "OFF")))
+		sync = "NORMAL";
+	snprintf(statement, sizeof(statement), "PRAGMA synchronous=%s;", sync);
+	sqlite3_exec(conn, statement, NULL, NULL, NULL);
+}
+
+static sqlite3_stmt* writer_prepare(const char* statement)
+{
+	sqlite3_stmt* stmt = NULL;
+	if (sqlite3_prepare_v2(writer_db, statement, -1, &stmt, NULL) != SQLITE_OK)
+		fprintf(stderr, "logbook writer: failed to prepare '%s': %s\n", statement, sqlite3_errmsg(writer_db));
+	return stmt;
+}
+
+static void writer_free(struct logbook_write* w)
+{
+	for (int i = 0; i < w->n_args; i++)
+		free(w->args[i]);
+	free(w);
+}
+
+/*!
+	Count the logbook row with \a id into (\a delta = 1) or out of (-1)
+	the worked-status tables, which follow edits and deletes as they happen.
+*/
+static void writer_worked_row(const char* id, int delta)
+{
+	if (!worked_ready() || !row_stmt || !id)
+		return;
+	sqlite3_bind_text(row_stmt, 1, id, -1, SQLITE_STATIC);
+	if (sqlite3_step(row_stmt) == SQLITE_ROW)
+		logbook_worked_row(row_stmt, delta);
+	sqlite3_reset(row_stmt);
+	sqlite3_clear_bindings(row_stmt);
+}
+
+/*!
+	Run one queued write; returns true if it changed anything
+	that the QSO index can't follow incrementally.
+	\a id is set to the row that was written.
+*/
+static bool writer_execute(struct logbook_write* w, sqlite3_int64* id_written)
+{
+	sqlite3_stmt* stmt;
+	switch (w->op) {
+	case LOGBOOK_WRITE_INSERT:
+		stmt = insert_stmt;
+		break;
+	case LOGBOOK_WRITE_UPDATE:
+		stmt = update_stmt;
+		break;
+	default:
+		stmt = delete_stmt;
+		break;
+	}
+	if (!stmt)
+		return false;
+	// the id is the last argument of an update, and the only one of a delete
+	const char* id = w->op == LOGBOOK_WRITE_INSERT ? NULL : w->args[w->n_args - 1];
+	*id_written = id ? atoll(id) : 0;
+	if (id)
+		writer_worked_row(id, -1);
+	for (int i = 0; i < w->n_args; i++)
+		sqlite3_bind_text(stmt, i + 1, w->args[i], -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt) != SQLITE_DONE)
+		fprintf(stderr, "logbook writer: %s\n", sqlite3_errmsg(writer_db));
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	if (w->op == LOGBOOK_WRITE_UPDATE)
+		writer_worked_row(id, 1);
+	if (w->op != LOGBOOK_WRITE_INSERT)
+		return true;
+	// the QSO index has it already, from logbook_queue_write()
+	*id_written = sqlite3_last_insert_rowid(writer_db);
+	if (worked_ready() && row_stmt) {
+		sqlite3_bind_int64(row_stmt, 1, *id_written);
+		if (sqlite3_step(row_stmt) == SQLITE_ROW)
+			logbook_worked_row(row_stmt, 1);
+		sqlite3_reset(row_stmt);
+	}
+	return false;
+}
+
+/*!
+	Reload the QSO index (and if \a worked, the worked-status tables) from
+	\a conn. Nothing can be queued meanwhile, and what is queued already
+	isn't in the table yet, so it goes back into the index.
+*/
+static void logbook_index_rebuild(sqlite3* conn, bool worked)
+{
+	pthread_mutex_lock(&writer_mutex);
+	logbook_index_build(conn, worked);
+	for (struct logbook_write* w = writer_head; w; w = w->next)
+		if (w->op == LOGBOOK_WRITE_INSERT)
+			logbook_index_add_write(w);
+	pthread_mutex_unlock(&writer_mutex);
+}
+
+static void* logbook_writer_function(void* arg)
+{
+	pthread_mutex_lock(&writer_mutex);
+	while (true) {
+		while (!writer_head && !writer_stop)
+			pthread_cond_wait(&writer_cond, &writer_mutex);
+		if (!writer_head)
+			break; // stopped, and nothing left to write
+		struct logbook_write* batch = writer_head;
+		writer_head = writer_tail = NULL;
+		pthread_mutex_unlock(&writer_mutex);
+
+		int n = 0;
+		for (struct logbook_write* w = batch; w; w = w->next)
+			n++;
+		struct logbook_written* written = malloc(sizeof(*written) + n * sizeof(written->rows[0]));
+		bool rebuild = false;
+		written->n = n;
+		n = 0;
+		sqlite3_exec(writer_db, "BEGIN;", NULL, NULL, NULL);
+		for (struct logbook_write* w = batch; w; w = w->next) {
+			written->rows[n].op = w->op;
+			rebuild |= writer_execute(w, &written->rows[n++].id);
+		}
+		sqlite3_exec(writer_db, "COMMIT;", NULL, NULL, NULL);
+		while (batch) {
+			struct logbook_write* next = batch->next;
+			writer_free(batch);
+			batch = next;
+		}
+
+		if (rebuild)
+			logbook_index_rebuild(writer_db, false);
+		g_idle_add(logbook_written_idle, written);
+
+		pthread_mutex_lock(&writer_mutex);
+	}
+	pthread_mutex_unlock(&writer_mutex);
+	return NULL;
+}
+
+static void logbook_writer_start(const char* db_path)
+{
+	if (writer_running)
+		return;
+	if (sqlite3_open(db_path, &writer_db) != SQLITE_OK) {
+		fprintf(stderr, "logbook writer: failed to open %s: %s\n", db_path, sqlite3_errmsg(writer_db));
+		return;
+	}
+	sqlite3_busy_timeout(writer_db, 5000);
+	logbook_set_durability(writer_db);
+
+	if (logbook_has_power_swr_xota())
+		insert_stmt = writer_prepare("INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent,"
+			"rst_sent, exch_sent, callsign_recv, rst_recv, exch_recv, comments, tx_power, vswr, xota, xota_loc) "
+			"VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);");
+	else
+		insert_stmt = writer_prepare("INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent,"
+			"rst_sent, exch_sent, callsign_recv, rst_recv, exch_recv, comments) "
+			"VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);");
+	update_stmt = writer_prepare("UPDATE logbook SET mode = ?, freq = ?, callsign_recv = ?, rst_sent = ?, "
+		"exch_sent = ?, rst_recv = ?, exch_recv = ?, comments = ? WHERE id = ?;");
+	delete_stmt = writer_prepare("DELETE FROM logbook WHERE id = ?;");
+	row_stmt = writer_prepare("select * from logbook where id = ?;");
+	n_table_columns = 0;
+	for (int i = 0; row_stmt && i < sqlite3_column_count(row_stmt) && i < LOGBOOK_MAX_COLUMNS; i++)
+		g_strlcpy(table_columns[n_table_columns++], sqlite3_column_name(row_stmt, i), sizeof(table_columns[0]));
+
+	writer_stop = false;
+	writer_running = !pthread_create(&writer_thread, NULL, logbook_writer_function, NULL);
+}
+
+// Write out everything still queued, then stop the writer thread.
+static void logbook_writer_stop()
+{
+	if (!writer_running)
+		return;
+	pthread_mutex_lock(&writer_mutex);
+	writer_stop = true;
+	pthread_cond_signal(&writer_cond);
+	pthread_mutex_unlock(&writer_mutex);
+	pthread_join(writer_thread, NULL);
+	writer_running = false;
+
+	sqlite3_finalize(insert_stmt);
+	sqlite3_finalize(update_stmt);
+	sqlite3_finalize(delete_stmt);
+	sqlite3_finalize(row_stmt);
+	insert_stmt = update_stmt = delete_stmt = row_stmt = NULL;
+	sqlite3_close(writer_db);
+	writer_db = NULL;
+}
+
+/*!
+	Queue a write of \a op with \a n_args string arguments
+	(bound in that order to the cached statement for \a op).
+*/
+static void logbook_queue_write(enum logbook_write_op op, int n_args, ...)
+{
+	struct logbook_write* w = calloc(1, sizeof(struct logbook_write));
+	va_list ap;
+
+	assert(n_args <= LOGBOOK_WRITE_MAX_ARGS);
+	w->op = op;
+	w->n_args = n_args;
+	va_start(ap, n_args);
+	for (int i = 0; i < n_args; i++) {
+		const char* arg = va_arg(ap, const char*);
+		w->args[i] = strdup(arg ? arg : "");
+	}
+	va_end(ap);
+
+	pthread_mutex_lock(&writer_mutex);
+	if (op == LOGBOOK_WRITE_INSERT && qso_index_ready())
+		logbook_index_add_write(w);
+	if (writer_tail)
+		writer_tail->next = w;
+	else
+		writer_head = w;
+	writer_tail = w;
+	pthread_cond_signal(&writer_cond);
+	pthread_mutex_unlock(&writer_mutex);
+}
+
 void logbook_open()
 {
 	if (db != NULL)
@@ -332,6 +1034,15 @@ void logbook_open()
 		sqlite3_free(zErrMsg);
 		return;
 	}
+	// WAL lets this connection read while the writer thread writes.
+	// journal_mode is persistent, so this only does something the first time.
+	rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL;", NULL, NULL, &zErrMsg);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "Failed to set logbook WAL mode: %s\n", zErrMsg);
+		sqlite3_free(zErrMsg);
+	}
+	sqlite3_busy_timeout(db, 5000);
+	logbook_set_durability(db);
 	char* sql = "SELECT name FROM sqlite_master WHERE type='index' AND tbl_name='logbook' AND name IN ('gridIx', 'callIx');";
 	int index_count = 0;
 	rc = sqlite3_exec(db, sql, row_count_callback, &index_count, &zErrMsg);
@@ -359,10 +1070,17 @@ void logbook_open()
 		}
 		printf("Logbook indexes created.\n");
 	}
+	logbook_fts_open(db);
+	logbook_index_build(db, true);
+	scp_build_start();
+	logbook_writer_start(db_path);
 }
 
 void logbook_close()
 {
+	logbook_writer_stop();
+	qso_index_clear();
+	worked_set_ready(false);
 	if (db)
 		sqlite3_close(db);
 	db = NULL;
@@ -372,7 +1090,7 @@ void logbook_add(const char* contact_callsign, const char* rst_sent, const char*
 	const char* rst_recv, const char* exchange_recv, int tx_power, int tx_vswr,
 	const char* xota, const char* xota_loc, const char* comments)
 {
-	char statement[1000], *err_msg, date_str[11], time_str[5];
+	char date_str[11], time_str[5], power_str[12], vswr_str[12];
 	char log_freq[12], mode[10], mycallsign[12];
 
 	time_t log_time = time_sbitx();
@@ -392,45 +1110,43 @@ void logbook_add(const char* contact_callsign, const char* rst_sent, const char*
 	snprintf(date_str, sizeof(date_str), "%04d-%02d-%02d", tmp->tm_year + 1900, tmp->tm_mon + 1, tmp->tm_mday);
 	snprintf(time_str, sizeof(time_str), "%02d%02d", tmp->tm_hour, tmp->tm_min);
 
-	if (logbook_has_power_swr_xota()) {
-		snprintf(statement, sizeof(statement),
-			"INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent,"
-			"rst_sent, exch_sent, callsign_recv, rst_recv, exch_recv, tx_power, vswr, xota, xota_loc, comments) "
-			"VALUES('%s', '%s', '%s', '%s',  '%s','%s','%s',  '%s','%s','%s','%d.%d','%d.%d','%s','%s','%s');",
-				log_freq, mode, date_str, time_str, mycallsign,
-				rst_sent, exchange_sent, contact_callsign, rst_recv, exchange_recv,
-				tx_power / 10, tx_power % 10, tx_vswr / 10, tx_vswr % 10, xota, xota_loc, comments);
-	} else {
-		snprintf(statement, sizeof(statement),
-			"INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent,"
-			"rst_sent, exch_sent, callsign_recv, rst_recv, exch_recv, comments) "
-			"VALUES('%s', '%s', '%s', '%s',  '%s','%s','%s',  '%s','%s','%s','%s');",
-				log_freq, mode, date_str, time_str, mycallsign,
-				rst_sent, exchange_sent, contact_callsign, rst_recv, exchange_recv, comments);
-	}
+	snprintf(power_str, sizeof(power_str), "%d.%d", tx_power / 10, tx_power % 10);
+	snprintf(vswr_str, sizeof(vswr_str), "%d.%d", tx_vswr / 10, tx_vswr % 10);
 
 	logbook_open();
 
-	sqlite3_exec(db, statement, 0, 0, &err_msg);
-
-	// Broadcast ADIF record via UDP if enabled
-	adif_broadcast_qso();
-
-	logbook_refill(NULL);
+	// the arguments are in the order of the columns in insert_stmt;
+	// the last 4 are ignored if the logbook doesn't have those columns
+	logbook_queue_write(LOGBOOK_WRITE_INSERT, logbook_has_power_swr_xota() ? 15 : 11,
+		log_freq, mode, date_str, time_str, mycallsign,
+		rst_sent, exchange_sent, contact_callsign, rst_recv, exchange_recv, comments,
+		power_str, vswr_str, xota, xota_loc);
+	scp_add(contact_callsign, SCP_LOGGED);
 }
 
+/*!
+	Refresh the list if it's open: reload it from the logbook if \a query is null
+	(keeping the current search), otherwise search for \a query.
+*/
 void logbook_refill(const char* query)
 {
-	// refresh/refill the list if opened
-	if (list_store) {
+	int* ids;
+
+	if (log_model) {
 		/* Detach model from view */
 		gtk_tree_view_set_model(GTK_TREE_VIEW(tree_view), NULL);
 
-		clear_tree(list_store);
-		logbook_fill(0, 10000, query);
+		if (query)
+			g_strlcpy(logbook_search_text, query, sizeof(logbook_search_text));
+		else
+			logbook_model_reload(log_model);
+		// the rows that match other than by callsign prefix (which the model checks itself)
+		int n_ids = logbook_search_ids(logbook_search_text, &ids);
+		logbook_model_set_filter(log_model, logbook_search_text, ids, n_ids);
+		g_free(ids);
 
 		/* Re-attach model to view */
-		gtk_tree_view_set_model(GTK_TREE_VIEW(tree_view), GTK_TREE_MODEL(list_store));
+		gtk_tree_view_set_model(GTK_TREE_VIEW(tree_view), GTK_TREE_MODEL(log_model));
 	}
 }
 
@@ -503,6 +1219,202 @@ static void strip_chr(char* str, const char to_remove)
 	}
 }
 
+/*!
+	Return the index in bands[] of the band containing \a freq
+	(a logbook freq column: Hz in new entries, kHz in old ones), or -1.
+*/
+static int logbook_band_index(const char* freq)
+{
+	long khz = atol(freq);
+	if (khz > 100000)
+		khz /= 1000;
+	for (int j = 0; j < sizeof(bands) / sizeof(struct band_name); j++)
+		if (bands[j].from <= khz && khz <= bands[j].to)
+			return j;
+	return -1;
+}
+
+/*!
+	Convert the qso_date (YYYY-MM-DD) and qso_time (HHMM) columns to a UTC timestamp,
+	the same as unixepoch(qso_date || ' ' || HH:MM) in the queries above.
+*/
+static time_t logbook_qso_timestamp(const char* date, const char* time)
+{
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+	if (!date || !time || sscanf(date, "%4d-%2d-%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3)
+		return 0;
+	tm.tm_year -= 1900;
+	tm.tm_mon -= 1;
+	if (strlen(time) >= 4) {
+		tm.tm_hour = (time[0] - '0') * 10 + (time[1] - '0');
+		tm.tm_min = (time[2] - '0') * 10 + (time[3] - '0');
+	}
+	return timegm(&tm);
+}
+
+static const char* column_str(sqlite3_stmt* stmt, int i)
+{
+	const char* ret = sqlite3_column_text(stmt, i);
+	return ret ? ret : "";
+}
+
+/*!
+	Add a QSO to the index, given the \a n columns of its logbook row by \a names
+	and \a values in table order. The summary is formatted the same way as
+	logbook_prev_log() formats it.
+*/
+static void logbook_index_add_fields(const char* const names[], const char* const values[], int n)
+{
+	const char *callsign = "", *grid = "", *freq = "", *mode = "", *date = NULL, *time = NULL;
+	char summary[1000];
+	int summary_len = 0;
+
+	summary[0] = 0;
+	for (int i = 0; i < n; i++) {
+		const char* col_name = names[i];
+		const char* value = values[i];
+		if (!strcmp(col_name, "id"))
+			continue;
+		if (!strcmp(col_name, "callsign_recv")) {
+			callsign = value;
+			continue;
+		}
+		if (!strcmp(col_name, "exch_recv"))
+			grid = value;
+		else if (!strcmp(col_name, "freq"))
+			freq = value;
+		else if (!strcmp(col_name, "mode"))
+			mode = value;
+		else if (!strcmp(col_name, "qso_date"))
+			date = value;
+		else if (!strcmp(col_name, "qso_time"))
+			time = value;
+		if (summary_len < sizeof(summary))
+			summary_len += snprintf(summary + summary_len, sizeof(summary) - summary_len, "%s%s",
+				value, strcmp(col_name, "qso_date") ? " " : "_");
+	}
+	qso_index_add(callsign, grid, logbook_band_index(freq), mode,
+		logbook_qso_timestamp(date, time), summary);
+}
+
+// Add the current row of \a stmt (a "select * from logbook" query) to the QSO index.
+static void logbook_index_add_row(sqlite3_stmt* stmt)
+{
+	const char* names[LOGBOOK_MAX_COLUMNS];
+	const char* values[LOGBOOK_MAX_COLUMNS];
+	int n = MIN(sqlite3_column_count(stmt), LOGBOOK_MAX_COLUMNS);
+
+	for (int i = 0; i < n; i++) {
+		names[i] = sqlite3_column_name(stmt, i);
+		values[i] = column_str(stmt, i);
+	}
+	logbook_index_add_fields(names, values, n);
+}
+
+/*!
+	Count the current row of \a stmt (a "select * from logbook" query)
+	into (\a delta = 1) or out of (-1) the worked-status tables.
+*/
+static void logbook_worked_row(sqlite3_stmt* stmt, int delta)
+{
+	const char *callsign = "", *grid = "", *freq = "", *mode = "";
+	int num_cols = sqlite3_column_count(stmt);
+	for (int i = 0; i < num_cols; i++) {
+		const char* col_name = sqlite3_column_name(stmt, i);
+		if (!strcmp(col_name, "callsign_recv"))
+			callsign = column_str(stmt, i);
+		else if (!strcmp(col_name, "exch_recv"))
+			grid = column_str(stmt, i);
+		else if (!strcmp(col_name, "freq"))
+			freq = column_str(stmt, i);
+		else if (!strcmp(col_name, "mode"))
+			mode = column_str(stmt, i);
+	}
+	const cty_info* info = callsign[0] ? cty_lookup_uncached(callsign) : NULL;
+	worked_add(info ? info->entity : -1, worked_grid_index(grid, -1),
+		logbook_band_index(freq), worked_mode_class(mode), delta);
+}
+
+/*!
+	(Re)load the whole logbook into the in-memory QSO index, and if \a worked,
+	into the worked-status tables too (otherwise they are kept as they are).
+	While this is going on, the lookups fall back to querying the database.
+*/
+static void logbook_index_build(sqlite3* conn, bool worked)
+{
+	sqlite3_stmt* stmt;
+	struct timespec t0, t1;
+	int calls, grids, qsos;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	qso_index_clear();
+	if (worked) {
+		if (!cty_loaded())
+			cty_load(CTY_FILE);
+		int n_entities = cty_entity_count();
+		bool is_dxcc[n_entities + 1];
+		for (int i = 0; i < n_entities; i++)
+			is_dxcc[i] = cty_entity(i)->is_dxcc;
+		worked_clear(n_entities, is_dxcc);
+	}
+	if (sqlite3_prepare_v2(conn, "select * from logbook ORDER BY id", -1, &stmt, NULL) != SQLITE_OK) {
+		fprintf(stderr, "Failed to build logbook index: %s\n", sqlite3_errmsg(conn));
+		return;
+	}
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		logbook_index_add_row(stmt);
+		if (worked)
+			logbook_worked_row(stmt, 1);
+	}
+	sqlite3_finalize(stmt);
+	qso_index_set_ready(true);
+	if (worked)
+		worked_set_ready(true);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	qso_index_stats(&calls, &grids, &qsos);
+	printf("Logbook index: %d QSOs, %d calls, %d grids", qsos, calls, grids);
+	if (worked)
+		printf(", %d entities", worked_entities(WORKED_ANY, WORKED_ANY));
+	printf(" in %ld ms\n", (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000);
+}
+
+// Index in the logbook band table of the band the radio is tuned to, or -1.
+int logbook_current_band()
+{
+	char freq[12];
+	snprintf(freq, sizeof(freq), "%d", field_int("FREQ"));
+	return logbook_band_index(freq);
+}
+
+/*!
+	Format the worked-status tables into \a buf (size \a len) as a table
+	of DXCC entities (all modes, CW, phone, digital) and grids per band.
+	Returns the length, or 0 if the tables aren't loaded yet.
+*/
+int logbook_awards_report(char* buf, int len)
+{
+	static const char* row_format = "%-5s %5d %5d %5d %5d %6d\n";
+	int n_bands = sizeof(bands) / sizeof(struct band_name);
+	int n = 0;
+
+	if (!worked_ready() || len <= 0)
+		return 0;
+	n += snprintf(buf + n, len - n, "%-5s %5s %5s %5s %5s %6s\n", "Band", "DXCC", "CW", "Phone", "Digi", "Grids");
+	for (int b = 0; b < n_bands && b < WORKED_MAX_BANDS && n < len; b++) {
+		if (!worked_entities(b, WORKED_ANY) && !worked_grids(b))
+			continue;
+		n += snprintf(buf + n, len - n, row_format, bands[b].name, worked_entities(b, WORKED_ANY),
+			worked_entities(b, WORKED_CW), worked_entities(b, WORKED_PHONE),
+			worked_entities(b, WORKED_DIGITAL), worked_grids(b));
+	}
+	if (n < len)
+		n += snprintf(buf + n, len - n, row_format, "All", worked_entities(WORKED_ANY, WORKED_ANY),
+			worked_entities(WORKED_ANY, WORKED_CW), worked_entities(WORKED_ANY, WORKED_PHONE),
+			worked_entities(WORKED_ANY, WORKED_DIGITAL), worked_grids(WORKED_ANY));
+	return n < len ? n : len - 1;
+}
+
 void *prepare_query_by_date(const char *start_date, const char *end_date)
 {
 	char statement[250];
@@ -548,17 +1460,19 @@ int write_adif_header(char *buf, int len, const char *source) {
 	- IOTA instead of MY_SOTA_REF for IOTA
 */
 int write_adif_record(void *stmt, char *buf, int len) {
-	char field_value[2000]; // big enough for a comment, hopefully; the rest are much smaller
+	char field_value[50]; // for the numbers and the columns we reformat; text is copied straight from sqlite
 	int num_cols = sqlite3_column_count(stmt);
 	bool is_ftx = false;
 
 	int buf_offset = 0;
-	char sig[5]; // IOTA/SOTA/POTA
+	char sig[5] = ""; // IOTA/SOTA/POTA
 	for (int i = 1; i < num_cols; i++) {
+		const char *value = field_value;
+		int field_len;
 		switch (sqlite3_column_type(stmt, i))
 		{
 		case (SQLITE3_TEXT):
-			strncpy(field_value, sqlite3_column_text(stmt, i), sizeof(field_value));
+			value = sqlite3_column_text(stmt, i);
 			break;
 		case (SQLITE_INTEGER):
 			snprintf(field_value, sizeof(field_value), "%d", sqlite3_column_int(stmt, i));
@@ -574,83 +1488,70 @@ int write_adif_record(void *stmt, char *buf, int len) {
 			break;
 		}
 		//~ printf("col %d of %d type %d: ADIF %s value '%s'\n",
-			//~ i, num_cols, sqlite3_column_type(stmt, i), adif_names[i], field_value);
+			//~ i, num_cols, sqlite3_column_type(stmt, i), adif_names[i], value);
 
-		int field_len = strlen(field_value);
-		bool output_done = false;
+		field_len = strlen(value);
+		const char *name = adif_names[i];
 		// Columns are in the order requested in prepare_query_by_date().
 		// First, take care of special cases for certain columns:
 		switch (i) {
 		case 1: // mode
 			// If mode is FT8/FT4, remember to use gridsquare instead of stx/srx fields - n1qm & k7ihz
-			is_ftx = (!strncmp("FT", field_value, 2));
+			is_ftx = (!strncmp("FT", value, 2));
 			break;
 		case 2: { // freq
-			long hz = atoi(field_value);
+			long hz = atoi(value);
 			if (hz > 100000) {
 				// big number: it must really be in hz (new log entry)
 				float mhz = hz / 1000000.0;
-				snprintf(field_value, sizeof(field_value), "%.6f", mhz); // write out with 6 decimal digits
+				field_len = snprintf(field_value, sizeof(field_value), "%.6f", mhz); // write out with 6 decimal digits
 			} else {
 				// assume it's in khz (old log entry)
 				hz *= 1000;
 				float mhz = hz / 1000000.0;
-				snprintf(field_value, sizeof(field_value), "%.3f", mhz); // write out only the 3 digits we know
+				field_len = snprintf(field_value, sizeof(field_value), "%.3f", mhz); // write out only the 3 digits we know
 			}
+			value = field_value;
 			const long khz = hz / 1000;
 			for (int j = 0 ; j < sizeof(bands)/sizeof(struct band_name); j++)
 				if (bands[j].from <= khz && khz <= bands[j].to)
-					buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-						"<BAND:%d>%s ", strlen(bands[j].name), bands[j].name);
+					buf_offset += adif_write_field(buf + buf_offset, len - buf_offset,
+						"BAND", bands[j].name, strlen(bands[j].name));
 		} break;
 		case 3: // qso_date
+			if (value != field_value) {
+				strncpy(field_value, value, sizeof(field_value) - 1);
+				field_value[sizeof(field_value) - 1] = 0;
+				value = field_value;
+			}
 			strip_chr(field_value, '-');
 			field_len = strlen(field_value);
 			break;
 		case 7: // exch_sent
 			if (is_ftx)
-				buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-					"<MY_GRIDSQUARE:%d>%s ", field_len, field_value);
-			else
-				buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-					"<%s:%d>%s ", adif_names[i], field_len, field_value);
-			output_done = true;
+				name = "MY_GRIDSQUARE";
 			break;
 		case 10: // exch_recv
 			if (is_ftx)
-				buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-					"<GRIDSQUARE:%d>%s ", field_len, field_value);
-			else
-				buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-					"<%s:%d>%s ", adif_names[i], field_len, field_value);
-			output_done = true;
+				name = "GRIDSQUARE";
 			break;
 		case 14: // xota
-			strncpy(sig, field_value, sizeof(sig));
+			strncpy(sig, value, sizeof(sig) - 1);
+			sig[sizeof(sig) - 1] = 0;
 			break;
 		case 15: // xota_loc
-			if (!strcmp("POTA", sig)) {
-				buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-					"<MY_SIG_INFO:%d>%s ", field_len, field_value);
-				output_done = true;
-			} else if (!strcmp("IOTA", sig)) {
-				buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-					"<IOTA:%d>%s ", field_len, field_value);
-				output_done = true;
-			}
+			if (!strcmp("POTA", sig))
+				name = "MY_SIG_INFO";
+			else if (!strcmp("IOTA", sig))
+				name = "IOTA";
 			// SOTA (as default) is taken care of below: adif_names[15] = MY_SOTA_REF
 			break;
 		default:
 			break;
 		}
-		// Special cases above can set output_done = true. Otherwise, assume
-		// output for this field is not yet done, so do it the generic way:
-		// the ADIF field name comes from the adif_names array.
-		if (!output_done && field_len > 0) {
-			//~ printf("    default output @%d\n", buf_offset);
-			buf_offset += snprintf(buf + buf_offset, len - buf_offset,
-				"<%s:%d>%s ", adif_names[i], field_len, field_value);
-		}
+		// The ADIF field name comes from the adif_names array,
+		// unless one of the special cases above substituted it.
+		buf_offset += adif_write_field(buf + buf_offset, len - buf_offset, name, value, field_len);
 	}
 	buf_offset += snprintf(buf + buf_offset, len - buf_offset, "<EOR>\n");
 	return buf_offset;
@@ -664,21 +1565,328 @@ void logbook_end_query(void *stmt) {
 	sqlite3_finalize(stmt);
 }
 
+/*!
+	Write the QSOs between \a start_date and \a end_date to the ADIF file \a path.
+	Returns the number of records written, or -1 on error.
+*/
 int export_adif(const char *path, const char *start_date, const char *end_date, const char *source) {
 	char buf[4096];
+	int records = 0;
 	sqlite3_stmt *stmt = prepare_query_by_date(start_date, end_date);
 	if (!stmt)
 		return -1;
 
-	//add to the bottom of the logbook
 	FILE *pf = fopen(path, "w");
+	if (!pf) {
+		perror(path);
+		logbook_end_query(stmt);
+		return -1;
+	}
+	// records are small: let stdio collect them into big writes
+	setvbuf(pf, NULL, _IOFBF, ADIF_IO_BUFFER);
 	fwrite(buf, 1, write_adif_header(buf, sizeof(buf), source), pf);
 
 	while (logbook_next(stmt)) {
 		fwrite(buf, 1, write_adif_record(stmt, buf, sizeof(buf)), pf);
+		records++;
 	}
 	logbook_end_query(stmt);
 	fclose(pf);
+	return records;
+}
+
+/*
+	ADIF import. The file is mapped into memory and tokenized in place by
+	adif_parse(); the values are bound straight from the mapping into one
+	prepared insert, and the inserts are committed IMPORT_BATCH at a time.
+	A QSO is a duplicate if the log (or the file, earlier on) already has
+	the same callsign, date, time (to the minute), band and mode.
+	The import has its own connection, so the writer thread can still
+	log QSOs in between the batches. The search indexes are brought up
+	to date once at the end, rather than row by row.
+*/
+
+#define IMPORT_BATCH 10000
+
+struct adif_import {
+	sqlite3 *conn;
+	sqlite3_stmt *insert;
+	GHashTable *seen;	// dupe keys of the QSOs in the log
+	int n_columns;		// 14 with tx_power/xota columns, else 11
+	int imported, duplicates, skipped, in_batch;
+	struct timespec start;
+};
+
+static gboolean logbook_refill_idle(gpointer data)
+{
+	logbook_refill(NULL);
+	return FALSE;
+}
+
+static double import_elapsed(struct adif_import *imp)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - imp->start.tv_sec) + (now.tv_nsec - imp->start.tv_nsec) / 1e9;
+}
+
+static void import_report(const char *format, ...)
+{
+	char msg[200];
+	va_list ap;
+	va_start(ap, format);
+	vsnprintf(msg, sizeof(msg), format, ap);
+	va_end(ap);
+	printf("%s", msg);
+	write_console(STYLE_LOG, msg);
+}
+
+static char *import_dupe_key(const char *call, const char *date, const char *time, int band, const char *mode)
+{
+	char *key = g_strdup_printf("%s|%s|%.4s|%d|%s", call, date, time, band, mode);
+	for (char *p = key; *p; p++)
+		*p = toupper(*p);
+	return key;
+}
+
+// Copy an ADIF value into \a dst (size \a dst_len), null-terminated.
+static const char *import_copy(char *dst, int dst_len, const char *value, int value_len)
+{
+	if (value_len >= dst_len)
+		value_len = dst_len - 1;
+	memcpy(dst, value, value_len);
+	dst[value_len] = 0;
+	return dst;
+}
+
+// Bind the first of \a names that is present in \a rec, or an empty string.
+static void import_bind(struct adif_import *imp, const adif_record *rec, int col, const char *names[])
+{
+	int len = 0;
+	const char *value = NULL;
+	for (int i = 0; names[i] && !value; i++)
+		value = adif_get(rec, names[i], &len);
+	sqlite3_bind_text(imp->insert, col, value ? value : "", len, SQLITE_STATIC);
+}
+
+static int import_record(const adif_record *rec, void *user)
+{
+	struct adif_import *imp = user;
+	char call[20], mode[20], date[11], time[7], freq[16], mhz[20], grid[5];
+	int len;
+	const char *value;
+
+	// CALL, QSO_DATE and TIME_ON are required
+	const char *call_v = adif_get(rec, "CALL", &len);
+	if (!call_v || !len) {
+		imp->skipped++;
+		return 0;
+	}
+	import_copy(call, sizeof(call), call_v, len);
+	value = adif_get(rec, "QSO_DATE", &len);
+	if (!value || len != 8) {
+		imp->skipped++;
+		return 0;
+	}
+	snprintf(date, sizeof(date), "%.4s-%.2s-%.2s", value, value + 4, value + 6);
+	value = adif_get(rec, "TIME_ON", &len);
+	if (!value || len < 4) {
+		imp->skipped++;
+		return 0;
+	}
+	import_copy(time, 5, value, 4);
+
+	// digital modes are MFSK with a SUBMODE (FT4, JS8...) in ADIF 3
+	value = adif_get(rec, "MODE", &len);
+	import_copy(mode, sizeof(mode), value ? value : "", len);
+	if (!strcasecmp(mode, "MFSK") && (value = adif_get(rec, "SUBMODE", &len)))
+		import_copy(mode, sizeof(mode), value, len);
+
+	// FREQ is in MHz, the logbook has Hz
+	freq[0] = 0;
+	if ((value = adif_get(rec, "FREQ", &len)))
+		snprintf(freq, sizeof(freq), "%ld",
+			lround(atof(import_copy(mhz, sizeof(mhz), value, len)) * 1000000.0));
+	int band = logbook_band_index(freq);
+
+	char *key = import_dupe_key(call, date, time, band, mode);
+	if (g_hash_table_contains(imp->seen, key)) {
+		g_free(key);
+		imp->duplicates++;
+		return 0;
+	}
+	g_hash_table_add(imp->seen, key);
+
+	static const char *sent_names[] = {"STATION_CALLSIGN", "OPERATOR", NULL};
+	static const char *rst_sent_names[] = {"RST_SENT", NULL};
+	static const char *rst_rcvd_names[] = {"RST_RCVD", NULL};
+	static const char *stx_names[] = {"STX_STRING", "STX", NULL};
+	static const char *srx_names[] = {"SRX_STRING", "SRX", NULL};
+	static const char *comment_names[] = {"COMMENTS", "COMMENT", NULL};
+	static const char *power_names[] = {"TX_PWR", NULL};
+
+	sqlite3_stmt *stmt = imp->insert;
+	sqlite3_bind_text(stmt, 1, freq, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt, 2, mode, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt, 3, date, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt, 4, time, -1, SQLITE_TRANSIENT);
+	import_bind(imp, rec, 5, sent_names);
+	import_bind(imp, rec, 6, rst_sent_names);
+	// the logbook keeps the 4 character grids of FTx QSOs in the exchange columns
+	if (!strncasecmp(mode, "FT", 2) && (value = adif_get(rec, "MY_GRIDSQUARE", &len)) && len >= 4)
+		sqlite3_bind_text(stmt, 7, value, 4, SQLITE_STATIC);
+	else
+		import_bind(imp, rec, 7, stx_names);
+	sqlite3_bind_text(stmt, 8, call, -1, SQLITE_TRANSIENT);
+	import_bind(imp, rec, 9, rst_rcvd_names);
+	if (!strncasecmp(mode, "FT", 2) && (value = adif_get(rec, "GRIDSQUARE", &len)) && len >= 4)
+		sqlite3_bind_text(stmt, 10, import_copy(grid, sizeof(grid), value, 4), -1, SQLITE_TRANSIENT);
+	else
+		import_bind(imp, rec, 10, srx_names);
+	import_bind(imp, rec, 11, comment_names);
+	if (imp->n_columns > 11) {
+		import_bind(imp, rec, 12, power_names);
+		// the reverse of the MY_SIG_INFO/IOTA/MY_SOTA_REF choice in write_adif_record()
+		if ((value = adif_get(rec, "MY_SIG_INFO", &len)) && len) {
+			sqlite3_bind_text(stmt, 13, "POTA", -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 14, value, len, SQLITE_STATIC);
+		} else if ((value = adif_get(rec, "MY_SOTA_REF", &len)) && len) {
+			sqlite3_bind_text(stmt, 13, "SOTA", -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 14, value, len, SQLITE_STATIC);
+		} else if ((value = adif_get(rec, "IOTA", &len)) && len) {
+			sqlite3_bind_text(stmt, 13, "IOTA", -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 14, value, len, SQLITE_STATIC);
+		} else {
+			sqlite3_bind_text(stmt, 13, "", 0, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 14, "", 0, SQLITE_STATIC);
+		}
+	}
+	if (sqlite3_step(stmt) != SQLITE_DONE) {
+		fprintf(stderr, "ADIF import: %s\n", sqlite3_errmsg(imp->conn));
+		sqlite3_reset(stmt);
+		return 1;
+	}
+	sqlite3_reset(stmt);
+	imp->imported++;
+	if (++imp->in_batch == IMPORT_BATCH) {
+		sqlite3_exec(imp->conn, "COMMIT; BEGIN;", NULL, NULL, NULL);
+		imp->in_batch = 0;
+	}
+	return 0;
+}
+
+static void import_progress(size_t done_bytes, size_t total_bytes, int records, void *user)
+{
+	struct adif_import *imp = user;
+	if (done_bytes < total_bytes)
+		import_report("ADIF import: %d%%, %d records, %.0f records/s\n",
+			(int)(done_bytes * 100 / total_bytes), records, records / import_elapsed(imp));
+}
+
+/*!
+	Add the QSOs in the ADIF file at \a path to the logbook, skipping duplicates.
+	Returns the number of QSOs imported, or -1 on error.
+	This can take a while: see logbook_import_start() to run it in the background.
+*/
+int import_adif(const char *path)
+{
+	struct adif_import imp;
+	char db_path[PATH_MAX];
+	sqlite3_stmt *stmt;
+
+	memset(&imp, 0, sizeof(imp));
+	clock_gettime(CLOCK_MONOTONIC, &imp.start);
+	snprintf(db_path, sizeof(db_path), "%s/sbitx/data/sbitx.db", getenv("HOME"));
+	if (sqlite3_open(db_path, &imp.conn) != SQLITE_OK) {
+		fprintf(stderr, "ADIF import: failed to open %s: %s\n", db_path, sqlite3_errmsg(imp.conn));
+		sqlite3_close(imp.conn);
+		return -1;
+	}
+	sqlite3_busy_timeout(imp.conn, 5000);
+	logbook_set_durability(imp.conn);
+
+	imp.n_columns = logbook_has_power_swr_xota() ? 14 : 11;
+	const char *sql = imp.n_columns > 11 ?
+		"INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent,"
+		"rst_sent, exch_sent, callsign_recv, rst_recv, exch_recv, comments, tx_power, xota, xota_loc) "
+		"VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);" :
+		"INSERT INTO logbook (freq, mode, qso_date, qso_time, callsign_sent,"
+		"rst_sent, exch_sent, callsign_recv, rst_recv, exch_recv, comments) "
+		"VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+	if (sqlite3_prepare_v2(imp.conn, sql, -1, &imp.insert, NULL) != SQLITE_OK) {
+		fprintf(stderr, "ADIF import: %s\n", sqlite3_errmsg(imp.conn));
+		sqlite3_close(imp.conn);
+		return -1;
+	}
+
+	// the dupe keys of what is already in the log
+	imp.seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	if (sqlite3_prepare_v2(imp.conn, "SELECT callsign_recv, qso_date, qso_time, freq, mode FROM logbook",
+			-1, &stmt, NULL) == SQLITE_OK) {
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+			g_hash_table_add(imp.seen, import_dupe_key(column_str(stmt, 0), column_str(stmt, 1),
+				column_str(stmt, 2), logbook_band_index(column_str(stmt, 3)), column_str(stmt, 4)));
+		sqlite3_finalize(stmt);
+	}
+
+	bool reindex = logbook_fts_ok;
+	sqlite3_int64 indexed_id = reindex ? logbook_fts_suspend(imp.conn) : 0;
+	sqlite3_exec(imp.conn, "BEGIN;", NULL, NULL, NULL);
+	int records = adif_parse_file(path, import_record, import_progress, &imp);
+	sqlite3_exec(imp.conn, "COMMIT;", NULL, NULL, NULL);
+	sqlite3_finalize(imp.insert);
+	if (reindex)
+		logbook_fts_resume(imp.conn, indexed_id);
+
+	double elapsed = import_elapsed(&imp);
+	if (records < 0)
+		import_report("ADIF import of %s stopped after %d QSOs\n", path, imp.imported);
+	else
+		import_report("ADIF import: %d QSOs imported, %d duplicates, %d skipped, in %.1f s (%.0f records/s)\n",
+			imp.imported, imp.duplicates, imp.skipped, elapsed, records / (elapsed > 0 ? elapsed : 1));
+
+	if (imp.imported) {
+		logbook_index_rebuild(imp.conn, true);
+		scp_build_start();
+		g_idle_add(logbook_refill_idle, NULL);
+	}
+	g_hash_table_destroy(imp.seen);
+	sqlite3_close(imp.conn);
+	return records < 0 ? -1 : imp.imported;
+}
+
+static bool import_running = false;
+
+static void* import_thread_function(void* arg)
+{
+	char* path = arg;
+	import_adif(path);
+	free(path);
+	import_running = false;
+	return NULL;
+}
+
+/*!
+	Start importing the ADIF file at \a path in the background;
+	the progress is reported on the console.
+*/
+void logbook_import_start(const char* path)
+{
+	pthread_t thread;
+
+	if (import_running) {
+		write_console(STYLE_LOG, "An ADIF import is already running\n");
+		return;
+	}
+	logbook_open();
+	import_running = true;
+	char* arg = strdup(path);
+	if (pthread_create(&thread, NULL, import_thread_function, arg)) {
+		free(arg);
+		import_running = false;
+		return;
+	}
+	pthread_detach(thread);
 }
 
 // Added the data folder for the save location  - W9JES
@@ -762,79 +1970,28 @@ int get_filename(char *path) {
 }
 */
 
-/*
-void import_button_clicked(GtkWidget *window) {
-	GtkWidget *dialog, *content_area, *vbox, *hbox, *frombox, *tobox;
-	GtkWidget *start_label, *end_label;
-	GtkWidget *start_calendar, *end_calendar;
-	GtkWidget *save_button, *cancel_button;
-
-	// Create a new dialog
-	dialog = gtk_dialog_new_with_buttons("Date Selection",
-	  NULL, GTK_DIALOG_MODAL,
-	  "_Save", GTK_RESPONSE_OK, "_Cancel", GTK_RESPONSE_CANCEL, NULL);
-
-	content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-
-	// Create vertical box container
-	vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-	gtk_container_set_border_width(GTK_CONTAINER(vbox), 10);
-	gtk_container_add(GTK_CONTAINER(content_area), vbox);
-
-
-	// horizontal box to have the from and to dates side by side
-	hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 2);
-	gtk_container_set_border_width(GTK_CONTAINER(hbox), 10);
-	gtk_container_add(GTK_CONTAINER(content_area), hbox);
-
-	// vertical box to have the from date
-	frombox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
-	gtk_container_set_border_width(GTK_CONTAINER(frombox), 10);
-	gtk_container_add(GTK_CONTAINER(hbox), frombox);
-
-	// Create From Date label
-	start_label = gtk_label_new("From Date:");
-	gtk_label_set_xalign(GTK_LABEL(start_label), 0); // Left-align the text within the label
-	gtk_box_pack_start(GTK_BOX(frombox), start_label, FALSE, FALSE, 0);
-
-	// Create start date calendar
-	start_calendar = gtk_calendar_new();
-	gtk_box_pack_start(GTK_BOX(frombox), start_calendar, TRUE, TRUE, 0);
-
-	// vertical box to have the from date
-	tobox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
-	gtk_container_set_border_width(GTK_CONTAINER(tobox), 10);
-	gtk_container_add(GTK_CONTAINER(hbox), tobox);
-
-	// Create To Date label
-	end_label = gtk_label_new("To Date:");
-	gtk_label_set_xalign(GTK_LABEL(end_label), 0); // Left-align the text within the label
-	gtk_box_pack_start(GTK_BOX(tobox), end_label, FALSE, FALSE, 0);
+void import_button_clicked(GtkWidget* window)
+{
+	GtkWidget* dialog = gtk_file_chooser_dialog_new("Import ADIF File",
+		GTK_WINDOW(window), GTK_FILE_CHOOSER_ACTION_OPEN,
+		"_Cancel", GTK_RESPONSE_CANCEL, "_Import", GTK_RESPONSE_ACCEPT, NULL);
+	GtkFileChooser* chooser = GTK_FILE_CHOOSER(dialog);
 
-	// Create end date calendar
-	end_calendar = gtk_calendar_new();
-	gtk_box_pack_start(GTK_BOX(tobox), end_calendar, TRUE, TRUE, 0);
+	gtk_file_chooser_set_current_folder(chooser, "/home/pi/sbitx/data");
+	GtkFileFilter* filter = gtk_file_filter_new();
+	gtk_file_filter_add_pattern(filter, "*.adi");
+	gtk_file_filter_add_pattern(filter, "*.ADI");
+	gtk_file_filter_add_pattern(filter, "*.adif");
+	gtk_file_filter_set_name(filter, "ADIF files (*.adi, *.adif)");
+	gtk_file_chooser_add_filter(chooser, filter);
 
-	// Show all widgets
-	gtk_widget_show_all(dialog);
-		gint response = gtk_dialog_run(GTK_DIALOG(dialog));
-		if (response == GTK_RESPONSE_OK){
-			char path[1000], start_str[20], end_str[20];
-			if (get_filename(path) != -1){
-				guint start_year, start_month, start_day, end_year, end_month, end_day;
-				gtk_calendar_get_date((GtkCalendar *)end_calendar,
-					&end_year, &end_month, &end_day);
-				gtk_calendar_get_date((GtkCalendar *)start_calendar,
-					&start_year, &start_month, &start_day);
-				sprintf(start_str,"%04d-%02d-%02d",start_year, start_month + 1, start_day);
-				sprintf(end_str, "%04d-%02d-%02d", end_year, end_month + 1, end_day);
-				export_adif(path, start_str, end_str);
-				printf("saved logs from %s to %s to file %s\n", start_str, end_str, path);
-			}
-		}
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+		char* filename = gtk_file_chooser_get_filename(chooser);
+		logbook_import_start(filename);
+		g_free(filename);
+	}
 	gtk_widget_destroy(dialog);
 }
-*/
 
 void export_button_clicked(GtkWidget* window)
 {
@@ -1062,137 +2219,10 @@ int edit_qso(char* qso_id, char* freq, char* mode, char* callsign, char* rst_sen
 	}
 }
 
-void add_to_list(GtkListStore* list_store, const gchar* id, const gchar* qso_date, const gchar* freq,
-	const gchar* mode, const gchar* callsign, const gchar* rst_sent, const gchar* exchange_sent,
-	const gchar* rst_recv, const gchar* exchange_recv, const gchar* tx_pwr, const gchar* swr,
-	const gchar* xota, const gchar* xota_loc, const gchar* comments)
-{
-	GtkTreeIter iter;
-	gtk_list_store_append(list_store, &iter);
-	gtk_list_store_set(list_store, &iter,
-		0, id,
-		1, qso_date,
-		2, freq,
-		3, mode,
-		4, callsign,
-		5, rst_sent,
-		6, exchange_sent,
-		7, rst_recv,
-		8, exchange_recv,
-		9, tx_pwr,
-		10, swr,
-		11, xota,
-		12, xota_loc,
-		13, comments,
-		-1);
-}
-
-int logbook_fill(int from_id, int count, const char* query)
-{
-	sqlite3_stmt *stmt;
-	char statement[200], param[2000];
-
-	logbook_open();
-
-	// add to the bottom of the logbook
-	if (from_id > 0) {
-		if (query)
-			snprintf(statement, sizeof(statement), "select * from logbook "
-							   "where (callsign_recv LIKE '%s%%' AND id < %d) ",
-				query, from_id);
-		else
-			snprintf(statement, sizeof(statement), "select * from logbook where id < %d ", from_id);
-	}
-	// last 200 QSOs
-	else if (from_id == 0) {
-		if (query)
-			snprintf(statement, sizeof(statement), "select * from logbook "
-							   "where callsign_recv LIKE '%s%%' ",
-				query);
-		else
-			strncpy(statement, "select * from logbook ", sizeof(statement));
-	}
-	// latest QSOs after from_id (top of the log)
-	else {
-		if (query)
-			snprintf(statement, sizeof(statement), "select * from logbook "
-							   "where (callsign_recv LIKE '%s%%' AND id > %d) ",
-				query, -from_id);
-		else
-			snprintf(statement, sizeof(statement), "select * from logbook where id > %d ", -from_id);
-	}
-
-	char stmt_count[100];
-	snprintf(stmt_count, sizeof(stmt_count), "ORDER BY id DESC LIMIT %d;", count);
-	strcat(statement, stmt_count);
-	// printf("[%s]\n", statement);
-	sqlite3_prepare_v2(db, statement, -1, &stmt, NULL);
-
-	int rec = 0;
-	char id[10], qso_time[20], qso_date[20], freq[20], mode[20], callsign[20],
-		rst_recv[20], exchange_recv[20], rst_sent[20], exchange_sent[20],
-		tx_pwr[10], swr[10], xota[5], xota_loc[16], comments[1000];
-
-	// these might be missing, so initialize them with empty strings
-	memset(tx_pwr, 0, sizeof(tx_pwr));
-	memset(swr, 0, sizeof(swr));
-
-	while (sqlite3_step(stmt) == SQLITE_ROW) {
-		int i;
-		int num_cols = sqlite3_column_count(stmt);
-		for (i = 0; i < num_cols; i++) {
-
-			char const* col_name = sqlite3_column_name(stmt, i);
-			if (!strcmp(col_name, "id"))
-				strcpy(id, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "qso_date"))
-				strcpy(qso_date, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "qso_time"))
-				strcpy(qso_time, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "freq"))
-				strcpy(freq, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "mode"))
-				strcpy(mode, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "callsign_recv"))
-				strcpy(callsign, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "rst_sent"))
-				strcpy(rst_sent, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "rst_recv"))
-				strcpy(rst_recv, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "exch_sent"))
-				strcpy(exchange_sent, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "exch_recv"))
-				strcpy(exchange_recv, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "tx_power"))
-				strcpy(tx_pwr, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "vswr"))
-				strcpy(swr, sqlite3_column_text(stmt, i));
-			else if (!strcmp(col_name, "xota"))
-				strncpy(xota, sqlite3_column_text(stmt, i), sizeof(xota));
-			else if (!strcmp(col_name, "xota_loc"))
-				strncpy(xota_loc, sqlite3_column_text(stmt, i), sizeof(xota_loc));
-			else if (!strcmp(col_name, "comments"))
-				strcpy(comments, sqlite3_column_text(stmt, i));
-		}
-
-		strcat(qso_date, " ");
-		strcat(qso_date, qso_time);
-		add_to_list(list_store, id,  qso_date, freq, mode,
-			callsign, rst_sent, exchange_sent, rst_recv, exchange_recv,
-			tx_pwr, swr, xota, xota_loc, comments);
-	}
-	sqlite3_finalize(stmt);
-}
-
-void clear_tree(GtkListStore* list_store)
-{
-	gtk_list_store_clear(list_store);
-}
-
 void search_button_clicked(GtkWidget* entry, gpointer search_box)
 {
-	const gchar* search_text = gtk_entry_get_text(GTK_ENTRY(search_box));
-	logbook_refill(strlen(search_text) == 0 ? NULL : search_text);
+	// an empty string shows everything again
+	logbook_refill(gtk_entry_get_text(GTK_ENTRY(search_box)));
 }
 
 void search_update(GtkWidget* entry, gpointer search_box)
@@ -1217,17 +2247,12 @@ void delete_button_clicked(GtkWidget* entry, gpointer tree_view)
 		GTK_DIALOG_MODAL, GTK_MESSAGE_QUESTION, GTK_BUTTONS_YES_NO,
 		"Do you want to delete #%s", qso_id);
 	int response = gtk_dialog_run(GTK_DIALOG(dialog));
-	if (response == GTK_RESPONSE_YES) {
-		char statement[100], *err_msg;
-		snprintf(statement, sizeof(statement), "DELETE FROM logbook WHERE id='%s';", qso_id);
-		sqlite3_exec(db, statement, 0, 0, &err_msg);
-	}
+	// the list follows once the writer thread has done it
+	if (response == GTK_RESPONSE_YES)
+		logbook_queue_write(LOGBOOK_WRITE_DELETE, 1, qso_id);
 	gtk_widget_destroy(dialog);
 	g_free(qso_id);
 	// printf("Response %d\n", response);
-
-	// refill the log
-	logbook_refill(NULL);
 }
 
 void edit_button_clicked(GtkWidget* entry, gpointer tree_view)
@@ -1263,19 +2288,10 @@ void edit_button_clicked(GtkWidget* entry, gpointer tree_view)
 	strncpy(exchange_recv, _exchange_recv, sizeof(exchange_recv)); g_free(_exchange_recv);
 	strncpy(comment, _comment, sizeof(comment)); g_free(_comment);
 
-	if (edit_qso(id, freq, mode, callsign, rst_sent, exchange_sent, rst_recv, exchange_recv, comment)) {
-		char statement[2000], *err_msg;
-		snprintf(statement, sizeof(statement),
-			"UPDATE logbook SET mode = '%s', freq = '%s', callsign_recv = '%s', rst_sent = '%s', "
-			"exch_sent = '%s',rst_recv = '%s', exch_recv = '%s', comments = '%s' WHERE id = '%s'",
-			mode, freq, callsign, rst_sent, exchange_sent, rst_recv, exchange_recv,
-			comment, id);
-
-		sqlite3_exec(db, statement, 0, 0, &err_msg);
-	}
-
-	// refill the log
-	logbook_refill(NULL);
+	// the list follows once the writer thread has done it
+	if (edit_qso(id, freq, mode, callsign, rst_sent, exchange_sent, rst_recv, exchange_recv, comment))
+		logbook_queue_write(LOGBOOK_WRITE_UPDATE, 9, mode, freq, callsign, rst_sent,
+			exchange_sent, rst_recv, exchange_recv, comment, id);
 }
 
 // Function to handle row activation
@@ -1293,16 +2309,9 @@ void on_row_activated(GtkTreeView* treeview, GtkTreePath* path, GtkTreeViewColum
 		7, &rst_recv, 8, &exchange_recv, 9, &comment,
 		-1);
 
-	if (edit_qso(qso_id, freq, mode, callsign, rst_sent, exchange_sent, rst_recv, exchange_recv, comment)) {
-		char statement[1000], *err_msg;
-		snprintf(statement, sizeof(statement),
-			"UPDATE logbook SET mode = '%s', freq = '%s', callsign_recv = '%s', rst_sent = '%s', "
-			"exch_sent = '%s',rst_recv = '%s', exch_recv = '%s', comments = '%s' WHERE id = '%s'",
-			mode, freq, callsign, rst_sent, exchange_sent, rst_recv, exchange_recv,
-			comment, qso_id);
-
-		sqlite3_exec(db, statement, 0, 0, &err_msg);
-	}
+	if (edit_qso(qso_id, freq, mode, callsign, rst_sent, exchange_sent, rst_recv, exchange_recv, comment))
+		logbook_queue_write(LOGBOOK_WRITE_UPDATE, 9, mode, freq, callsign, rst_sent,
+			exchange_sent, rst_recv, exchange_recv, comment, qso_id);
 
 	g_free(qso_id);
 	g_free(mode);
@@ -1313,9 +2322,6 @@ void on_row_activated(GtkTreeView* treeview, GtkTreePath* path, GtkTreeViewColum
 	g_free(rst_recv);
 	g_free(exchange_recv);
 	g_free(comment);
-
-	// refill the log
-	logbook_refill(NULL);
 }
 
 // Function to handle row selection
@@ -1338,10 +2344,11 @@ static void logbook_window_close(GtkWidget* widget, gpointer user_data)
 		 model can be finalized once the tree view releases its ref.
 		 Finally, clear module-level pointers to avoid dangling references.
 	*/
-	if (list_store) {
-		g_object_unref(list_store);
-		list_store = NULL;
+	if (log_model) {
+		g_object_unref(log_model);
+		log_model = NULL;
 	}
+	logbook_search_text[0] = 0;
 	tree_view = NULL;
 	selection = NULL;
 	logbook_window = NULL;
@@ -1417,10 +2424,10 @@ void logbook_list_open()
 	gtk_toolbar_insert(GTK_TOOLBAR(toolbar), delete_tool_item, -1);
 
 	// Create "Import" button  - W9JES
-	//	GtkWidget *import_button = gtk_button_new_with_label("Import...");
-	//	GtkToolItem *import_tool_item = gtk_tool_item_new();
-	//	gtk_container_add(GTK_CONTAINER(import_tool_item), import_button);
-	//	gtk_toolbar_insert(GTK_TOOLBAR(toolbar), import_tool_item, -1);
+	GtkWidget* import_button = gtk_button_new_with_label("Import...");
+	GtkToolItem* import_tool_item = gtk_tool_item_new();
+	gtk_container_add(GTK_CONTAINER(import_tool_item), import_button);
+	gtk_toolbar_insert(GTK_TOOLBAR(toolbar), import_tool_item, -1);
 
 	// Create "Export" button	- W9JES
 	GtkWidget* export_button = gtk_button_new_with_label("Export...");
@@ -1434,32 +2441,36 @@ void logbook_list_open()
 		GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
 	gtk_box_pack_start(GTK_BOX(vbox), scrolled_window, TRUE, TRUE, 0);
 
-	// Create a list store
-	if (!list_store)
-		list_store = gtk_list_store_new(14, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
-			G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
-			G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
-	else
-		clear_tree(list_store);
+	// Create the (virtual) model: rows are only fetched when they are shown
+	logbook_open();
+	if (!log_model)
+		log_model = logbook_model_new(db, logbook_has_power_swr_xota());
 
-	// Create a tree view and set up columns with headings aligned to the left
-	tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(list_store));
+	// Create a tree view and set up columns with headings aligned to the left.
+	// Fixed column widths let the tree view use fixed-height mode, so that
+	// it asks the model only for the rows that are visible.
+	tree_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(log_model));
 	const char *headings[] = {"#", "Date", "Freq", "Mode", "Call", "Sent", "Exch",
 			"Recv", "Exch", "Tx Pwr", "SWR", "xOTA", "xOTA Loc", "Comments"};
-	for (int i = 0; i < 14; ++i) {
+	const int widths[] = {55, 125, 85, 50, 95, 45, 60, 45, 60, 55, 45, 50, 80, 300};
+	for (int i = 0; i < LOGBOOK_MODEL_COLUMNS; ++i) {
 		GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
 		GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes(headings[i], renderer,
 			"text", i, NULL);
 		gtk_tree_view_column_set_alignment(column, 0.0); // Set alignment to the left (0.0)
+		gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+		gtk_tree_view_column_set_fixed_width(column, widths[i]);
+		gtk_tree_view_column_set_resizable(column, TRUE);
 		gtk_tree_view_append_column(GTK_TREE_VIEW(tree_view), column);
 	}
+	gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(tree_view), TRUE);
 
 	// Connect buttons to handlers, passing tree_view as user_data
 	g_signal_connect(edit_button, "clicked", G_CALLBACK(edit_button_clicked), tree_view);
 	g_signal_connect(delete_button, "clicked", G_CALLBACK(delete_button_clicked), tree_view);
 	g_signal_connect(search_entry, "changed", G_CALLBACK(search_update), tree_view);
 	// These handlers take logbook_window as user_data
-	//	g_signal_connect(import_button, "clicked", G_CALLBACK(import_button_clicked), logbook_window);  - W9JES
+	g_signal_connect(import_button, "clicked", G_CALLBACK(import_button_clicked), logbook_window); // W9JES
 	g_signal_connect(export_button, "clicked", G_CALLBACK(export_button_clicked), logbook_window); // W9JES
 	/*
 		// Apply CSS for tree view
@@ -1474,8 +2485,6 @@ void logbook_list_open()
 	*/
 	// Add tree view to scrolled window
 	gtk_container_add(GTK_CONTAINER(scrolled_window), tree_view);
-	clear_tree(list_store);
-	logbook_fill(0, 10000, NULL);
 
 	// Connect row activation signal
 	//		gtk_tree_view_set_activate_on_single_click((GtkTreeView *)tree_view, FALSE);
@@ -13,6 +13,10 @@ void logbook_open();
 void logbook_close();
 time_t logbook_grid_last_qso(const char *id, int len);
 time_t logbook_last_qso(const char * callsign, int len);
+int logbook_search_ids(const char *query, int **ids);
+// worked-status tables (see worked.h)
+int logbook_current_band();
+int logbook_awards_report(char *buf, int len);
 
 // ADIF export
 // start_date can be null or empty if you want all records, unrestricted
@@ -22,3 +26,8 @@ void logbook_end_query(void *stmt);
 int write_adif_header(char *buf, int len, const char *source);
 int write_adif_record(void *stmt, char *buf, int len);
 int export_adif(const char *path, const char *start_date, const char *end_date, const char *source);
+
+// ADIF import: returns the number of QSOs added, or -1 on error
+int import_adif(const char *path);
+// same, in a background thread, reporting on the console
+void logbook_import_start(const char *path);
@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "logbook_model.h"
+
+/*
+	Rows are addressed by their position in visible[], which indexes keys[]
+	(all QSOs, newest first). A page is PAGE_ROWS consecutive visible rows;
+	the cache keeps the CACHE_PAGES most recently used pages. With the tree
+	view in fixed-height mode, it only asks for the rows on screen, so
+	opening or searching the log costs one pass over (id, callsign) and
+	a single page query, however big the log is.
+*/
+
+#define PAGE_ROWS 64
+#define CACHE_PAGES 16
+
+typedef struct {
+	int id;
+	char call[16];
+} row_key;
+
+typedef struct {
+	int first;		// position of the first row of the page, or -1 if unused
+	unsigned int used;	// for LRU eviction
+	gchar *cells[PAGE_ROWS][LOGBOOK_MODEL_COLUMNS];
+} row_page;
+
+struct _LogbookModel {
+	GObject parent;
+	sqlite3 *db;
+	sqlite3_stmt *page_stmt;
+	row_key *keys;
+	int n_keys;
+	int *visible;
+	int n_visible;
+	char filter[32];
+	int *search_ids;	// rows matching the filter other than by callsign prefix
+	int n_search_ids;
+	row_page cache[CACHE_PAGES];
+	unsigned int clock;
+	gint stamp;
+};
+
+static void logbook_model_tree_model_init(GtkTreeModelIface *iface);
+static gboolean set_iter(LogbookModel *m, GtkTreeIter *iter, int row);
+
+G_DEFINE_TYPE_WITH_CODE(LogbookModel, logbook_model, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, logbook_model_tree_model_init))
+
+static void cache_clear(LogbookModel *m)
+{
+	for (int p = 0; p < CACHE_PAGES; p++) {
+		for (int r = 0; r < PAGE_ROWS; r++)
+			for (int c = 0; c < LOGBOOK_MODEL_COLUMNS; c++) {
+				g_free(m->cache[p].cells[r][c]);
+				m->cache[p].cells[r][c] = NULL;
+			}
+		m->cache[p].first = -1;
+		m->cache[p].used = 0;
+	}
+	// invalidate outstanding iters
+	m->stamp = g_random_int();
+}
+
+// Run one query with the ids of a page, and fill the page cells from the results.
+static void page_fetch(LogbookModel *m, row_page *page, int first)
+{
+	int ids[PAGE_ROWS];
+	int n = MIN(PAGE_ROWS, m->n_visible - first);
+
+	for (int r = 0; r < PAGE_ROWS; r++) {
+		ids[r] = r < n ? m->keys[m->visible[first + r]].id : -1;
+		sqlite3_bind_int(m->page_stmt, r + 1, ids[r]);
+		for (int c = 0; c < LOGBOOK_MODEL_COLUMNS; c++) {
+			g_free(page->cells[r][c]);
+			page->cells[r][c] = NULL;
+		}
+	}
+	while (sqlite3_step(m->page_stmt) == SQLITE_ROW) {
+		int id = sqlite3_column_int(m->page_stmt, 0);
+		int r = 0;
+		while (r < n && ids[r] != id)
+			r++;
+		if (r == n)
+			continue;
+		for (int c = 0; c < LOGBOOK_MODEL_COLUMNS; c++)
+			page->cells[r][c] = g_strdup((const gchar *)sqlite3_column_text(m->page_stmt, c));
+	}
+	sqlite3_reset(m->page_stmt);
+	page->first = first;
+}
+
+static row_page *page_for_row(LogbookModel *m, int row)
+{
+	int first = row - row % PAGE_ROWS;
+	row_page *lru = &m->cache[0];
+
+	for (int p = 0; p < CACHE_PAGES; p++) {
+		if (m->cache[p].first == first) {
+			m->cache[p].used = ++m->clock;
+			return &m->cache[p];
+		}
+		if (m->cache[p].used < lru->used)
+			lru = &m->cache[p];
+	}
+	page_fetch(m, lru, first);
+	lru->used = ++m->clock;
+	return lru;
+}
+
+// Position of QSO \a id in keys[] (which is in descending id order), or -1.
+static int key_position(LogbookModel *m, int id)
+{
+	int lo = 0, hi = m->n_keys - 1;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if (m->keys[mid].id == id)
+			return mid;
+		if (m->keys[mid].id > id)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+static void apply_filter(LogbookModel *m, bool narrow)
+{
+	int len = strlen(m->filter);
+	int n = 0;
+
+	if (m->n_search_ids) {
+		// the prefix matches, plus the rows that the search found
+		bool *found = g_new0(bool, MAX(m->n_keys, 1));
+		for (int i = 0; i < m->n_search_ids; i++) {
+			int k = key_position(m, m->search_ids[i]);
+			if (k >= 0)
+				found[k] = true;
+		}
+		for (int i = 0; i < m->n_keys; i++)
+			if (found[i] || !g_ascii_strncasecmp(m->keys[i].call, m->filter, len))
+				m->visible[n++] = i;
+		g_free(found);
+	} else if (narrow) {
+		// the new filter extends the old one: only the rows that matched can still match
+		for (int i = 0; i < m->n_visible; i++)
+			if (!g_ascii_strncasecmp(m->keys[m->visible[i]].call, m->filter, len))
+				m->visible[n++] = m->visible[i];
+	} else {
+		for (int i = 0; i < m->n_keys; i++)
+			if (!len || !g_ascii_strncasecmp(m->keys[i].call, m->filter, len))
+				m->visible[n++] = i;
+	}
+	m->n_visible = n;
+	cache_clear(m);
+}
+
+/*!
+	Reload the ids and callsigns of all QSOs (after the logbook has changed),
+	keeping the current filter.
+*/
+void logbook_model_reload(LogbookModel *m)
+{
+	sqlite3_stmt *stmt;
+	struct timespec t0, t1;
+	int cap = m->n_keys > 0 ? m->n_keys + 64 : 1024;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	m->keys = g_renew(row_key, m->keys, cap);
+	m->n_keys = 0;
+	if (sqlite3_prepare_v2(m->db, "SELECT id, callsign_recv FROM logbook ORDER BY id DESC",
+			-1, &stmt, NULL) == SQLITE_OK) {
+		while (sqlite3_step(stmt) == SQLITE_ROW) {
+			if (m->n_keys == cap) {
+				cap *= 2;
+				m->keys = g_renew(row_key, m->keys, cap);
+			}
+			row_key *k = &m->keys[m->n_keys++];
+			const char *call = (const char *)sqlite3_column_text(stmt, 1);
+			k->id = sqlite3_column_int(stmt, 0);
+			g_strlcpy(k->call, call ? call : "", sizeof(k->call));
+		}
+		sqlite3_finalize(stmt);
+	}
+	m->visible = g_renew(int, m->visible, MAX(cap, 1));
+	apply_filter(m, false);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	printf("Logbook model: %d QSOs loaded in %ld ms\n", m->n_keys,
+		(t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000);
+}
+
+/*!
+	Show only the QSOs whose callsign starts with \a filter (case-insensitive),
+	and those with the \a n_ids ids in \a search_ids (found by a full-text search);
+	all of them if \a filter is null or empty. Without search ids, typing
+	one more character only searches the rows that matched before.
+*/
+void logbook_model_set_filter(LogbookModel *m, const char *filter, const int *search_ids, int n_ids)
+{
+	int old_len = strlen(m->filter);
+	bool narrow = old_len && filter && !g_ascii_strncasecmp(filter, m->filter, old_len);
+
+	g_strlcpy(m->filter, filter ? filter : "", sizeof(m->filter));
+	g_free(m->search_ids);
+	m->search_ids = g_new(int, MAX(n_ids, 1));
+	memcpy(m->search_ids, search_ids, n_ids * sizeof(int));
+	m->n_search_ids = n_ids;
+	apply_filter(m, narrow);
+}
+
+// The callsign of QSO \a id, from the logbook, into \a call.
+static void read_call(LogbookModel *m, int id, char *call, int len)
+{
+	sqlite3_stmt *stmt;
+
+	call[0] = 0;
+	if (sqlite3_prepare_v2(m->db, "SELECT callsign_recv FROM logbook WHERE id = ?", -1, &stmt, NULL) != SQLITE_OK)
+		return;
+	sqlite3_bind_int(stmt, 1, id);
+	if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0))
+		g_strlcpy(call, (const char *)sqlite3_column_text(stmt, 0), len);
+	sqlite3_finalize(stmt);
+}
+
+// Position in visible[] of keys[k], or -1.
+static int visible_position(LogbookModel *m, int k)
+{
+	for (int r = 0; r < m->n_visible; r++)
+		if (m->visible[r] == k)
+			return r;
+	return -1;
+}
+
+static void emit_row(LogbookModel *m, int row, bool inserted)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path = gtk_tree_path_new_from_indices(row, -1);
+	set_iter(m, &iter, row);
+	if (inserted)
+		gtk_tree_model_row_inserted(GTK_TREE_MODEL(m), path, &iter);
+	else
+		gtk_tree_model_row_changed(GTK_TREE_MODEL(m), path, &iter);
+	gtk_tree_path_free(path);
+}
+
+/*!
+	QSO \a id has been added to the logbook: it goes into its place among
+	the keys, and is shown if its callsign matches the filter. The rest
+	of the rows stay as they are.
+*/
+void logbook_model_row_inserted(LogbookModel *m, int id)
+{
+	int k = 0, r = 0;
+
+	if (key_position(m, id) >= 0)
+		return;
+	while (k < m->n_keys && m->keys[k].id > id)
+		k++;
+	m->keys = g_renew(row_key, m->keys, m->n_keys + 1);
+	m->visible = g_renew(int, m->visible, m->n_keys + 1);
+	memmove(&m->keys[k + 1], &m->keys[k], (m->n_keys - k) * sizeof(row_key));
+	m->n_keys++;
+	m->keys[k].id = id;
+	read_call(m, id, m->keys[k].call, sizeof(m->keys[k].call));
+
+	for (int i = 0; i < m->n_visible; i++)
+		if (m->visible[i] >= k)
+			m->visible[i]++;
+	cache_clear(m);
+	if (g_ascii_strncasecmp(m->keys[k].call, m->filter, strlen(m->filter)))
+		return;
+	while (r < m->n_visible && m->visible[r] < k)
+		r++;
+	memmove(&m->visible[r + 1], &m->visible[r], (m->n_visible - r) * sizeof(int));
+	m->visible[r] = k;
+	m->n_visible++;
+	emit_row(m, r, true);
+}
+
+// QSO \a id has been edited: only its page is fetched again.
+void logbook_model_row_changed(LogbookModel *m, int id)
+{
+	int k = key_position(m, id);
+
+	if (k < 0)
+		return;
+	read_call(m, id, m->keys[k].call, sizeof(m->keys[k].call));
+	int r = visible_position(m, k);
+	if (r < 0)
+		return;
+	for (int p = 0; p < CACHE_PAGES; p++)
+		if (m->cache[p].first == r - r % PAGE_ROWS)
+			m->cache[p].first = -1;
+	emit_row(m, r, false);
+}
+
+// QSO \a id has been deleted from the logbook.
+void logbook_model_row_deleted(LogbookModel *m, int id)
+{
+	int k = key_position(m, id);
+
+	if (k < 0)
+		return;
+	int r = visible_position(m, k);
+	memmove(&m->keys[k], &m->keys[k + 1], (m->n_keys - k - 1) * sizeof(row_key));
+	m->n_keys--;
+	if (r >= 0) {
+		memmove(&m->visible[r], &m->visible[r + 1], (m->n_visible - r - 1) * sizeof(int));
+		m->n_visible--;
+	}
+	for (int i = 0; i < m->n_visible; i++)
+		if (m->visible[i] > k)
+			m->visible[i]--;
+	cache_clear(m);
+	if (r >= 0) {
+		GtkTreePath *path = gtk_tree_path_new_from_indices(r, -1);
+		gtk_tree_model_row_deleted(GTK_TREE_MODEL(m), path);
+		gtk_tree_path_free(path);
+	}
+}
+
+int logbook_model_row_count(LogbookModel *m)
+{
+	return m->n_visible;
+}
+
+LogbookModel *logbook_model_new(sqlite3 *db, bool has_power_swr_xota)
+{
+	LogbookModel *m = g_object_new(LOGBOOK_TYPE_MODEL, NULL);
+	GString *sql = g_string_new(has_power_swr_xota ?
+		"SELECT id, qso_date || ' ' || qso_time, freq, mode, callsign_recv, rst_sent, exch_sent,"
+		" rst_recv, exch_recv, tx_power, vswr, xota, xota_loc, comments FROM logbook WHERE id IN (" :
+		"SELECT id, qso_date || ' ' || qso_time, freq, mode, callsign_recv, rst_sent, exch_sent,"
+		" rst_recv, exch_recv, '', '', '', '', comments FROM logbook WHERE id IN (");
+
+	for (int r = 0; r < PAGE_ROWS; r++)
+		g_string_append(sql, r ? ",?" : "?");
+	g_string_append(sql, ");");
+	m->db = db;
+	if (sqlite3_prepare_v2(db, sql->str, -1, &m->page_stmt, NULL) != SQLITE_OK)
+		fprintf(stderr, "Logbook model: %s\n", sqlite3_errmsg(db));
+	g_string_free(sql, TRUE);
+	logbook_model_reload(m);
+	return m;
+}
+
+static void logbook_model_finalize(GObject *object)
+{
+	LogbookModel *m = LOGBOOK_MODEL(object);
+	cache_clear(m);
+	sqlite3_finalize(m->page_stmt);
+	g_free(m->keys);
+	g_free(m->visible);
+	g_free(m->search_ids);
+	G_OBJECT_CLASS(logbook_model_parent_class)->finalize(object);
+}
+
+static void logbook_model_class_init(LogbookModelClass *klass)
+{
+	G_OBJECT_CLASS(klass)->finalize = logbook_model_finalize;
+}
+
+static void logbook_model_init(LogbookModel *m)
+{
+	for (int p = 0; p < CACHE_PAGES; p++)
+		m->cache[p].first = -1;
+	m->stamp = g_random_int();
+}
+
+/* GtkTreeModel interface: a flat list; iter->user_data is the row position */
+
+static GtkTreeModelFlags get_flags(GtkTreeModel *model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint get_n_columns(GtkTreeModel *model)
+{
+	return LOGBOOK_MODEL_COLUMNS;
+}
+
+static GType get_column_type(GtkTreeModel *model, gint column)
+{
+	return G_TYPE_STRING;
+}
+
+static gboolean set_iter(LogbookModel *m, GtkTreeIter *iter, int row)
+{
+	if (row < 0 || row >= m->n_visible) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	iter->stamp = m->stamp;
+	iter->user_data = GINT_TO_POINTER(row);
+	return TRUE;
+}
+
+static gboolean get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	if (gtk_tree_path_get_depth(path) != 1)
+		return FALSE;
+	return set_iter(LOGBOOK_MODEL(model), iter, gtk_tree_path_get_indices(path)[0]);
+}
+
+static GtkTreePath *get_path(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return gtk_tree_path_new_from_indices(GPOINTER_TO_INT(iter->user_data), -1);
+}
+
+static void get_value(GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value)
+{
+	LogbookModel *m = LOGBOOK_MODEL(model);
+	int row = GPOINTER_TO_INT(iter->user_data);
+
+	g_value_init(value, G_TYPE_STRING);
+	if (iter->stamp != m->stamp || row >= m->n_visible || column < 0 || column >= LOGBOOK_MODEL_COLUMNS)
+		return;
+	row_page *page = page_for_row(m, row);
+	g_value_set_string(value, page->cells[row - page->first][column]);
+}
+
+static gboolean iter_next(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return set_iter(LOGBOOK_MODEL(model), iter, GPOINTER_TO_INT(iter->user_data) + 1);
+}
+
+static gboolean iter_previous(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return set_iter(LOGBOOK_MODEL(model), iter, GPOINTER_TO_INT(iter->user_data) - 1);
+}
+
+static gboolean iter_children(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	if (parent)
+		return FALSE;
+	return set_iter(LOGBOOK_MODEL(model), iter, 0);
+}
+
+static gboolean iter_has_child(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return FALSE;
+}
+
+static gint iter_n_children(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return iter ? 0 : LOGBOOK_MODEL(model)->n_visible;
+}
+
+static gboolean iter_nth_child(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n)
+{
+	if (parent)
+		return FALSE;
+	return set_iter(LOGBOOK_MODEL(model), iter, n);
+}
+
+static gboolean iter_parent(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	return FALSE;
+}
+
+static void logbook_model_tree_model_init(GtkTreeModelIface *iface)
+{
+	iface->get_flags = get_flags;
+	iface->get_n_columns = get_n_columns;
+	iface->get_column_type = get_column_type;
+	iface->get_iter = get_iter;
+	iface->get_path = get_path;
+	iface->get_value = get_value;
+	iface->iter_next = iter_next;
+	iface->iter_previous = iter_previous;
+	iface->iter_children = iter_children;
+	iface->iter_has_child = iter_has_child;
+	iface->iter_n_children = iter_n_children;
+	iface->iter_nth_child = iter_nth_child;
+	iface->iter_parent = iter_parent;
+}
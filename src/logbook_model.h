@@ -0,0 +1,30 @@
+#ifndef LOGBOOK_MODEL_H
+#define LOGBOOK_MODEL_H
+
+#include <stdbool.h>
+#include <gtk/gtk.h>
+#include <sqlite3.h>
+
+/*
+	A virtual GtkTreeModel over the logbook table, for the logbook window.
+	It keeps only the id and callsign of each QSO in memory, and fetches
+	the full rows a page at a time, as the tree view asks for them.
+	The columns are the same as the old GtkListStore had:
+	id, date+time, freq, mode, call, rst sent, exch sent, rst recv,
+	exch recv, tx power, swr, xota, xota loc, comments; all strings.
+*/
+
+#define LOGBOOK_MODEL_COLUMNS 14
+
+#define LOGBOOK_TYPE_MODEL (logbook_model_get_type())
+G_DECLARE_FINAL_TYPE(LogbookModel, logbook_model, LOGBOOK, MODEL, GObject)
+
+LogbookModel *logbook_model_new(sqlite3 *db, bool has_power_swr_xota);
+void logbook_model_reload(LogbookModel *model);
+void logbook_model_set_filter(LogbookModel *model, const char *filter, const int *search_ids, int n_ids);
+void logbook_model_row_inserted(LogbookModel *model, int id);
+void logbook_model_row_changed(LogbookModel *model, int id);
+void logbook_model_row_deleted(LogbookModel *model, int id);
+int logbook_model_row_count(LogbookModel *model);
+
+#endif /* LOGBOOK_MODEL_H */
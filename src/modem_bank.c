@@ -0,0 +1,181 @@
+// standard library includes
+#include <complex.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// third-party library includes
+#include <fftw3.h>
+
+// project-specific includes
+#include "sdr.h"
+#include "sdr_ui.h"
+#include "modem_bank.h"
+
+// windowed sinc low-pass filter, with a gain of 1 at 0 Hz
+// inputs:  float *taps, int n, float cutoff (as a fraction of the sampling rate)
+// returns: void
+void bank_lowpass(float *taps, int n, float cutoff) {
+  float sum = 0.0f;
+  for (int i = 0; i < n; i++) {
+    float m = i - (n - 1) / 2.0f;
+    float x = (m == 0.0f) ? 2.0f * cutoff : sinf(2.0f * M_PI * cutoff * m) / (M_PI * m);
+    float w = 0.54f - 0.46f * cosf(2.0f * M_PI * i / (n - 1));
+    taps[i] = x * w;
+    sum += taps[i];
+  }
+  for (int i = 0; i < n; i++)
+    taps[i] /= sum;
+}
+
+// set up the front end and the finder; the modem's settings are applied
+// before the next block
+// inputs:  struct modem_bank *b
+// returns: void
+void bank_init(struct modem_bank *b) {
+  bank_lowpass(b->front_taps, BANK_FRONT_TAPS, 3300.0f / BANK_RATE);
+  memset(b->front_history, 0, sizeof(b->front_history));
+  b->front_phase = 0;
+
+  for (int i = 0; i < BANK_FFT; i++)
+    b->find_window[i] = 0.5f - 0.5f * cosf(2.0f * M_PI * i / BANK_FFT);
+  if (!b->fft_in) {
+    b->fft_in = fftwf_malloc(sizeof(fftwf_complex) * BANK_FFT);
+    b->fft_out = fftwf_malloc(sizeof(fftwf_complex) * BANK_FFT);
+    b->fft_plan = fftwf_plan_dft_1d(BANK_FFT, b->fft_in, b->fft_out, FFTW_FORWARD, FFTW_ESTIMATE);
+  }
+  b->find_len = 0;
+  b->power_valid = false;
+  b->applied = atomic_load_explicit(&b->generation, memory_order_relaxed) - 1;
+}
+
+// called by the modem's poll after it has changed what it wants
+// inputs:  struct modem_bank *b
+// returns: void
+void bank_changed(struct modem_bank *b) {
+  atomic_fetch_add_explicit(&b->generation, 1, memory_order_release);
+}
+
+// a decoded character: channel 0 writes it to the console, the others
+// collect a line of it
+// inputs:  struct modem_bank *b, struct bank_line *line, int index, int c, float freq
+// returns: void
+void bank_rx_text(struct modem_bank *b, struct bank_line *line, int index, int c, float freq) {
+  if (c != '\n' && (c < ' ' || c > '~'))
+    return;
+  if (index == 0) {
+    char s[2] = {c, 0};
+    write_console(STYLE_FLDIGI_RX, s);
+    b->console_mid_line = (c != '\n');
+    return;
+  }
+  if (c != '\n' && !(c == ' ' && line->len == 0))
+    line->text[line->len++] = c;
+  if (c == '\n' || line->len >= BANK_LINE)
+    bank_skim_line(b, line, freq);
+}
+
+// write a skimmer channel's line of text, with its frequency
+// inputs:  struct modem_bank *b, struct bank_line *line, float freq
+// returns: void
+void bank_skim_line(struct modem_bank *b, struct bank_line *line, float freq) {
+  char buff[BANK_LINE + 32];
+  if (!line->len)
+    return;
+  line->text[line->len] = 0;
+  snprintf(buff, sizeof(buff), "%s%s %4.0f: %s\n", b->console_mid_line ? "\n" : "",
+    b->name, freq, line->text);
+  write_console(STYLE_FLDIGI_RX, buff);
+  b->console_mid_line = false;
+  line->len = 0;
+}
+
+// the finder's spectrum, averaged over the last few passes
+// inputs:  struct modem_bank *b
+// returns: void
+static void bank_find(struct modem_bank *b) {
+  for (int i = 0; i < BANK_FFT; i++)
+    b->fft_in[i] = b->find_buf[i] * b->find_window[i];
+  fftwf_execute(b->fft_plan);
+  for (int k = 0; k < BANK_FFT / 2; k++) {
+    float p = crealf(b->fft_out[k]) * crealf(b->fft_out[k]) + cimagf(b->fft_out[k]) * cimagf(b->fft_out[k]);
+    b->power[k] = b->power_valid ? b->power[k] + (p - b->power[k]) * BANK_FIND_ALPHA : p;
+  }
+  b->power_valid = true;
+  b->find();
+}
+
+// low-pass filter and decimate the 96 kHz audio to 8 kHz; the filter
+// runs only for the samples that are kept
+// inputs:  struct modem_bank *b, const int32_t *input, int count, float *output
+// returns: int, the number of output samples
+static int bank_decimate(struct modem_bank *b, const int32_t *input, int count, float *output) {
+  static float x[BANK_FRONT_TAPS - 1 + BANK_MAX_BLOCK];
+  int n = 0, i;
+
+  memcpy(x, b->front_history, sizeof(b->front_history));
+  for (i = 0; i < count; i++)
+    x[BANK_FRONT_TAPS - 1 + i] = input[i] / 32768.0f;
+  for (i = b->front_phase; i < count; i += BANK_DECIMATION) {
+    float y = 0.0f;
+    for (int t = 0; t < BANK_FRONT_TAPS; t++)
+      y += x[i + t] * b->front_taps[t];
+    output[n++] = y;
+  }
+  b->front_phase = i - count;
+  memcpy(b->front_history, x + count, sizeof(b->front_history));
+  return n;
+}
+
+// a block of received audio through the front end, the finder and the channels
+// inputs:  struct modem_bank *b, int32_t *samples, int count
+// returns: void
+void bank_rx(struct modem_bank *b, int32_t *samples, int count) {
+  float audio[BANK_MAX_BLOCK / BANK_DECIMATION + 1];
+  struct timespec t0, t1;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  unsigned int generation = atomic_load_explicit(&b->generation, memory_order_acquire);
+  if (b->applied != generation) {
+    b->applied = generation;
+    b->configure();
+  }
+
+  while (count > 0) {
+    int block = count > BANK_MAX_BLOCK ? BANK_MAX_BLOCK : count;
+    int n = bank_decimate(b, samples, block, audio);
+    samples += block;
+    count -= block;
+
+    for (int i = 0; i < n; i++) {
+      b->find_buf[b->find_len++] = audio[i];
+      if (b->find_len == BANK_FFT) {
+        bank_find(b);
+        memmove(b->find_buf, b->find_buf + BANK_FFT / 2, BANK_FFT / 2 * sizeof(float));
+        b->find_len = BANK_FFT / 2;
+      }
+    }
+
+    b->rx_channel_blocks += b->channels_rx(audio, n);
+    b->rx_blocks++;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  b->rx_ns += (t1.tv_sec - t0.tv_sec) * 1000000000ULL + t1.tv_nsec - t0.tv_nsec;
+}
+
+// the CPU time spent receiving, a line for the modem's report
+// inputs:  struct modem_bank *b, char *report, int len
+// returns: int, the length of the line
+int bank_report(struct modem_bank *b, char *report, int len) {
+  if (!b->rx_blocks || len <= 0)
+    return 0;
+  int n = snprintf(report, len, "%.1f us per block, %.1f us per channel\n",
+    b->rx_ns / 1000.0 / b->rx_blocks,
+    b->rx_channel_blocks ? b->rx_ns / 1000.0 / b->rx_channel_blocks : 0.0);
+  return n < len ? n : len - 1;
+}
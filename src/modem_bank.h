@@ -0,0 +1,71 @@
+#ifndef MODEM_BANK_H
+#define MODEM_BANK_H
+
+// The receive front end that modem_psk.c and modem_rtty.c share: the
+// audio from modem_rx() is decimated from 96 kHz to 8 kHz once, and handed
+// to the modem's bank of channels; a channel finder averages the spectrum
+// of the 8 kHz audio every 64 ms for the modem to look for signals in.
+// The modem's settings are picked up on the audio thread: the poll sets
+// what it wants and calls bank_changed(), and bank_rx() calls the modem's
+// configure() before the next block.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fftw3.h>
+
+#define BANK_RATE 96000            // modem_rx()
+#define BANK_DECIMATION 12         // to the 8 kHz the channels work at
+#define BANK_FS 8000
+#define BANK_FRONT_TAPS 96
+#define BANK_MAX_BLOCK 2048
+#define BANK_FFT 1024              // channel finder: 7.8 Hz bins at 8 kHz
+#define BANK_FIND_ALPHA 0.3f
+#define BANK_LINE 64               // a line of skimmer text
+
+// what a skimmer channel has received since its last line
+struct bank_line {
+  char text[BANK_LINE + 1];
+  int len;
+};
+
+struct modem_bank {
+  // set by the modem
+  const char *name;                          // before each skimmer line
+  void (*configure)(void);                   // the settings changed
+  void (*find)(void);                        // power[] has been updated
+  int (*channels_rx)(const float *audio, int n);  // returns the channels that ran
+
+  // the front end
+  float front_taps[BANK_FRONT_TAPS];
+  float front_history[BANK_FRONT_TAPS - 1];
+  int front_phase;
+
+  // the channel finder
+  float find_buf[BANK_FFT];
+  int find_len;
+  float find_window[BANK_FFT];
+  float power[BANK_FFT / 2];                 // averaged
+  bool power_valid;
+  fftwf_complex *fft_in, *fft_out;
+  fftwf_plan fft_plan;
+
+  atomic_uint generation;                    // bumped by bank_changed()
+  unsigned int applied;
+  bool console_mid_line;
+
+  // CPU time spent receiving, for bank_report()
+  uint64_t rx_ns;
+  uint64_t rx_blocks;
+  uint64_t rx_channel_blocks;
+};
+
+void bank_lowpass(float *taps, int n, float cutoff);
+void bank_init(struct modem_bank *b);
+void bank_changed(struct modem_bank *b);
+void bank_rx_text(struct modem_bank *b, struct bank_line *line, int index, int c, float freq);
+void bank_skim_line(struct modem_bank *b, struct bank_line *line, float freq);
+void bank_rx(struct modem_bank *b, int32_t *samples, int count);
+int  bank_report(struct modem_bank *b, char *report, int len);
+
+#endif /* MODEM_BANK_H */
@@ -3,6 +3,9 @@
 #include <complex.h>
 #include <ctype.h>  
 #include <math.h>   
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdint.h> 
 #include <stdbool.h>
 #include <stdio.h>
@@ -20,6 +23,7 @@
 #include "sdr.h"       
 #include "sdr_ui.h"    
 #include "modem_cw.h"  
+#include "scp.h"
 #include "sound.h"
 
 // defines and constants
@@ -28,6 +32,21 @@
 #define FLOAT_SCALE (1073741824.0)  // 2^30
 #define HIGH_DECAY 100   // larger means change sig level slower
 #define NOISE_DECAY 100  // controls max noise_level adjustment
+#define CW_KEY_EVENTS 64               // key changes queued for the audio thread
+#define CW_TX_BLOCK (MAX_BINS / 2)    // samples tx_process() computes at a time
+#define CW_KEY_MARGIN_NS 4000000LL     // for the sound thread waking late
+// paddle to TX: a change can come just after its block was computed
+#define CW_KEY_LATENCY_NS (CW_TX_BLOCK * 1000000000LL / 96000 + CW_KEY_MARGIN_NS)
+#define CW_KEY_DEBOUNCE_NS 3000000LL
+#define CW_KEY_POLL_NS 1000000LL
+#define CW_CLOCK_BLOCK CW_TX_BLOCK    // samples between readings of the wall clock
+#define CW_CLOCK_RESET_NS 50000000LL  // restart the sample clock when it is this far off
+#define CW_JITTER_BUCKETS 21          // 0.1 ms each, the last for 2 ms and over
+#define CW_SKIM_CHANNELS 96      // skimmer channels, 4.5 kHz of 46.875 Hz bins
+#define CW_SKIM_MAX_HZ 24000     // how far from the dial a skimmer channel can be
+#define CW_SKIM_SPOTS 64
+#define CW_SKIM_RESPOT_SEC 600   // print a spotted call again after this long
+#define CW_SKIM_LEVEL 1000.0f    // average skimmer bin magnitude after scaling
 
 // structs
 struct morse_tx {
@@ -71,6 +90,7 @@ struct cw_decoder {
   int n_bins;
   int wpm;
   int console_font;  // decoder output STYLE_CW_RX or STYLE_CW_TX
+  int channel;       // skimmer channel, or -1 for the main decoder
 
   // bins (Goertzel filters at offsets)
   struct bin signal_minus2;
@@ -141,6 +161,33 @@ struct cw_tx_decoder {
   struct bin signal_center;
 };
 
+// skimmer channel: a decoder fed from 5 spectrum bins, and the words it decoded
+struct cw_skim_channel {
+  struct cw_decoder decoder;
+  int bin;                           // signed spectrum bin at the channel center
+  char word[SCP_CALL_LEN + 1];       // the word being received
+  int word_len;
+  char prev_word[SCP_CALL_LEN + 1];  // the word before it, for CQ and DE
+  char last_call[SCP_CALL_LEN + 1];  // a call is spotted when it comes twice
+};
+
+// a change of the key state, timestamped by the keyer thread
+struct cw_key_event {
+  int64_t t_ns;  // CLOCK_MONOTONIC
+  int key;       // CW_IDLE, CW_DOT, CW_DASH, CW_SQUEEZE or CW_DOWN
+};
+
+// a call heard by the skimmer
+struct cw_skim_spot {
+  char call[SCP_CALL_LEN];
+  int freq_hz;
+  int wpm;
+  int snr_db;
+  bool cq;
+  time_t heard;
+  int count;
+};
+
 static struct cw_tx_decoder tx_decoder;
 static struct cw_decoder decoder;
 
@@ -261,6 +308,26 @@ static int32_t tx_sample_buffer[1024];  // TX decoder buffer
 static int tx_buffer_pos = 0;
 static bool tx_session_active = false;  // Track if we're in a TX session
 
+// keyer thread (see cw_keyer_function()) and the audio thread's sample clock
+static struct cw_key_event cw_key_events[CW_KEY_EVENTS];
+static atomic_uint cw_key_wr;           // written by the keyer thread
+static atomic_uint cw_key_rd;           // written by the audio thread
+static atomic_bool cw_key_dropped;      // the queue was full: resync from cw_keyer_key
+static atomic_llong cw_key_edge_ns;     // last GPIO edge, from cw_key_isr()
+static pthread_mutex_t cw_keyer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cw_keyer_cond;   // on CLOCK_MONOTONIC, see cw_keyer_start()
+static unsigned int cw_keyer_signals;   // wakeups, guarded by cw_keyer_mutex
+static atomic_bool cw_keyer_armed;      // in CW or CWR: poll the key between edges
+static pthread_t cw_keyer_thread;
+static bool cw_keyer_running = false;
+static volatile int cw_keyer_key = CW_IDLE;  // latest debounced key state
+static int64_t cw_clock_anchor = 0;     // wall-clock time of TX sample 0
+static int64_t cw_clock_start = 0;      // when the sample clock last started
+static int64_t cw_clock_samples = 0;   // only touched by the audio thread
+static atomic_bool cw_clock_restart;    // set by cw_poll(), taken by cw_keyer_apply()
+static unsigned int cw_wake_hist[CW_JITTER_BUCKETS];  // edge to keyer thread
+static unsigned int cw_late_hist[CW_JITTER_BUCKETS];  // due time to the TX sample
+
 // Blackman-Harris cw envelope
 // data values were calculated in external spreadsheet
 static const float cw_envelope_data[480] = {
@@ -364,7 +431,10 @@ static const float cw_envelope_data[480] = {
 
 // low-pass FIR filter coefficients
 // generated for a 5000 Hz cutoff at a 96000 Hz sample rate using a Blackman window
-static const float fir_coeffs[64] = {
+// the taps are symmetric, which cw_rx_decimate() relies on
+#define CW_FIR_TAPS 64
+#define CW_DECIMATION 8  // 96 kHz -> 12 kHz
+static const float fir_coeffs[CW_FIR_TAPS] = {
     1.08424165e-19f,  -4.95217686e-06f, -8.90038960e-06f, 9.10186219e-06f,  7.22463826e-05f,
     1.99508746e-04f,  3.97578446e-04f,  6.52204412e-04f,  9.20791878e-04f,  1.12876449e-03f,
     1.17243269e-03f,  9.30617527e-04f,  2.85948198e-04f,  -8.45319093e-04f, -2.47858182e-03f,
@@ -379,6 +449,9 @@ static const float fir_coeffs[64] = {
     9.20791878e-04f,  6.52204412e-04f,  3.97578446e-04f,  1.99508746e-04f,  7.22463826e-05f,
     9.10186219e-06f,  -8.90038960e-06f, -4.95217686e-06f, 1.08424165e-19f};
 
+// the last CW_FIR_TAPS - 1 input samples of the previous block
+static float fir_history[CW_FIR_TAPS - 1];
+
 
 //////////////////////////////////////////
 //  Function prototypes
@@ -397,13 +470,28 @@ static void     handle_mode_iambic_common(uint8_t symbol_now, bool modeB);
 static void     handle_mode_kbd(uint8_t symbol_now);
 void            handle_cw_state_machine(uint8_t state_machine_mode, uint8_t symbol_now);
 
+// CW keyer thread
+static int64_t  cw_now_ns(void);
+void            cw_key_isr(void);
+void            cw_keyer_enable(int on);
+static void     cw_jitter_add(unsigned int *hist, int64_t ns);
+static void     cw_key_push(int64_t t_ns, int key);
+static void    *cw_keyer_function(void *arg);
+static void     cw_keyer_apply(void);
+static void     cw_keyer_start(void);
+static int      cw_jitter_report(char *report, int len, const char *title,
+                                 const unsigned int *hist);
+int             cw_keyer_report(char *report, int len, int reset);
+
 // CW RX decoder pipeline
 void            cw_rx(int32_t *samples, int count);                     // Section 1: entry point
+static void     cw_rx_decode(struct cw_decoder *p);                     //   (stages 4 to 8)
 static void     cw_rx_condition(int32_t *samples, int count,            // Section 2: signal conditioning
                                 int32_t *out, int out_len);
-void            apply_fir_filter(int32_t *input, int32_t *output,       //   (FIR helper)
-                                 const float *coeffs, int input_count, int order);
+static void     cw_rx_decimate(int32_t *input, int input_count,        //   (decimating FIR helper)
+                               int32_t *output, int output_count);
 static void     cw_rx_bin(struct cw_decoder *p, int32_t *samples);      // Section 3: frequency analysis
+static void     cw_rx_bin_decide(struct cw_decoder *p, const int *raw); //   (5 magnitudes → sig_state)
 static int      cw_rx_bin_detect(struct bin *p, int32_t *data);         //   (Goertzel helper)
 static int      cw_rx_kmeans_update_2d(struct cw_decoder *p,            //   (k-means helper)
                                        int magnitude, int max_idx,
@@ -424,13 +512,25 @@ static void     cw_rx_build_morse(struct cw_decoder *p,
 static void     cw_rx_classify_and_output(struct cw_decoder *p,         // Section 8: classify & output
                                           struct cw_morse_result *result);
 static void     cw_write_console(int style, const char *text);
+static void     cw_rx_emit(struct cw_decoder *p, const char *text);
 static void     cw_rx_bin_init(struct bin *p, float freq, int n,        //   (Goertzel init helper)
                                float sampling_freq);
 
+// CW skimmer (one decoder per spectrum bin)
+static void     cw_skim_poll(void);
+static void     cw_skim_configure(int mode);
+void            cw_skim_rx(int mode, fftw_complex *spectrum);
+static bool     cw_skim_is_call(const char *word);
+static void     cw_skim_spot(struct cw_skim_channel *ch, const char *call, bool cq);
+static void     cw_skim_word(struct cw_skim_channel *ch);
+static void     cw_skim_text(int channel, const char *text);
+int             cw_skim_report(char *report, int len);
+
 // CW TX decoder
 static void     cw_tx_decode_samples(void);
 
 // CW init/poll/stats API
+static void     cw_rx_decoder_init(struct cw_decoder *p, int channel);
 void            cw_init(void);
 char           *cw_get_stats(char *buf, size_t len);
 void            cw_poll(int bytes_available, int tx_is_on);
@@ -522,6 +622,10 @@ float cw_tx_get_sample() {
   float sample = 0;
   uint8_t state_machine_mode;
   static uint8_t symbol_now = CW_IDLE;
+
+  // key changes from the keyer thread, at the sample they are due
+  if (cw_keyer_running)
+    cw_keyer_apply();
   
   if ((keydown_count == 0) && (keyup_count == 0)) {
     // note current time to use with UI value of CW_DELAY to control break-in
@@ -811,6 +915,233 @@ void handle_cw_state_machine(uint8_t state_machine_mode, uint8_t symbol_now) {
   }
 }
 
+//////////////////////////////////////////////////////////////////////////
+//  CW keyer thread
+//////////////////////////////////////////////////////////////////////////
+// The paddles used to be read by cw_poll() from the 1 ms GTK ui_tick, so a
+// busy GUI delayed them by a varying amount, and the audio thread then saw
+// the change at whatever point of its 1024-sample block it had reached.
+// Now the GPIO edge interrupts wake a real-time thread that timestamps
+// every debounced change of the paddles and queues it.  The audio thread
+// keeps a sample clock locked to the wall clock and applies each change
+// at the sample that is due exactly CW_KEY_LATENCY_NS after it happened.
+// The keyer state machines above still count elements in samples, so the
+// paddles now reach them with a fixed delay instead of a jittery one.
+
+// wall-clock time in ns (CLOCK_MONOTONIC)
+static int64_t cw_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// called by wiringPi on every edge of the paddle (or straight key) lines
+// inputs:  none
+// returns: void
+void cw_key_isr(void) {
+  atomic_store(&cw_key_edge_ns, cw_now_ns());
+  pthread_mutex_lock(&cw_keyer_mutex);
+  cw_keyer_signals++;
+  pthread_cond_signal(&cw_keyer_cond);
+  pthread_mutex_unlock(&cw_keyer_mutex);
+}
+
+// called by modem_poll() when the mode changes: outside CW and CWR the
+// keyer thread sleeps until an edge instead of polling every millisecond
+// inputs:  int on
+// returns: void
+void cw_keyer_enable(int on) {
+  atomic_store(&cw_keyer_armed, on);
+  pthread_mutex_lock(&cw_keyer_mutex);
+  cw_keyer_signals++;
+  pthread_cond_signal(&cw_keyer_cond);
+  pthread_mutex_unlock(&cw_keyer_mutex);
+}
+
+// count a delay in the 0.1 ms buckets of a jitter histogram
+// inputs:  unsigned int *hist, int64_t ns
+// returns: void
+static void cw_jitter_add(unsigned int *hist, int64_t ns) {
+  int64_t b = ns > 0 ? ns / 100000 : 0;
+  if (b >= CW_JITTER_BUCKETS) b = CW_JITTER_BUCKETS - 1;
+  hist[b]++;
+}
+
+// queue a change of the key state for the audio thread; when the queue
+// is full the change is dropped (the audio thread may be reading any of the
+// queued entries), and the audio thread takes the latest state once it has
+// caught up
+// inputs:  int64_t t_ns (when it happened), int key
+// returns: void
+static void cw_key_push(int64_t t_ns, int key) {
+  unsigned int wr = atomic_load_explicit(&cw_key_wr, memory_order_relaxed);
+  unsigned int rd = atomic_load_explicit(&cw_key_rd, memory_order_acquire);
+  if (wr - rd >= CW_KEY_EVENTS) {
+    atomic_store_explicit(&cw_key_dropped, true, memory_order_release);
+    return;
+  }
+  cw_key_events[wr % CW_KEY_EVENTS].t_ns = t_ns;
+  cw_key_events[wr % CW_KEY_EVENTS].key = key;
+  atomic_store_explicit(&cw_key_wr, wr + 1, memory_order_release);
+}
+
+// the keyer thread: wait for an edge (or 1 ms in CW, for the tune key and
+// in case there are no interrupts), read the key and queue any change
+// inputs:  void *arg (unused)
+// returns: void *
+static void *cw_keyer_function(void *arg) {
+  struct sched_param sch;
+  // just below the sound thread
+  sch.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch);
+
+  int64_t lockout_until = 0;
+  int64_t last_edge = 0;
+  unsigned int seen = 0;
+  while (1) {
+    int64_t now = cw_now_ns();
+    // 0: until an edge
+    int64_t wait_ns = atomic_load(&cw_keyer_armed) ? CW_KEY_POLL_NS : 0;
+    if (lockout_until > now && (!wait_ns || lockout_until - now < wait_ns))
+      wait_ns = lockout_until - now;
+    pthread_mutex_lock(&cw_keyer_mutex);
+    if (seen == cw_keyer_signals) {
+      if (wait_ns) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += wait_ns;
+        if (deadline.tv_nsec >= 1000000000L) {
+          deadline.tv_sec++;
+          deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&cw_keyer_cond, &cw_keyer_mutex, &deadline);
+      } else {
+        pthread_cond_wait(&cw_keyer_cond, &cw_keyer_mutex);
+      }
+    }
+    seen = cw_keyer_signals;
+    pthread_mutex_unlock(&cw_keyer_mutex);
+
+    // contacts bounce: after a change, ignore the lines for a while
+    now = cw_now_ns();
+    if (now < lockout_until)
+      continue;
+    int key = key_poll();
+    if (key == cw_keyer_key)
+      continue;
+
+    // a change seen soon after an edge happened at the edge
+    int64_t edge = atomic_load(&cw_key_edge_ns);
+    int64_t t = now;
+    if (edge != last_edge && edge <= now && now - edge < CW_KEY_DEBOUNCE_NS)
+      t = edge;
+    last_edge = edge;
+
+    cw_jitter_add(cw_wake_hist, now - t);
+    cw_keyer_key = key;
+    cw_key_push(t, key);
+    lockout_until = t + CW_KEY_DEBOUNCE_NS;
+  }
+  return NULL;
+}
+
+// Called for every TX sample: advance the sample clock and apply the key
+// changes that are due by this sample.  The clock is re-read every
+// CW_CLOCK_BLOCK samples and follows the wall clock slowly, so that the
+// bursts in which the audio blocks are computed don't show in it; after a
+// gap it starts again from now, as it does at the start of a
+// transmission, when cw_poll() asks for it through cw_clock_restart.
+// inputs:  none
+// returns: void (updates cw_key_state)
+static void cw_keyer_apply(void) {
+  const int64_t period_ns = 1000000000LL / 96000;
+  if (atomic_exchange_explicit(&cw_clock_restart, false, memory_order_acquire))
+    cw_clock_samples = 0;
+  if (cw_clock_samples % CW_CLOCK_BLOCK == 0) {
+    int64_t now = cw_now_ns();
+    int64_t err = now - (cw_clock_anchor + cw_clock_samples * period_ns);
+    if (!cw_clock_samples || err > CW_CLOCK_RESET_NS || err < -CW_CLOCK_RESET_NS) {
+      cw_clock_anchor = now;
+      cw_clock_start = now;
+      cw_clock_samples = 0;
+    } else {
+      cw_clock_anchor += err / 16;
+    }
+  }
+  int64_t t = cw_clock_anchor + cw_clock_samples * period_ns;
+  cw_clock_samples++;
+
+  unsigned int rd = atomic_load_explicit(&cw_key_rd, memory_order_relaxed);
+  unsigned int wr = atomic_load_explicit(&cw_key_wr, memory_order_acquire);
+  while (rd != wr) {
+    const struct cw_key_event *e = &cw_key_events[rd % CW_KEY_EVENTS];
+    int64_t due = e->t_ns + CW_KEY_LATENCY_NS;
+    if (due > t)
+      break;
+    cw_key_state = e->key;
+    // changes from before this transmission started are all late
+    if (e->t_ns >= cw_clock_start)
+      cw_jitter_add(cw_late_hist, t - due);
+    rd++;
+  }
+  atomic_store_explicit(&cw_key_rd, rd, memory_order_release);
+  // changes were dropped: what is queued is done, so go to the key as it is now
+  if (rd == wr && atomic_load_explicit(&cw_key_dropped, memory_order_relaxed)
+      && atomic_exchange_explicit(&cw_key_dropped, false, memory_order_acquire))
+    cw_key_state = cw_keyer_key;
+}
+
+// start the keyer thread, once
+// inputs:  none
+// returns: void
+static void cw_keyer_start(void) {
+  pthread_condattr_t attr;
+
+  if (cw_keyer_running)
+    return;
+  cw_keyer_key = key_poll();
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cw_keyer_cond, &attr);
+  pthread_condattr_destroy(&attr);
+  cw_keyer_running = !pthread_create(&cw_keyer_thread, NULL, cw_keyer_function, NULL);
+  if (!cw_keyer_running)
+    printf("CW keyer thread failed to start, polling the key instead\n");
+}
+
+// print one jitter histogram, skipping empty buckets
+static int cw_jitter_report(char *report, int len, const char *title, const unsigned int *hist) {
+  unsigned int total = 0;
+  for (int b = 0; b < CW_JITTER_BUCKETS; b++) total += hist[b];
+  int pos = snprintf(report, len, "%s: %u\n", title, total);
+  for (int b = 0; b < CW_JITTER_BUCKETS && pos < len; b++) {
+    if (!hist[b]) continue;
+    if (b == CW_JITTER_BUCKETS - 1)
+      pos += snprintf(report + pos, len - pos, "  >= %.1f ms  %6u\n", b / 10.0, hist[b]);
+    else
+      pos += snprintf(report + pos, len - pos, "  %.1f-%.1f ms %6u\n", b / 10.0, (b + 1) / 10.0, hist[b]);
+  }
+  return pos < len ? pos : len - 1;
+}
+
+// the keyer thread's timing: how long after an edge it read the key, and
+// how late the audio path applied each change, with \a reset to start again
+// inputs:  char *report, int len, bool reset
+// returns: int, the length of the report
+int cw_keyer_report(char *report, int len, int reset) {
+  int pos = snprintf(report, len, "CW keyer: %s, paddle to TX %.1f ms\n",
+                     cw_keyer_running ? "real-time thread" : "polled",
+                     CW_KEY_LATENCY_NS / 1e6);
+  if (pos < len)
+    pos += cw_jitter_report(report + pos, len - pos, "edge to keyer thread", cw_wake_hist);
+  if (pos < len)
+    pos += cw_jitter_report(report + pos, len - pos, "late at the TX sample", cw_late_hist);
+  if (reset) {
+    memset(cw_wake_hist, 0, sizeof(cw_wake_hist));
+    memset(cw_late_hist, 0, sizeof(cw_late_hist));
+  }
+  return pos < len ? pos : len - 1;
+}
 
 //////////////////////////////////////////////////////////////////////////
 //  KB2ML CW Decoder
@@ -835,22 +1166,31 @@ void cw_rx(int32_t *samples, int count) {
   cw_rx_condition(samples, count, conditioned, decoder.n_bins);
   // Stage 3: Frequency analysis (Goertzel bins + clustering → sig_state)
   cw_rx_bin(&decoder, conditioned);
+  // Stages 4 to 8
+  cw_rx_decode(&decoder);
+}
+
+// Run the stages after frequency analysis for one tick of a decoder.
+// The skimmer channels share these with the main decoder.
+// inputs:  struct cw_decoder *p (with sig_state set by Section 3)
+// returns: void
+static void cw_rx_decode(struct cw_decoder *p) {
   // Stage 4: Signal level tracking (high_level / noise_floor)
-  cw_rx_update_levels(&decoder);
+  cw_rx_update_levels(p);
   // Stage 5: Denoising / mark decision (EMA + hysteresis → mark)
-  cw_rx_denoise(&decoder);
+  cw_rx_denoise(p);
   // Stage 6: Symbol detection (transitions → symbol buffer)
-  bool char_ready = cw_rx_detect_symbol(&decoder);
+  bool char_ready = cw_rx_detect_symbol(p);
   // Stage 7 & 8 (only if char is ready for output)
   if (char_ready) {
     // Stage 7: Build morse string
     struct cw_morse_result result;
     // Build Morse character from symbol buffer
-    cw_rx_build_morse(&decoder, &result);
+    cw_rx_build_morse(p, &result);
     // Reset symbol buffer before output so next symbols start fresh
-    decoder.next_symbol = 0;
+    p->next_symbol = 0;
     // Stage 8: Classify and output
-    cw_rx_classify_and_output(&decoder, &result);
+    cw_rx_classify_and_output(p, &result);
   }
 }
 
@@ -860,8 +1200,7 @@ void cw_rx(int32_t *samples, int count) {
 
 // Condition raw 96 kHz samples down to 12 kHz for Goertzel analysis.
 //
-//   FIR low-pass filter (5 kHz cutoff at 96 kHz)
-//   Decimate by 8 → 12 kHz
+//   FIR low-pass filter (5 kHz cutoff at 96 kHz), decimating by 8 → 12 kHz
 //   Drop 8 LSBs (A/D is 24-bit, not 32)
 //
 // inputs:  raw 96 kHz samples, sample count,
@@ -869,44 +1208,55 @@ void cw_rx(int32_t *samples, int count) {
 // returns: void
 static void cw_rx_condition(int32_t *samples, int count,
                             int32_t *out, int out_len) {
-  const int decimation_factor = 8;  // 96 kHz -> 12 kHz
-  int32_t filtered[count];  // local; don't modify caller's buffer
-
-  // anti-alias low-pass filter
-  apply_fir_filter(samples, filtered, fir_coeffs, count, 64);
+  // anti-alias low-pass filter, only at the samples we keep
+  cw_rx_decimate(samples, count, out, out_len);
 
-  // downsample and strip 8 LSBs (A/D was 24 bits, not 32)
+  // strip 8 LSBs (A/D was 24 bits, not 32)
   for (int i = 0; i < out_len; i++) {
-    out[i] = filtered[i * decimation_factor] >> 8;
+    out[i] >>= 8;
   }
 }
 
-// apply the FIR low-pass filter using convolution
-// inputs:  int32_t *input, int32_t *output, const float *coeffs, int input_count, int order
+// Decimating FIR low-pass filter: computes only every CW_DECIMATION'th
+// output (samples 0, 8, 16 ... of the block, as before), so it does an
+// eighth of the work of filtering at 96 kHz and then dropping 7 of every
+// 8 outputs.  The filter runs on floats across block boundaries, keeping
+// the tail of the previous block in fir_history.  With symmetric taps the
+// convolution is a straight dot product over the window, which the
+// compiler vectorizes (NEON on the Pi) given the 4 separate sums.
+// inputs:  int32_t *input (96 kHz), int input_count,
+//          int32_t *output, int output_count (at most input_count / 8)
 // returns: void
-// notes:  added to eliminate aliasing with down-sampling (LPF possibly not needed?)
-void apply_fir_filter(int32_t *input, int32_t *output, const float *coeffs, int input_count,
-                      int order) {
-  for (int i = 0; i < input_count; i++) {
-    float sum = 0.0f;
-    for (int j = 0; j < order; j++) {
-      int k = i - j;
-      if (k >= 0) {
-        sum += (float)input[k] * coeffs[j];
-      }
+// notes:  added to eliminate aliasing with down-sampling
+static void cw_rx_decimate(int32_t *input, int input_count,
+                           int32_t *output, int output_count) {
+  float x[CW_FIR_TAPS - 1 + input_count];
+  memcpy(x, fir_history, sizeof(fir_history));
+  for (int i = 0; i < input_count; i++)
+    x[CW_FIR_TAPS - 1 + i] = (float)input[i];
+
+  for (int i = 0; i < output_count; i++) {
+    // output sample n needs inputs n - 63 .. n, at x[n] .. x[n + 63]
+    const float *w = x + i * CW_DECIMATION;
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int j = 0; j < CW_FIR_TAPS; j += 4) {
+      sum[0] += w[j] * fir_coeffs[j];
+      sum[1] += w[j + 1] * fir_coeffs[j + 1];
+      sum[2] += w[j + 2] * fir_coeffs[j + 2];
+      sum[3] += w[j + 3] * fir_coeffs[j + 3];
     }
-    output[i] = (int32_t)sum;
+    output[i] = (int32_t)((sum[0] + sum[1]) + (sum[2] + sum[3]));
   }
+
+  memcpy(fir_history, x + input_count, sizeof(fir_history));
 }
 
 //////////////////////////////////////////////////////////////////////////
 // Section 3: Frequency analysis (5-bin Goertzel + median + EMA + k-means)
 //////////////////////////////////////////////////////////////////////////
 
-// Run Goertzel on 5 frequency bins around the CW pitch, apply per-bin
-// 3-tick median filtering, pick the strongest, apply adaptive EMA
-// smoothing, and use 2-D k-means clustering to decide whether a signal
-// is present (sets p->sig_state).
+// Run Goertzel on 5 frequency bins around the CW pitch and pass the
+// magnitudes on to cw_rx_bin_decide().
 //
 // Bins are at -150, -75, 0, +75, +150 Hz relative to center pitch.
 // inputs:  struct cw_decoder *p, int32_t *samples (12 kHz decimated)
@@ -919,7 +1269,17 @@ static void cw_rx_bin(struct cw_decoder *p, int32_t *samples) {
   raw[2] = cw_rx_bin_detect(&p->signal_center, samples);
   raw[3] = cw_rx_bin_detect(&p->signal_plus1,  samples);
   raw[4] = cw_rx_bin_detect(&p->signal_plus2,  samples);
+  cw_rx_bin_decide(p, raw);
+}
 
+// Apply per-bin 3-tick median filtering to one tick of 5 magnitudes
+// (raw[2] at the center), pick the strongest, apply adaptive EMA
+// smoothing, and use 2-D k-means clustering to decide whether a signal
+// is present (sets p->sig_state).  The magnitudes come from the Goertzel
+// bins of the main decoder, or from spectrum bins for the skimmer.
+// inputs:  struct cw_decoder *p, const int *raw (5 magnitudes)
+// returns: void (updates p->magnitude, p->sig_state, p->max_bin_idx, etc.)
+static void cw_rx_bin_decide(struct cw_decoder *p, const int *raw) {
   // Per-bin 3-tick median filter
   // Store raw magnitudes into circular history buffer
   int pos = p->bin_hist_pos;
@@ -1490,9 +1850,9 @@ static bool cw_rx_detect_symbol(struct cw_decoder *p) {
           : 0.0f;
       const float MIN_SNR_FOR_SPACE = 1.6f;
 
-       if (cw_decode_enabled && p->decoded_char_seen && !p->last_char_was_space &&
-            snr_ratio >= MIN_SNR_FOR_SPACE) {
-        cw_write_console(p->console_font, " ");
+       if ((cw_decode_enabled || p->channel >= 0) && p->decoded_char_seen &&
+            !p->last_char_was_space && snr_ratio >= MIN_SNR_FOR_SPACE) {
+        cw_rx_emit(p, " ");
         p->last_char_was_space = 1;
         p->decoded_char_seen = 0;
       }
@@ -1733,9 +2093,30 @@ static void cw_rx_build_morse(struct cw_decoder *p, struct cw_morse_result *resu
 static int last_console_style = -1;
 static bool last_console_was_newline = false;
 
+// the word being received, so that calls heard on CW can be offered
+// by the super check partial (see scp.h)
+static char cw_rx_word[SCP_CALL_LEN + 1];
+static int cw_rx_word_len = 0;
+
+static void cw_rx_track_word(int style, const char *text) {
+  if (style != STYLE_CW_RX || text[0] == ' ' || text[0] == '\n') {
+    if (cw_rx_word_len && cw_rx_word_len < SCP_CALL_LEN) {
+      cw_rx_word[cw_rx_word_len] = 0;
+      scp_add(cw_rx_word, SCP_HEARD);
+    }
+    cw_rx_word_len = 0;
+    return;
+  }
+  for (; *text; text++) {
+    if (cw_rx_word_len < SCP_CALL_LEN)
+      cw_rx_word[cw_rx_word_len++] = *text; // too long for a call once it's full
+  }
+}
+
 // write decoded text to the console, inserting a newline
 // on the previous style's line whenever the style changes
 static void cw_write_console(int style, const char *text) {
+  cw_rx_track_word(style, text);
   if (last_console_style != -1 && last_console_style != style) {
     // only insert a newline if we didn't just write one,
     // to avoid blank lines at TX→RX transitions
@@ -1748,6 +2129,15 @@ static void cw_write_console(int style, const char *text) {
   last_console_was_newline = (strcmp(text, "\n") == 0);
 }
 
+// send decoded text on: the main decoder writes to the console,
+// skimmer channels collect it for their calls (see cw_skim_text())
+static void cw_rx_emit(struct cw_decoder *p, const char *text) {
+  if (p->channel >= 0)
+    cw_skim_text(p->channel, text);
+  else
+    cw_write_console(p->console_font, text);
+}
+
 // Classify the Morse string built by Section 7, adapt dot_len, and
 // output the decoded character to the console.
 //
@@ -1832,8 +2222,8 @@ static void cw_rx_classify_and_output(struct cw_decoder *p, struct cw_morse_resu
       if (decoded[0] == ' ' && decoded[1] == '\0') {
         return;
       }
-      if (cw_decode_enabled) {
-        cw_write_console(p->console_font, decoded);
+      if (cw_decode_enabled || p->channel >= 0) {
+        cw_rx_emit(p, decoded);
       }
       p->last_char_was_space = 0;
       p->decoded_char_seen = 1;
@@ -1842,6 +2232,297 @@ static void cw_rx_classify_and_output(struct cw_decoder *p, struct cw_morse_resu
   }
 }
 
+//////////////////////////////////////////////////////////////////////////
+// CW skimmer (one decoder per spectrum bin)
+//   Spectrum bins → 5 magnitudes per channel → Sections 3 to 8
+//   Decoded words → calls → spot list and console
+//////////////////////////////////////////////////////////////////////////
+
+// Each channel is one 46.875 Hz bin of the Hann-windowed spectrum that
+// rx_linear() computes for the waterfall, and gets a new magnitude every
+// 1024 IQ samples: the same 10.67 ms tick as the main decoder's Goertzel
+// blocks, so dot_len and all the gap timing carry over unchanged.  The
+// 5 bins around a channel stand in for the 5 Goertzel bins.
+
+static struct cw_skim_channel cw_skim[CW_SKIM_CHANNELS];
+static int cw_skim_count = 0;        // channels in use
+static float cw_skim_level = 0.0f;   // EMA of the bin magnitudes over the channels
+
+// set by cw_skim_poll(), applied by cw_skim_rx() when the generation changes
+static int cw_skim_lo_hz = 0;
+static int cw_skim_hi_hz = 0;
+static int cw_skim_dial_hz = 0;
+static int cw_skim_pitch = 0;
+static int cw_skim_wpm = INIT_WPM;
+static volatile unsigned int cw_skim_generation = 0;
+static unsigned int cw_skim_applied = 0;
+static int cw_skim_mode = -1;
+static int cw_skim_sign = 1;         // +1 for CW (beat note in positive bins), -1 for CWR
+
+// CPU time spent on the channels, for cw_skim_report()
+static uint64_t cw_skim_ns = 0;
+static uint64_t cw_skim_ticks = 0;
+
+static pthread_mutex_t cw_skim_mutex = PTHREAD_MUTEX_INITIALIZER;  // guards the spots
+static struct cw_skim_spot cw_skim_spots[CW_SKIM_SPOTS];
+static int cw_skim_n_spots = 0;
+
+// read the CW_SKIM setting ("<low> <high>" in Hz from the dial, or empty
+// for off) along with the dial and pitch, and have the channels rebuilt
+// by the audio thread when any of them changes
+// inputs:  none
+// returns: void
+static void cw_skim_poll(void) {
+  static char setting[32] = "";
+  const char *now = field_str("CW_SKIM");
+  int dial = field_int("FREQ");
+  int pitch = field_int("PITCH");
+  cw_skim_wpm = field_int("WPM");
+  if (!now || (!strcmp(now, setting) && dial == cw_skim_dial_hz && pitch == cw_skim_pitch))
+    return;
+  strncpy(setting, now, sizeof(setting) - 1);
+
+  int lo = 0, hi = 0;
+  if (setting[0] && strcasecmp(setting, "OFF") &&
+      (sscanf(setting, "%d%*[ ,]%d", &lo, &hi) != 2 || hi <= lo)) {
+    printf("CW_SKIM: ignoring '%s'\n", setting);
+    lo = hi = 0;
+  }
+  if (lo < -CW_SKIM_MAX_HZ) lo = -CW_SKIM_MAX_HZ;
+  if (hi > CW_SKIM_MAX_HZ) hi = CW_SKIM_MAX_HZ;
+  cw_skim_lo_hz = lo;
+  cw_skim_hi_hz = hi;
+  cw_skim_dial_hz = dial;
+  cw_skim_pitch = pitch;
+  cw_skim_generation++;
+}
+
+// (re)start the channels for the current setting and mode
+// inputs:  int mode
+// returns: void
+static void cw_skim_configure(int mode) {
+  const double bin_hz = 96000.0 / MAX_BINS;
+  cw_skim_count = 0;
+  cw_skim_sign = (mode == MODE_CWR) ? -1 : 1;
+
+  // the beat note of a signal at the dial is at the pitch (see rx_linear())
+  int first = (int)ceil((cw_skim_lo_hz + cw_skim_sign * cw_skim_pitch) / bin_hz);
+  int last = (int)floor((cw_skim_hi_hz + cw_skim_sign * cw_skim_pitch) / bin_hz);
+  int n = (cw_skim_hi_hz > cw_skim_lo_hz) ? last - first + 1 : 0;
+  if (n > CW_SKIM_CHANNELS) n = CW_SKIM_CHANNELS;
+
+  for (int c = 0; c < n; c++) {
+    struct cw_skim_channel *ch = &cw_skim[c];
+    cw_rx_decoder_init(&ch->decoder, c);
+    ch->decoder.wpm = cw_skim_wpm > 0 ? cw_skim_wpm : INIT_WPM;
+    ch->decoder.dot_len = (6 * SAMPLING_FREQ) / (5 * N_BINS * ch->decoder.wpm);
+    ch->bin = first + c;
+    ch->word_len = 0;
+    ch->prev_word[0] = 0;
+    ch->last_call[0] = 0;
+  }
+  cw_skim_level = 0.0f;
+  cw_skim_ns = 0;
+  cw_skim_ticks = 0;
+  cw_skim_count = n;
+}
+
+// Feed the skimmer channels from the Hann-windowed spectrum of the last
+// MAX_BINS IQ samples, called by rx_linear() once per block in CW and CWR.
+// The magnitudes are scaled so that their average over the channels sits
+// at CW_SKIM_LEVEL, well clear of the floor of 100 in cw_rx_update_levels()
+// whatever the RF and IF gain.
+// inputs:  int mode, fftw_complex *spectrum (MAX_BINS bins, 0 Hz at bin 0)
+// returns: void
+void cw_skim_rx(int mode, fftw_complex *spectrum) {
+  if (cw_skim_applied != cw_skim_generation || cw_skim_mode != mode) {
+    cw_skim_applied = cw_skim_generation;
+    cw_skim_mode = mode;
+    cw_skim_configure(mode);
+  }
+  const int n = cw_skim_count;
+  if (!n) return;
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  // magnitudes of the channel bins and 2 more on each side
+  float mag[CW_SKIM_CHANNELS + 4];
+  float sum = 0.0f;
+  for (int i = 0; i < n + 4; i++) {
+    int b = cw_skim[0].bin - 2 + i;
+    if (b < 0) b += MAX_BINS;
+    else if (b >= MAX_BINS) b -= MAX_BINS;
+    mag[i] = (float)cabs(spectrum[b]);
+    sum += mag[i];
+  }
+  float mean = sum / (float)(n + 4);
+  if (cw_skim_level <= 0.0f)
+    cw_skim_level = mean;
+  else
+    cw_skim_level = 0.99f * cw_skim_level + 0.01f * mean;
+  float scale = (cw_skim_level > 0.0f) ? CW_SKIM_LEVEL / cw_skim_level : 0.0f;
+
+  for (int c = 0; c < n; c++) {
+    int raw[5];
+    for (int j = 0; j < 5; j++)
+      raw[j] = (int)(mag[c + j] * scale);
+    cw_rx_bin_decide(&cw_skim[c].decoder, raw);
+    cw_rx_decode(&cw_skim[c].decoder);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  cw_skim_ns += (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL + t1.tv_nsec - t0.tv_nsec;
+  cw_skim_ticks++;
+}
+
+// Does the word look like a callsign: a letter and a digit, ending in a
+// letter (before any /suffix), and not just a cut-number report like 5NN?
+// inputs:  const char *word
+// returns: bool
+static bool cw_skim_is_call(const char *word) {
+  int len = strlen(word);
+  bool letter = false, digit = false, cut_only = true;
+  int base_end = len;  // end of the call before any /suffix
+  if (len < 3 || len >= SCP_CALL_LEN || word[0] == '/' || word[len - 1] == '/')
+    return false;
+  for (int i = 0; i < len; i++) {
+    char c = word[i];
+    if (c == '/') {
+      if (base_end == len && i > 0) base_end = i;
+      continue;
+    }
+    if (!isupper((unsigned char)c) && !isdigit((unsigned char)c))
+      return false;
+    letter |= isupper((unsigned char)c) != 0;
+    digit |= isdigit((unsigned char)c) != 0;
+    if (!isdigit((unsigned char)c) && !strchr("AENT", c))
+      cut_only = false;
+  }
+  return letter && digit && !cut_only && isupper((unsigned char)word[base_end - 1]);
+}
+
+// add or refresh a spot, and print it if the call is new or was last
+// spotted more than CW_SKIM_RESPOT_SEC ago
+// inputs:  struct cw_skim_channel *ch, const char *call, bool cq
+// returns: void
+static void cw_skim_spot(struct cw_skim_channel *ch, const char *call, bool cq) {
+  const struct cw_decoder *p = &ch->decoder;
+  float dot = p->mark_emission_ready ? p->mark_mu_dot : (float)p->dot_len;
+  if (dot < 1.0f) dot = 1.0f;
+  int wpm = (int)roundf((6.0f * SAMPLING_FREQ) / (5.0f * N_BINS * dot));
+  int snr_db = (p->noise_floor > 0 && p->high_level > p->noise_floor)
+      ? (int)roundf(20.0f * log10f((float)p->high_level / (float)p->noise_floor))
+      : 0;
+  int freq_hz = cw_skim_dial_hz + (int)lround(ch->bin * 96000.0 / MAX_BINS)
+      - cw_skim_sign * cw_skim_pitch;
+  time_t now = time(NULL);
+  bool fresh = true;
+
+  pthread_mutex_lock(&cw_skim_mutex);
+  struct cw_skim_spot *s = NULL;
+  for (int i = 0; i < cw_skim_n_spots && !s; i++)
+    if (!strcmp(cw_skim_spots[i].call, call))
+      s = &cw_skim_spots[i];
+  if (s) {
+    fresh = now - s->heard >= CW_SKIM_RESPOT_SEC;
+    s->count++;
+  } else {
+    if (cw_skim_n_spots < CW_SKIM_SPOTS) {
+      s = &cw_skim_spots[cw_skim_n_spots++];
+    } else {
+      // replace the one heard longest ago
+      s = &cw_skim_spots[0];
+      for (int i = 1; i < cw_skim_n_spots; i++)
+        if (cw_skim_spots[i].heard < s->heard)
+          s = &cw_skim_spots[i];
+    }
+    strcpy(s->call, call);
+    s->count = 1;
+  }
+  s->freq_hz = freq_hz;
+  s->wpm = wpm;
+  s->snr_db = snr_db;
+  s->cq = cq;
+  s->heard = now;
+  pthread_mutex_unlock(&cw_skim_mutex);
+
+  scp_add(call, SCP_HEARD);
+  if (fresh) {
+    char line[80];
+    snprintf(line, sizeof(line), "CW skim %.1f %s %dwpm %ddB%s\n",
+             freq_hz / 1000.0, call, wpm, snr_db, cq ? " CQ" : "");
+    cw_write_console(STYLE_LOG, line);
+  }
+}
+
+// a word decoded on a skimmer channel: spot it if it is a call
+// that follows CQ, TEST or DE, or that came twice in a row
+// inputs:  struct cw_skim_channel *ch (with the word in ch->word)
+// returns: void
+static void cw_skim_word(struct cw_skim_channel *ch) {
+  if (cw_skim_is_call(ch->word)) {
+    bool cq = !strcmp(ch->prev_word, "CQ") || !strcmp(ch->prev_word, "TEST");
+    if (cq || !strcmp(ch->prev_word, "DE") || !strcmp(ch->last_call, ch->word))
+      cw_skim_spot(ch, ch->word, cq);
+    strcpy(ch->last_call, ch->word);
+  }
+  strcpy(ch->prev_word, ch->word);
+}
+
+// decoded text from skimmer channel, collected into words (see cw_rx_emit())
+// inputs:  int channel, const char *text
+// returns: void
+static void cw_skim_text(int channel, const char *text) {
+  struct cw_skim_channel *ch = &cw_skim[channel];
+  if (text[0] == ' ' || text[0] == '\n') {
+    if (ch->word_len && ch->word_len < SCP_CALL_LEN) {
+      ch->word[ch->word_len] = 0;
+      cw_skim_word(ch);
+    }
+    ch->word_len = 0;
+    return;
+  }
+  for (; *text; text++) {
+    if (ch->word_len < SCP_CALL_LEN)
+      ch->word[ch->word_len++] = *text;  // too long for a call once it's full
+  }
+}
+
+// the skimmer setting, its CPU load and the spots, most recent first
+// inputs:  char *report, int len
+// returns: int, the length of the report
+int cw_skim_report(char *report, int len) {
+  int n = cw_skim_count;
+  int pos;
+  if (!n) {
+    pos = snprintf(report, len, "CW skimmer: off\n");
+  } else {
+    double us_per_channel = cw_skim_ticks
+        ? cw_skim_ns / 1000.0 / cw_skim_ticks / n : 0.0;
+    pos = snprintf(report, len, "CW skimmer: %d channels, %d to %d Hz, %.2f us per channel per %.1f ms\n",
+                   n, cw_skim_lo_hz, cw_skim_hi_hz, us_per_channel,
+                   1000.0 * N_BINS / SAMPLING_FREQ);
+  }
+
+  pthread_mutex_lock(&cw_skim_mutex);
+  bool shown[CW_SKIM_SPOTS] = {false};
+  time_t now = time(NULL);
+  for (int k = 0; k < cw_skim_n_spots && pos < len; k++) {
+    int best = -1;
+    for (int i = 0; i < cw_skim_n_spots; i++)
+      if (!shown[i] && (best < 0 || cw_skim_spots[i].heard > cw_skim_spots[best].heard))
+        best = i;
+    shown[best] = true;
+    const struct cw_skim_spot *s = &cw_skim_spots[best];
+    pos += snprintf(report + pos, len - pos, "%10.1f %-10s %2dwpm %3ddB %3dx %3d min%s\n",
+                    s->freq_hz / 1000.0, s->call, s->wpm, s->snr_db, s->count,
+                    (int)((now - s->heard) / 60), s->cq ? " CQ" : "");
+  }
+  pthread_mutex_unlock(&cw_skim_mutex);
+  return pos < len ? pos : len - 1;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // CW TX Decoder (separate from the RX decoder pipeline)
 //////////////////////////////////////////////////////////////////////////
@@ -1940,81 +2621,89 @@ static void cw_tx_decode_samples(void) {
 // CW init / poll / stats / abort API
 //////////////////////////////////////////////////////////////////////////
 
-// initialize struct values for cw tx and decoder 
-// inputs:  none
+// initialize the state of an RX decoder, apart from its Goertzel bins
+// inputs:  struct cw_decoder *p, int channel (skimmer channel, or -1)
 // returns: void
-void cw_init(void) {
+static void cw_rx_decoder_init(struct cw_decoder *p, int channel) {
   // RX decoder: cfg 
-  decoder.n_bins = N_BINS;
-  decoder.wpm = 20;
-  decoder.console_font = STYLE_CW_RX;
-
-  // RX decoder: bins 
-  int cw_rx_pitch = field_int("PITCH");
-  cw_rx_bin_init(&decoder.signal_minus2, cw_rx_pitch - 150.0f, N_BINS, SAMPLING_FREQ);
-  cw_rx_bin_init(&decoder.signal_minus1, cw_rx_pitch - 75.0f, N_BINS, SAMPLING_FREQ);
-  cw_rx_bin_init(&decoder.signal_center, cw_rx_pitch + 0.0f, N_BINS, SAMPLING_FREQ);
-  cw_rx_bin_init(&decoder.signal_plus1,  cw_rx_pitch + 75.0f, N_BINS, SAMPLING_FREQ);
-  cw_rx_bin_init(&decoder.signal_plus2,  cw_rx_pitch + 150.0f, N_BINS, SAMPLING_FREQ);
+  p->n_bins = N_BINS;
+  p->wpm = 20;
+  p->console_font = STYLE_CW_RX;
+  p->channel = channel;
 
   // RX decoder: detect
-  decoder.mark = false;
-  decoder.prev_mark = false;
-  decoder.sig_state = false;
-  decoder.ticker = 0;
+  p->mark = false;
+  p->prev_mark = false;
+  p->sig_state = false;
+  p->ticker = 0;
 
   // RX decoder: levels
-  decoder.magnitude = 0;
-  decoder.smoothed_magnitude = 0.0f;
-  decoder.high_level = 500;  // start with non-zero values for SNR
-  decoder.noise_floor = 200;
-  decoder.max_bin_idx = -1;
-  decoder.max_bin_streak = 0;
+  p->magnitude = 0;
+  p->smoothed_magnitude = 0.0f;
+  p->high_level = 500;  // start with non-zero values for SNR
+  p->noise_floor = 200;
+  p->max_bin_idx = -1;
+  p->max_bin_streak = 0;
 
   // RX decoder: per-bin median filter history
   for (int b = 0; b < 5; b++)
     for (int t = 0; t < 3; t++)
-      decoder.bin_hist[b][t] = 0;
-  decoder.bin_hist_pos = 0;
-  decoder.bin_hist_count = 0;
+      p->bin_hist[b][t] = 0;
+  p->bin_hist_pos = 0;
+  p->bin_hist_count = 0;
 
   // RX decoder: timing
-  decoder.dot_len = (6 * SAMPLING_FREQ) / (5 * N_BINS * INIT_WPM);
-  decoder.next_symbol = 0;
-  decoder.last_char_was_space = 0;
-  decoder.decoded_char_seen = 0;
-  decoder.char_gap_ema = 0.0f;
-  decoder.word_gap_ema = 0.0f;
+  p->dot_len = (6 * SAMPLING_FREQ) / (5 * N_BINS * INIT_WPM);
+  p->next_symbol = 0;
+  p->last_char_was_space = 0;
+  p->decoded_char_seen = 0;
+  p->char_gap_ema = 0.0f;
+  p->word_gap_ema = 0.0f;
 
   // RX decoder: km (2-D clustering)
-  decoder.k_alpha = 0.04f;
-  decoder.k_warmup = 0;
-  decoder.k_count_noise = 0;
-  decoder.k_count_signal = 0;
-  decoder.k_centroid_noise[0] = 0.0f;
-  decoder.k_centroid_noise[1] = 0.0f;
-  decoder.k_centroid_signal[0] = 0.0f;
-  decoder.k_centroid_signal[1] = 0.0f;
-  decoder.k_signal_streak = 0;
-  decoder.k_noise_streak = 0;
-  decoder.k_initialized = false;
+  p->k_alpha = 0.04f;
+  p->k_warmup = 0;
+  p->k_count_noise = 0;
+  p->k_count_signal = 0;
+  p->k_centroid_noise[0] = 0.0f;
+  p->k_centroid_noise[1] = 0.0f;
+  p->k_centroid_signal[0] = 0.0f;
+  p->k_centroid_signal[1] = 0.0f;
+  p->k_signal_streak = 0;
+  p->k_noise_streak = 0;
+  p->k_initialized = false;
 
   // RX decoder: em (mark emission params)
-  decoder.mark_mu_dot  = 0.0f;
-  decoder.mark_mu_dash = 0.0f;
-  decoder.mark_emission_ready = false;
-  decoder.sig_confidence = 0.0f;
-  decoder.recent_marks_pos = 0;
-  decoder.recent_marks_count = 0;
-  decoder.shortest_recent_mark = 0.0f;
-  for (int i = 0; i < 8; i++) decoder.recent_marks[i] = 0.0f;
+  p->mark_mu_dot  = 0.0f;
+  p->mark_mu_dash = 0.0f;
+  p->mark_emission_ready = false;
+  p->sig_confidence = 0.0f;
+  p->recent_marks_pos = 0;
+  p->recent_marks_count = 0;
+  p->shortest_recent_mark = 0.0f;
+  for (int i = 0; i < 8; i++) p->recent_marks[i] = 0.0f;
 
   // RX decoder: sym buffer
   for (int i = 0; i < MAX_SYMBOLS; ++i) {
-    decoder.symbol_str[i].is_mark = 0;
-    decoder.symbol_str[i].magnitude = 0;
-    decoder.symbol_str[i].ticks = 0;
+    p->symbol_str[i].is_mark = 0;
+    p->symbol_str[i].magnitude = 0;
+    p->symbol_str[i].ticks = 0;
   }
+}
+
+// initialize struct values for cw tx and decoder 
+// inputs:  none
+// returns: void
+void cw_init(void) {
+  cw_rx_decoder_init(&decoder, -1);
+
+  // RX decoder: bins 
+  int cw_rx_pitch = field_int("PITCH");
+  cw_rx_bin_init(&decoder.signal_minus2, cw_rx_pitch - 150.0f, N_BINS, SAMPLING_FREQ);
+  cw_rx_bin_init(&decoder.signal_minus1, cw_rx_pitch - 75.0f, N_BINS, SAMPLING_FREQ);
+  cw_rx_bin_init(&decoder.signal_center, cw_rx_pitch + 0.0f, N_BINS, SAMPLING_FREQ);
+  cw_rx_bin_init(&decoder.signal_plus1,  cw_rx_pitch + 75.0f, N_BINS, SAMPLING_FREQ);
+  cw_rx_bin_init(&decoder.signal_plus2,  cw_rx_pitch + 150.0f, N_BINS, SAMPLING_FREQ);
 
   // TX decoder: only needs WPM and center bin
   tx_decoder.wpm = 20;
@@ -2031,6 +2720,9 @@ void cw_init(void) {
   tx_char_emitted = false;
   memset(tx_morse_buf, 0, sizeof(tx_morse_buf));
 
+  // RX front end
+  memset(fir_history, 0, sizeof(fir_history));
+
   // CW TX side (keyer, envelope, LUT)
   cw_init_morse_lut();
   vfo_start(&cw_tone, 700, 0);
@@ -2039,6 +2731,7 @@ void cw_init(void) {
   keyup_count = 0;
   cw_envelope = 0;
   cw_mode = get_cw_input_method();
+  cw_keyer_start();
 }
 
 // called from sbitx_gtk.c to display cw stats under zerobeat indicator
@@ -2133,7 +2826,10 @@ char *cw_get_stats(char *buf, size_t len)
 // or tx_off() to start/stop transmission
 void cw_poll(int bytes_available, int tx_is_on) {
   cw_bytes_available = bytes_available;
-  cw_key_state = key_poll();
+  // with the keyer thread, the audio path updates cw_key_state itself
+  int key = cw_keyer_running ? cw_keyer_key : key_poll();
+  if (!cw_keyer_running)
+    cw_key_state = key;
   millis_now = millis();
 
   // cache UI-derived break-in delay here so audio path reads cw_delay_ms only (not the GUI value)
@@ -2161,6 +2857,9 @@ void cw_poll(int bytes_available, int tx_is_on) {
     cw_rx_bin_init(&decoder.signal_plus2,  cw_rx_pitch + 150.0f, N_BINS, SAMPLING_FREQ);
   }
 
+  // skimmer channels follow the setting, dial and pitch
+  cw_skim_poll();
+
   // retune TX decoder pitch if needed
   // path (cw_tx_get_sample) does not call get_pitch() itself
   cw_pitch_hz = get_pitch();
@@ -2171,7 +2870,9 @@ void cw_poll(int bytes_available, int tx_is_on) {
   // TX ON if bytes are available (from macro/keyboard) or key is pressed
   // or we are in the middle of symbol (dah/dit) transmission
   if (!tx_is_on && ((cw_bytes_available > 0 && text_ready == 1) ||
-        cw_key_state || (symbol_next && *symbol_next))) {
+        key || (symbol_next && *symbol_next))) {
+    // restart the audio thread's sample clock for this transmission
+    atomic_store_explicit(&cw_clock_restart, true, memory_order_release);
     tx_on(TX_SOFT);
     cw_tx_until = cw_delay_ms + millis_now;
     cw_mode = get_cw_input_method();
@@ -9,6 +9,14 @@ float cw_next_sample();
 // added to support zerobeat display of cw decoder status
 int cw_get_max_bin_highlight_index(void);
 
+// the CW skimmer's channels and spots, for \cwskim
+int cw_skim_report(char *report, int len);
+
+// paddle edges wake the keyer thread; its timing, for \cwkeyer
+void cw_key_isr(void);
+void cw_keyer_enable(int on);
+int cw_keyer_report(char *report, int len, int reset);
+
 #define N_BINS 128
 #define INIT_TONE 600
 #define SAMPLING_FREQ 12000
@@ -12,12 +12,15 @@
 #include <complex.h>
 #include <fftw3.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include "ftx_rules.h"
 #include "sdr.h"
 #include "sdr_ui.h"
 #include "modem_ft8.h"
 #include "logbook.h"
+#include "worked.h"
+#include "scp.h"
 #include "udp_broadcast.h"
 
 #define LOG_LEVEL LOG_INFO
@@ -28,10 +31,13 @@
 #include "ft8_lib/ft8/decode.h"
 #include "ft8_lib/ft8/encode.h"
 #include "ft8_lib/ft8/constants.h"
+#include "ft8_lib/ft8/ldpc.h"
+#include "ft8_lib/ft8/crc.h"
 #include "ft8_lib/fft/kiss_fftr.h"
 
 #include "clu/src/dxcc.h"
 #include "clu/src/locator.h"
+#include "cty.h"
 
 // We try to avoid calling automatically the same stations again and again, at least in this session
 #define FTX_CALLED_SIZE 64
@@ -39,16 +45,12 @@ static char ftx_already_called[FTX_CALLED_SIZE][32];
 static int ftx_already_called_n = 0;
 static int recent_qso_age = 24; // hours
 
-static float ftx_rx_buffer[FT8_MAX_BUFF];
-static float ftx_tx_buffer[FT8_MAX_BUFF];
 static char ftx_tx_text[128];
 static char ftx_xota_text[14];
 ftx_message_t ftx_tx_msg;
 ftx_message_t ftx_xota_msg;
-static int ftx_rx_buff_index = 0;
-static int ftx_tx_buff_index = 0;
+static int ftx_tx_buff_index = 0;	// at FTX_TX_RATE
 static int ftx_tx_nsamples = 0;
-static int ftx_do_decode = 0;
 static int ftx_do_tx = 0;
 static int ftx_pitch = 0;
 static pthread_t ftx_thread;
@@ -63,7 +65,7 @@ static bool rules_inited = false;
 
 // This path happens to be there on the rpiOS image. But
 // TODO ensure that we use the newest available file: it is updated often.
-static const char* cty_location = "data/cty.dat";
+static const char* cty_location = CTY_FILE;
 // This file should change less often; if a new country is omitted, we simply won't abbreviate its name.
 static const char* abbrev_location = "clu/share/clu/abbrev.tsv";
 
@@ -71,7 +73,7 @@ static const int kMin_score = 10; // Minimum sync score threshold for candidates
 static const int kMax_candidates = 120;
 static const int kLDPC_iterations = 20;
 
-static const int kMax_decoded_messages = 50;
+static const int kMax_decoded_messages = 100;
 
 static const int kFreq_osr = 2; // Frequency oversampling rate (bin subdivision)
 static const int kTime_osr = 2; // Time oversampling rate (symbol subdivision)
@@ -89,6 +91,7 @@ static const int kFieldType_style_map[] = {
 
 #define SECS_IN_DAY (24 * 60 * 60)
 static int wallclock_day_ms = 0; // starts from 0 each day
+static struct timespec wallclock_mono; // CLOCK_MONOTONIC when wallclock_day_ms was read
 
 static void ftx_update_clock()
 {
@@ -98,6 +101,7 @@ static void ftx_update_clock()
 	   perror("clock_gettime");
 	   exit(EXIT_FAILURE);
 	}
+	clock_gettime(CLOCK_MONOTONIC, &wallclock_mono);
 
 	time_t ms = ts.tv_nsec / 1000000;
 	wallclock_day_ms = (ts.tv_sec % SECS_IN_DAY) * 1000 + ms;
@@ -139,6 +143,23 @@ static char *hmst_wallclock_time_sprint(char *buf)
 
 #define GFSK_CONST_K 5.336446f ///< == pi * sqrt(2 / log(2))
 
+// The transmission is synthesised straight at the IF, see ft8_next_if_block()
+#define FTX_TX_RATE 96000
+#define FTX_TX_MAX_SPSYM (FTX_TX_RATE * 160 / 1000)	// FT8_SYMBOL_PERIOD, the longer one
+
+static struct
+{
+    uint8_t tones[FT4_NN > FT8_NN ? FT4_NN : FT8_NN];
+    int n_sym;
+    int n_spsym;        ///< samples per symbol
+    int n_silence;      ///< samples before the first symbol, to centre it in the slot
+    float dphi_f0;      ///< the pitch, in radians per sample
+    float dphi_peak;    ///< the spacing of the tones, in radians per sample
+    float pulse[3 * FTX_TX_MAX_SPSYM];
+    double phase;       ///< of the tone
+    double if_phase;    ///< of the IF it is moved up to
+} ftx_tx;
+
 #define CALLSIGN_HASHTABLE_SIZE 256
 
 static struct
@@ -148,15 +169,20 @@ static struct
 } callsign_hashtable[CALLSIGN_HASHTABLE_SIZE];
 
 static int callsign_hashtable_size;
+// the GUI thread encodes (and saves hashes) while the decoder thread looks them up
+static pthread_mutex_t callsign_hashtable_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 void hashtable_init(void)
 {
+    pthread_mutex_lock(&callsign_hashtable_mutex);
     callsign_hashtable_size = 0;
     memset(callsign_hashtable, 0, sizeof(callsign_hashtable));
+    pthread_mutex_unlock(&callsign_hashtable_mutex);
 }
 
 void hashtable_cleanup(uint8_t max_age)
 {
+    pthread_mutex_lock(&callsign_hashtable_mutex);
     for (int idx_hash = 0; idx_hash < CALLSIGN_HASHTABLE_SIZE; ++idx_hash)
     {
         if (callsign_hashtable[idx_hash].callsign[0] != '\0')
@@ -177,12 +203,20 @@ void hashtable_cleanup(uint8_t max_age)
             }
         }
     }
+    pthread_mutex_unlock(&callsign_hashtable_mutex);
 }
 
 void hashtable_add(const char* callsign, uint32_t hash)
 {
     uint16_t hash10 = (hash >> 12) & 0x3FFu;
     int idx_hash = (hash10 * 23) % CALLSIGN_HASHTABLE_SIZE;
+    pthread_mutex_lock(&callsign_hashtable_mutex);
+    if (callsign_hashtable_size >= CALLSIGN_HASHTABLE_SIZE - 1)
+    {
+        // full: the probe below would never find an empty slot
+        pthread_mutex_unlock(&callsign_hashtable_mutex);
+        return;
+    }
     while (callsign_hashtable[idx_hash].callsign[0] != '\0')
     {
         if (((callsign_hashtable[idx_hash].hash & 0x3FFFFFu) == hash) && (0 == strcmp(callsign_hashtable[idx_hash].callsign, callsign)))
@@ -190,6 +224,7 @@ void hashtable_add(const char* callsign, uint32_t hash)
             // reset age
             callsign_hashtable[idx_hash].hash &= 0x3FFFFFu;
             LOG(LOG_DEBUG, "Found a duplicate [%s]\n", callsign);
+            pthread_mutex_unlock(&callsign_hashtable_mutex);
             return;
         }
         else
@@ -203,6 +238,7 @@ void hashtable_add(const char* callsign, uint32_t hash)
     strncpy(callsign_hashtable[idx_hash].callsign, callsign, 11);
     callsign_hashtable[idx_hash].callsign[11] = '\0';
     callsign_hashtable[idx_hash].hash = hash;
+    pthread_mutex_unlock(&callsign_hashtable_mutex);
 }
 
 bool hashtable_lookup(ftx_callsign_hash_type_t hash_type, uint32_t hash, char* callsign)
@@ -210,16 +246,19 @@ bool hashtable_lookup(ftx_callsign_hash_type_t hash_type, uint32_t hash, char* c
     uint8_t hash_shift = (hash_type == FTX_CALLSIGN_HASH_10_BITS) ? 12 : (hash_type == FTX_CALLSIGN_HASH_12_BITS ? 10 : 0);
     uint16_t hash10 = (hash >> (12 - hash_shift)) & 0x3FFu;
     int idx_hash = (hash10 * 23) % CALLSIGN_HASHTABLE_SIZE;
+    pthread_mutex_lock(&callsign_hashtable_mutex);
     while (callsign_hashtable[idx_hash].callsign[0] != '\0')
     {
         if (((callsign_hashtable[idx_hash].hash & 0x3FFFFFu) >> hash_shift) == hash)
         {
             strcpy(callsign, callsign_hashtable[idx_hash].callsign);
+            pthread_mutex_unlock(&callsign_hashtable_mutex);
             return true;
         }
         // Move on to check the next entry in hash table
         idx_hash = (idx_hash + 1) % CALLSIGN_HASHTABLE_SIZE;
     }
+    pthread_mutex_unlock(&callsign_hashtable_mutex);
     callsign[0] = '\0';
     return false;
 }
@@ -272,17 +311,10 @@ static void gfsk_pulse(int n_spsym, float symbol_bt, float* pulse)
     }
 }
 
-/// Synthesize waveform data using GFSK phase shaping.
-/// The output waveform will contain n_sym symbols.
-/// @param[in] symbols Array of symbols (tones) (0-7 for FT8)
-/// @param[in] n_sym Number of symbols in the symbol array
-/// @param[in] f0 Audio frequency in Hertz for the symbol 0 (base frequency)
-/// @param[in] symbol_bt Symbol smoothing filter bandwidth (2 for FT8, 1 for FT4)
-/// @param[in] symbol_period Symbol period (duration), seconds
-/// @param[in] signal_rate Sample rate of synthesized signal, Hertz
-/// @param[out] signal Output array of signal waveform samples (should have space for n_sym*n_spsym samples)
+/// Compute the phase of each sample of a GFSK waveform (see ft8_next_if_block()).
+/// @param[out] phase Output array of phases in radians, 0 to 2 pi (should have space for n_sym*n_spsym samples)
 ///
-static void synth_gfsk(const uint8_t* symbols, int n_sym, float f0, float symbol_bt, float symbol_period, int signal_rate, float* signal)
+static void gfsk_phase(const uint8_t* symbols, int n_sym, float f0, float symbol_bt, float symbol_period, int signal_rate, float* phase)
 {
     int n_spsym = (int)(0.5f + signal_rate * symbol_period); // Samples per symbol
     int n_wave = n_sym * n_spsym;                            // Number of output samples
@@ -319,33 +351,24 @@ static void synth_gfsk(const uint8_t* symbols, int n_sym, float f0, float symbol
         dphi[j + n_sym * n_spsym] += dphi_peak * pulse[j] * symbols[n_sym - 1];
     }
 
-    // Calculate and insert the audio waveform
+    // Integrate the frequency into the phase
     float phi = 0;
     for (int k = 0; k < n_wave; ++k)
     { // Don't include dummy symbols
-        signal[k] = sinf(phi);
+        phase[k] = phi;
         phi = fmodf(phi + dphi[k + n_spsym], 2 * M_PI);
     }
-
-    // Apply envelope shaping to the first and last symbols
-    int n_ramp = n_spsym / 8;
-    for (int i = 0; i < n_ramp; ++i)
-    {
-        float env = (1 - cosf(2 * M_PI * i / (2 * n_ramp))) / 2;
-        signal[i] *= env;
-        signal[n_wave - 1 - i] *= env;
-    }
 }
 
 /*!
-	Encode ftx_tx_msg or ftx_xota_msg payload onto audio carrier \a freq and output to \a signal.
-	@return the number of audio samples
+	Encode ftx_tx_msg or ftx_xota_msg payload into the tones that
+	ft8_next_if_block() sends on audio carrier \a freq.
+	@return the number of samples at FTX_TX_RATE, silence included
 */
-int sbitx_ftx_msg_audio(int32_t freq, float *signal)
+static int sbitx_ftx_msg_tones(int32_t freq)
 {
 	if (!freq)
 		freq = field_int("TX_PITCH");
-    float frequency = 1.0 * freq;
 
 	bool is_ft4 = !strcmp(field_str("MODE"), "FT4");
 
@@ -354,30 +377,26 @@ int sbitx_ftx_msg_audio(int32_t freq, float *signal)
 	float symbol_bt = is_ft4 ? FT4_SYMBOL_BT : FT8_SYMBOL_BT;
 	float slot_time = is_ft4 ? FT4_SLOT_TIME : FT8_SLOT_TIME;
 
-    // Second, encode the binary message as a sequence of FSK tones
-    uint8_t tones[num_tones]; // Array of 79 tones (symbols)
+    // Encode the binary message as a sequence of FSK tones
     if (is_ft4)
-        ft4_encode(ftx_xota ? ftx_xota_msg.payload : ftx_tx_msg.payload, tones);
+        ft4_encode(ftx_xota ? ftx_xota_msg.payload : ftx_tx_msg.payload, ftx_tx.tones);
     else
-        ft8_encode(ftx_xota ? ftx_xota_msg.payload : ftx_tx_msg.payload, tones);
-
-    // Third, convert the FSK tones into an audio signal
-    int sample_rate = 12000;
-    int num_samples = (int)(0.5f + num_tones * symbol_period * sample_rate); // samples in the data signal
-    int num_silence = (slot_time * sample_rate - num_samples) / 2;           // Silence  to make 15 seconds
-    int num_total_samples = num_silence + num_samples + num_silence;         // total Number samples
-
-    for (int i = 0; i < num_silence; i++) {
-        signal[i] = 0;
-        signal[i + num_samples + num_silence] = 0;
-    }
-
-    // Synthesize waveform data (signal) and save it as WAV file
-	LOG(LOG_DEBUG, "%05d %s '%s' synth_gfsk %d %f %f %f %d samples %d silence %d\n",
+        ft8_encode(ftx_xota ? ftx_xota_msg.payload : ftx_tx_msg.payload, ftx_tx.tones);
+
+    // and get the GFSK shaping ready (see gfsk_phase())
+    ftx_tx.n_sym = num_tones;
+    ftx_tx.n_spsym = (int)(0.5f + FTX_TX_RATE * symbol_period);
+    int num_samples = num_tones * ftx_tx.n_spsym;                   // samples in the data signal
+    ftx_tx.n_silence = (slot_time * FTX_TX_RATE - num_samples) / 2; // Silence to make 15 seconds
+    ftx_tx.dphi_f0 = 2 * M_PI * freq / FTX_TX_RATE;
+    ftx_tx.dphi_peak = 2 * M_PI / ftx_tx.n_spsym;
+    gfsk_pulse(ftx_tx.n_spsym, symbol_bt, ftx_tx.pulse);
+    ftx_tx.phase = 0;
+
+	LOG(LOG_DEBUG, "%05d %s '%s' tones %d %d %f %f samples %d silence %d\n",
 		wallclock_day_ms % 60000, (is_ft4 ? "FT4" : "FT8"), ftx_xota ? ftx_xota_text : ftx_tx_text, num_tones,
-		frequency, symbol_bt, symbol_period, sample_rate, num_samples, num_silence);
-    synth_gfsk(tones, num_tones, frequency, symbol_bt, symbol_period, sample_rate, signal + num_silence);
-    return num_total_samples;
+		freq, symbol_bt, symbol_period, num_samples, ftx_tx.n_silence);
+    return ftx_tx.n_silence + num_samples + ftx_tx.n_silence;
 }
 
 /*!
@@ -603,6 +622,195 @@ static void monitor_process(monitor_t* me, const float* frame)
     ++me->wf.num_blocks;
 }
 
+// Start a new waterfall with the same configuration.
+static void monitor_reset(monitor_t* me)
+{
+    me->wf.num_blocks = 0;
+    memset(me->last_frame, 0, me->nfft * sizeof(me->last_frame[0]));
+    me->max_mag = -120.0f;
+}
+
+/*
+	A receive stream is one 3 kHz channel of 12 kHz audio that is decoded
+	every slot. The first two are the main receiver's audio (see ft8_rx()),
+	decimated once and decoded as FT8 and as FT4, each with its own slots;
+	the one for the current mode is the main one, and the other is only decoded
+	if FTX_BOTH is on. The others are skimmer channels, cut out of the IQ
+	spectrum at a fixed offset from the dial by ft8_skim_rx().
+	The audio thread appends to the buffer, and is the only one that writes
+	buff_index and slot: it publishes the samples by storing buff_index with
+	release, and starts the buffer over at the slot boundary. The ftx thread
+	reads buff_index with acquire and computes the waterfall block by block
+	while the slot is still being received, so that only the candidate
+	search and LDPC decoding are left to do when it ends; if slot has
+	changed by the time it has read buff_index, the buffer was started over
+	under it, and it waits for the next call. The monitor persists from
+	slot to slot, and is only touched from the ftx thread.
+*/
+#define FTX_STREAM_FT8 0
+#define FTX_STREAM_FT4 1
+#define FTX_AUDIO_STREAMS 2
+#define FTX_SKIM_CHANNELS 4
+#define FTX_STREAMS (FTX_AUDIO_STREAMS + FTX_SKIM_CHANNELS)
+#define FTX_SKIM_NFFT (MAX_BINS / 8) // 96 kHz spectrum to 12 kHz audio
+
+typedef struct
+{
+	bool active;
+	ftx_protocol_t protocol;
+	int offset_hz;		// of the channel from the dial frequency (0 for the main receiver)
+	float buffer[FT8_MAX_BUFF];
+	atomic_int buff_index;	// samples in buffer (see above)
+	atomic_uint slot;	// incremented whenever the buffer starts over
+	atomic_bool do_decode;	// set by the audio thread, taken by the ftx thread
+	bool decode_asked;	// do_decode was already set in this slot
+	struct timespec slot_end;	// end of the slot's reception, on CLOCK_MONOTONIC
+
+	monitor_t mon;
+	bool mon_inited;
+	unsigned int mon_slot;	// slot that the waterfall belongs to
+	int mon_fed;	// samples of buffer already in the waterfall
+
+	// skimmer channel: the first spectrum bin, and an inverse FFT to 12 kHz
+	int bin;
+	unsigned int blocks;
+	fftw_complex *fft_freq;
+	fftw_complex *fft_time;
+	fftw_plan plan_rev;
+} ftx_stream_t;
+
+static ftx_stream_t ftx_streams[FTX_STREAMS];
+static atomic_int ftx_main = FTX_STREAM_FT8; // the stream for the current mode: it gets answered
+static bool ftx_both = false; // decode the other protocol from the receiver audio too
+
+static void ftx_monitor_init(monitor_t* me, ftx_protocol_t protocol)
+{
+	monitor_config_t mon_cfg = {
+		.f_min = 100,
+		.f_max = 3000,
+		.sample_rate = 12000,
+		.time_osr = kTime_osr,
+		.freq_osr = kFreq_osr,
+		.protocol = protocol
+	};
+	monitor_init(me, &mon_cfg);
+}
+
+// Bring the waterfall of \a st up to date with the samples received so far in this slot.
+static void ftx_monitor_feed(ftx_stream_t *st)
+{
+	const unsigned int slot = atomic_load_explicit(&st->slot, memory_order_acquire);
+	const int available = atomic_load_explicit(&st->buff_index, memory_order_acquire);
+	// started over since slot was read: available may be from either slot
+	if (atomic_load_explicit(&st->slot, memory_order_acquire) != slot)
+		return;
+
+	if (st->mon_inited && st->mon_slot == slot && available < st->mon_fed + st->mon.block_size
+		&& st->mon.wf.protocol == st->protocol)
+		return; // nothing new yet
+
+	if (!st->mon_inited || st->mon.wf.protocol != st->protocol) {
+		if (st->mon_inited)
+			monitor_free(&st->mon);
+		ftx_monitor_init(&st->mon, st->protocol);
+		st->mon_inited = true;
+		st->mon_slot = slot - 1; // force a reset below
+	}
+
+	if (st->mon_slot != slot) {
+		st->mon_slot = slot;
+		st->mon_fed = 0;
+		monitor_reset(&st->mon);
+	}
+
+	while (st->mon_fed + st->mon.block_size <= available) {
+		monitor_process(&st->mon, st->buffer + st->mon_fed);
+		st->mon_fed += st->mon.block_size;
+	}
+}
+
+// time spent in logbook lookups during the current decode (see sbitx_ft8_decode)
+static long ftx_lookup_ns = 0;
+static int ftx_lookup_count = 0;
+
+static long ftx_elapsed_ns(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000000L + (now.tv_nsec - start->tv_nsec);
+}
+
+// \a ts moved by \a ms milliseconds (which may be negative)
+static struct timespec ftx_timespec_add_ms(struct timespec ts, long ms)
+{
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (ms % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	} else if (ts.tv_nsec < 0) {
+		ts.tv_sec--;
+		ts.tv_nsec += 1000000000L;
+	}
+	return ts;
+}
+
+// the main stream, as the audio thread last set it
+static ftx_stream_t *ftx_main_stream()
+{
+	return &ftx_streams[atomic_load_explicit(&ftx_main, memory_order_acquire)];
+}
+
+// slot length and when in the slot its decode starts, in ms, for \a protocol
+static int ftx_slot_ms(ftx_protocol_t protocol)
+{
+	return protocol == FTX_PROTOCOL_FT4 ? 7500 : 15000;
+}
+
+static int ftx_slot_decode_ms(ftx_protocol_t protocol)
+{
+	return protocol == FTX_PROTOCOL_FT4 ? 13000 / 2 : 13000;
+}
+
+// When the next slot of \a protocol ends by the wall clock, on CLOCK_MONOTONIC
+static struct timespec ftx_next_slot_end(ftx_protocol_t protocol)
+{
+	struct timespec rt, mono;
+	clock_gettime(CLOCK_REALTIME, &rt);
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+	const int day_ms = (rt.tv_sec % SECS_IN_DAY) * 1000 + rt.tv_nsec / 1000000;
+	int ms = ftx_slot_decode_ms(protocol) - day_ms % ftx_slot_ms(protocol);
+	if (ms < 0)
+		ms += ftx_slot_ms(protocol);
+	return ftx_timespec_add_ms(mono, ms);
+}
+
+// audio frequency of a candidate, in Hz
+static int ftx_candidate_freq(const ftx_waterfall_t *wf, const ftx_candidate_t *cand, float symbol_period)
+{
+	return lroundf((cand->freq_offset + (float)cand->freq_sub / wf->freq_osr) / symbol_period);
+}
+
+static time_t ftx_last_qso(const char *callsign, int len)
+{
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	time_t ret = logbook_last_qso(callsign, len);
+	ftx_lookup_ns += ftx_elapsed_ns(&start);
+	++ftx_lookup_count;
+	return ret;
+}
+
+static time_t ftx_grid_last_qso(const char *grid, int len)
+{
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	time_t ret = logbook_grid_last_qso(grid, len);
+	ftx_lookup_ns += ftx_elapsed_ns(&start);
+	++ftx_lookup_count;
+	return ret;
+}
+
 static int message_callsign_count(const ftx_message_offsets_t *spans)
 {
 	int ret = 0;
@@ -621,80 +829,704 @@ static int message_last_span_offset(const ftx_message_offsets_t *spans, ftx_fiel
 	return ret;
 }
 
-static int sbitx_ft8_decode(float *signal, int num_samples)
+/*
+	Candidate decoding (LDPC and CRC) is by far the most expensive part of
+	a decode, and each candidate is independent of the others, so it is
+	spread over a small pool of worker threads. ftx_decode_candidate() keeps
+	all its scratch space on the stack, so each worker only needs its own
+	result slot per candidate. The results are then unpacked, deduplicated
+	and printed on the decoder thread in candidate order, exactly as when
+	they were decoded one after another.
+*/
+#define FTX_DECODE_MAX_WORKERS 3
+
+// the outcome of one candidate, filled in by whichever thread took it
+typedef struct
 {
-    int sample_rate = 12000;
-	bool is_ft8 = !strcmp(field_str("MODE"), "FT8");
-	recent_qso_age = field_int("RECENT_QSO_AGE");
+	bool ok;
+	ftx_message_t message;
+	ftx_decode_status_t status;
+	int ap_type; // 0, or the AP hypothesis that the message was decoded with
+	bool skipped; // not tried, because the deadline had passed
+} ftx_candidate_result_t;
 
-    // Compute FFT over the whole signal and store it
-    monitor_t mon;
-    monitor_config_t mon_cfg = {
-        .f_min = 100,
-        .f_max = 3000,
-        .sample_rate = sample_rate,
-        .time_osr = kTime_osr,
-        .freq_osr = kFreq_osr,
-        .protocol = is_ft8 ? FTX_PROTOCOL_FT8 : FTX_PROTOCOL_FT4
-    };
+static struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t work;	// a new batch was posted
+	pthread_cond_t done;	// the last candidate in the batch was finished
+	unsigned int batch;
+	const ftx_waterfall_t *wf;
+	const ftx_candidate_t *candidates;
+	ftx_candidate_result_t *results;
+	const struct timespec *deadline;	// or NULL
+	int n_candidates;
+	int next;		// next candidate to be taken
+	int finished;
+	int workers;	// -1 until the threads are started
+} ftx_pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.work = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+	.workers = -1
+};
 
-	// timestamp the packets
-	// the time is shifted back by the time it took to capture these samples
-	const int packet_time_ms = is_ft8 ? 15000 : 7500;
-	const int raw_ms = (wallclock_day_ms / packet_time_ms) * packet_time_ms;
-	time_t now = time(NULL);
-	int time_sec_i = (raw_ms % 60000) / 1000;
+// Decode candidates of the current batch until none are left; call with ftx_pool.lock held.
+static void ftx_pool_drain()
+{
+	while (ftx_pool.next < ftx_pool.n_candidates) {
+		const int idx = ftx_pool.next++;
+		const ftx_waterfall_t *wf = ftx_pool.wf;
+		const ftx_candidate_t *cand = &ftx_pool.candidates[idx];
+		ftx_candidate_result_t *result = &ftx_pool.results[idx];
+		const struct timespec *deadline = ftx_pool.deadline;
+		pthread_mutex_unlock(&ftx_pool.lock);
+
+		result->skipped = deadline && ftx_elapsed_ns(deadline) >= 0;
+		result->ok = cand->score >= kMin_score && !result->skipped &&
+			ftx_decode_candidate(wf, cand, kLDPC_iterations, &result->message, &result->status);
+		result->ap_type = 0;
+
+		pthread_mutex_lock(&ftx_pool.lock);
+		if (++ftx_pool.finished == ftx_pool.n_candidates)
+			pthread_cond_signal(&ftx_pool.done);
+	}
+}
 
-	LOG(LOG_DEBUG, "sbitx_ftx_decode: %02d %s sample rate %d Hz, %d samples, %.3f seconds\n",
-		time_sec_i, (is_ft8 ? "FT8" : "FT4"), sample_rate, num_samples, (double)num_samples / sample_rate);
+static void *ftx_pool_worker(void *ptr)
+{
+	unsigned int batch = 0;
+	pthread_mutex_lock(&ftx_pool.lock);
+	while (1) {
+		while (ftx_pool.batch == batch)
+			pthread_cond_wait(&ftx_pool.work, &ftx_pool.lock);
+		batch = ftx_pool.batch;
+		ftx_pool_drain();
+	}
+	return NULL;
+}
 
-	int i;
-	char mycallsign_upper[20];
-	char mycallsign[20];
-	get_field_value("#mycallsign", mycallsign);
-	for (i = 0; i < strlen(mycallsign); i++)
-		mycallsign_upper[i] = toupper(mycallsign[i]);
-	mycallsign_upper[i] = 0;
+/*!
+	Try to decode all \a n_candidates in \a candidates from \a wf, and put
+	the outcome of each in the same position in \a results.
+	Candidates are taken in order; those not started by \a deadline (if not NULL)
+	are skipped.
+	The calling thread works along with the pool, and returns when all are done.
+	@return the number of threads that took part
+*/
+static int ftx_decode_candidates(const ftx_waterfall_t *wf, const ftx_candidate_t *candidates,
+	int n_candidates, ftx_candidate_result_t *results, const struct timespec *deadline)
+{
+	pthread_mutex_lock(&ftx_pool.lock);
+	if (ftx_pool.workers < 0) {
+		// leave a core for the audio and GUI threads
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		int want = cores > 1 ? (int)cores - 1 : 0;
+		if (want > FTX_DECODE_MAX_WORKERS)
+			want = FTX_DECODE_MAX_WORKERS;
+		ftx_pool.workers = 0;
+		for (int i = 0; i < want; i++) {
+			pthread_t thread;
+			if (pthread_create(&thread, NULL, ftx_pool_worker, NULL))
+				break;
+			pthread_detach(thread);
+			ftx_pool.workers++;
+		}
+		LOG(LOG_INFO, "FTx decoder: %d worker threads\n", ftx_pool.workers);
+	}
 
-	char mygrid[8];
-	strncpy(mygrid, field_str("MYGRID"), 8);
-	mygrid[4] = 0; // use only the first 4 letters of the grid
-	double mylat, mylon;
-	bool myloc_ok = !locator2longlat(&mylon, &mylat, mygrid);
+	ftx_pool.wf = wf;
+	ftx_pool.candidates = candidates;
+	ftx_pool.results = results;
+	ftx_pool.deadline = deadline;
+	ftx_pool.n_candidates = n_candidates;
+	ftx_pool.next = 0;
+	ftx_pool.finished = 0;
+	ftx_pool.batch++;
+	pthread_cond_broadcast(&ftx_pool.work);
+
+	ftx_pool_drain();
+	while (ftx_pool.finished < n_candidates)
+		pthread_cond_wait(&ftx_pool.done, &ftx_pool.lock);
+	ftx_pool.n_candidates = 0;
+	const int threads = ftx_pool.workers + 1;
+	pthread_mutex_unlock(&ftx_pool.lock);
+	return threads;
+}
 
-    monitor_init(&mon, &mon_cfg);
+/*
+	A-priori (AP) decoding, as WSJT-X does it: while a QSO is in progress we
+	know our own call, the other station's call, and which message should
+	come back next. For the candidates near the frequencies where that reply
+	is expected which could not be decoded on their own, the codeword bits
+	that those parts of the message determine are set to the values they
+	should have, more confidently than the channel gives any bit, and the
+	LDPC decoder is run again. Since that also makes it easier to "decode"
+	noise, a result is only kept if the CRC checks and the received symbols
+	disagree with the whole codeword in no more bits than a normal decode
+	could (kAP_max_hard_errors).
+	The hypothesis types are numbered as in WSJT-X, which shows them as a2..a6.
+*/
+#define FTX_AP_MAX 5
 
-    // Process the waveform data frame by frame - you could have a live loop here with data from an audio device
-    for (int frame_pos = 0; frame_pos + mon.block_size <= num_samples; frame_pos += mon.block_size)
-        monitor_process(&mon, signal + frame_pos);
+typedef struct
+{
+	int type;		// 2: our call; 3: ours and the DX call; 4: RRR; 5: 73; 6: RR73
+	int known_bits;	// payload bits 0 .. known_bits - 1 are known, and so is i3 (bits 74-76)
+	uint8_t bits[FTX_PAYLOAD_LENGTH_BYTES];	// the payload, as it goes into the codeword
+} ftx_ap_hypothesis_t;
 
-//    LOG(LOG_DEBUG, "Waterfall accumulated %d symbols\n", mon.wf.num_blocks);
-//    LOG(LOG_INFO, "Max magnitude: %.1f dB\n", mon.max_mag);
+static const int kAP_width_hz = 50; // how far from the expected frequency a candidate may be
+static const int kAP_max_hard_errors = 36;
 
-    // Find top candidates by Costas sync score and localize them in time and frequency
-    ftx_candidate_t candidate_list[kMax_candidates];
-    int num_candidates = ftx_find_candidates(&mon.wf, kMax_candidates, candidate_list, kMin_score);
+static ftx_ap_hypothesis_t ftx_ap[FTX_AP_MAX];
+static int ftx_ap_count = 0;
+static int ftx_ap_freq[2]; // where replies are expected: our TX pitch, and the DX station's pitch
 
-    // Hash table for decoded messages (to check for duplicates)
-	typedef struct
-	{
-		int last_qso_age;
-		int grid_last_qso_age;
-		char text[FTX_MAX_MESSAGE_LENGTH]; // message text as decoded
-		ftx_message_offsets_t spans; // locations/lengths of fields in text
-		ftx_message_t message; // encoded form
-	} decoded_message_t;
-
-	int num_decoded = 0;
-	decoded_message_t decoded[kMax_decoded_messages];
-	decoded_message_t* decoded_hashtable[kMax_decoded_messages];
-	int n_decodes = 0;
-	int crc_mismatches = 0;
-	int highest_priority = -999;
-	uint32_t highest_priority_row = 0;
+// Add a hypothesis that we receive "mycall dxcall extra", of which \a known_bits are to be trusted.
+static void ftx_ap_add(int type, int known_bits, ftx_protocol_t protocol,
+	const char *mycall, const char *dxcall, const char *extra)
+{
+	ftx_message_t msg;
+	if (ftx_ap_count >= FTX_AP_MAX ||
+			ftx_message_encode_std(&msg, &hash_if, mycall, dxcall, extra) != FTX_MESSAGE_RC_OK ||
+			ftx_message_get_i3(&msg) != 1)
+		return; // only standard messages have the calls where we expect them
+	ftx_ap_hypothesis_t *ap = &ftx_ap[ftx_ap_count++];
+	ap->type = type;
+	ap->known_bits = known_bits;
+	for (int i = 0; i < FTX_PAYLOAD_LENGTH_BYTES; ++i)
+		ap->bits[i] = msg.payload[i] ^ (protocol == FTX_PROTOCOL_FT4 ? kFT4_XOR_sequence[i] : 0);
+}
 
-	// Initialize hash table pointers
-	memset(decoded_hashtable, 0, sizeof(decoded_hashtable));
+/*!
+	Work out what the station we are in QSO with should send next, from the
+	CALL field and the message we are sending, and set up the hypotheses for it.
+	While calling CQ, only our own call is known.
+*/
+static void ftx_ap_prepare(ftx_protocol_t protocol)
+{
+	char mycall[16], dxcall[16], tx_text[sizeof(ftx_tx_text)];
+	char to[16] = "", de[16] = "", extra[16] = "";
+
+	ftx_ap_count = 0;
+	strncpy(mycall, field_str("MYCALLSIGN"), sizeof(mycall) - 1);
+	mycall[sizeof(mycall) - 1] = 0;
+	strncpy(dxcall, field_str("CALL"), sizeof(dxcall) - 1);
+	dxcall[sizeof(dxcall) - 1] = 0;
+	strncpy(tx_text, ftx_tx_text, sizeof(tx_text) - 1);
+	tx_text[sizeof(tx_text) - 1] = 0;
+	for (char *c = mycall; *c; ++c)
+		*c = toupper(*c);
+	for (char *c = dxcall; *c; ++c)
+		*c = toupper(*c);
+	if (!mycall[0])
+		return;
+	ftx_ap_freq[0] = field_int("TX_PITCH");
+	ftx_ap_freq[1] = field_int("FTX_RX_PITCH");
+
+	if (tx_text[0] && is_cq) {
+		ftx_ap_add(2, 29, protocol, mycall, mycall, "RRR");
+		ftx_ap_freq[1] = ftx_ap_freq[0];
+		return;
+	}
+	if (!dxcall[0])
+		return;
+	ftx_ap_add(3, 58, protocol, mycall, dxcall, "RRR");
+
+	// the message that we are sending to dxcall tells what to expect back
+	sscanf(tx_text, "%15s %15s %15s", to, de, extra);
+	if (strcasecmp(to, dxcall) || strcasecmp(de, mycall))
+		return;
+	if (extra[0] == 'R' && (extra[1] == '+' || extra[1] == '-')) {
+		ftx_ap_add(4, 77, protocol, mycall, dxcall, "RRR");
+		ftx_ap_add(6, 77, protocol, mycall, dxcall, "RR73");
+		ftx_ap_add(5, 77, protocol, mycall, dxcall, "73");
+	} else if (!strcmp(extra, "RR73") || !strcmp(extra, "RRR")) {
+		ftx_ap_add(5, 77, protocol, mycall, dxcall, "73");
+	}
+}
+
+/*!
+	Log-likelihoods of the 174 codeword bits of candidate \a cand, as
+	ftx_decode_candidate() computes them (but it doesn't expose them):
+	for each bit, the strongest tone that would make it 1 less the strongest
+	one that would make it 0; then normalized to a variance of 24.
+*/
+static void ftx_ap_likelihood(const ftx_waterfall_t *wf, const ftx_candidate_t *cand, float *log174)
+{
+	const bool is_ft4 = wf->protocol == FTX_PROTOCOL_FT4;
+	const int n_symbols = is_ft4 ? FT4_ND : FT8_ND;
+	const int n_tones = is_ft4 ? 4 : 8;
+	const int n_bits = is_ft4 ? 2 : 3;
+	const uint8_t *gray = is_ft4 ? kFT4_Gray_map : kFT8_Gray_map;
+	int offset = ((cand->time_offset * wf->time_osr + cand->time_sub) * wf->freq_osr + cand->freq_sub) * wf->num_bins + cand->freq_offset;
+
+	for (int k = 0; k < n_symbols; ++k) {
+		// skip the sync symbols
+		int sym_idx = is_ft4 ? k + (k < 29 ? 5 : (k < 58 ? 9 : 13)) : k + (k < 29 ? 7 : 14);
+		int block = cand->time_offset + sym_idx;
+		float *logl = log174 + n_bits * k;
+		if (block < 0 || block >= wf->num_blocks) {
+			for (int b = 0; b < n_bits; ++b)
+				logl[b] = 0;
+			continue;
+		}
+		const uint8_t *mag = wf->mag + offset + sym_idx * wf->block_stride;
+		for (int b = 0; b < n_bits; ++b) {
+			float max1 = 0, max0 = 0;
+			for (int j = 0; j < n_tones; ++j) {
+				float s = mag[gray[j]];
+				if (j & (1 << (n_bits - 1 - b)))
+					max1 = fmaxf(max1, s);
+				else
+					max0 = fmaxf(max0, s);
+			}
+			logl[b] = max1 - max0;
+		}
+	}
+
+	float sum = 0, sum2 = 0;
+	for (int i = 0; i < FTX_LDPC_N; ++i) {
+		sum += log174[i];
+		sum2 += log174[i] * log174[i];
+	}
+	float variance = (sum2 - sum * sum / FTX_LDPC_N) / FTX_LDPC_N;
+	if (variance > 0) {
+		float norm = sqrtf(24.0f / variance);
+		for (int i = 0; i < FTX_LDPC_N; ++i)
+			log174[i] *= norm;
+	}
+}
+
+static bool ftx_ap_known_bit(const ftx_ap_hypothesis_t *ap, int i)
+{
+	return i < ap->known_bits || (i >= 74 && i < 77);
+}
+
+/*!
+	Try the AP hypotheses on candidate \a cand, in order.
+	@return the type of the hypothesis that decoded it, with the message in
+	\a message; or 0 if none did
+*/
+static int ftx_ap_decode(const ftx_waterfall_t *wf, const ftx_candidate_t *cand, ftx_message_t *message)
+{
+	float raw[FTX_LDPC_N], log174[FTX_LDPC_N];
+	uint8_t plain[FTX_LDPC_N];
+	uint8_t a91[FTX_LDPC_K_BYTES];
+
+	ftx_ap_likelihood(wf, cand, raw);
+	float ap_mag = 0;
+	for (int i = 0; i < FTX_LDPC_N; ++i)
+		ap_mag = fmaxf(ap_mag, fabsf(raw[i]));
+	ap_mag *= 1.01f;
+
+	for (int h = 0; h < ftx_ap_count; ++h) {
+		const ftx_ap_hypothesis_t *ap = &ftx_ap[h];
+		memcpy(log174, raw, sizeof(log174));
+		for (int i = 0; i < 77; ++i)
+			if (ftx_ap_known_bit(ap, i))
+				log174[i] = (ap->bits[i / 8] & (0x80 >> (i % 8))) ? ap_mag : -ap_mag;
+		int errors;
+		bp_decode(log174, kLDPC_iterations, plain, &errors);
+		if (errors > 0)
+			continue;
+
+		// the channel must agree with the codeword on its own, without the AP bits
+		int hard_errors = 0;
+		for (int i = 0; i < FTX_LDPC_N; ++i)
+			if ((raw[i] > 0) != (plain[i] != 0))
+				++hard_errors;
+		if (hard_errors > kAP_max_hard_errors)
+			continue;
+
+		memset(a91, 0, sizeof(a91));
+		for (int i = 0; i < FTX_LDPC_K; ++i)
+			if (plain[i])
+				a91[i / 8] |= 0x80 >> (i % 8);
+		bool matches = true;
+		for (int i = 0; i < 77 && matches; ++i)
+			if (ftx_ap_known_bit(ap, i))
+				matches = !(a91[i / 8] & (0x80 >> (i % 8))) == !(ap->bits[i / 8] & (0x80 >> (i % 8)));
+		uint16_t crc_extracted = ftx_extract_crc(a91);
+		a91[9] &= 0xF8;
+		a91[10] = 0;
+		if (!matches || crc_extracted != ftx_compute_crc(a91, 96 - 14))
+			continue;
+
+		message->hash = crc_extracted;
+		for (int i = 0; i < FTX_PAYLOAD_LENGTH_BYTES; ++i)
+			message->payload[i] = a91[i] ^ (wf->protocol == FTX_PROTOCOL_FT4 ? kFT4_XOR_sequence[i] : 0);
+		return ap->type;
+	}
+	return 0;
+}
+
+/*!
+	Try AP decoding on the candidates in \a candidates that ftx_decode_candidates()
+	could not decode, if they are near where a reply is expected.
+	Those not started by \a deadline are marked skipped, as in ftx_decode_candidates().
+	@return the number of candidates that were tried
+*/
+static int ftx_ap_decode_candidates(const ftx_waterfall_t *wf, const ftx_candidate_t *candidates,
+	int n_candidates, ftx_candidate_result_t *results, float symbol_period,
+	const struct timespec *deadline)
+{
+	int tried = 0;
+	for (int idx = 0; idx < n_candidates && ftx_ap_count; ++idx) {
+		const ftx_candidate_t *cand = &candidates[idx];
+		if (results[idx].ok || results[idx].skipped || cand->score < kMin_score)
+			continue;
+		int freq_hz = ftx_candidate_freq(wf, cand, symbol_period);
+		if (abs(freq_hz - ftx_ap_freq[0]) > kAP_width_hz && abs(freq_hz - ftx_ap_freq[1]) > kAP_width_hz)
+			continue;
+		if (ftx_elapsed_ns(deadline) >= 0) {
+			results[idx].skipped = true;
+			continue;
+		}
+		++tried;
+		results[idx].ap_type = ftx_ap_decode(wf, cand, &results[idx].message);
+		results[idx].ok = results[idx].ap_type > 0;
+	}
+	return tried;
+}
+
+/*
+	Decode scheduling: the reply to a message has to be queued before the
+	next slot starts, so when there are more candidates than a slow CPU can
+	decode in time, the ones that matter most go first, and those not started
+	by the deadline (FTX_BUDGET ms after the end of the slot; half that for
+	FT4) are skipped and reported rather than making the reply late.
+	The other streams have the same deadline, but stop earlier if the main
+	one is due before that, since they are decoded on the same thread.
+	Before decoding, relevance can only be guessed from the frequency: near
+	the DX station's pitch or our own, it is probably our QSO partner; near
+	where a CQ or a new DXCC was decoded in the last two slots, probably the
+	same station again. Within each rank, ft8_lib's order (by sync score) is kept.
+*/
+#define FTX_HEARD_MAX 100
+
+enum { FTX_RANK_OTHER, FTX_RANK_NEW_DXCC, FTX_RANK_CQ, FTX_RANK_QSO };
+
+typedef struct
+{
+	int freq_hz;
+	int rank;
+} ftx_heard_t;
+
+static const int kHeard_width_hz = 10; // how far a station may have moved since it was heard
+static ftx_heard_t ftx_heard[2][FTX_HEARD_MAX]; // decodes in the last two slots, by slot parity
+static int ftx_heard_n[2];
+static long ftx_heard_slot[2] = {-1, -1};
+
+// Remember that a decode with \a rank was at \a freq_hz in \a slot.
+static void ftx_heard_add(long slot, int freq_hz, int rank)
+{
+	const int p = slot & 1;
+	if (ftx_heard_slot[p] != slot) {
+		ftx_heard_slot[p] = slot;
+		ftx_heard_n[p] = 0;
+	}
+	if (rank > FTX_RANK_OTHER && ftx_heard_n[p] < FTX_HEARD_MAX) {
+		ftx_heard[p][ftx_heard_n[p]].freq_hz = freq_hz;
+		ftx_heard[p][ftx_heard_n[p]++].rank = rank;
+	}
+}
+
+static int ftx_candidate_rank(int freq_hz, long slot, const int *qso_freq)
+{
+	for (int i = 0; i < 2; ++i)
+		if (qso_freq[i] > 0 && abs(freq_hz - qso_freq[i]) <= kAP_width_hz)
+			return FTX_RANK_QSO;
+	int rank = FTX_RANK_OTHER;
+	for (int p = 0; p < 2; ++p) {
+		if (ftx_heard_slot[p] < slot - 2 || ftx_heard_slot[p] >= slot)
+			continue; // not one of the last two slots
+		for (int i = 0; i < ftx_heard_n[p]; ++i)
+			if (ftx_heard[p][i].rank > rank && abs(freq_hz - ftx_heard[p][i].freq_hz) <= kHeard_width_hz)
+				rank = ftx_heard[p][i].rank;
+	}
+	return rank;
+}
+
+/*!
+	Put the \a n_candidates in \a candidates in the order they should be
+	decoded in \a slot: by rank, then in their original order.
+*/
+static void ftx_schedule_candidates(const ftx_waterfall_t *wf, ftx_candidate_t *candidates,
+	int n_candidates, float symbol_period, long slot)
+{
+	int qso_freq[2] = {0, 0};
+	int ranks[kMax_candidates];
+
+	if (field_str("CALL")[0])
+		qso_freq[0] = field_int("FTX_RX_PITCH");
+	if (ftx_tx_text[0])
+		qso_freq[1] = field_int("TX_PITCH");
+	for (int i = 0; i < n_candidates; ++i)
+		ranks[i] = ftx_candidate_rank(ftx_candidate_freq(wf, &candidates[i], symbol_period), slot, qso_freq);
+	// insertion sort is stable, and there are only a hundred or so
+	for (int i = 1; i < n_candidates; ++i) {
+		ftx_candidate_t cand = candidates[i];
+		int rank = ranks[i];
+		int j = i;
+		for (; j > 0 && ranks[j - 1] < rank; --j) {
+			candidates[j] = candidates[j - 1];
+			ranks[j] = ranks[j - 1];
+		}
+		candidates[j] = cand;
+		ranks[j] = rank;
+	}
+}
+
+/*
+	Multi-pass decoding: after each pass, the signals that were decoded are
+	synthesized again from their payloads, fitted to the received audio and
+	subtracted from a copy of it, so that weaker signals underneath them can
+	be decoded from the residual in the next pass. Mixing the audio down with
+	the conjugate of the synthesized phase leaves the complex amplitude of
+	the signal in each symbol; the phase steps between symbols give its
+	frequency error and drift, and once those are corrected, the (smoothed)
+	amplitudes are what gets subtracted.
+*/
+static const int kMax_passes = 3;
+// FT8 decode budget when FTX_BUDGET is not set: no candidate or pass is started later than this after the slot
+static const int kDecode_budget_ms = 1500;
+
+static float ftx_residual[FT8_MAX_BUFF];
+static monitor_t ftx_residual_mon[2]; // [is FT4], since FT8 and FT4 may be decoded in turn
+static bool ftx_residual_mon_inited[2] = {false, false};
+static float *ftx_sub_phase = NULL;		// synthesized phase of the signal being subtracted
+static float complex *ftx_sub_ref = NULL;	// exp(-j phase)
+static int ftx_sub_len = 0;
+
+/*!
+	Mix \a signal down with ftx_sub_ref placed at \a offset, and put the mean
+	of each symbol into \a amp (if not NULL).
+	@return the total power of the symbols
+*/
+static float ftx_sub_symbols(const float *signal, int num_samples, int offset,
+	int n_sym, int n_spsym, float complex *amp)
+{
+	float power = 0;
+	for (int s = 0; s < n_sym; ++s) {
+		const int start = offset + s * n_spsym;
+		const int k0 = start < 0 ? -start : 0;
+		const int k1 = start + n_spsym > num_samples ? num_samples - start : n_spsym;
+		const float complex *ref = ftx_sub_ref + s * n_spsym;
+		float complex sum = 0;
+		for (int k = k0; k < k1; ++k)
+			sum += signal[start + k] * ref[k];
+		sum /= n_spsym;
+		if (amp)
+			amp[s] = sum;
+		power += crealf(sum) * crealf(sum) + cimagf(sum) * cimagf(sum);
+	}
+	return power;
+}
+
+/*!
+	Subtract the decoded \a message, found at \a time_sec and \a freq_hz,
+	from \a signal (\a num_samples long).
+	@return false if it couldn't be fitted, or there was no memory to do it in
+*/
+static bool ftx_subtract(float *signal, int num_samples, const ftx_message_t *message,
+	ftx_protocol_t protocol, float time_sec, int freq_hz)
+{
+	const bool is_ft4 = protocol == FTX_PROTOCOL_FT4;
+	const int sample_rate = 12000;
+	const int n_sym = is_ft4 ? FT4_NN : FT8_NN;
+	const float symbol_period = is_ft4 ? FT4_SYMBOL_PERIOD : FT8_SYMBOL_PERIOD;
+	const float symbol_bt = is_ft4 ? FT4_SYMBOL_BT : FT8_SYMBOL_BT;
+	const int n_spsym = (int)(0.5f + sample_rate * symbol_period);
+	const int n_wave = n_sym * n_spsym;
+
+	if (ftx_sub_len < n_wave) {
+		float *phase = malloc(n_wave * sizeof(ftx_sub_phase[0]));
+		float complex *ref = malloc(n_wave * sizeof(ftx_sub_ref[0]));
+		if (!phase || !ref) {
+			free(phase);
+			free(ref);
+			return false;
+		}
+		free(ftx_sub_phase);
+		free(ftx_sub_ref);
+		ftx_sub_phase = phase;
+		ftx_sub_ref = ref;
+		ftx_sub_len = n_wave;
+	}
+
+	uint8_t tones[FT4_NN > FT8_NN ? FT4_NN : FT8_NN];
+	if (is_ft4)
+		ft4_encode(message->payload, tones);
+	else
+		ft8_encode(message->payload, tones);
+	gfsk_phase(tones, n_sym, freq_hz, symbol_bt, symbol_period, sample_rate, ftx_sub_phase);
+	for (int k = 0; k < n_wave; ++k)
+		ftx_sub_ref[k] = cosf(ftx_sub_phase[k]) - I * sinf(ftx_sub_phase[k]);
+
+	// The candidate time is only good to half a symbol: search around it,
+	// first in 1/8 symbol steps, then in 1/64
+	int offset = lroundf(time_sec * sample_rate);
+	float best_power = -1;
+	for (int step = n_spsym / 8; step >= n_spsym / 64; step /= 8) {
+		const int from = offset - 8 * step;
+		for (int i = 0; i <= 16; ++i) {
+			float power = ftx_sub_symbols(signal, num_samples, from + i * step, n_sym, n_spsym, NULL);
+			if (power > best_power) {
+				best_power = power;
+				offset = from + i * step;
+			}
+		}
+	}
+
+	// Fit the phase steps between symbols to a + b * (s - mid):
+	// a is the frequency error and b the drift, in radians per symbol (squared)
+	float complex amp[FT4_NN > FT8_NN ? FT4_NN : FT8_NN];
+	ftx_sub_symbols(signal, num_samples, offset, n_sym, n_spsym, amp);
+	const float mid = (n_sym - 2) / 2.0f;
+	double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (int s = 0; s + 1 < n_sym; ++s) {
+		const float complex d = amp[s + 1] * conjf(amp[s]);
+		const float w = cabsf(d);
+		const float x = s - mid;
+		const float y = cargf(d);
+		sw += w;
+		sx += w * x;
+		sy += w * y;
+		sxx += w * x * x;
+		sxy += w * x * y;
+	}
+	if (sw <= 0)
+		return false;
+	const double det = sw * sxx - sx * sx;
+	const float b = det > 0 ? (sw * sxy - sx * sy) / det : 0;
+	const float a = (sy - b * sx) / sw;
+	if (fabsf(a) > M_PI / 2)
+		return false;
+
+	// The step between symbols s and s + 1 belongs to u = s + 1 (in symbols from the start),
+	// so the phase error is the integral of a + b * (u - 1 - mid)
+	for (int k = 0; k < n_wave; ++k) {
+		const float u = (float)k / n_spsym;
+		const float v = u - 1 - mid;
+		const float psi = a * u + b / 2 * (v * v - (1 + mid) * (1 + mid));
+		ftx_sub_ref[k] *= cosf(psi) - I * sinf(psi);
+	}
+	ftx_sub_symbols(signal, num_samples, offset, n_sym, n_spsym, amp);
+
+	// Smooth the amplitudes over neighbouring symbols, and subtract,
+	// interpolating between the symbol centers
+	float complex smooth[FT4_NN > FT8_NN ? FT4_NN : FT8_NN];
+	for (int s = 0; s < n_sym; ++s) {
+		const float complex prev = s > 0 ? amp[s - 1] : amp[s];
+		const float complex next = s + 1 < n_sym ? amp[s + 1] : amp[s];
+		smooth[s] = (prev + 2 * amp[s] + next) / 4;
+	}
+	const int n_ramp = n_spsym / 8;
+	for (int k = 0; k < n_wave; ++k) {
+		const int n = offset + k;
+		if (n < 0 || n >= num_samples)
+			continue;
+		const float u = (float)k / n_spsym - 0.5f;
+		int s = (int)floorf(u);
+		float f = u - s;
+		if (s < 0) {
+			s = 0;
+			f = 0;
+		} else if (s >= n_sym - 1) {
+			s = n_sym - 2;
+			f = 1;
+		}
+		float complex c = smooth[s] * (1 - f) + smooth[s + 1] * f;
+		// the same envelope as ft8_next_if_block() puts on the first and last symbols
+		if (k < n_ramp)
+			c *= (1 - cosf(M_PI * k / n_ramp)) / 2;
+		else if (k >= n_wave - n_ramp)
+			c *= (1 - cosf(M_PI * (n_wave - 1 - k) / n_ramp)) / 2;
+		signal[n] -= 2 * crealf(c * conjf(ftx_sub_ref[k]));
+	}
+
+	LOG(LOG_DEBUG, "Subtracted %d Hz at %+d samples: %+.2f Hz, drift %+.3f Hz/s\n",
+		freq_hz, offset - (int)lroundf(time_sec * sample_rate),
+		a / (2 * M_PI * symbol_period), b / (2 * M_PI * symbol_period * symbol_period));
+	return true;
+}
+
+// Compute the waterfall of the first \a num_samples of ftx_residual, and return its monitor.
+static monitor_t *ftx_residual_waterfall(ftx_protocol_t protocol, int num_samples)
+{
+	const int p = protocol == FTX_PROTOCOL_FT4;
+	monitor_t *mon = &ftx_residual_mon[p];
+	if (!ftx_residual_mon_inited[p]) {
+		ftx_monitor_init(mon, protocol);
+		ftx_residual_mon_inited[p] = true;
+	}
+	monitor_reset(mon);
+	for (int pos = 0; pos + mon->block_size <= num_samples; pos += mon->block_size)
+		monitor_process(mon, ftx_residual + pos);
+	return mon;
+}
+
+// A message decoded in this slot, kept to check for duplicates
+typedef struct
+{
+	int last_qso_age;
+	int grid_last_qso_age;
+	int entity_qsos; // QSOs with the caller's DXCC entity, or -1 if not looked up
+	int entity_band_qsos; // the same, on this band
+	char text[FTX_MAX_MESSAGE_LENGTH]; // message text as decoded
+	ftx_message_offsets_t spans; // locations/lengths of fields in text
+	ftx_message_t message; // encoded form
+	float time_sec; // where it was found, to subtract it for the next pass
+	int freq_hz;
+} decoded_message_t;
+
+// What sbitx_ft8_decode() keeps from one pass to the next
+typedef struct
+{
+	ftx_stream_t *st;
+	bool is_main;
+	int band;
+	int raw_ms; // the start of the slot
+	time_t now;
+	char mycallsign_upper[20];
+	double mylat, mylon;
+	struct timespec slot_end;
+	decoded_message_t *decoded; // [kMax_decoded_messages]
+	decoded_message_t **decoded_hashtable; // [kMax_decoded_messages]
+	int num_decoded;
+	int n_decodes;
+	int crc_mismatches;
+	int highest_priority;
+	uint32_t highest_priority_row;
+	int n_skipped;
+	int skipped_len;
+	char skipped[200];
+	int *pass_new; // the decoded[] slots filled in this pass
+	int n_pass_new;
+	int ap_decodes;
+} ftx_slot_decode_t;
+
+/*!
+	Print, spot and answer the new messages among the \a results of
+	decoding \a candidate_list in one pass of sbitx_ft8_decode().
+*/
+static void ftx_show_decodes(ftx_slot_decode_t *sd, const ftx_candidate_t *candidate_list,
+	int num_candidates, const ftx_candidate_result_t *results)
+{
+	ftx_stream_t *st = sd->st;
+	monitor_t *mon = &st->mon;
+	const bool is_main = sd->is_main;
+	const bool is_ft8 = mon->wf.protocol == FTX_PROTOCOL_FT8;
+	const int band = sd->band;
+	const int raw_ms = sd->raw_ms;
+	const time_t now = sd->now;
+	const char *mycallsign_upper = sd->mycallsign_upper;
+	const double mylat = sd->mylat, mylon = sd->mylon;
+	const struct timespec slot_end = sd->slot_end;
+	decoded_message_t *decoded = sd->decoded;
+	decoded_message_t **decoded_hashtable = sd->decoded_hashtable;
 
     // Go over candidates and attempt to decode messages
     for (int idx = 0; idx < num_candidates; ++idx)
@@ -703,21 +1535,30 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
         if (cand->score < kMin_score)
             continue;
 
-        int freq_hz = lroundf((cand->freq_offset + (float)cand->freq_sub / mon.wf.freq_osr) / mon.symbol_period);
-		//~ printf("freq_hz: (%d + %d / %d) / %f = %d\n", cand->freq_offset, cand->freq_sub, mon.wf.freq_osr, mon.symbol_period, freq_hz);
-        float time_sec = (cand->time_offset + (float)cand->time_sub / mon.wf.time_osr) * mon.symbol_period;
+        int freq_hz = ftx_candidate_freq(&mon->wf, cand, mon->symbol_period);
+		//~ printf("freq_hz: (%d + %d / %d) / %f = %d\n", cand->freq_offset, cand->freq_sub, mon->wf.freq_osr, mon->symbol_period, freq_hz);
+        float time_sec = (cand->time_offset + (float)cand->time_sub / mon->wf.time_osr) * mon->symbol_period;
 
-        ftx_message_t message;
-        ftx_decode_status_t status;
-        if (!ftx_decode_candidate(&mon.wf, cand, kLDPC_iterations, &message, &status)){
+        ftx_message_t message = results[idx].message;
+        ftx_decode_status_t status = results[idx].status;
+        if (!results[idx].ok){
             // printf("000000 %3d %+4.2f %4.0f ~  ---\n", cand->score, time_sec, freq_hz);
+			if (results[idx].skipped) {
+				++sd->n_skipped;
+				if (sd->skipped_len < sizeof(sd->skipped) - 16)
+					sd->skipped_len += snprintf(sd->skipped + sd->skipped_len, sizeof(sd->skipped) - sd->skipped_len,
+						" %d/%d", freq_hz, cand->score);
+				continue;
+			}
 			if (status.crc_calculated != status.crc_extracted)
-				++crc_mismatches;
+				++sd->crc_mismatches;
             //~ else if (status.ldpc_errors > 0)
                 //~ LOG(LOG_DEBUG, "LDPC decode: %d errors\n", status.ldpc_errors);
             continue;
         }
 
+        if (sd->num_decoded >= kMax_decoded_messages)
+            break;
         LOG(LOG_DEBUG, "Checking hash table for %4.1fs / %dHz [%d]...\n", time_sec, freq_hz, cand->score);
         int idx_hash = message.hash % kMax_decoded_messages;
         bool found_empty_slot = false;
@@ -744,7 +1585,9 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 			// Fill the empty hashtable slot
 			memcpy(&decoded[idx_hash].message, &message, sizeof(message));
 			decoded_hashtable[idx_hash] = &decoded[idx_hash];
-			++num_decoded;
+			decoded[idx_hash].time_sec = time_sec;
+			decoded[idx_hash].freq_hz = freq_hz;
+			++sd->num_decoded;
 
 			char text[FTX_MAX_MESSAGE_LENGTH];
 			ftx_message_offsets_t spans;
@@ -755,9 +1598,11 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 			decoded[idx_hash].spans = spans;
 			decoded[idx_hash].last_qso_age = -1;
 			decoded[idx_hash].grid_last_qso_age = -1;
+			decoded[idx_hash].entity_qsos = -1;
+			decoded[idx_hash].entity_band_qsos = -1;
 
 			char buf[128];
-			int prefix_len = 8 + snprintf(hmst_time_sprint(buf, raw_ms), sizeof(buf) - 8, " %3d %+03d %4d ", cand->score, cand->snr, freq_hz);
+			int prefix_len = 8 + snprintf(hmst_time_sprint(buf, raw_ms), sizeof(buf) - 8, " %3d %+03d %4d ", cand->score, cand->snr, st->offset_hz + freq_hz);
 			int line_len = prefix_len + snprintf(buf + prefix_len, sizeof(buf) - prefix_len, "%s", text);
 
 			const bool is_cq = !strncmp(text, "CQ ", 3);
@@ -810,7 +1655,8 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 								--len;
 							strncpy(callsign, buf + start, len);
 							callsign[len] = 0;
-							time_t recent_qso = len > 0 ? logbook_last_qso(callsign, len) : 0ll;
+							scp_add(callsign, SCP_HEARD);
+							time_t recent_qso = len > 0 ? ftx_last_qso(callsign, len) : 0ll;
 							//~ printf("checking for recent QSO: callsign is at text range %d len %d from '%s': '%s'; last qso @ %lld, %lld secs ago; limit is %d hours\n",
 								//~ start, len, buf, callsign, recent_qso, now - recent_qso, recent_qso_age);
 							decoded[idx_hash].last_qso_age = recent_qso ? (now - recent_qso) / 60 / 60 : -1; // convert seconds to hours
@@ -876,11 +1722,16 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 							strncpy(grid, buf + sem[sem_i - 1].start_column, 4);
 						}
 						// When was the last QSO with someone in this grid?
-						time_t recent_grid_qso = sem[sem_i - 1].length > 0 ? logbook_grid_last_qso(buf + sem[sem_i - 1].start_column, sem[sem_i - 1].length) : 0ll;
+						time_t recent_grid_qso = sem[sem_i - 1].length > 0 ? ftx_grid_last_qso(buf + sem[sem_i - 1].start_column, sem[sem_i - 1].length) : 0ll;
 						//~ printf("checking for QSO: grid is at text range %d len %d from '%s'; exists? %d\n",
 							//~ sem[sem_i - 1].start_column, sem[sem_i - 1].length, buf, exists);
 						decoded[idx_hash].grid_last_qso_age = recent_grid_qso ? (now - recent_grid_qso) / 60 / 60 : -1; // convert seconds to hours
-						if (recent_grid_qso)
+						// A grid that is new on this band keeps STYLE_GRID, so that it stands out
+						int grid_index = worked_grid_index(buf + sem[sem_i - 1].start_column, sem[sem_i - 1].length);
+						bool grid_worked = recent_grid_qso;
+						if (worked_ready() && grid_index >= 0)
+							grid_worked = worked_grid_qsos(grid_index, band) > 0;
+						if (grid_worked)
 							sem[sem_i - 1].semantic = STYLE_EXISTING_GRID;
 						break;
 					}
@@ -895,7 +1746,8 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 							--len;
 						strncpy(callsign, buf + start, len);
 						callsign[len] = 0;
-						time_t recent_qso = len > 0 ? logbook_last_qso(callsign, len) : 0ll;
+						scp_add(callsign, SCP_HEARD);
+						time_t recent_qso = len > 0 ? ftx_last_qso(callsign, len) : 0ll;
 						decoded[idx_hash].last_qso_age = recent_qso ? (now - recent_qso) / 60 / 60 : -1; // convert seconds to hours
 						if (recent_qso && decoded[idx_hash].last_qso_age < recent_qso_age)
 							sem[sem_i - 1].semantic = STYLE_RECENT_CALLER;
@@ -908,27 +1760,31 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 			// add supplementary information: country, distance, azimuth.
 			// Don't do that otherwise: it can confuse ftx_call_or_continue()
 			if (!cty_inited)
-				cty_inited = !readctydata(cty_location) && !readabbrev(abbrev_location);
+				cty_inited = (cty_loaded() || !cty_load(cty_location)) && !readabbrev(abbrev_location);
 			if (!rules_inited)
 				load_ftx_rules();
 			rules_inited = true; // or at least we aren't going to try again
 			if ((is_cq || (my_call_found && grid[0])) && cty_inited) {
-				dxcc_data info = lookupcountry_by_callsign(callsign);
-				if (info.country) {
+				const cty_info *info = cty_lookup(callsign);
+				if (info && worked_ready()) {
+					decoded[idx_hash].entity_qsos = worked_entity_qsos(info->entity, WORKED_ANY, WORKED_ANY);
+					decoded[idx_hash].entity_band_qsos = worked_entity_qsos(info->entity, band, WORKED_ANY);
+				}
+				if (info) {
 					const char *country_abbrev = NULL;
 					double distance = 0.0, azimuth = 0.0;
-					// TODO store this in callsigns hashtable so we don't have to keep calling lookupcountry_by_callsign every time
-					country_abbrev = abbreviate_country(info.countryname);
+					double latitude = info->latitude, longitude = info->longitude;
+					country_abbrev = abbreviate_country(info->country);
 					int cty_abb_len = snprintf(buf + line_len, sizeof(buf) - line_len, " %s", country_abbrev);
 					sem[sem_i].semantic = STYLE_COUNTRY;
 					sem[sem_i].start_column = line_len;
 					sem[sem_i++].length = cty_abb_len;
 					line_len += cty_abb_len;
 					if (grid[0])
-						set_location_from_grid(&info, grid);
-					int qrbOK = !qrb(mylon, mylat, info.longitude, info.latitude, &distance, &azimuth);
+						locator2longlat(&longitude, &latitude, grid);
+					int qrbOK = !qrb(mylon, mylat, longitude, latitude, &distance, &azimuth);
 					LOG(LOG_DEBUG, "%s: %s '%s' @ %5.2lf,%5.2lf (qrb ok? %d) d %5.0lf a %3.0lf rel to me @ %5.2lf,%5.2lf\n",
-						callsign, country_abbrev, info.countryname, info.latitude, info.longitude,
+						callsign, country_abbrev, info->country, latitude, longitude,
 						qrbOK, distance, azimuth, mylat, mylon);
 					if (qrbOK) {
 						int dist_len = snprintf(buf + line_len, sizeof(buf) - line_len, " %.0lf", distance);
@@ -962,44 +1818,217 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 				}
 			}
 
+			// tag what the other protocol decodes, so that it isn't mistaken for the current one
+			if (mon->wf.protocol != ftx_main_stream()->protocol && sem_i < MAX_CONSOLE_LINE_STYLES) {
+				int tag_len = snprintf(buf + line_len, sizeof(buf) - line_len, " %s", is_ft8 ? "FT8" : "FT4");
+				sem[sem_i].semantic = STYLE_LOG;
+				sem[sem_i].start_column = line_len;
+				sem[sem_i++].length = tag_len;
+				line_len += tag_len;
+			}
+
 			// write the message out
 			const int message_type = ftx_message_get_i3(&message);
+			const char *entity_news = "";
+			if (!decoded[idx_hash].entity_qsos)
+				entity_news = "; new DXCC";
+			else if (!decoded[idx_hash].entity_band_qsos)
+				entity_news = "; DXCC new on this band";
 			if (decoded[idx_hash].last_qso_age < 0 && decoded[idx_hash].grid_last_qso_age < 0) {
 				// never had a QSO with this call before (as far as the sbitx database knows)
-				LOG(LOG_INFO, "<< %d.%c p%+d   %s\n",
-					message_type, message_type ? ' ' : '0' + ftx_message_get_n3(&message), priority, buf);
+				LOG(LOG_INFO, "<< %d.%c p%+d   %s%s\n",
+					message_type, message_type ? ' ' : '0' + ftx_message_get_n3(&message), priority, buf, entity_news);
 			} else {
-				LOG(LOG_INFO, "<< %d.%c p%+d   %s; last QSO with %s was %d hours ago, with grid %d hours ago\n",
+				LOG(LOG_INFO, "<< %d.%c p%+d   %s; last QSO with %s was %d hours ago, with grid %d hours ago%s\n",
 					message_type, message_type ? ' ' : '0' + ftx_message_get_n3(&message), priority,
-					buf, callsign, decoded[idx_hash].last_qso_age, decoded[idx_hash].grid_last_qso_age);
+					buf, callsign, decoded[idx_hash].last_qso_age, decoded[idx_hash].grid_last_qso_age, entity_news);
 			}
 			buf[line_len++] = '\n';
 			buf[line_len] = 0;
+			if (results[idx].ap_type) {
+				LOG(LOG_INFO, "AP decode (a%d): %s\n", results[idx].ap_type, decoded[idx_hash].text);
+				sd->ap_decodes++;
+			}
 			uint32_t console_row = write_console_semantic(buf, sem, sem_i);
+			if (!sd->n_decodes)
+				LOG(LOG_DEBUG, "First decode %ld ms after the end of the slot\n", ftx_elapsed_ns(&slot_end) / 1000000);
 
 			// Broadcast decode to WSJT-X compatible applications (e.g., Gridtracker)
 			const char *mode_str = is_ft8 ? "~" : "+";
-			udp_broadcast_decode(raw_ms, cand->snr, 0.0, freq_hz, mode_str,
+			udp_broadcast_decode(raw_ms, cand->snr, 0.0, st->offset_hz + freq_hz, mode_str,
 			                       decoded[idx_hash].text, false, false);
 
-			if (priority > highest_priority) {
-				highest_priority = priority;
-				highest_priority_row = console_row;
+			if (is_main && priority > sd->highest_priority) {
+				sd->highest_priority = priority;
+				sd->highest_priority_row = console_row;
 			}
 
-			if (my_call_found)
+			if (is_main && my_call_found)
 				ftx_call_or_continue(buf, line_len, sem);
-			n_decodes++;
+			sd->n_decodes++;
+			sd->pass_new[sd->n_pass_new++] = idx_hash;
         }
     }
-	if (crc_mismatches)
-		LOG(LOG_DEBUG, "Decoded %d messages; %d CRC mismatches\n", num_decoded, crc_mismatches);
+
+}
+
+/*!
+	Find and print the messages in the waterfall of stream \a st.
+	Only messages from the main receiver are answered automatically;
+	those from skimmer channels are shown and spotted with their
+	frequency offset from the dial.
+*/
+static int sbitx_ft8_decode(ftx_stream_t *st)
+{
+    int sample_rate = 12000;
+	monitor_t *mon = &st->mon;
+	const int num_samples = st->mon_fed;
+	const ftx_stream_t *main_st = ftx_main_stream();
+	const bool is_main = st == main_st;
+	bool is_ft8 = mon->wf.protocol == FTX_PROTOCOL_FT8;
+	recent_qso_age = field_int("RECENT_QSO_AGE");
+	const struct timespec slot_end = st->slot_end;
+	ftx_slot_decode_t sd = {.st = st, .is_main = is_main, .band = logbook_current_band(),
+		.slot_end = slot_end, .highest_priority = -999};
+
+	// timestamp the packets
+	// the time is shifted back by the time it took to capture these samples
+	const int packet_time_ms = is_ft8 ? 15000 : 7500;
+	const int raw_ms = (wallclock_day_ms / packet_time_ms) * packet_time_ms;
+	sd.raw_ms = raw_ms;
+	sd.now = time(NULL);
+	int time_sec_i = (raw_ms % 60000) / 1000;
+
+	LOG(LOG_DEBUG, "sbitx_ftx_decode: %02d %s sample rate %d Hz, %d samples, %.3f seconds\n",
+		time_sec_i, (is_ft8 ? "FT8" : "FT4"), sample_rate, num_samples, (double)num_samples / sample_rate);
+
+	int i;
+	char mycallsign[20];
+	get_field_value("#mycallsign", mycallsign);
+	for (i = 0; i < strlen(mycallsign); i++)
+		sd.mycallsign_upper[i] = toupper(mycallsign[i]);
+	sd.mycallsign_upper[i] = 0;
+
+	char mygrid[8];
+	strncpy(mygrid, field_str("MYGRID"), 8);
+	mygrid[4] = 0; // use only the first 4 letters of the grid
+	bool myloc_ok = !locator2longlat(&sd.mylon, &sd.mylat, mygrid);
+
+//    LOG(LOG_DEBUG, "Waterfall accumulated %d symbols\n", mon->wf.num_blocks);
+//    LOG(LOG_INFO, "Max magnitude: %.1f dB\n", mon->max_mag);
+
+    // Hash table for decoded messages (to check for duplicates)
+	decoded_message_t decoded[kMax_decoded_messages];
+	decoded_message_t* decoded_hashtable[kMax_decoded_messages];
+	int pass_new[kMax_decoded_messages];
+	sd.decoded = decoded;
+	sd.decoded_hashtable = decoded_hashtable;
+	sd.pass_new = pass_new;
+
+	// Initialize hash table pointers
+	memset(decoded_hashtable, 0, sizeof(decoded_hashtable));
+	ftx_lookup_ns = 0;
+	ftx_lookup_count = 0;
+
+	// Decode in passes, subtracting what was decoded from the audio in between
+	const ftx_waterfall_t *wf = &mon->wf;
+	int budget_ms = field_int("FTX_BUDGET");
+	if (budget_ms <= 0)
+		budget_ms = kDecode_budget_ms;
+	if (!is_ft8)
+		budget_ms /= 2;
+	struct timespec deadline = ftx_timespec_add_ms(slot_end, budget_ms);
+	// the other streams must not hold up the main one: stop when it is due
+	if (!is_main) {
+		const struct timespec main_due = ftx_next_slot_end(main_st->protocol);
+		if (ftx_elapsed_ns(&main_due) > ftx_elapsed_ns(&deadline))
+			deadline = main_due;
+	}
+	const long slot = raw_ms / packet_time_ms;
+	int first_pass_decodes = 0;
+	int passes = 0;
+	int decode_threads = 1;
+	long decode_ns = 0;
+	int ap_tried = 0;
+	if (is_main)
+		ftx_ap_prepare(mon->wf.protocol);
+	if (kMax_passes > 1)
+		memcpy(ftx_residual, st->buffer, num_samples * sizeof(ftx_residual[0]));
+	for (int pass = 0; pass < kMax_passes; ++pass) {
+		struct timespec pass_start;
+		clock_gettime(CLOCK_MONOTONIC, &pass_start);
+		sd.n_pass_new = 0;
+		passes++;
+
+		// Find top candidates by Costas sync score and localize them in time and frequency
+		ftx_candidate_t candidate_list[kMax_candidates];
+		int num_candidates = ftx_find_candidates(wf, kMax_candidates, candidate_list, kMin_score);
+		// and put the ones that matter most to us first
+		if (is_main)
+			ftx_schedule_candidates(wf, candidate_list, num_candidates, mon->symbol_period, slot);
+
+		// Attempt to decode all candidates at once, in parallel, up to the deadline
+		ftx_candidate_result_t results[kMax_candidates];
+		struct timespec decode_start;
+		clock_gettime(CLOCK_MONOTONIC, &decode_start);
+		decode_threads = ftx_decode_candidates(wf, candidate_list, num_candidates, results, &deadline);
+		// then use what we know about the QSO in progress on those that failed near its frequency
+		if (is_main)
+			ap_tried += ftx_ap_decode_candidates(wf, candidate_list, num_candidates, results, mon->symbol_period,
+				&deadline);
+		decode_ns += ftx_elapsed_ns(&decode_start);
+
+		ftx_show_decodes(&sd, candidate_list, num_candidates, results);
+
+		if (pass == 0)
+			first_pass_decodes = sd.n_decodes;
+		if (!sd.n_pass_new || pass + 1 == kMax_passes)
+			break;
+		// assume that subtracting and the next pass take as long as this one
+		if (ftx_elapsed_ns(&deadline) + ftx_elapsed_ns(&pass_start) > 0)
+			break;
+		if (!is_main && atomic_load_explicit(&main_st->do_decode, memory_order_relaxed))
+			break;
+
+		for (int i = 0; i < sd.n_pass_new; ++i) {
+			const decoded_message_t *d = &decoded[pass_new[i]];
+			ftx_subtract(ftx_residual, num_samples, &d->message, wf->protocol, d->time_sec, d->freq_hz);
+		}
+		wf = &ftx_residual_waterfall(wf->protocol, num_samples)->wf;
+	}
+	if (passes > 1)
+		LOG(LOG_INFO, "FTx: %d decodes in the first pass, %d after %d passes, %ld ms\n",
+			first_pass_decodes, sd.n_decodes, passes, ftx_elapsed_ns(&slot_end) / 1000000);
+	LOG(LOG_DEBUG, "LDPC: %d passes on %d threads in %ld us\n",
+		passes, decode_threads, decode_ns / 1000);
+	if (sd.crc_mismatches)
+		LOG(LOG_DEBUG, "Decoded %d messages; %d CRC mismatches\n", sd.num_decoded, sd.crc_mismatches);
+	if (ap_tried)
+		LOG(LOG_DEBUG, "AP: %d hypotheses on %d candidates, %d decodes\n", ftx_ap_count, ap_tried, sd.ap_decodes);
+	if (sd.n_skipped)
+		LOG(LOG_INFO, "FTx: %d candidates (Hz/score) skipped at the %ld ms deadline:%s%s\n",
+			sd.n_skipped, (ftx_elapsed_ns(&slot_end) - ftx_elapsed_ns(&deadline)) / 1000000, sd.skipped, sd.skipped_len >= sizeof(sd.skipped) - 16 ? " ..." : "");
+
+	// remember where the CQs and new DXCCs were, to decode them first next time
+	if (is_main) {
+		ftx_heard_add(slot, 0, FTX_RANK_OTHER);
+		for (int i = 0; i < kMax_decoded_messages; ++i) {
+			const decoded_message_t *d = decoded_hashtable[i];
+			if (d && !strncmp(d->text, "CQ ", 3))
+				ftx_heard_add(slot, d->freq_hz, FTX_RANK_CQ);
+			else if (d && !d->entity_qsos)
+				ftx_heard_add(slot, d->freq_hz, FTX_RANK_NEW_DXCC);
+		}
+	}
+	if (sd.n_decodes)
+		LOG(LOG_DEBUG, "Logbook lookups: %d in %ld us, %.1f us per decode\n",
+			ftx_lookup_count, ftx_lookup_ns / 1000, ftx_lookup_ns / 1000.0 / sd.n_decodes);
 
 	// If we are in autorespond mode and in idle state (i.e. no message planned to transmit),
-	// try to answer the CQ message on the highest_priority_row in the console, if found.
-	if (highest_priority_row > 0 && highest_priority >= 0 && !strcmp(field_str("FTX_AUTO"), "CQRESP")) {
+	// try to answer the CQ message on the sd.highest_priority_row in the console, if found.
+	if (sd.highest_priority_row > 0 && sd.highest_priority >= 0 && !strcmp(field_str("FTX_AUTO"), "CQRESP")) {
 		// LOG(LOG_DEBUG, "considering auto-respond @ time %d: highest priority was %d from row %d; existing tx msg? %d\n",
-		// 	time_sec_i, highest_priority, highest_priority_row, ftx_tx_text[0]);
+		// 	time_sec_i, sd.highest_priority, sd.highest_priority_row, ftx_tx_text[0]);
 		if (ftx_tx_text[0]) {
 			LOG(LOG_DEBUG, "skipping auto-responder because of queued message '%s'\n", ftx_tx_text);
 		} else {
@@ -1012,11 +2041,11 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 			memset(cand_callsign, 0, sizeof(cand_callsign));
 			memset(cand_exch, 0, sizeof(cand_exch));
 
-			console_extract_semantic(highest_priority_row, STYLE_CALLER, cand_callsign, sizeof(cand_callsign));
-			console_extract_semantic(highest_priority_row, STYLE_FREQ, cand_exch, sizeof(cand_exch)); // not really: just use the same buffer
+			console_extract_semantic(sd.highest_priority_row, STYLE_CALLER, cand_callsign, sizeof(cand_callsign));
+			console_extract_semantic(sd.highest_priority_row, STYLE_FREQ, cand_exch, sizeof(cand_exch)); // not really: just use the same buffer
 			cand_pitch = atoi(cand_exch);
 			memset(cand_exch, 0, sizeof(cand_exch));
-			console_extract_semantic(highest_priority_row, STYLE_GRID, cand_exch, sizeof(cand_exch));
+			console_extract_semantic(sd.highest_priority_row, STYLE_GRID, cand_exch, sizeof(cand_exch));
 
 			field_set("CALL", cand_callsign);
 			field_set("EXCH", cand_exch);
@@ -1029,7 +2058,7 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 			set_field_int("ftx_rx_pitch", cand_pitch);
 			ft8_call(time_sec_i); // decide in which slot to transmit, etc.
 			LOG(LOG_INFO, "Auto-responding in %s slot to p%+d '%s' @ '%s' from t %d f %d '%s'\n",
-				ftx_tx1st ? "even" : "odd", highest_priority, cand_callsign,
+				ftx_tx1st ? "even" : "odd", sd.highest_priority, cand_callsign,
 				cand_exch, time_sec_i, cand_pitch, cand_text);
 			strcpy(ftx_already_called[ftx_already_called_n % FTX_CALLED_SIZE], cand_callsign);
 			ftx_already_called_n++;
@@ -1041,16 +2070,16 @@ static int sbitx_ft8_decode(float *signal, int num_samples)
 	// completely autonomous ft8 bot), according to the preferences of the user.
 	// If that gets done, we can add ROBOT to the list of modes for FTX_AUTO (see sbitx_gtk.c:1110)
 
-    monitor_free(&mon);
-    hashtable_cleanup(10);
+    if (is_main)
+        hashtable_cleanup(10);
 
     // Send status update after decode cycle
     // This keeps Gridtracker updated with current radio state
-    if (n_decodes > 0) {
+    if (sd.n_decodes > 0) {
         udp_broadcast_status_auto();
     }
 
-    return n_decodes;
+    return sd.n_decodes;
 }
 
 static bool encode_xota() {
@@ -1160,7 +2189,7 @@ static void ftx_start_tx(int offset_ms){
 	int freq = field_int("TX_PITCH");
 	if (freq != ftx_pitch)
 		ftx_pitch = freq;
-	ftx_tx_nsamples = sbitx_ftx_msg_audio(freq, ftx_tx_buffer);
+	ftx_tx_nsamples = sbitx_ftx_msg_tones(freq);
 
 	snprintf(hmst_wallclock_time_sprint(buf), sizeof(buf) - 8, "  TX     %4d %s\n",
 		ftx_pitch, ftx_xota ? ftx_xota_text : ftx_tx_text);
@@ -1182,7 +2211,7 @@ static void ftx_start_tx(int offset_ms){
 	// start at the beginning if at all reasonable
 	if (offset_ms < 1000)
 		offset_ms = 0;
-	ftx_tx_buff_index = offset_ms * 96;
+	ftx_tx_buff_index = offset_ms * (FTX_TX_RATE / 1000);
 	LOG(LOG_DEBUG, "%05d ftx_start_tx: starting @index %d based on offset_ms %d '%s'\n",
 		wallclock_day_ms % 60000, ftx_tx_buff_index, offset_ms, ftx_xota ? ftx_xota_text : ftx_tx_text);
 }
@@ -1258,58 +2287,237 @@ void ft8_tx_3f(const char* call_to, const char* call_de, const char* extra) {
 		message_type, message_type ? ' ' : '0' + ftx_message_get_n3(&ftx_tx_msg), ftx_repeat, call_to, call_de, extra);
 }
 
+// Start filling the buffer of \a st from the beginning again (on the audio thread).
+static void ftx_stream_restart(ftx_stream_t *st)
+{
+	atomic_store_explicit(&st->buff_index, 0, memory_order_relaxed);
+	atomic_fetch_add_explicit(&st->slot, 1, memory_order_release);
+	st->decode_asked = false;
+}
+
+// Start a new slot in \a st at the slot boundary, and ask for a decode near its end.
+static void ftx_stream_timing(ftx_stream_t *st)
+{
+	const int slot_time = wallclock_day_ms % ftx_slot_ms(st->protocol);
+	const int slot_time_decode = ftx_slot_decode_ms(st->protocol);
+	const int min_secs = st->protocol == FTX_PROTOCOL_FT4 ? 6000 : 12000;
+	const int buff_index = atomic_load_explicit(&st->buff_index, memory_order_relaxed);
+	//~ printf("time %d; slot %d; buff_index %d\n", wallclock_day_ms % 60000, slot_time, buff_index);
+
+	if (slot_time < 500 && buff_index)
+		ftx_stream_restart(st);
+
+	//we should have at least 6 or 12 seconds of samples to decode
+	if (buff_index >= 13 * min_secs && slot_time > slot_time_decode && !st->decode_asked) {
+		// the decode budget runs from the end of the slot by the wall clock,
+		// not from whenever the ftx thread gets to it
+		st->slot_end = ftx_timespec_add_ms(wallclock_mono, slot_time_decode - slot_time);
+		st->decode_asked = true;
+		atomic_store_explicit(&st->do_decode, true, memory_order_release);
+		//~ printf("ftx decoding trigger index %d, clock %d, slot_time %d\n", buff_index, wallclock_day_ms % 60000, slot_time);
+	}
+}
+
+// the skimmer channels that ftx_skim_configure() last parsed, applied by
+// ft8_skim_rx() when the generation changes
+static struct {
+	ftx_protocol_t protocol;
+	int bin;
+} ftx_skim_want[FTX_SKIM_CHANNELS];
+static int ftx_skim_want_n = 0;
+static atomic_uint ftx_skim_generation = 0;
+static unsigned int ftx_skim_applied = 0;
+
+/*!
+	Parse the FTX_SKIM setting: up to FTX_SKIM_CHANNELS skimmer channels,
+	separated by spaces or commas, each given as the offset in Hz from the
+	dial frequency, optionally followed by :FT4 (FT8 is the default).
+	For example "6000:FT4 -12000" decodes FT4 from 6 to 9 kHz above the dial,
+	and FT8 from 12 to 9 kHz below it.
+	The audio thread, which owns the streams, sets them up (ftx_skim_apply()).
+*/
+static void ftx_skim_configure()
+{
+	static char applied[128] = "";
+	const char *setting = field_str("FTX_SKIM");
+	if (!setting || !strcmp(setting, applied))
+		return;
+	strncpy(applied, setting, sizeof(applied) - 1);
+
+	const double bin_hz = 96000.0 / MAX_BINS;
+	char buf[sizeof(applied)];
+	strcpy(buf, applied);
+	int n = 0;
+	char *save = NULL;
+	for (char *tok = strtok_r(buf, " ,", &save); tok && n < FTX_SKIM_CHANNELS; tok = strtok_r(NULL, " ,", &save)) {
+		char *end;
+		long offset = strtol(tok, &end, 10);
+		// the channel has to fit in the 96 kHz spectrum
+		if (end == tok || offset < -45000 || offset > 42000) {
+			LOG(LOG_INFO, "FTX_SKIM: ignoring '%s'\n", tok);
+			continue;
+		}
+		ftx_skim_want[n].protocol = !strcasecmp(end, ":FT4") ? FTX_PROTOCOL_FT4 : FTX_PROTOCOL_FT8;
+		ftx_skim_want[n++].bin = lround(offset / bin_hz);
+	}
+	ftx_skim_want_n = n;
+	atomic_fetch_add_explicit(&ftx_skim_generation, 1, memory_order_release);
+	LOG(LOG_INFO, "FTx skimmer: %d channels\n", n);
+}
+
+// Set the skimmer streams up as ftx_skim_configure() last parsed; on the audio thread
+static void ftx_skim_apply()
+{
+	const double bin_hz = 96000.0 / MAX_BINS;
+
+	ftx_skim_applied = atomic_load_explicit(&ftx_skim_generation, memory_order_acquire);
+	const int n = ftx_skim_want_n;
+	for (int i = 0; i < FTX_SKIM_CHANNELS; i++) {
+		ftx_stream_t *st = &ftx_streams[FTX_AUDIO_STREAMS + i];
+		st->active = false;
+		if (i >= n)
+			continue;
+		st->protocol = ftx_skim_want[i].protocol;
+		st->bin = ftx_skim_want[i].bin;
+		st->offset_hz = lround(st->bin * bin_hz);
+		st->blocks = 0;
+		atomic_store_explicit(&st->do_decode, false, memory_order_relaxed);
+		ftx_stream_restart(st);
+		st->active = true;
+	}
+}
+
 void *ftx_thread_function(void *ptr){
-	//wake up every 100 msec to see if there is anything to decode
+	int ticks = 0;
+	bool due[FTX_STREAMS];
+
+	//wake up every msec to extend the waterfalls, and see if there is anything to decode
 	while(1){
 		usleep(1000);
 
-		if (!ftx_do_decode)
-			continue;
+		if (++ticks >= 1000) {
+			ticks = 0;
+			ftx_skim_configure();
+			ftx_both = !strcmp(field_str("FTX_BOTH"), "ON");
+		}
 
-		ftx_do_decode = 0;
-		if (ftx_rx_buff_index)
-			sbitx_ft8_decode(ftx_rx_buffer, ftx_rx_buff_index);
-		//let the next batch begin
-		ftx_rx_buff_index = 0;
+		for (int i = 0; i < FTX_STREAMS; i++) {
+			ftx_stream_t *st = &ftx_streams[i];
+			due[i] = false;
+			if (!st->active)
+				continue;
+			ftx_monitor_feed(st);
+			// slot_end was set before do_decode
+			if (atomic_exchange_explicit(&st->do_decode, false, memory_order_acquire))
+				due[i] = true;
+		}
+
+		// the main receiver first: it is the one that gets answered
+		const int main_i = atomic_load_explicit(&ftx_main, memory_order_acquire);
+		for (int n = 0; n < FTX_STREAMS; n++) {
+			int i = n ? (n <= main_i ? n - 1 : n) : main_i;
+			if (!due[i])
+				continue;
+			if (ftx_streams[i].mon_fed)
+				sbitx_ft8_decode(&ftx_streams[i]);
+			// the audio thread starts the next batch at the slot boundary
+		}
 	}
 }
 
 // the ft8 sampling is at 12000, the incoming samples are at
-// 96000 samples/sec
-void ft8_rx(int32_t *samples, int count) {
+// 96000 samples/sec; \a mode is MODE_FT8 or MODE_FT4
+void ft8_rx(int mode, int32_t *samples, int count) {
+
+	const int decimation_ratio = 96000/12000;
+	const int n = count / decimation_ratio;
+	float decimated[n];
+
+	ftx_stream_t *st_main = &ftx_streams[mode == MODE_FT4 ? FTX_STREAM_FT4 : FTX_STREAM_FT8];
+	ftx_stream_t *st_other = &ftx_streams[mode == MODE_FT4 ? FTX_STREAM_FT8 : FTX_STREAM_FT4];
+	if (!st_main->active)
+		ftx_stream_restart(st_main);
+	st_main->active = true;
+	if (ftx_both && !st_other->active)
+		ftx_stream_restart(st_other);
+	st_other->active = ftx_both;
+	atomic_store_explicit(&ftx_main, st_main - ftx_streams, memory_order_release);
 
-	bool is_ft4 = !strcmp(field_str("MODE"), "FT4");
-	int decimation_ratio = 96000/12000;
+	//down convert to 12000 Hz sampling rate
+	for (int i = 0; i < n; i++)
+		decimated[i] = samples[i * decimation_ratio] / 200000000.0f;
 
-	//if there is an overflow, then reset to the begining
-	if (ftx_rx_buff_index + (count/decimation_ratio) >= FT8_MAX_BUFF){
-		ftx_rx_buff_index = 0;
-		printf("Buffer Overflow\n");
+	ftx_update_clock();
+	for (int i = 0; i < FTX_AUDIO_STREAMS; i++) {
+		ftx_stream_t *st = &ftx_streams[i];
+		if (!st->active)
+			continue;
+		//if there is an overflow, then reset to the begining
+		if (atomic_load_explicit(&st->buff_index, memory_order_relaxed) + n >= FT8_MAX_BUFF){
+			ftx_stream_restart(st);
+			printf("Buffer Overflow\n");
+		}
+		const int buff_index = atomic_load_explicit(&st->buff_index, memory_order_relaxed);
+		memcpy(st->buffer + buff_index, decimated, n * sizeof(decimated[0]));
+		atomic_store_explicit(&st->buff_index, buff_index + n, memory_order_release);
+		ftx_stream_timing(st);
 	}
+}
 
-	//down convert to 12000 Hz sampling rate
-	for (int i = 0; i < count; i += decimation_ratio)
-		ftx_rx_buffer[ftx_rx_buff_index++] = samples[i] / 200000000.0f;
+// the channel filter: 100 Hz to 3 kHz, so only the bins up to 3.5 kHz matter
+#define FTX_SKIM_BINS 75
+static struct filter *ftx_skim_filter;
 
-	ftx_update_clock();
+/*!
+	Feed the skimmer channels from \a fft_out, the spectrum of the last
+	MAX_BINS IQ samples at 96 kHz, half of them new (see rx_linear()).
+	Each channel takes the bins from its offset up, which shifts them down
+	to 0 Hz, and transforms them back at 12 kHz: the second half of that
+	is the new audio, as in the overlap-save filter of the main receiver.
+*/
+void ft8_skim_rx(fftw_complex *fft_out)
+{
+	const int n_new = FTX_SKIM_NFFT / 2;
+	bool clock_updated = false;
 
-	int slot_time = wallclock_day_ms % 15000;
-	int min_secs = 12000;
-	int slot_time_decode = 13000;
-	if (is_ft4) {
-		slot_time = wallclock_day_ms % 7500;
-		min_secs = 6000;
-		slot_time_decode = 13000 / 2;
-	}
-	//~ printf("time %d; slot %d; ftx_rx_buff_index %d\n", wallclock_day_ms % 60000, slot_time, ftx_rx_buff_index);
+	if (ftx_skim_applied != atomic_load_explicit(&ftx_skim_generation, memory_order_acquire))
+		ftx_skim_apply();
+
+	for (int c = FTX_AUDIO_STREAMS; c < FTX_STREAMS; c++) {
+		ftx_stream_t *st = &ftx_streams[c];
+		if (!st->active)
+			continue;
 
-	if (slot_time < 500)
-		ftx_rx_buff_index = 0;
+		memset(st->fft_freq, 0, FTX_SKIM_NFFT * sizeof(st->fft_freq[0]));
+		for (int k = 0; k < FTX_SKIM_BINS; k++) {
+			int b = st->bin + k;
+			if (b < 0)
+				b += MAX_BINS;
+			else if (b >= MAX_BINS)
+				b -= MAX_BINS;
+			st->fft_freq[k] = fft_out[b] * ftx_skim_filter->fir_coeff[k];
+		}
+		fftw_execute(st->plan_rev);
 
-	//we should have at least 6 or 12 seconds of samples to decode
-	if (ftx_rx_buff_index >= 13 * min_secs && slot_time > slot_time_decode) {
-		ftx_do_decode = 1;
-		//~ printf("ft8_rx decoding trigger index %d, clock %d, slot_time %d\n", ftx_rx_buff_index, wallclock_day_ms % 60000, slot_time);
+		// shifting by an odd number of bins flips the sign of every other block
+		const double sign = (st->bin & 1) && (st->blocks & 1) ? -1 : 1;
+		st->blocks++;
+
+		if (atomic_load_explicit(&st->buff_index, memory_order_relaxed) + n_new >= FT8_MAX_BUFF) {
+			ftx_stream_restart(st);
+			printf("Buffer Overflow\n");
+		}
+		// about the same scale as the main receiver's audio, before its AGC
+		const int buff_index = atomic_load_explicit(&st->buff_index, memory_order_relaxed);
+		for (int i = 0; i < n_new; i++)
+			st->buffer[buff_index + i] = sign * creal(st->fft_time[n_new + i]) * 0.05;
+		atomic_store_explicit(&st->buff_index, buff_index + n_new, memory_order_release);
+
+		if (!clock_updated) {
+			ftx_update_clock();
+			clock_updated = true;
+		}
+		ftx_stream_timing(st);
 	}
 }
 
@@ -1352,15 +2560,65 @@ void ft8_poll(int tx_is_on){
 	}
 }
 
-float ft8_next_sample(){
-	float sample = 0;
-	if (ftx_tx_buff_index/8 < ftx_tx_nsamples){
-		sample = ftx_tx_buffer[ftx_tx_buff_index/8]/7;
-		ftx_tx_buff_index++;
+/*!
+	The next \a count samples of the transmission at FTX_TX_RATE, made
+	straight from the tones rather than through the SSB filter:
+	\a if_signal gets the tone moved up to \a if_freq and \a audio the
+	tone itself, for the sidetone, both peaking at 1/7.
+	The frequency follows the tones through gfsk_pulse() as in gfsk_phase(),
+	on a phase that runs on from block to block, and the first and last
+	symbols are ramped in and out.
+*/
+void ft8_next_if_block(float *if_signal, float *audio, int count, double if_freq)
+{
+	const int n_spsym = ftx_tx.n_spsym;
+	const int n_wave = ftx_tx.n_sym * n_spsym;
+	const int n_ramp = n_spsym / 8;
+	const double dphi_if = 2 * M_PI * if_freq / FTX_TX_RATE;
+
+	for (int i = 0; i < count; i++) {
+		int k = ftx_tx_buff_index - ftx_tx.n_silence; // into the tones
+		if (ftx_tx_buff_index < ftx_tx_nsamples)
+			ftx_tx_buff_index++;
+		else { //stop transmitting ft8
+			ftx_tx_nsamples = 0;
+			k = -1;
+		}
+		if (k < 0 || k >= n_wave) {
+			if_signal[i] = audio[i] = 0;
+			continue;
+		}
+
+		// this symbol's pulse and the tails of those either side, the first
+		// and last symbols standing in for those beyond the ends
+		int s = k / n_spsym;
+		int j = k - s * n_spsym;
+		float dphi = ftx_tx.dphi_f0;
+		for (int d = -1; d <= 1; d++) {
+			int t = s + d;
+			if (t < 0)
+				t = 0;
+			else if (t >= ftx_tx.n_sym)
+				t = ftx_tx.n_sym - 1;
+			dphi += ftx_tx.dphi_peak * ftx_tx.tones[t] * ftx_tx.pulse[j + n_spsym * (1 - d)];
+		}
+
+		float env = 1;
+		if (k < n_ramp)
+			env = (1 - cosf(M_PI * k / n_ramp)) / 2;
+		else if (k >= n_wave - n_ramp)
+			env = (1 - cosf(M_PI * (n_wave - 1 - k) / n_ramp)) / 2;
+
+		audio[i] = env * sinf(ftx_tx.phase) / 7;
+		if_signal[i] = env * cosf(ftx_tx.phase + ftx_tx.if_phase) / 7;
+
+		ftx_tx.phase += dphi;
+		if (ftx_tx.phase > M_PI)
+			ftx_tx.phase -= 2 * M_PI;
+		ftx_tx.if_phase += dphi_if;
+		if (ftx_tx.if_phase > M_PI)
+			ftx_tx.if_phase -= 2 * M_PI;
 	}
-	else //stop transmitting ft8
-		ftx_tx_nsamples = 0;
-	return sample;
 }
 
 /*!
@@ -1603,13 +2861,26 @@ void ftx_call_or_continue(const char* line, int line_len, const text_span_semant
 }
 
 void ft8_init(){
-	ftx_rx_buff_index = 0;
 	ftx_tx_buff_index = 0;
 	ftx_tx_nsamples = 0;
 	hashtable_init();
+
+	memset(ftx_streams, 0, sizeof(ftx_streams));
+	ftx_streams[FTX_STREAM_FT8].protocol = FTX_PROTOCOL_FT8;
+	ftx_streams[FTX_STREAM_FT4].protocol = FTX_PROTOCOL_FT4;
+	ftx_streams[FTX_STREAM_FT8].active = true;
+	atomic_store_explicit(&ftx_main, FTX_STREAM_FT8, memory_order_release);
+	for (int c = FTX_AUDIO_STREAMS; c < FTX_STREAMS; c++) {
+		ftx_stream_t *st = &ftx_streams[c];
+		st->fft_freq = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * FTX_SKIM_NFFT);
+		st->fft_time = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * FTX_SKIM_NFFT);
+		st->plan_rev = fftw_plan_dft_1d(FTX_SKIM_NFFT, st->fft_freq, st->fft_time, FFTW_BACKWARD, FFTW_ESTIMATE);
+	}
+	// the same overlap-save filter as the main receiver's (see sbitx.c)
+	ftx_skim_filter = filter_new(1024, 1025);
+	filter_tune(ftx_skim_filter, 100.0 / 96000.0, 3000.0 / 96000.0, 5);
+
 	pthread_create( &ftx_thread, NULL, ftx_thread_function, (void*)NULL);
-	memset(ftx_rx_buffer, 0, sizeof(ftx_rx_buffer));
-	memset(ftx_tx_buffer, 0, sizeof(ftx_tx_buffer));
 	memset(ftx_tx_text, 0, sizeof(ftx_tx_text));
 	memset(ftx_xota_text, 0, sizeof(ftx_xota_text));
 }
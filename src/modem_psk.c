@@ -0,0 +1,762 @@
+// standard library includes
+#include <complex.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+// third-party library includes
+#include <fftw3.h>
+
+// project-specific includes
+#include "sdr.h"
+#include "sdr_ui.h"
+#include "modem_bank.h"
+#include "modem_psk.h"
+
+// BPSK31 and BPSK63, without fldigi
+//
+// Receive: the audio from modem_rx() is decimated from 96 kHz to 8 kHz once,
+// and shared by a bank of channels (see modem_bank.c). Each channel mixes its signal down to
+// 0 Hz, filters and decimates it to 500 Hz, and applies the matched filter,
+// the raised cosine pulse that PSK31 is shaped with. A second order Costas
+// loop run once a symbol keeps the channel on the carrier (the AFC), the
+// symbol clock follows the peaks of the envelope, and each bit is the phase
+// of a symbol against the one before it: a reversal is a 0.
+// A channel finder looks at the spectrum of the 8 kHz audio every 64 ms.
+// Channel 0 sits at the pitch and is pulled onto a signal near it; its text
+// goes to the console as it comes. With PSK_SKIM on, the finder puts the
+// other channels on every signal it sees, and their text goes to the
+// console a line at a time, with the frequency.
+//
+// Transmit: the varicode of each character, then "00", as a carrier at the
+// pitch whose phase is reversed for each 0; a reversal is shaped by a cosine
+// over one symbol, so the spectrum is that of raised cosine pulses.
+
+#define PSK_RATE 96000            // modem_next_sample()
+#define PSK_FS BANK_FS
+#define PSK_CHANNEL_DECIMATION 16 // 8 kHz to the 500 Hz a channel demodulates at
+#define PSK_CHANNEL_FS 500
+#define PSK_CHANNEL_TAPS 128
+#define PSK_MAX_SPS 16            // channel samples per symbol, at 31.25 baud
+#define PSK_MF_TAPS (2 * PSK_MAX_SPS - 1)
+#define PSK_CHANNELS 16           // channel 0 is the one at the pitch
+#define PSK_LOOP_KP 0.2f          // Costas loop, per symbol
+#define PSK_LOOP_KI 0.01f
+#define PSK_FLL_GAIN 0.1f         // pulls a channel in until it has the signal
+#define PSK_AFC_HZ 40.0f          // how far channel 0 follows a signal from the pitch
+#define PSK_SYNC_ALPHA 0.1f
+#define PSK_CLOCK_GAIN 0.05f
+#define PSK_DCD_ALPHA 0.05f
+#define PSK_DCD_ON 0.5f           // average cos(2 * phase change) to start printing
+#define PSK_DCD_OFF 0.25f
+#define PSK_FADE 0.05f            // a symbol this far below the average is no signal...
+#define PSK_FADE_SYMBOLS 3        // ...and this many of them end the text at once
+#define PSK_FIND_LO_HZ 200
+#define PSK_FIND_HI_HZ 3000
+#define PSK_FIND_SNR_DB 8.0f      // in the band of one signal
+#define PSK_FIND_PEAKS 32
+#define PSK_SKIM_MISSES 40        // finder passes (64 ms) a skimmer channel can go without its signal
+#define PSK_TX_QUEUE 64
+#define PSK_TX_AHEAD 4            // characters queued for the modulator
+#define PSK_TX_MAX_SPS (PSK_RATE * 4 / 125)  // 3072 at 31.25 baud
+#define PSK_PREAMBLE 32           // symbols of reversals before the text
+#define PSK_POSTAMBLE 32          // symbols of carrier after it
+
+// structs
+struct psk_channel {
+  bool active;
+  float freq;                     // Hz, the carrier as the loop has it
+  float home;                     // Hz, where the loop is held around
+  float complex lo, lo_step;      // mixer phasor, and its step per 8 kHz sample
+  float complex hist[2 * PSK_CHANNEL_TAPS];  // mixed samples, each stored twice
+  int hist_pos;
+  int dec_count;
+  float complex mf[2 * PSK_MF_TAPS];         // 500 Hz samples, each stored twice
+  int mf_pos;
+  float complex last;             // matched filter output at the previous sample
+  float clk;                      // position in the symbol, in 500 Hz samples
+  bool sampled;                   // this symbol has been taken
+  float sync[PSK_MAX_SPS];        // envelope at each position in the symbol
+  float complex prev;             // the previous symbol
+  float quality;                  // average cos(2 * phase change): 1 clean, 0 noise
+  float level;                    // average power of the symbols
+  int fade;                       // symbols in a row far below that
+  bool dcd;
+  unsigned int shreg;             // bits since the last "00"
+  float snr;                      // dB, from the finder
+  int missed;                     // finder passes without a signal here
+  struct bank_line line;
+};
+
+struct psk_peak {
+  float freq;
+  float snr;
+  bool used;
+};
+
+enum {
+  PSK_TX_OFF = 0,
+  PSK_TX_PREAMBLE,
+  PSK_TX_DATA,
+  PSK_TX_POSTAMBLE,
+  PSK_TX_RAMPDOWN,
+  PSK_TX_ENDING,
+  PSK_TX_END
+};
+
+// function prototypes (ordered to match definitions)
+static void psk_set_baud(int baud);
+void        psk_init();
+static void psk_channel_start(struct psk_channel *ch, float freq, float home);
+static void psk_channel_stop(struct psk_channel *ch);
+static void psk_symbol(struct psk_channel *ch, int index, float complex z);
+static void psk_channel_sample(struct psk_channel *ch, int index, float complex y);
+static void psk_channel_rx(struct psk_channel *ch, int index, const float *audio, int n);
+static int  psk_compare(const void *a, const void *b);
+static int  psk_find_peaks(struct psk_peak *peaks);
+static void psk_find(void);
+static void psk_configure(void);
+static int  psk_channels_rx(const float *audio, int n);
+void        psk_rx(int32_t *samples, int count);
+static int  psk_tx_next_symbol(void);
+float       psk_tx_get_sample();
+static void psk_tx_start(void);
+static void psk_tx_queue(char c);
+static void psk_poll_settings(void);
+void        psk_poll(int bytes_available, int tx_is_on);
+void        psk_abort();
+int         psk_report(char *report, int len);
+
+// the varicode of G3PLX, indexed by ASCII
+static const char *psk_varicode[128] = {
+  "1010101011", "1011011011", "1011101101", "1101110111", "1011101011", "1101011111", "1011101111", "1011111101",
+  "1011111111", "11101111",   "11101",      "1101101111", "1011011101", "11111",      "1101110101", "1110101011",
+  "1011110111", "1011110101", "1110101101", "1110101111", "1101011011", "1101101011", "1101101101", "1101010111",
+  "1101111011", "1101111101", "1110110111", "1101010101", "1101011101", "1110111011", "1011111011", "1101111111",
+  "1",          "111111111",  "101011111",  "111110101",  "111011011",  "1011010101", "1010111011", "101111111",
+  "11111011",   "11110111",   "101101111",  "111011111",  "1110101",    "110101",     "1010111",    "110101111",
+  "10110111",   "10111101",   "11101101",   "11111111",   "101110111",  "101011011",  "101101011",  "110101101",
+  "110101011",  "110110111",  "11110101",   "110111101",  "111101101",  "1010101",    "111010111",  "1010101111",
+  "1010111101", "1111101",    "11101011",   "10101101",   "10110101",   "1110111",    "11011011",   "11111101",
+  "101010101",  "1111111",    "111111101",  "101111101",  "11010111",   "10111011",   "11011101",   "10101011",
+  "11010101",   "111011101",  "10101111",   "1101111",    "1101101",    "101010111",  "110110101",  "101011101",
+  "101110101",  "101111011",  "1010101101", "111110111",  "111101111",  "111111011",  "1010111111", "101101101",
+  "1011011111", "1011",       "1011111",    "101111",     "101101",     "11",         "111101",     "1011011",
+  "101011",     "1101",       "111101011",  "10111111",   "11011",      "111011",     "1111",       "111",
+  "111111",     "110111111",  "10101",      "10111",      "101",        "110111",     "1111011",    "1101011",
+  "11011111",   "1011101",    "111010101",  "1010110111", "110111011",  "1010110101", "1011010111", "1110110101"
+};
+
+// a received code (with its leading 1) to its character, or -1
+static short psk_varicode_rx[1024];
+
+// the receive chain, set up by psk_set_baud()
+static int psk_baud = 0;              // 31 or 63
+static float psk_baud_hz = 31.25f;
+static int psk_sps = PSK_MAX_SPS;     // 500 Hz samples per symbol
+static float psk_channel_taps[PSK_CHANNEL_TAPS];
+static float psk_mf_taps[PSK_MF_TAPS];
+static int psk_mf_len = PSK_MF_TAPS;
+static struct psk_channel psk_channels[PSK_CHANNELS];
+
+// the front end and the channel finder
+static struct modem_bank psk_bank = {
+  .name = "PSK",
+  .configure = psk_configure,
+  .find = psk_find,
+  .channels_rx = psk_channels_rx,
+  .generation = 1
+};
+
+// set by psk_poll_settings(), applied by psk_configure() on the audio thread
+static int psk_want_baud = 31;
+static bool psk_want_skim = false;
+static int psk_want_pitch = 1000;
+static bool psk_skim_on = false;
+static int psk_pitch = 0;
+
+// the modulator: psk_poll() queues characters and starts and ends the
+// transmission, the audio thread does the rest in psk_tx_get_sample()
+static char psk_tx_chars[PSK_TX_QUEUE];
+static atomic_int psk_tx_wr = 0, psk_tx_rd = 0;
+static atomic_int psk_tx_state = PSK_TX_OFF;
+static atomic_bool psk_tx_end = false;     // "^r": back to receive once the text is sent
+static atomic_bool psk_tx_stop = false;    // psk_abort(): stop at the next symbol
+static float psk_tx_shape[PSK_TX_MAX_SPS]; // (1 + cos(pi t / T)) / 2
+static int psk_tx_sps = PSK_TX_MAX_SPS;
+static int psk_tx_pos = 0;
+static int psk_tx_count = 0;
+static float psk_tx_a_prev = 0.0f, psk_tx_a_cur = 0.0f;
+static char psk_tx_code[16];
+static int psk_tx_code_pos = 0;
+static double psk_tx_phase = 0.0, psk_tx_step = 0.0;
+static bool psk_tx_caret = false;
+
+////////////////////////////////////////////////////////////////////////
+// Setup
+////////////////////////////////////////////////////////////////////////
+
+// set up the channel filters for 31 or 63 baud, and stop all the channels
+// inputs:  int baud
+// returns: void
+static void psk_set_baud(int baud) {
+  psk_baud = (baud == 63) ? 63 : 31;
+  psk_baud_hz = (psk_baud == 63) ? 62.5f : 31.25f;
+  psk_sps = (int)(PSK_CHANNEL_FS / psk_baud_hz + 0.5f);
+  bank_lowpass(psk_channel_taps, PSK_CHANNEL_TAPS, 3.2f * psk_baud_hz / PSK_FS);
+
+  // the matched filter is the raised cosine pulse, two symbols long
+  float sum = 0.0f;
+  psk_mf_len = 2 * psk_sps - 1;
+  for (int i = 0; i < psk_mf_len; i++) {
+    psk_mf_taps[i] = 0.5f + 0.5f * cosf(M_PI * (i - (psk_sps - 1)) / psk_sps);
+    sum += psk_mf_taps[i];
+  }
+  for (int i = 0; i < psk_mf_len; i++)
+    psk_mf_taps[i] /= sum;
+
+  for (int c = 0; c < PSK_CHANNELS; c++)
+    psk_channel_stop(&psk_channels[c]);
+}
+
+// called by modem_init() in modems.c
+// inputs: none
+// returns: void
+void psk_init() {
+  memset(psk_varicode_rx, 0xff, sizeof(psk_varicode_rx));
+  for (int c = 0; c < 128; c++) {
+    unsigned int code = 0;
+    for (const char *b = psk_varicode[c]; *b; b++)
+      code = (code << 1) | (*b == '1');
+    psk_varicode_rx[code] = c;
+  }
+
+  bank_init(&psk_bank);
+
+  for (int i = 0; i < PSK_TX_MAX_SPS; i++)
+    psk_tx_shape[i] = 0.5f + 0.5f * cosf(M_PI * i / PSK_TX_MAX_SPS);
+
+  psk_set_baud(31);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Receive
+////////////////////////////////////////////////////////////////////////
+
+// (re)start a channel on a carrier at freq Hz, held around home Hz
+// inputs:  struct psk_channel *ch, float freq, float home
+// returns: void
+static void psk_channel_start(struct psk_channel *ch, float freq, float home) {
+  bank_skim_line(&psk_bank, &ch->line, ch->freq);
+  memset(ch, 0, sizeof(*ch));
+  ch->active = true;
+  ch->freq = freq;
+  ch->home = home;
+  ch->lo = 1.0f;
+  ch->lo_step = cexpf(-I * 2.0f * M_PI * freq / PSK_FS);
+  ch->prev = 1.0f;
+}
+
+static void psk_channel_stop(struct psk_channel *ch) {
+  bank_skim_line(&psk_bank, &ch->line, ch->freq);
+  ch->active = false;
+}
+
+// one symbol: track the carrier, check the signal and decode the bit
+// inputs:  struct psk_channel *ch, int index, float complex z
+// returns: void
+static void psk_symbol(struct psk_channel *ch, int index, float complex z) {
+  if (crealf(z) == 0.0f && cimagf(z) == 0.0f)
+    return;
+
+  // the phase change from the last symbol, and how clean it is; the
+  // quality falls slowly in noise, so a carrier that stops ends it sooner
+  float complex d = z * conjf(ch->prev);
+  ch->prev = z;
+  float re = crealf(d), im = cimagf(d);
+  float q = (re * re - im * im) / (re * re + im * im);
+  ch->quality += (q - ch->quality) * PSK_DCD_ALPHA;
+  float power = crealf(z * conjf(z));
+  ch->fade = (power < PSK_FADE * ch->level) ? ch->fade + 1 : 0;
+  ch->level += (power - ch->level) * PSK_DCD_ALPHA;
+  if (ch->fade >= PSK_FADE_SYMBOLS)
+    ch->quality = 0.0f;
+  if (!ch->dcd && ch->quality > PSK_DCD_ON) {
+    ch->dcd = true;
+    ch->shreg = 0;
+  } else if (ch->dcd && ch->quality < PSK_DCD_OFF) {
+    ch->dcd = false;
+    bank_skim_line(&psk_bank, &ch->line, ch->freq);
+  }
+
+  // Costas loop: the phase error, taking the symbol as 0 or 180 degrees
+  float err = atan2f(cimagf(z), crealf(z));
+  if (err > M_PI / 2)
+    err -= M_PI;
+  else if (err < -M_PI / 2)
+    err += M_PI;
+  ch->lo *= cexpf(-I * PSK_LOOP_KP * err);
+  ch->lo /= cabsf(ch->lo);
+  float df = PSK_LOOP_KI * err;
+  // until then, the Costas loop may be too far off to pull in, so the phase
+  // change (squared, to take out the data) steers the frequency too
+  if (!ch->dcd)
+    df += PSK_FLL_GAIN * cargf(d * d) / 2;
+  float limit = (index == 0) ? PSK_AFC_HZ : psk_baud_hz;
+  ch->freq += df * psk_baud_hz / (2.0f * M_PI);
+  if (ch->freq > ch->home + limit)
+    ch->freq = ch->home + limit;
+  if (ch->freq < ch->home - limit)
+    ch->freq = ch->home - limit;
+  ch->lo_step = cexpf(-I * 2.0f * M_PI * ch->freq / PSK_FS);
+
+  // a reversal is a 0, and "00" ends a character
+  ch->shreg = ((ch->shreg << 1) | (re > 0.0f)) & 0xffff;
+  if ((ch->shreg & 3) == 0) {
+    unsigned int code = ch->shreg >> 2;
+    if (ch->dcd && code && code < 1024 && psk_varicode_rx[code] >= 0)
+      bank_rx_text(&psk_bank, &ch->line, index, psk_varicode_rx[code], ch->freq);
+    ch->shreg = 0;
+  }
+}
+
+// one 500 Hz sample of a channel: matched filter and symbol clock
+// inputs:  struct psk_channel *ch, int index, float complex y
+// returns: void
+static void psk_channel_sample(struct psk_channel *ch, int index, float complex y) {
+  float complex z = 0.0f;
+  ch->mf[ch->mf_pos] = ch->mf[ch->mf_pos + psk_mf_len] = y;
+  ch->mf_pos = (ch->mf_pos + 1) % psk_mf_len;
+  for (int i = 0; i < psk_mf_len; i++)
+    z += ch->mf[ch->mf_pos + i] * psk_mf_taps[i];
+
+  int pos = ((int)floorf(ch->clk) + psk_sps) % psk_sps;
+  ch->sync[pos] += (cabsf(z) - ch->sync[pos]) * PSK_SYNC_ALPHA;
+
+  // take the symbol at the middle of the clock, between this sample and the last
+  float middle = psk_sps / 2.0f;
+  if (!ch->sampled && ch->clk >= middle) {
+    float frac = ch->clk - middle;
+    psk_symbol(ch, index, z - frac * (z - ch->last));
+    ch->sampled = true;
+  }
+  ch->last = z;
+
+  ch->clk += 1.0f;
+  if (ch->clk >= psk_sps) {
+    ch->clk -= psk_sps;
+    ch->sampled = false;
+    // move the middle of the clock towards the peak of the envelope
+    float c = 0.0f, s = 0.0f;
+    for (int i = 0; i < psk_sps; i++) {
+      c += ch->sync[i] * cosf(2.0f * M_PI * i / psk_sps);
+      s += ch->sync[i] * sinf(2.0f * M_PI * i / psk_sps);
+    }
+    float err = remainderf(atan2f(s, c) * psk_sps / (2.0f * M_PI) - middle, psk_sps);
+    ch->clk -= err * PSK_CLOCK_GAIN;
+  }
+}
+
+// run a channel over a block of 8 kHz audio
+// inputs:  struct psk_channel *ch, int index, const float *audio, int n
+// returns: void
+static void psk_channel_rx(struct psk_channel *ch, int index, const float *audio, int n) {
+  for (int i = 0; i < n; i++) {
+    float complex z = audio[i] * ch->lo;
+    ch->lo *= ch->lo_step;
+    ch->hist[ch->hist_pos] = ch->hist[ch->hist_pos + PSK_CHANNEL_TAPS] = z;
+    ch->hist_pos = (ch->hist_pos + 1) % PSK_CHANNEL_TAPS;
+    if (++ch->dec_count < PSK_CHANNEL_DECIMATION)
+      continue;
+    ch->dec_count = 0;
+
+    const float complex *h = ch->hist + ch->hist_pos;
+    float complex y = 0.0f;
+    for (int t = 0; t < PSK_CHANNEL_TAPS; t++)
+      y += h[t] * psk_channel_taps[t];
+    psk_channel_sample(ch, index, y);
+  }
+  // the phasor picks up rounding errors
+  ch->lo /= cabsf(ch->lo);
+}
+
+static int psk_compare(const void *a, const void *b) {
+  float x = *(const float *)a, y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+// find the signals in the averaged spectrum
+// inputs:  struct psk_peak *peaks (PSK_FIND_PEAKS of them)
+// returns: int, the number found
+static int psk_find_peaks(struct psk_peak *peaks) {
+  const float bin_hz = (float)PSK_FS / BANK_FFT;
+  const int lo = PSK_FIND_LO_HZ / bin_hz, hi = PSK_FIND_HI_HZ / bin_hz;
+  const float *power = psk_bank.power;
+  float sorted[BANK_FFT / 2], band[BANK_FFT / 2];
+  int count = 0;
+
+  // the noise floor is taken low in the distribution of the bins
+  int n = hi - lo;
+  memcpy(sorted, power + lo, n * sizeof(float));
+  qsort(sorted, n, sizeof(float), psk_compare);
+  float floor = sorted[n * 3 / 10];
+  if (floor <= 0.0f)
+    return 0;
+
+  // the power in the band of one signal around each bin
+  int half = (int)(0.6f * psk_baud_hz / bin_hz + 0.5f);
+  for (int k = lo + half; k < hi - half; k++) {
+    band[k] = 0.0f;
+    for (int j = -half; j <= half; j++)
+      band[k] += power[k + j];
+  }
+
+  // a peak is the highest band within a signal's width each side, so
+  // only the bins whose neighbours all have a band sum can be one
+  int width = 2 * half + 1;
+  for (int k = lo + half + width; k < hi - half - width && count < PSK_FIND_PEAKS; k++) {
+    float snr = 10.0f * log10f(band[k] / (width * floor));
+    if (snr < PSK_FIND_SNR_DB)
+      continue;
+    bool peak = true;
+    for (int j = -width; j <= width && peak; j++)
+      if (band[k + j] > band[k] || (j < 0 && band[k + j] == band[k]))
+        peak = false;
+    if (!peak)
+      continue;
+
+    float sum = 0.0f, moment = 0.0f;
+    for (int j = -half; j <= half; j++) {
+      float p = power[k + j] - floor;
+      if (p > 0.0f) {
+        sum += p;
+        moment += p * (k + j);
+      }
+    }
+    peaks[count].freq = (sum > 0.0f ? moment / sum : k) * bin_hz;
+    peaks[count].snr = snr;
+    peaks[count].used = false;
+    count++;
+  }
+  return count;
+}
+
+// the channel finder: put the channels on the signals in the averaged
+// spectrum
+// inputs: none
+// returns: void
+static void psk_find(void) {
+  struct psk_peak peaks[PSK_FIND_PEAKS];
+
+  int n = psk_find_peaks(peaks);
+
+  // which channels still have their signal
+  for (int c = 0; c < PSK_CHANNELS; c++) {
+    struct psk_channel *ch = &psk_channels[c];
+    if (!ch->active)
+      continue;
+    int best = -1;
+    for (int p = 0; p < n; p++)
+      if (fabsf(peaks[p].freq - ch->freq) < psk_baud_hz / 2 && (best < 0 || peaks[p].snr > peaks[best].snr))
+        best = p;
+    if (best >= 0) {
+      ch->missed = 0;
+      ch->snr = peaks[best].snr;
+      peaks[best].used = true;
+    } else
+      ch->missed++;
+  }
+
+  // channel 0 is pulled onto the strongest signal near the pitch
+  struct psk_channel *ch0 = &psk_channels[0];
+  if (!ch0->dcd) {
+    int best = -1;
+    for (int p = 0; p < n; p++)
+      if (fabsf(peaks[p].freq - psk_pitch) <= PSK_AFC_HZ && (best < 0 || peaks[p].snr > peaks[best].snr))
+        best = p;
+    if (best >= 0 && fabsf(peaks[best].freq - ch0->freq) > 2.0f) {
+      psk_channel_start(ch0, peaks[best].freq, psk_pitch);
+      ch0->snr = peaks[best].snr;
+      peaks[best].used = true;
+    }
+  }
+  if (!psk_skim_on)
+    return;
+
+  // let go of the skimmer channels whose signal has gone, or that have
+  // ended up on the same signal as another channel
+  for (int c = 1; c < PSK_CHANNELS; c++) {
+    struct psk_channel *ch = &psk_channels[c];
+    if (!ch->active)
+      continue;
+    bool drop = (!ch->dcd && ch->missed > PSK_SKIM_MISSES) || ch->missed > 4 * PSK_SKIM_MISSES;
+    for (int o = 0; o < c && !drop; o++)
+      if (psk_channels[o].active && fabsf(psk_channels[o].freq - ch->freq) < psk_baud_hz / 2)
+        drop = true;
+    if (drop)
+      psk_channel_stop(ch);
+  }
+
+  // and put the free ones on the new signals
+  for (int p = 0; p < n; p++) {
+    if (peaks[p].used)
+      continue;
+    bool near = false;
+    for (int c = 0; c < PSK_CHANNELS && !near; c++)
+      if (psk_channels[c].active && fabsf(psk_channels[c].freq - peaks[p].freq) < 1.5f * psk_baud_hz)
+        near = true;
+    if (near)
+      continue;
+    for (int c = 1; c < PSK_CHANNELS; c++) {
+      if (!psk_channels[c].active) {
+        psk_channel_start(&psk_channels[c], peaks[p].freq, peaks[p].freq);
+        psk_channels[c].snr = peaks[p].snr;
+        break;
+      }
+    }
+  }
+}
+
+// apply what psk_poll_settings() last saw
+// inputs: none
+// returns: void
+static void psk_configure(void) {
+  if (psk_want_baud != psk_baud)
+    psk_set_baud(psk_want_baud);
+  psk_skim_on = psk_want_skim;
+  if (!psk_skim_on)
+    for (int c = 1; c < PSK_CHANNELS; c++)
+      psk_channel_stop(&psk_channels[c]);
+  if (psk_want_pitch != psk_pitch || !psk_channels[0].active) {
+    psk_pitch = psk_want_pitch;
+    psk_channel_start(&psk_channels[0], psk_pitch, psk_pitch);
+  }
+}
+
+// run the active channels over a block of 8 kHz audio
+// inputs:  const float *audio, int n
+// returns: int, the number of channels
+static int psk_channels_rx(const float *audio, int n) {
+  int active = 0;
+  for (int c = 0; c < PSK_CHANNELS; c++) {
+    if (psk_channels[c].active) {
+      psk_channel_rx(&psk_channels[c], c, audio, n);
+      active++;
+    }
+  }
+  return active;
+}
+
+// called by modem_rx() in modems.c with each block of received audio
+// inputs:  int32_t *samples, int count
+// returns: void
+void psk_rx(int32_t *samples, int count) {
+  bank_rx(&psk_bank, samples, count);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Transmit
+////////////////////////////////////////////////////////////////////////
+
+// the amplitude of the carrier at the next symbol: +1 or -1 (a reversal
+// from the last is a 0), or 0 to ramp down at the end
+// inputs: none
+// returns: int
+static int psk_tx_next_symbol(void) {
+  int bit = 0;
+  if (atomic_load(&psk_tx_stop)) {
+    atomic_store(&psk_tx_state, PSK_TX_ENDING);
+    return 0;
+  }
+  switch (atomic_load(&psk_tx_state)) {
+  case PSK_TX_PREAMBLE:
+    if (--psk_tx_count <= 0)
+      atomic_store(&psk_tx_state, PSK_TX_DATA);
+    break;
+  case PSK_TX_DATA:
+    if (!psk_tx_code[psk_tx_code_pos]) {
+      int rd = atomic_load(&psk_tx_rd);
+      if (rd != atomic_load(&psk_tx_wr)) {
+        unsigned char c = psk_tx_chars[rd] & 0x7f;
+        atomic_store(&psk_tx_rd, (rd + 1) % PSK_TX_QUEUE);
+        snprintf(psk_tx_code, sizeof(psk_tx_code), "%s00", psk_varicode[c]);
+        psk_tx_code_pos = 0;
+      } else if (atomic_load(&psk_tx_end)) {
+        atomic_store(&psk_tx_state, PSK_TX_POSTAMBLE);
+        psk_tx_count = PSK_POSTAMBLE;
+        bit = 1;
+        break;
+      } else
+        break; // idle: reversals
+    }
+    bit = psk_tx_code[psk_tx_code_pos++] == '1';
+    break;
+  case PSK_TX_POSTAMBLE:
+    bit = 1;
+    if (--psk_tx_count <= 0)
+      atomic_store(&psk_tx_state, PSK_TX_RAMPDOWN);
+    break;
+  default:
+    atomic_store(&psk_tx_state, PSK_TX_ENDING);
+    return 0;
+  }
+  if (psk_tx_a_cur == 0.0f)
+    return 1;
+  return bit ? psk_tx_a_cur : -psk_tx_a_cur;
+}
+
+// called by modem_next_sample() in modems.c, 96000 times a second
+// inputs: none
+// returns: float
+float psk_tx_get_sample() {
+  int state = atomic_load(&psk_tx_state);
+  if (state == PSK_TX_OFF || state == PSK_TX_END)
+    return 0.0f;
+
+  if (psk_tx_pos == 0) {
+    if (state == PSK_TX_ENDING) {
+      atomic_store(&psk_tx_state, PSK_TX_END);
+      return 0.0f;
+    }
+    psk_tx_a_prev = psk_tx_a_cur;
+    psk_tx_a_cur = psk_tx_next_symbol();
+  }
+
+  float w = psk_tx_shape[psk_tx_pos * (PSK_TX_MAX_SPS / psk_tx_sps)];
+  float amplitude = psk_tx_a_prev * w + psk_tx_a_cur * (1.0f - w);
+  if (++psk_tx_pos == psk_tx_sps)
+    psk_tx_pos = 0;
+
+  psk_tx_phase += psk_tx_step;
+  if (psk_tx_phase > 2 * M_PI)
+    psk_tx_phase -= 2 * M_PI;
+  return amplitude * sinf(psk_tx_phase) / 8;
+}
+
+// start a transmission at the pitch; the audio thread isn't in the
+// modulator while the state is off
+// inputs: none
+// returns: void
+static void psk_tx_start(void) {
+  psk_tx_sps = (psk_want_baud == 63) ? PSK_TX_MAX_SPS / 2 : PSK_TX_MAX_SPS;
+  psk_tx_step = 2 * M_PI * psk_want_pitch / PSK_RATE;
+  psk_tx_phase = 0.0;
+  psk_tx_pos = 0;
+  psk_tx_a_prev = psk_tx_a_cur = 0.0f;
+  psk_tx_code[0] = 0;
+  psk_tx_code_pos = 0;
+  psk_tx_count = PSK_PREAMBLE;
+  psk_tx_caret = false;
+  atomic_store(&psk_tx_rd, 0);
+  atomic_store(&psk_tx_wr, 0);
+  atomic_store(&psk_tx_end, false);
+  atomic_store(&psk_tx_stop, false);
+  atomic_store(&psk_tx_state, PSK_TX_PREAMBLE);
+}
+
+// hand a character to the modulator, and echo it
+// inputs:  char c
+// returns: void
+static void psk_tx_queue(char c) {
+  char s[2] = {c, 0};
+  int wr = atomic_load(&psk_tx_wr);
+  psk_tx_chars[wr] = c;
+  atomic_store(&psk_tx_wr, (wr + 1) % PSK_TX_QUEUE);
+  write_console(STYLE_FLDIGI_TX, s);
+}
+
+// pick up the baud rate, the skimmer setting and the pitch
+// inputs: none
+// returns: void
+static void psk_poll_settings(void) {
+  const char *skim = field_str("PSK_SKIM");
+  int baud = field_int("PSK") == 63 ? 63 : 31;
+  bool skim_on = skim && !strcasecmp(skim, "ON");
+  int pitch = get_pitch();
+  if (baud == psk_want_baud && skim_on == psk_want_skim && pitch == psk_want_pitch)
+    return;
+  psk_want_baud = baud;
+  psk_want_skim = skim_on;
+  psk_want_pitch = pitch;
+  bank_changed(&psk_bank);
+}
+
+// called by modem_poll() in modems.c: follows the settings, and feeds the
+// modulator while the transmitter is on. The operator (or a macro) turns
+// the transmitter on; a macro ends with "^r" to turn it off when its text
+// has been sent.
+// inputs:  int bytes_available, int tx_is_on
+// returns: void
+void psk_poll(int bytes_available, int tx_is_on) {
+  psk_poll_settings();
+
+  int state = atomic_load(&psk_tx_state);
+  if (!tx_is_on) {
+    if (state != PSK_TX_OFF)
+      atomic_store(&psk_tx_state, PSK_TX_OFF);
+    return;
+  }
+  if (state == PSK_TX_OFF)
+    psk_tx_start();
+  else if (state == PSK_TX_END) {
+    atomic_store(&psk_tx_state, PSK_TX_OFF);
+    write_console(STYLE_FLDIGI_TX, "\n");
+    tx_off();
+    return;
+  }
+
+  // keep a few characters ahead of the modulator
+  while (bytes_available > 0 && !atomic_load(&psk_tx_end)) {
+    int queued = (atomic_load(&psk_tx_wr) - atomic_load(&psk_tx_rd) + PSK_TX_QUEUE) % PSK_TX_QUEUE;
+    char c;
+    if (queued >= PSK_TX_AHEAD || !get_tx_data_byte(&c))
+      break;
+    bytes_available--;
+    if (psk_tx_caret) {
+      psk_tx_caret = false;
+      if (c == 'r' || c == 'R') {
+        atomic_store(&psk_tx_end, true);
+        break;
+      }
+      psk_tx_queue('^');
+    } else if (c == '^') {
+      psk_tx_caret = true;
+      continue;
+    }
+    psk_tx_queue(c);
+  }
+}
+
+// called by modem_abort() in modems.c: drop the text, and ramp the carrier
+// down at the next symbol
+// inputs: none
+// returns: void
+void psk_abort() {
+  atomic_store(&psk_tx_rd, atomic_load(&psk_tx_wr));
+  atomic_store(&psk_tx_stop, true);
+  psk_tx_caret = false;
+}
+
+// the baud rate, the channels and the CPU time spent on them
+// inputs:  char *report, int len
+// returns: int, the length of the report
+int psk_report(char *report, int len) {
+  int n = snprintf(report, len, "PSK%d at %d Hz, skimmer %s\n", psk_want_baud, psk_want_pitch,
+    psk_want_skim ? "on" : "off");
+  if (n < len)
+    n += bank_report(&psk_bank, report + n, len - n);
+  for (int c = 0; c < PSK_CHANNELS && n < len; c++) {
+    struct psk_channel *ch = &psk_channels[c];
+    if (!ch->active)
+      continue;
+    n += snprintf(report + n, len - n, "%2d %6.1f Hz %+4.0f dB quality %.2f%s\n",
+      c, ch->freq, ch->snr, ch->quality, ch->dcd ? " copying" : "");
+  }
+  return n < len ? n : len - 1;
+}
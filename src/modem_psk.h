@@ -0,0 +1,13 @@
+#ifndef MODEM_PSK_H
+#define MODEM_PSK_H
+
+void psk_init();
+void psk_rx(int32_t *samples, int count);
+float psk_tx_get_sample();
+void psk_poll(int bytes_available, int tx_is_on);
+void psk_abort();
+
+// the baud rate, channels and CPU time, for \psk
+int psk_report(char *report, int len);
+
+#endif /* MODEM_PSK_H */
@@ -0,0 +1,698 @@
+// standard library includes
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+// third-party library includes
+#include <fftw3.h>
+
+// project-specific includes
+#include "sdr.h"
+#include "sdr_ui.h"
+#include "modem_bank.h"
+#include "modem_rtty.h"
+
+// RTTY receive, without fldigi (fldigi still transmits it)
+//
+// The audio from modem_rx() is decimated from 96 kHz to 8 kHz once, and
+// shared by a bank of channels (see modem_bank.c). A channel has a mixer for each of its two
+// tones and a matched filter for each, which for FSK is the sum over one
+// bit; the decision is the difference of their powers over their sum, so
+// it doesn't depend on the signal level or on one tone fading. Each
+// channel runs two start/stop decoders on it, one for each polarity, and
+// prints from the one that gets more good stop bits. A decoder keeps the
+// decisions of the last character and times its bits from all of them,
+// not just the start bit's edge. Noise, and two tones of different
+// signals that happen to be a shift apart, are kept off the console by
+// how seldom the tones are both on at once.
+// A channel finder looks at the spectrum of the 8 kHz audio every 64 ms for
+// pairs of tones at one of the usual shifts. Channel 0 sits at the pitch and
+// is pulled onto a signal near it, taking its shift; its text goes to the
+// console as it comes. With RTTY_SKIM on, the finder puts the other channels
+// on every signal it sees, and their text goes to the console a line at a
+// time, with the frequency.
+
+#define RTTY_FS BANK_FS
+#define RTTY_MAX_BIT 177           // 8 kHz samples in a bit, at 45.45 baud
+#define RTTY_CHANNELS 16           // channel 0 is the one at the pitch
+#define RTTY_AFC_HZ 50.0f          // how far channel 0 follows a signal from the pitch
+#define RTTY_RETUNE_HZ 10.0f       // the matched filters take a signal this far off
+#define RTTY_QUALITY_ALPHA 0.25f   // per character
+#define RTTY_QUALITY_ON 0.8f       // average of good stop bits to start printing
+#define RTTY_QUALITY_OFF 0.6f
+#define RTTY_OVERLAP_ON 0.55f      // rtty_overlap() to start printing
+#define RTTY_OVERLAP_OFF 0.7f
+#define RTTY_OVERLAP_BITS 16       // averaged over
+#define RTTY_FADE 0.1f             // of the level while copying, for the signal to have gone
+#define RTTY_CONTRAST_ON 0.7f      // average |decision| at the bits, to start printing (noise is 0.5)
+#define RTTY_CONTRAST_OFF 0.6f
+#define RTTY_CONTRAST_ALPHA 0.1f   // per bit
+#define RTTY_HOLDOFF 0.4f          // bits after the middle of a stop bit before looking for a start
+#define RTTY_MIN_MARK 0.5f         // bits of mark, at least, before a start bit
+#define RTTY_HISTORY 2048          // decisions kept, more than a character at 45.45 baud
+#define RTTY_SEARCH 0.25f          // bits either side of the edge's timing to look at
+#define RTTY_POLARITY_MARGIN 0.15f
+#define RTTY_FIND_LO_HZ 200
+#define RTTY_FIND_HI_HZ 3000
+#define RTTY_FIND_SNR_DB 8.0f      // of a tone, in three bins
+#define RTTY_FIND_PEAK_BINS 6      // a tone is the highest of its neighbours this far, past its keying sidebands
+#define RTTY_FIND_BALANCE_DB 6.0f  // between the two tones of a signal
+#define RTTY_FIND_TONES 64
+#define RTTY_FIND_SIGNALS 32
+#define RTTY_SKIM_MISSES 40        // finder passes (64 ms) a skimmer channel can go without its signal
+
+// structs
+
+// one start/stop decoder
+struct rtty_uart {
+  int state;
+  unsigned int edge;               // when the start bit was seen, or the hunt for it begins
+  int marks;                       // samples of mark until now
+  float quality;                   // average of good stop bits
+  bool figs;
+};
+
+struct rtty_channel {
+  bool active;
+  float freq;                      // Hz, between the tones
+  int shift;                       // Hz, mark above space
+  float complex lo_mark, step_mark, lo_space, step_space;
+  float complex ring_mark[RTTY_MAX_BIT], ring_space[RTTY_MAX_BIT];
+  float complex sum_mark, sum_space;  // the matched filters: the last bit of each tone
+  int pos;
+  float history[RTTY_HISTORY];     // decisions, for rtty_uart_frame()
+  unsigned int now;                // samples so far
+  float contrast;                  // average |decision| at the bits
+  float power;                     // of both filters, over about a bit
+  float mark_avg, space_avg, both_avg; // for rtty_overlap()
+  float level;                     // power while copying
+  bool dcd;                        // copying: printing what is decoded
+  struct rtty_uart uart[2];        // mark above space, and reversed
+  int polarity;                    // the uart being printed from
+  float snr;                       // dB, from the finder
+  int missed;                      // finder passes without a signal here
+  struct bank_line line;
+};
+
+struct rtty_tone {
+  float freq;
+  float snr;
+  bool used;
+};
+
+struct rtty_signal {
+  float freq;
+  int shift;
+  float snr;
+  bool used;
+};
+
+enum {
+  RTTY_WAIT = 0,                   // for a mark, after a bad stop bit
+  RTTY_HUNT,                       // for the start bit
+  RTTY_START,                      // until the middle of the start bit
+  RTTY_FRAME                       // until the whole character is in the history
+};
+
+// function prototypes (ordered to match definitions)
+static void rtty_set_baud(int baud);
+void        rtty_init();
+static void rtty_channel_start(struct rtty_channel *ch, float freq, int shift);
+static void rtty_channel_stop(struct rtty_channel *ch);
+static float rtty_overlap(struct rtty_channel *ch);
+static void rtty_dcd(struct rtty_channel *ch);
+static int  rtty_baudot(struct rtty_uart *u, int code);
+static float rtty_decision(struct rtty_channel *ch, int polarity, unsigned int at);
+static void rtty_uart_frame(struct rtty_channel *ch, int index, int polarity);
+static void rtty_uart_sample(struct rtty_channel *ch, int index, int polarity);
+static void rtty_channel_rx(struct rtty_channel *ch, int index, const float *audio, int n);
+static int  rtty_compare(const void *a, const void *b);
+static int  rtty_find_tones(struct rtty_tone *tones);
+static int  rtty_find_signals(struct rtty_signal *signals);
+static void rtty_find(void);
+static void rtty_configure(void);
+static int  rtty_channels_rx(const float *audio, int n);
+void        rtty_rx(int32_t *samples, int count);
+void        rtty_poll();
+int         rtty_report(char *report, int len);
+
+// ITA2, with the US figures; 27 is FIGS and 31 is LTRS
+static const char rtty_letters[32] = {
+  0, 'E', '\n', 'A', ' ', 'S', 'I', 'U', '\r', 'D', 'R', 'J', 'N', 'F', 'C', 'K',
+  'T', 'Z', 'L', 'W', 'H', 'Y', 'P', 'Q', 'O', 'B', 'G', 0, 'M', 'X', 'V', 0
+};
+static const char rtty_figures[32] = {
+  0, '3', '\n', '-', ' ', '\a', '8', '7', '\r', '$', '4', '\'', ',', '!', ':', '(',
+  '5', '"', ')', '2', '#', '6', '0', '1', '9', '?', '&', 0, '.', '/', ';', 0
+};
+static const int rtty_shifts[] = {170, 200, 425, 850};
+#define RTTY_SHIFTS (int)(sizeof(rtty_shifts) / sizeof(rtty_shifts[0]))
+
+// the receive chain, set up by rtty_set_baud()
+static int rtty_baud = 0;            // 45, 50 or 75
+static float rtty_bit_len = 176.0f;  // 8 kHz samples in a bit
+static int rtty_filter_len = 176;
+static int rtty_bit_pos[7];          // from the start edge to the middle of each bit, to the stop bit
+static int rtty_holdoff;
+static int rtty_min_marks;
+static int rtty_search;
+static struct rtty_channel rtty_channels[RTTY_CHANNELS];
+
+// the front end and the channel finder
+static struct modem_bank rtty_bank = {
+  .name = "RTTY",
+  .configure = rtty_configure,
+  .find = rtty_find,
+  .channels_rx = rtty_channels_rx,
+  .generation = 1
+};
+
+// set by rtty_poll(), applied by rtty_configure() on the audio thread
+static int rtty_want_baud = 45;
+static int rtty_want_shift = 0;      // 0 to take it from the signal
+static bool rtty_want_skim = false;
+static int rtty_want_pitch = 1000;
+static int rtty_shift = 0;
+static bool rtty_skim_on = false;
+static int rtty_pitch = 0;
+
+////////////////////////////////////////////////////////////////////////
+// Setup
+////////////////////////////////////////////////////////////////////////
+
+// set the bit length for 45 (45.45), 50 or 75 baud, and stop all the channels
+// inputs:  int baud
+// returns: void
+static void rtty_set_baud(int baud) {
+  rtty_baud = (baud == 50 || baud == 75) ? baud : 45;
+  rtty_bit_len = RTTY_FS / (rtty_baud == 45 ? 45.45f : (float)rtty_baud);
+  rtty_filter_len = (int)(rtty_bit_len + 0.5f);
+  for (int k = 0; k <= 6; k++)
+    rtty_bit_pos[k] = (int)(rtty_bit_len * (k + 0.5f) + 0.5f);
+  rtty_holdoff = (int)(rtty_bit_len * RTTY_HOLDOFF + 0.5f);
+  rtty_min_marks = (int)(rtty_bit_len * RTTY_MIN_MARK);
+  rtty_search = (int)(rtty_bit_len * RTTY_SEARCH);
+  for (int c = 0; c < RTTY_CHANNELS; c++)
+    rtty_channel_stop(&rtty_channels[c]);
+}
+
+// called by modem_init() in modems.c
+// inputs: none
+// returns: void
+void rtty_init() {
+  bank_init(&rtty_bank);
+  rtty_set_baud(45);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Receive
+////////////////////////////////////////////////////////////////////////
+
+// (re)start a channel between tones shift Hz apart around freq Hz
+// inputs:  struct rtty_channel *ch, float freq, int shift
+// returns: void
+static void rtty_channel_start(struct rtty_channel *ch, float freq, int shift) {
+  bank_skim_line(&rtty_bank, &ch->line, ch->freq);
+  memset(ch, 0, sizeof(*ch));
+  ch->active = true;
+  ch->freq = freq;
+  ch->shift = shift;
+  ch->lo_mark = ch->lo_space = 1.0f;
+  ch->step_mark = cexpf(-I * 2.0f * M_PI * (freq + shift / 2.0f) / RTTY_FS);
+  ch->step_space = cexpf(-I * 2.0f * M_PI * (freq - shift / 2.0f) / RTTY_FS);
+  // neither polarity is known to be right or wrong yet
+  ch->uart[0].quality = ch->uart[1].quality = 0.5f;
+}
+
+static void rtty_channel_stop(struct rtty_channel *ch) {
+  bank_skim_line(&rtty_bank, &ch->line, ch->freq);
+  ch->active = false;
+}
+
+// how much the two tones are on together, from 0 for FSK to 1 for tones
+// or noise that have nothing to do with each other
+// inputs:  struct rtty_channel *ch
+// returns: float
+static float rtty_overlap(struct rtty_channel *ch) {
+  return ch->both_avg / (ch->mark_avg * ch->space_avg + 1e-30f);
+}
+
+// start or stop copying, with the framing and contrast of the polarity
+// being printed and the overlap of the tones
+// inputs:  struct rtty_channel *ch
+// returns: void
+static void rtty_dcd(struct rtty_channel *ch) {
+  float quality = ch->uart[ch->polarity].quality;
+  float overlap = rtty_overlap(ch);
+  if (!ch->dcd && quality > RTTY_QUALITY_ON && ch->contrast > RTTY_CONTRAST_ON &&
+      overlap < RTTY_OVERLAP_ON) {
+    ch->dcd = true;
+    ch->level = ch->power;
+  } else if (ch->dcd && (quality < RTTY_QUALITY_OFF || ch->contrast < RTTY_CONTRAST_OFF ||
+      overlap > RTTY_OVERLAP_OFF))
+    ch->dcd = false;
+}
+
+// a Baudot code to its character, following LTRS and FIGS; a space goes
+// back to letters (unshift on space)
+// inputs:  struct rtty_uart *u, int code
+// returns: int, the character, or 0 for none
+static int rtty_baudot(struct rtty_uart *u, int code) {
+  if (code == 27) {
+    u->figs = true;
+    return 0;
+  }
+  if (code == 31) {
+    u->figs = false;
+    return 0;
+  }
+  int c = u->figs ? rtty_figures[code] : rtty_letters[code];
+  if (c == ' ')
+    u->figs = false;
+  return c;
+}
+
+// a decision from the history, for a polarity: > 0 is mark, < 0 is space
+// inputs:  struct rtty_channel *ch, int polarity, unsigned int at (a sample count)
+// returns: float
+static float rtty_decision(struct rtty_channel *ch, int polarity, unsigned int at) {
+  float d = ch->history[at & (RTTY_HISTORY - 1)];
+  return polarity ? -d : d;
+}
+
+// a character from the history, timed from the start bit at u->edge
+// inputs:  struct rtty_channel *ch, int index, int polarity
+// returns: void
+static void rtty_uart_frame(struct rtty_channel *ch, int index, int polarity) {
+  struct rtty_uart *u = &ch->uart[polarity];
+  int best = 0;
+  float best_score = -1e9f;
+
+  // the edge alone is a poor clock when the signal is weak: take the time
+  // at which all the bits of the character are furthest from the
+  // threshold, which they are with the whole of each in the filter
+  for (int t = -rtty_search; t <= rtty_search; t++) {
+    float score = 0.0f;
+    for (int k = 0; k <= 6; k++) {
+      float d = rtty_decision(ch, polarity, u->edge + rtty_bit_pos[k] + t);
+      score += k == 0 ? -d : (k == 6 ? d : fabsf(d));
+    }
+    if (score > best_score) {
+      best_score = score;
+      best = t;
+    }
+  }
+
+  unsigned int at = u->edge + best;
+  int code = 0;
+  for (int k = 1; k <= 5; k++) {
+    float d = rtty_decision(ch, polarity, at + rtty_bit_pos[k]);
+    if (d > 0.0f)
+      code |= 1 << (k - 1);
+    if (polarity == ch->polarity)
+      ch->contrast += (fabsf(d) - ch->contrast) * RTTY_CONTRAST_ALPHA;
+  }
+
+  if (rtty_decision(ch, polarity, at + rtty_bit_pos[0]) < 0.0f &&
+      rtty_decision(ch, polarity, at + rtty_bit_pos[6]) > 0.0f) {
+    u->quality += (1.0f - u->quality) * RTTY_QUALITY_ALPHA;
+    int c = rtty_baudot(u, code);
+    if (polarity == ch->polarity)
+      rtty_dcd(ch);
+    if (c && polarity == ch->polarity && ch->dcd)
+      bank_rx_text(&rtty_bank, &ch->line, index, c, ch->freq);
+    // not in what is left of the stop bit
+    u->state = RTTY_HUNT;
+    u->edge = at + rtty_bit_pos[6] + rtty_holdoff;
+  } else {
+    u->quality -= u->quality * RTTY_QUALITY_ALPHA;
+    u->state = RTTY_WAIT;
+    if (polarity == ch->polarity)
+      rtty_dcd(ch);
+  }
+
+  // print from the polarity that frames better
+  struct rtty_uart *other = &ch->uart[1 - ch->polarity];
+  if (other->quality > ch->uart[ch->polarity].quality + RTTY_POLARITY_MARGIN) {
+    bank_skim_line(&rtty_bank, &ch->line, ch->freq);
+    ch->polarity = 1 - ch->polarity;
+  }
+}
+
+// the start/stop decoder for one polarity, at the latest decision
+// inputs:  struct rtty_channel *ch, int index, int polarity
+// returns: void
+static void rtty_uart_sample(struct rtty_channel *ch, int index, int polarity) {
+  struct rtty_uart *u = &ch->uart[polarity];
+  float d = rtty_decision(ch, polarity, ch->now);
+  int since = ch->now - u->edge;
+  int marks = u->marks;
+
+  u->marks = d > 0.0f ? u->marks + 1 : 0;
+
+  // the filters sum the last bit, so an edge shows half a bit late and a
+  // bit is all in the sum at the end of it: half a bit after the edge
+  // is the middle of the start bit
+  switch (u->state) {
+  case RTTY_WAIT:
+    if (d > 0.0f) {
+      u->state = RTTY_HUNT;
+      u->edge = ch->now;
+    }
+    break;
+  case RTTY_HUNT:
+    // a start bit comes after some mark: the stop bit at least
+    if (since >= 0 && d < 0.0f && marks >= rtty_min_marks) {
+      u->state = RTTY_START;
+      u->edge = ch->now;
+    }
+    break;
+  case RTTY_START:
+    if (since == rtty_bit_pos[0])
+      u->state = d < 0.0f ? RTTY_FRAME : RTTY_HUNT;
+    break;
+  case RTTY_FRAME:
+    if (since == rtty_bit_pos[6] + rtty_search)
+      rtty_uart_frame(ch, index, polarity);
+    break;
+  }
+}
+
+// run a channel over a block of 8 kHz audio
+// inputs:  struct rtty_channel *ch, int index, const float *audio, int n
+// returns: void
+static void rtty_channel_rx(struct rtty_channel *ch, int index, const float *audio, int n) {
+  bool was_dcd = ch->dcd;
+  float alpha = 1.0f / rtty_filter_len;
+
+  for (int i = 0; i < n; i++) {
+    float complex zm = audio[i] * ch->lo_mark;
+    float complex zs = audio[i] * ch->lo_space;
+    ch->lo_mark *= ch->step_mark;
+    ch->lo_space *= ch->step_space;
+    ch->sum_mark += zm - ch->ring_mark[ch->pos];
+    ch->sum_space += zs - ch->ring_space[ch->pos];
+    ch->ring_mark[ch->pos] = zm;
+    ch->ring_space[ch->pos] = zs;
+    if (++ch->pos == rtty_filter_len) {
+      // sum afresh once a bit, before rounding errors build up
+      ch->pos = 0;
+      ch->sum_mark = ch->sum_space = 0.0f;
+      for (int t = 0; t < rtty_filter_len; t++) {
+        ch->sum_mark += ch->ring_mark[t];
+        ch->sum_space += ch->ring_space[t];
+      }
+      ch->lo_mark /= cabsf(ch->lo_mark);
+      ch->lo_space /= cabsf(ch->lo_space);
+    }
+
+    float pm = crealf(ch->sum_mark * conjf(ch->sum_mark));
+    float ps = crealf(ch->sum_space * conjf(ch->sum_space));
+    ch->history[++ch->now & (RTTY_HISTORY - 1)] = (pm - ps) / (pm + ps + 1e-20f);
+
+    // stop copying as soon as the signal goes, rather than print the noise
+    // until the framing fails
+    ch->power += (pm + ps - ch->power) * alpha;
+    ch->mark_avg += (pm - ch->mark_avg) * alpha / RTTY_OVERLAP_BITS;
+    ch->space_avg += (ps - ch->space_avg) * alpha / RTTY_OVERLAP_BITS;
+    ch->both_avg += (pm * ps - ch->both_avg) * alpha / RTTY_OVERLAP_BITS;
+    if (ch->dcd) {
+      ch->level += (ch->power - ch->level) * alpha / 8;
+      if (ch->power < ch->level * RTTY_FADE) {
+        ch->dcd = false;
+        ch->uart[0].quality = ch->uart[1].quality = 0.5f;
+      }
+    }
+    rtty_uart_sample(ch, index, 0);
+    rtty_uart_sample(ch, index, 1);
+  }
+
+  // end a skimmer line when the signal goes
+  if (was_dcd && !ch->dcd)
+    bank_skim_line(&rtty_bank, &ch->line, ch->freq);
+}
+
+static int rtty_compare(const void *a, const void *b) {
+  float x = *(const float *)a, y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+// find the tones in the averaged spectrum
+// inputs:  struct rtty_tone *tones (RTTY_FIND_TONES of them)
+// returns: int, the number found
+static int rtty_find_tones(struct rtty_tone *tones) {
+  const float bin_hz = (float)RTTY_FS / BANK_FFT;
+  const int lo = RTTY_FIND_LO_HZ / bin_hz, hi = RTTY_FIND_HI_HZ / bin_hz;
+  const float *power = rtty_bank.power;
+  float sorted[BANK_FFT / 2];
+  int count = 0;
+
+  // the noise floor is taken low in the distribution of the bins
+  int n = hi - lo;
+  memcpy(sorted, power + lo, n * sizeof(float));
+  qsort(sorted, n, sizeof(float), rtty_compare);
+  float floor = sorted[n * 3 / 10];
+  if (floor <= 0.0f)
+    return 0;
+
+  for (int k = lo + RTTY_FIND_PEAK_BINS; k < hi - RTTY_FIND_PEAK_BINS && count < RTTY_FIND_TONES; k++) {
+    float band = power[k - 1] + power[k] + power[k + 1];
+    float snr = 10.0f * log10f(band / (3 * floor));
+    if (snr < RTTY_FIND_SNR_DB)
+      continue;
+    bool peak = true;
+    for (int j = -RTTY_FIND_PEAK_BINS; j <= RTTY_FIND_PEAK_BINS && peak; j++)
+      if (power[k + j] > power[k] || (j < 0 && power[k + j] == power[k]))
+        peak = false;
+    if (!peak)
+      continue;
+
+    float sum = 0.0f, moment = 0.0f;
+    for (int j = -1; j <= 1; j++) {
+      float p = power[k + j] - floor;
+      if (p > 0.0f) {
+        sum += p;
+        moment += p * (k + j);
+      }
+    }
+    tones[count].freq = (sum > 0.0f ? moment / sum : k) * bin_hz;
+    tones[count].snr = snr;
+    tones[count].used = false;
+    count++;
+  }
+  return count;
+}
+
+// pair up the tones that are one of the shifts apart (or the set shift);
+// the narrow shifts go first, since the tones of different signals are
+// more often a wide shift apart, and the strongest pairs first within each
+// inputs:  struct rtty_signal *signals (RTTY_FIND_SIGNALS of them)
+// returns: int, the number found
+static int rtty_find_signals(struct rtty_signal *signals) {
+  struct rtty_tone tones[RTTY_FIND_TONES];
+  int n_tones = rtty_find_tones(tones);
+  int count = 0;
+
+  for (int s = 0; s < RTTY_SHIFTS; s++) {
+    int shift = rtty_shifts[s];
+    if (rtty_shift && shift != rtty_shift)
+      continue;
+    while (count < RTTY_FIND_SIGNALS) {
+      int best_a = -1, best_b = -1;
+      float best_snr = 0.0f;
+      for (int a = 0; a < n_tones; a++) {
+        for (int b = a + 1; b < n_tones; b++) {
+          float snr = fminf(tones[a].snr, tones[b].snr);
+          if (tones[a].used || tones[b].used || snr <= best_snr)
+            continue;
+          if (fabsf(tones[b].freq - tones[a].freq - shift) > fmaxf(12.0f, 0.06f * shift))
+            continue;
+          if (fabsf(tones[a].snr - tones[b].snr) > RTTY_FIND_BALANCE_DB)
+            continue;
+          best_a = a;
+          best_b = b;
+          best_snr = snr;
+        }
+      }
+      if (best_a < 0)
+        break;
+      tones[best_a].used = tones[best_b].used = true;
+      signals[count].freq = (tones[best_a].freq + tones[best_b].freq) / 2;
+      signals[count].shift = shift;
+      signals[count].snr = best_snr;
+      signals[count].used = false;
+      count++;
+    }
+  }
+  return count;
+}
+
+// the channel finder: put the channels on the signals in the averaged
+// spectrum
+// inputs: none
+// returns: void
+static void rtty_find(void) {
+  struct rtty_signal signals[RTTY_FIND_SIGNALS];
+
+  int n = rtty_find_signals(signals);
+
+  // which channels still have their signal
+  for (int c = 0; c < RTTY_CHANNELS; c++) {
+    struct rtty_channel *ch = &rtty_channels[c];
+    if (!ch->active)
+      continue;
+    int best = -1;
+    for (int s = 0; s < n; s++)
+      if (signals[s].shift == ch->shift && fabsf(signals[s].freq - ch->freq) < 20.0f &&
+          (best < 0 || signals[s].snr > signals[best].snr))
+        best = s;
+    if (best >= 0) {
+      ch->missed = 0;
+      ch->snr = signals[best].snr;
+      signals[best].used = true;
+    } else
+      ch->missed++;
+  }
+
+  // channel 0 is pulled onto the strongest signal near the pitch
+  struct rtty_channel *ch0 = &rtty_channels[0];
+  if (!ch0->dcd) {
+    int best = -1;
+    for (int s = 0; s < n; s++)
+      if (fabsf(signals[s].freq - rtty_pitch) <= RTTY_AFC_HZ && (best < 0 || signals[s].snr > signals[best].snr))
+        best = s;
+    if (best >= 0 && (fabsf(signals[best].freq - ch0->freq) > RTTY_RETUNE_HZ || signals[best].shift != ch0->shift)) {
+      rtty_channel_start(ch0, signals[best].freq, signals[best].shift);
+      ch0->snr = signals[best].snr;
+      signals[best].used = true;
+    }
+  }
+  if (!rtty_skim_on)
+    return;
+
+  // let go of the skimmer channels whose signal has gone, or that are on
+  // the same signal as another channel
+  for (int c = 1; c < RTTY_CHANNELS; c++) {
+    struct rtty_channel *ch = &rtty_channels[c];
+    if (!ch->active)
+      continue;
+    bool drop = (!ch->dcd && ch->missed > RTTY_SKIM_MISSES) || ch->missed > 4 * RTTY_SKIM_MISSES;
+    for (int o = 0; o < c && !drop; o++)
+      if (rtty_channels[o].active && fabsf(rtty_channels[o].freq - ch->freq) < 20.0f)
+        drop = true;
+    if (drop)
+      rtty_channel_stop(ch);
+  }
+
+  // and put the free ones on the new signals
+  for (int s = 0; s < n; s++) {
+    if (signals[s].used)
+      continue;
+    bool near = false;
+    for (int c = 0; c < RTTY_CHANNELS && !near; c++)
+      if (rtty_channels[c].active && fabsf(rtty_channels[c].freq - signals[s].freq) < 40.0f)
+        near = true;
+    if (near)
+      continue;
+    for (int c = 1; c < RTTY_CHANNELS; c++) {
+      if (!rtty_channels[c].active) {
+        rtty_channel_start(&rtty_channels[c], signals[s].freq, signals[s].shift);
+        rtty_channels[c].snr = signals[s].snr;
+        break;
+      }
+    }
+  }
+}
+
+// apply what rtty_poll() last saw
+// inputs: none
+// returns: void
+static void rtty_configure(void) {
+  if (rtty_want_baud != rtty_baud || rtty_want_shift != rtty_shift) {
+    rtty_shift = rtty_want_shift;
+    rtty_set_baud(rtty_want_baud);
+  }
+  rtty_skim_on = rtty_want_skim;
+  if (!rtty_skim_on)
+    for (int c = 1; c < RTTY_CHANNELS; c++)
+      rtty_channel_stop(&rtty_channels[c]);
+  if (rtty_want_pitch != rtty_pitch || !rtty_channels[0].active) {
+    rtty_pitch = rtty_want_pitch;
+    rtty_channel_start(&rtty_channels[0], rtty_pitch, rtty_shift ? rtty_shift : 170);
+  }
+}
+
+// run the active channels over a block of 8 kHz audio
+// inputs:  const float *audio, int n
+// returns: int, the number of channels
+static int rtty_channels_rx(const float *audio, int n) {
+  int active = 0;
+  for (int c = 0; c < RTTY_CHANNELS; c++) {
+    if (rtty_channels[c].active) {
+      rtty_channel_rx(&rtty_channels[c], c, audio, n);
+      active++;
+    }
+  }
+  return active;
+}
+
+// called by modem_rx() in modems.c with each block of received audio
+// inputs:  int32_t *samples, int count
+// returns: void
+void rtty_rx(int32_t *samples, int count) {
+  bank_rx(&rtty_bank, samples, count);
+}
+
+// called by modem_poll() in modems.c: pick up the baud rate, shift,
+// skimmer setting and pitch
+// inputs: none
+// returns: void
+void rtty_poll() {
+  const char *skim = field_str("RTTY_SKIM");
+  int baud = field_int("RTTY");
+  int shift = field_int("RTTY_SHIFT");
+  bool skim_on = skim && !strcasecmp(skim, "ON");
+  int pitch = get_pitch();
+
+  if (baud != 50 && baud != 75)
+    baud = 45;
+  if (shift != 170 && shift != 200 && shift != 425 && shift != 850)
+    shift = 0;
+  if (baud == rtty_want_baud && shift == rtty_want_shift && skim_on == rtty_want_skim &&
+      pitch == rtty_want_pitch)
+    return;
+  rtty_want_baud = baud;
+  rtty_want_shift = shift;
+  rtty_want_skim = skim_on;
+  rtty_want_pitch = pitch;
+  bank_changed(&rtty_bank);
+}
+
+// the settings, the channels and the CPU time spent on them
+// inputs:  char *report, int len
+// returns: int, the length of the report
+int rtty_report(char *report, int len) {
+  char shift[16] = "auto";
+  if (rtty_want_shift)
+    snprintf(shift, sizeof(shift), "%d Hz", rtty_want_shift);
+  int n = snprintf(report, len, "RTTY %s baud, shift %s, at %d Hz, skimmer %s\n",
+    rtty_want_baud == 45 ? "45.45" : (rtty_want_baud == 50 ? "50" : "75"), shift,
+    rtty_want_pitch, rtty_want_skim ? "on" : "off");
+  if (n < len)
+    n += bank_report(&rtty_bank, report + n, len - n);
+  for (int c = 0; c < RTTY_CHANNELS && n < len; c++) {
+    struct rtty_channel *ch = &rtty_channels[c];
+    if (!ch->active)
+      continue;
+    n += snprintf(report + n, len - n, "%2d %6.1f Hz shift %d%s %+4.0f dB framing %.2f contrast %.2f overlap %.2f%s\n",
+      c, ch->freq, ch->shift, ch->polarity ? " reversed" : "", ch->snr,
+      ch->uart[ch->polarity].quality, ch->contrast, rtty_overlap(ch), ch->dcd ? " copying" : "");
+  }
+  return n < len ? n : len - 1;
+}
@@ -0,0 +1,11 @@
+#ifndef MODEM_RTTY_H
+#define MODEM_RTTY_H
+
+void rtty_init();
+void rtty_rx(int32_t *samples, int count);
+void rtty_poll();
+
+// the settings, channels and CPU time, for \rtty
+int rtty_report(char *report, int len);
+
+#endif /* MODEM_RTTY_H */
@@ -93,68 +93,40 @@ void init_eq(parametriceq* eq, const char* section) {
     }
 
     fclose(file);
+    // after the bands, so that apply_eq() sees them when it works the sections out again
+    atomic_fetch_add_explicit(&eq->changes, 1, memory_order_release);
 }
 
 
-// Structure for Biquad filter
-typedef struct {
-    double a0, a1, a2, b0, b1, b2;
-    double x1, x2, y1, y2;
-} Biquad;
-
-// Function to calculate filter coefficients
-void calculate_coefficients(EQBand* band, double sample_rate, Biquad* filter) {
+// Function to calculate the coefficients of one band's peaking section,
+// normalised so that a0 is 1; a band that does nothing passes straight through
+static void calculate_coefficients(const EQBand* band, double sample_rate, EQSections* s, int k) {
     double clamped_gain = fmax(fmin(band->gain, 24.0), -24.0); // Clamp gain to ±24 dB
+
+    if (clamped_gain == 0.0 || band->frequency <= 0.0 || band->frequency >= sample_rate / 2.0
+        || band->bandwidth <= 0.0) {
+        s->b0[k] = 1.0f;
+        s->b1[k] = s->b2[k] = s->a1[k] = s->a2[k] = 0.0f;
+        return;
+    }
+
     double A = pow(10.0, clamped_gain / 40.0);
     double omega = 2.0 * M_PI * band->frequency / sample_rate;
     double sin_omega = sin(omega);
     double cos_omega = cos(omega);
     double alpha = sin_omega * sinh(log(2.0) / 2.0 * band->bandwidth * omega / fmax(sin_omega, 1e-10));
-
-    // Ensure the filter coefficients are stable
-    filter->b0 = 1.0 + alpha * A;
-    filter->b1 = -2.0 * cos_omega;
-    filter->b2 = 1.0 - alpha * A;
-    filter->a0 = 1.0 + alpha / A;
-    filter->a1 = -2.0 * cos_omega;
-    filter->a2 = 1.0 - alpha / A;
+    double a0 = 1.0 + alpha / A;
 
     // Check if a0 is close to zero to prevent division by zero
-    if (fabs(filter->a0) < 1e-10) {
-        filter->a0 = 1e-10; // Prevent division by zero
+    if (fabs(a0) < 1e-10) {
+        a0 = 1e-10;
     }
 
-    // Normalize the coefficients
-    filter->b0 /= filter->a0;
-    filter->b1 /= filter->a0;
-    filter->b2 /= filter->a0;
-    filter->a1 /= filter->a0;
-    filter->a2 /= filter->a0;
-
-    // a0 should always be normalized to 1.0
-    filter->a0 = 1.0;
-
-    // Initialize filter states
-    filter->x1 = filter->x2 = 0.0;
-    filter->y1 = filter->y2 = 0.0;
-}
-
-// Function to process a single sample through the filter
-int32_t process_sample(Biquad* filter, int32_t sample) {
-    double result = filter->b0 * sample + filter->b1 * filter->x1 + filter->b2 * filter->x2
-        - filter->a1 * filter->y1 - filter->a2 * filter->y2;
-    
-    // Update filter states
-    filter->x2 = filter->x1;
-    filter->x1 = sample;
-    filter->y2 = filter->y1;
-    filter->y1 = result;
-
-    // Ensure result is within valid range
-    if (result > INT32_MAX) result = INT32_MAX;
-    if (result < INT32_MIN) result = INT32_MIN;
-
-    return (int32_t)result;
+    s->b0[k] = (1.0 + alpha * A) / a0;
+    s->b1[k] = -2.0 * cos_omega / a0;
+    s->b2[k] = (1.0 - alpha * A) / a0;
+    s->a1[k] = -2.0 * cos_omega / a0;
+    s->a2[k] = (1.0 - alpha / A) / a0;
 }
 
 // Function to remove DC offset
@@ -169,58 +141,87 @@ void remove_dc_offset(int32_t* samples, int num_samples) {
     }
 }
 
-// Function to scale samples by a gain factor
-void scale_samples(int32_t* samples, int num_samples, float gain_factor) {
-    for (int i = 0; i < num_samples; i++) {
-        // Apply the gain factor and clamp values to avoid overflow/underflow
-        int64_t scaled_sample = (int64_t)(samples[i] * gain_factor);
-        if (scaled_sample > INT32_MAX) scaled_sample = INT32_MAX;
-        if (scaled_sample < INT32_MIN) scaled_sample = INT32_MIN;
-        samples[i] = (int32_t)scaled_sample;
-    }
-}
-
-// Function to apply EQ and gain scaling
-void apply_eq(parametriceq* eq, int32_t* samples, int num_samples, double sample_rate) {
-    Biquad filters[NUM_BANDS];
-
-    // Step 1: Calculate coefficients for each band
-    for (int i = 0; i < NUM_BANDS; i++) {
-        calculate_coefficients(&eq->bands[i], sample_rate, &filters[i]);
+// Function to apply EQ: the bands are peaking sections in series, with
+// their coefficients and state kept in eq->sections from block to block.
+// The coefficients are worked out again only after a band has changed.
+//
+// The sections run as a pipeline, one lane each: at every step lane k
+// filters the sample that lane k - 1 filtered at the step before, so the
+// lanes don't wait on each other and -O3 vectorises the loop over them
+// (NEON on the Pi, SSE/AVX on x86). The lanes past NUM_BANDS pass their
+// input through and only pad the vector. The output comes out of the
+// last band NUM_BANDS - 1 samples late, the same delay on every block.
+void apply_eq_float(parametriceq* eq, float* samples, int num_samples, double sample_rate) {
+    EQSections* s = &eq->sections;
+    // pairs with the release in init_eq() and the modify_eq_band_*() functions
+    unsigned int changes = atomic_load_explicit(&eq->changes, memory_order_acquire);
+
+    if (changes != eq->applied || sample_rate != eq->sample_rate) {
+        for (int k = 0; k < EQ_LANES; k++) {
+            if (k < NUM_BANDS)
+                calculate_coefficients(&eq->bands[k], sample_rate, s, k);
+            else {
+                s->b0[k] = 1.0f;
+                s->b1[k] = s->b2[k] = s->a1[k] = s->a2[k] = 0.0f;
+            }
+        }
+        eq->applied = changes;
+        eq->sample_rate = sample_rate;
     }
 
-    // Step 2: Initialize output buffer
-    int32_t output_samples[num_samples];
-    memset(output_samples, 0, sizeof(output_samples));
-
-    // Step 3: Process samples for each band
-    for (int i = 0; i < NUM_BANDS; i++) {
-        double band_gain = pow(10.0, eq->bands[i].gain / 20.0); // Convert dB to linear scale
+    // work on copies so the compiler can keep the lanes in registers
+    float b0[EQ_LANES], b1[EQ_LANES], b2[EQ_LANES], a1[EQ_LANES], a2[EQ_LANES];
+    float z1[EQ_LANES], z2[EQ_LANES], y[EQ_LANES];
+    memcpy(b0, s->b0, sizeof(b0));
+    memcpy(b1, s->b1, sizeof(b1));
+    memcpy(b2, s->b2, sizeof(b2));
+    memcpy(a1, s->a1, sizeof(a1));
+    memcpy(a2, s->a2, sizeof(a2));
+    memcpy(z1, s->z1, sizeof(z1));
+    memcpy(z2, s->z2, sizeof(z2));
+    memcpy(y, s->y, sizeof(y));
 
-        for (int n = 0; n < num_samples; n++) {
-            // Apply the filter to the current sample
-            double filtered_sample = process_sample(&filters[i], samples[n]);
-
-            // Accumulate the scaled filtered output
-            output_samples[n] += (int32_t)(filtered_sample * band_gain);
+    for (int n = 0; n < num_samples; n++) {
+        float x[EQ_LANES];
+
+        // lane 0 takes the new sample, the others what came out of the lane before
+        x[0] = samples[n];
+        for (int k = 1; k < EQ_LANES; k++)
+            x[k] = y[k - 1];
+
+        // transposed direct form II, kept a loop so that gcc vectorises it
+        // instead of unrolling it into scalar code
+#pragma GCC unroll 1
+        for (int k = 0; k < EQ_LANES; k++) {
+            y[k] = b0[k] * x[k] + z1[k];
+            z1[k] = b1[k] * x[k] - a1[k] * y[k] + z2[k];
+            z2[k] = b2[k] * x[k] - a2[k] * y[k];
         }
-    }
 
-    // Step 4: Normalize the summed output
-    for (int n = 0; n < num_samples; n++) {
-        output_samples[n] /= NUM_BANDS; // Prevent unintentional gain
+        samples[n] = y[NUM_BANDS - 1];
     }
 
-    // Step 5: Scale and clamp using scale_samples
-    scale_samples(output_samples, num_samples, 1.0);
-
-    // Step 6: Copy normalized output back to input buffer
-    memcpy(samples, output_samples, sizeof(int32_t) * num_samples);
+    memcpy(s->z1, z1, sizeof(z1));
+    memcpy(s->z2, z2, sizeof(z2));
+    memcpy(s->y, y, sizeof(y));
 }
 
+// Function to apply EQ to int32 samples, for the receiver
+void apply_eq(parametriceq* eq, int32_t* samples, int num_samples, double sample_rate) {
+    float buffer[num_samples];
 
+    for (int n = 0; n < num_samples; n++) {
+        buffer[n] = (float)samples[n];
+    }
 
+    apply_eq_float(eq, buffer, num_samples, sample_rate);
 
-
-
-
+    for (int n = 0; n < num_samples; n++) {
+        float out = buffer[n];
+        // (float)INT32_MAX rounds up to 2^31, which doesn't fit in an int32_t;
+        // 2147483520 is the largest float below it
+        if (out > 2147483520.0f) out = 2147483520.0f;
+        if (out < (float)INT32_MIN) out = (float)INT32_MIN;
+        samples[n] = (int32_t)out;
+    }
+}
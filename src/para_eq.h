@@ -2,6 +2,7 @@
 
 #ifndef PARA_EQ_H_
 #define PARA_EQ_H_
+#include <stdatomic.h>
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
@@ -17,9 +18,22 @@ typedef struct {
     double bandwidth;
 } EQBand;
 
+// The bands as biquad sections, one per lane, padded to a whole vector
+#define EQ_LANES 8
+
+typedef struct {
+    float b0[EQ_LANES], b1[EQ_LANES], b2[EQ_LANES], a1[EQ_LANES], a2[EQ_LANES];
+    float z1[EQ_LANES], z2[EQ_LANES];   // transposed direct form II state
+    float y[EQ_LANES];                  // each lane's last output, the next lane's input
+} EQSections;
+
 // Define parametriceq structure
 typedef struct {
     EQBand bands[NUM_BANDS];
+    EQSections sections;                // kept from block to block by apply_eq_float()
+    atomic_uint changes;                // bumped (release) after the bands change
+    unsigned int applied;               // the changes the sections were worked out for
+    double sample_rate;
 } parametriceq;
 
 extern parametriceq eq;
@@ -31,6 +45,7 @@ extern void modify_eq_band_gain(parametriceq *eq, int band_index, double new_gai
 extern void modify_eq_band_bandwidth(parametriceq *eq, int band_index, double new_bandwidth);
 extern void print_eq_int(const parametriceq *eq, const char *label);
 extern void apply_eq(parametriceq* eq, int32_t* samples, int num_samples, double sample_rate);
+extern void apply_eq_float(parametriceq* eq, float* samples, int num_samples, double sample_rate);
 extern int eq_is_enabled;
 extern int rx_eq_is_enabled;
 
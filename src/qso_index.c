@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "qso_index.h"
+
+/*
+	Two open-addressing hash tables: one keyed by callsign, one by grid
+	(or whatever is in exch_recv). Both grow by doubling when 3/4 full.
+	The decode thread reads while the GUI thread adds, so everything
+	is done under index_mutex; every operation is a hash probe plus
+	(for the dupe check) a walk back over the newest few timestamps.
+*/
+
+#define QSO_INDEX_CALL_LEN 16
+#define QSO_INDEX_GRID_LEN 8
+#define QSO_INDEX_INITIAL_SIZE 1024
+
+struct call_entry {
+	char call[QSO_INDEX_CALL_LEN];
+	time_t *times;		// QSO timestamps, ascending
+	int n_times;
+	int cap_times;
+	uint32_t bands;		// bit n: worked on logbook band n
+	uint32_t modes;		// bit n: worked in mode_names[n]
+	char *summary;		// the most recent QSO, formatted for logbook_prev_log()
+};
+
+struct grid_entry {
+	char grid[QSO_INDEX_GRID_LEN];
+	time_t last;
+	int count;
+};
+
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct call_entry *calls = NULL;
+static int calls_size = 0, calls_used = 0;
+static struct grid_entry *grids = NULL;
+static int grids_size = 0, grids_used = 0;
+static int qsos_total = 0;
+// set by whichever thread builds the index, read by the lookups on any thread
+static atomic_bool index_ready = false;
+
+static char mode_names[QSO_INDEX_MAX_MODES][8];
+static int mode_names_n = 0;
+
+static uint32_t key_hash(const char *key)
+{
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	while (*key) {
+		h ^= (uint8_t)*key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/*!
+	Copy at most \a len characters of \a src into \a dst (size \a dst_len),
+	uppercased, stopping at a space or null.
+	Returns the key length, or 0 if it's empty or doesn't fit.
+*/
+static int make_key(char *dst, int dst_len, const char *src, int len)
+{
+	int i;
+	if (!src)
+		return 0;
+	if (len < 0)
+		len = strlen(src);
+	for (i = 0; i < len && src[i] && src[i] != ' '; i++) {
+		if (i >= dst_len - 1)
+			return 0;
+		dst[i] = toupper(src[i]);
+	}
+	dst[i] = 0;
+	return i;
+}
+
+static struct call_entry *call_find(const char *key, bool create)
+{
+	if (!calls_size)
+		return NULL;
+	int i = key_hash(key) & (calls_size - 1);
+	while (calls[i].call[0]) {
+		if (!strcmp(calls[i].call, key))
+			return &calls[i];
+		i = (i + 1) & (calls_size - 1);
+	}
+	if (!create)
+		return NULL;
+	strcpy(calls[i].call, key);
+	calls_used++;
+	return &calls[i];
+}
+
+static void calls_grow()
+{
+	struct call_entry *old = calls;
+	int old_size = calls_size;
+
+	calls_size = old_size ? old_size * 2 : QSO_INDEX_INITIAL_SIZE;
+	calls = calloc(calls_size, sizeof(struct call_entry));
+	for (int i = 0; i < old_size; i++) {
+		if (!old[i].call[0])
+			continue;
+		int j = key_hash(old[i].call) & (calls_size - 1);
+		while (calls[j].call[0])
+			j = (j + 1) & (calls_size - 1);
+		calls[j] = old[i];
+	}
+	free(old);
+}
+
+static struct grid_entry *grid_find(const char *key, bool create)
+{
+	if (!grids_size)
+		return NULL;
+	int i = key_hash(key) & (grids_size - 1);
+	while (grids[i].grid[0]) {
+		if (!strcmp(grids[i].grid, key))
+			return &grids[i];
+		i = (i + 1) & (grids_size - 1);
+	}
+	if (!create)
+		return NULL;
+	strcpy(grids[i].grid, key);
+	grids_used++;
+	return &grids[i];
+}
+
+static void grids_grow()
+{
+	struct grid_entry *old = grids;
+	int old_size = grids_size;
+
+	grids_size = old_size ? old_size * 2 : QSO_INDEX_INITIAL_SIZE;
+	grids = calloc(grids_size, sizeof(struct grid_entry));
+	for (int i = 0; i < old_size; i++) {
+		if (!old[i].grid[0])
+			continue;
+		int j = key_hash(old[i].grid) & (grids_size - 1);
+		while (grids[j].grid[0])
+			j = (j + 1) & (grids_size - 1);
+		grids[j] = old[i];
+	}
+	free(old);
+}
+
+// call with index_mutex locked
+static int mode_bit_locked(const char *mode)
+{
+	if (!mode || !mode[0])
+		return -1;
+	for (int i = 0; i < mode_names_n; i++)
+		if (!strcasecmp(mode_names[i], mode))
+			return i;
+	if (mode_names_n >= QSO_INDEX_MAX_MODES)
+		return -1;
+	strncpy(mode_names[mode_names_n], mode, sizeof(mode_names[0]) - 1);
+	return mode_names_n++;
+}
+
+int qso_index_mode_bit(const char *mode)
+{
+	pthread_mutex_lock(&index_mutex);
+	int ret = mode_bit_locked(mode);
+	pthread_mutex_unlock(&index_mutex);
+	return ret;
+}
+
+void qso_index_clear()
+{
+	pthread_mutex_lock(&index_mutex);
+	for (int i = 0; i < calls_size; i++) {
+		free(calls[i].times);
+		free(calls[i].summary);
+	}
+	free(calls);
+	free(grids);
+	calls = NULL;
+	grids = NULL;
+	calls_size = calls_used = 0;
+	grids_size = grids_used = 0;
+	qsos_total = 0;
+	atomic_store_explicit(&index_ready, false, memory_order_release);
+	pthread_mutex_unlock(&index_mutex);
+}
+
+bool qso_index_ready()
+{
+	return atomic_load_explicit(&index_ready, memory_order_acquire);
+}
+
+void qso_index_set_ready(bool ready)
+{
+	atomic_store_explicit(&index_ready, ready, memory_order_release);
+}
+
+/*!
+	Add one QSO to the index.
+	\a band is an index into the logbook band table (or -1 if unknown);
+	\a summary (may be null) is what qso_index_prev_log() will report
+	if this is the most recent QSO with \a callsign.
+*/
+void qso_index_add(const char *callsign, const char *grid, int band, const char *mode,
+	time_t when, const char *summary)
+{
+	char key[QSO_INDEX_CALL_LEN];
+	char grid_key[QSO_INDEX_GRID_LEN];
+
+	pthread_mutex_lock(&index_mutex);
+	if (make_key(key, sizeof(key), callsign, -1)) {
+		if ((calls_used + 1) * 4 >= calls_size * 3)
+			calls_grow();
+		struct call_entry *e = call_find(key, true);
+		if (e->n_times == e->cap_times) {
+			e->cap_times = e->cap_times ? e->cap_times * 2 : 4;
+			e->times = realloc(e->times, e->cap_times * sizeof(time_t));
+		}
+		// keep the timestamps sorted: they almost always arrive in order
+		int i = e->n_times++;
+		while (i > 0 && e->times[i - 1] > when) {
+			e->times[i] = e->times[i - 1];
+			i--;
+		}
+		e->times[i] = when;
+		if (band >= 0 && band < 32)
+			e->bands |= 1u << band;
+		int m = mode_bit_locked(mode);
+		if (m >= 0)
+			e->modes |= 1u << m;
+		if (summary && i == e->n_times - 1) {
+			free(e->summary);
+			e->summary = strdup(summary);
+		}
+		qsos_total++;
+	}
+	if (make_key(grid_key, sizeof(grid_key), grid, -1)) {
+		if ((grids_used + 1) * 4 >= grids_size * 3)
+			grids_grow();
+		struct grid_entry *g = grid_find(grid_key, true);
+		if (when > g->last)
+			g->last = when;
+		g->count++;
+	}
+	pthread_mutex_unlock(&index_mutex);
+}
+
+/*!
+	Timestamp of the most recent QSO with \a callsign, or \c 0 if none.
+	\a callsign may end with a space or null; \a len tells where.
+*/
+time_t qso_index_last_qso(const char *callsign, int len)
+{
+	char key[QSO_INDEX_CALL_LEN];
+	time_t ret = 0;
+
+	if (!make_key(key, sizeof(key), callsign, len))
+		return 0;
+	pthread_mutex_lock(&index_mutex);
+	struct call_entry *e = call_find(key, false);
+	if (e && e->n_times)
+		ret = e->times[e->n_times - 1];
+	pthread_mutex_unlock(&index_mutex);
+	return ret;
+}
+
+time_t qso_index_grid_last_qso(const char *grid, int len)
+{
+	char key[QSO_INDEX_GRID_LEN];
+	time_t ret = 0;
+
+	if (!make_key(key, sizeof(key), grid, len))
+		return 0;
+	pthread_mutex_lock(&index_mutex);
+	struct grid_entry *g = grid_find(key, false);
+	if (g)
+		ret = g->last;
+	pthread_mutex_unlock(&index_mutex);
+	return ret;
+}
+
+/*!
+	Count the QSOs with \a callsign at or after \a since.
+*/
+int qso_index_count_since(const char *callsign, time_t since)
+{
+	char key[QSO_INDEX_CALL_LEN];
+	int ret = 0;
+
+	if (!make_key(key, sizeof(key), callsign, -1))
+		return 0;
+	pthread_mutex_lock(&index_mutex);
+	struct call_entry *e = call_find(key, false);
+	if (e)
+		for (int i = e->n_times - 1; i >= 0 && e->times[i] >= since; i--)
+			ret++;
+	pthread_mutex_unlock(&index_mutex);
+	return ret;
+}
+
+/*!
+	Write "CALL: <most recent QSO>: <count>" into \a result, as logbook_prev_log() does.
+	Returns the number of QSOs with \a callsign.
+*/
+int qso_index_prev_log(const char *callsign, char *result, int result_len)
+{
+	char key[QSO_INDEX_CALL_LEN];
+	int count = 0;
+	const char *summary = "";
+
+	make_key(key, sizeof(key), callsign, -1);
+	pthread_mutex_lock(&index_mutex);
+	struct call_entry *e = key[0] ? call_find(key, false) : NULL;
+	if (e) {
+		count = e->n_times;
+		if (e->summary)
+			summary = e->summary;
+	}
+	snprintf(result, result_len, "%s: %s: %d", callsign, summary, count);
+	pthread_mutex_unlock(&index_mutex);
+	return count;
+}
+
+uint32_t qso_index_bands(const char *callsign)
+{
+	char key[QSO_INDEX_CALL_LEN];
+	uint32_t ret = 0;
+
+	if (!make_key(key, sizeof(key), callsign, -1))
+		return 0;
+	pthread_mutex_lock(&index_mutex);
+	struct call_entry *e = call_find(key, false);
+	if (e)
+		ret = e->bands;
+	pthread_mutex_unlock(&index_mutex);
+	return ret;
+}
+
+uint32_t qso_index_modes(const char *callsign)
+{
+	char key[QSO_INDEX_CALL_LEN];
+	uint32_t ret = 0;
+
+	if (!make_key(key, sizeof(key), callsign, -1))
+		return 0;
+	pthread_mutex_lock(&index_mutex);
+	struct call_entry *e = call_find(key, false);
+	if (e)
+		ret = e->modes;
+	pthread_mutex_unlock(&index_mutex);
+	return ret;
+}
+
+void qso_index_stats(int *n_calls, int *n_grids, int *n_qsos)
+{
+	pthread_mutex_lock(&index_mutex);
+	if (n_calls)
+		*n_calls = calls_used;
+	if (n_grids)
+		*n_grids = grids_used;
+	if (n_qsos)
+		*n_qsos = qsos_total;
+	pthread_mutex_unlock(&index_mutex);
+}
+
+/*!
+	Call \a f for every callsign in the index, in no particular order.
+	The index is locked meanwhile, so \a f must not call back into it.
+	Returns the number of calls.
+*/
+int qso_index_calls(void (*f)(const char *callsign, void *user), void *user)
+{
+	int n = 0;
+	pthread_mutex_lock(&index_mutex);
+	for (int i = 0; i < calls_size; i++)
+		if (calls[i].call[0]) {
+			f(calls[i].call, user);
+			n++;
+		}
+	pthread_mutex_unlock(&index_mutex);
+	return n;
+}
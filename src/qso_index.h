@@ -0,0 +1,32 @@
+#ifndef QSO_INDEX_H
+#define QSO_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+	In-memory index of the logbook, so that the per-decode lookups
+	(last QSO with a call or grid, dupe checks, previous log entry)
+	don't need to go to sqlite. logbook.c fills it in logbook_open()
+	and keeps it up to date whenever it writes to the logbook table.
+*/
+
+#define QSO_INDEX_MAX_MODES 32
+
+void qso_index_clear();
+bool qso_index_ready();
+void qso_index_set_ready(bool ready);
+void qso_index_add(const char *callsign, const char *grid, int band, const char *mode,
+	time_t when, const char *summary);
+time_t qso_index_last_qso(const char *callsign, int len);
+time_t qso_index_grid_last_qso(const char *grid, int len);
+int qso_index_count_since(const char *callsign, time_t since);
+int qso_index_prev_log(const char *callsign, char *result, int result_len);
+uint32_t qso_index_bands(const char *callsign);
+uint32_t qso_index_modes(const char *callsign);
+int qso_index_mode_bit(const char *mode);
+void qso_index_stats(int *calls, int *grids, int *qsos);
+int qso_index_calls(void (*f)(const char *callsign, void *user), void *user);
+
+#endif /* QSO_INDEX_H */
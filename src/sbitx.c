@@ -245,6 +245,23 @@ double notch_bandwidth = 0;	   // Notch bandwidth in Hz W2JON
 int compression_control_level; // Audio Compression level W2JON
 int txmon_control_level;	   // TX Monitor level W2JON
 float vmax=0.0;   // vu meter
+
+// The voice TX chain is float from the mic to the FFT, with samples
+// in units of TX_MIC_SCALE on the mic's int32 scale
+#define TX_MIC_SCALE 2000000000.0
+
+// TX levels for \txmeter since the last reset: the peak after each stage
+// of the voice chain, the peak at the DAC and the samples clipped
+enum {TX_METER_MIC, TX_METER_COMPRESSOR, TX_METER_EQ, TX_METER_CESSB, TX_METER_STAGES};
+static struct {
+	float peak[TX_METER_STAGES];	// in the chain's units
+	double peak_dac;				// a fraction of full scale
+	unsigned long clipped_compressor;
+	unsigned long clipped_voice;
+	unsigned long clipped_dac;
+	unsigned long voice_samples;
+	int reset;						// set by tx_meter_reset() during TX, done by tx_process()
+} tx_meter;
 int get_rx_gain(void)
 {
 	// printf("rx_gain %d\n", rx_gain);
@@ -523,9 +540,11 @@ static int create_mcast_socket(){
 }
 */
 
-void apply_fixed_compression(float *input, int num_samples, int compression_control_value)
+// returns the number of samples clipped
+int apply_fixed_compression(float *input, int num_samples, int compression_control_value)
 {
 	float compression_level = compression_control_value / 10.0;
+	int clipped = 0;
 
 	// I dont think we need to provide too many confusng controls so let's define internal fixed compression parameters
 	float internal_threshold = 0.1f;
@@ -549,13 +568,20 @@ void apply_fixed_compression(float *input, int num_samples, int compression_cont
 
 		// Ensure sample stays within range or we'll clip
 		if (sample > 1.0)
+		{
 			sample = 1.0;
+			clipped++;
+		}
 		if (sample < -1.0)
+		{
 			sample = -1.0;
+			clipped++;
+		}
 
 		// Send the processed sample back
 		input[i] = sample;
 	}
+	return clipped;
 }
 
 // S-Meter test W2JON
@@ -1764,8 +1790,12 @@ void rx_linear(const double *iq_i, const double *iq_q, int32_t *output_speaker,
     mute_count--;
   }
 
-  // Feed demodulated audio to modem decoders
+  // Feed demodulated audio to modem decoders, and the spectrum to the FTx and CW skimmers
   modem_rx(rx_list->mode, output_speaker, MAX_BINS / 2);
+  if (r->mode == MODE_FT8 || r->mode == MODE_FT4)
+    ft8_skim_rx(fft_out);
+  else if (r->mode == MODE_CW || r->mode == MODE_CWR)
+    cw_skim_rx(r->mode, fft_spectrum);
 
   // RX equalizer and soft limiter (voice modes only)
   if (r->mode != MODE_DIGITAL && r->mode != MODE_FT8 && r->mode != MODE_FT4 &&
@@ -1858,6 +1888,74 @@ void read_power()
 
 static int tx_process_restart = 1;
 
+static void tx_meter_peak(int stage, float *samples, int n_samples)
+{
+	float peak = tx_meter.peak[stage];
+
+	for (int i = 0; i < n_samples; i++)
+		if (fabsf(samples[i]) > peak)
+			peak = fabsf(samples[i]);
+	tx_meter.peak[stage] = peak;
+}
+
+void tx_meter_reset()
+{
+	if (in_tx)
+		tx_meter.reset = 1;
+	else
+		memset(&tx_meter, 0, sizeof(tx_meter));
+}
+
+// the levels for \txmeter, relative to the voice clip level and the DAC's full scale
+int tx_meter_report(char *report, int len)
+{
+	static const char *stage_names[TX_METER_STAGES] = {"mic", "compressor", "eq", "cessb"};
+	int n = snprintf(report, len, "TX peaks over %.1f s of voice, re the voice clip level:\n",
+		tx_meter.voice_samples / 96000.0);
+
+	for (int i = 0; i < TX_METER_STAGES && n < len; i++)
+	{
+		if (tx_meter.peak[i] > 0)
+			n += snprintf(report + n, len - n, "  %-11s %6.1f dB\n", stage_names[i],
+				20 * log10(tx_meter.peak[i] / voice_clip_level));
+		else
+			n += snprintf(report + n, len - n, "  %-11s      -\n", stage_names[i]);
+	}
+	if (n < len)
+		n += snprintf(report + n, len - n, "Clipped: %lu by the compressor, %lu by the voice clipper\n",
+			tx_meter.clipped_compressor, tx_meter.clipped_voice);
+	if (n < len)
+	{
+		if (tx_meter.peak_dac > 0)
+			n += snprintf(report + n, len - n, "DAC peak %.1f dBFS, %lu samples clipped\n",
+				20 * log10(tx_meter.peak_dac), tx_meter.clipped_dac);
+		else
+			n += snprintf(report + n, len - n, "DAC peak -, %lu samples clipped\n",
+				tx_meter.clipped_dac);
+	}
+	return n < len ? n : len - 1;
+}
+
+// the one conversion out of the chain, to the DAC
+static int32_t tx_dac(double s)
+{
+	if (fabs(s) > tx_meter.peak_dac * INT32_MAX)
+		tx_meter.peak_dac = fabs(s) / INT32_MAX;
+	if (s > INT32_MAX)
+	{
+		s = INT32_MAX;
+		tx_meter.clipped_dac++;
+	}
+	else if (s < -INT32_MAX)
+	{
+		s = -INT32_MAX;
+		tx_meter.clipped_dac++;
+	}
+	return s;
+}
+
+static void tx_monitor(int32_t *output_tx);
+
 void tx_process(
 	int32_t *input_rx, int32_t *input_mic,
 	int32_t *output_speaker, int32_t *output_tx,
@@ -1867,11 +1965,22 @@ void tx_process(
 	double i_sample, q_sample, i_carrier;
 	// Check if browser microphone is active and use it instead of physical mic
 	int32_t browser_mic_samples[n_samples];
-	int use_browser_mic = is_browser_mic_active();
+	int32_t *mic_in = input_mic;
 
-	if (use_browser_mic) {
+	if (is_browser_mic_active()) {
 		// Get upsampled browser mic audio
 		upsample_browser_mic(browser_mic_samples, n_samples);
+		mic_in = browser_mic_samples;
+	}
+
+	// the one conversion into the float chain
+	float mic[n_samples];
+	for (i = 0; i < n_samples; i++)
+		mic[i] = mic_in[i] / TX_MIC_SCALE;
+
+	if (tx_meter.reset)
+	{
+		memset(&tx_meter, 0, sizeof(tx_meter));
 	}
 
 	struct rx *r = tx_list;
@@ -1890,76 +1999,62 @@ void tx_process(
 		eq_initialized = 1;
 	}
 
-	if (in_tx && (r->mode != MODE_DIGITAL && r->mode != MODE_FT8 && r->mode != MODE_FT4 && r->mode != MODE_2TONE && r->mode != MODE_CW && r->mode != MODE_CWR))
+	if (in_tx && (r->mode != MODE_DIGITAL && r->mode != MODE_FT8 && r->mode != MODE_FT4 && r->mode != MODE_2TONE && r->mode != MODE_CW && r->mode != MODE_CWR && r->mode != MODE_PSK31 && r->mode != MODE_RTTY))
 	{
 
+		tx_meter_peak(TX_METER_MIC, mic, n_samples);
+		tx_meter.voice_samples += n_samples;
+
 		// Apply compression is the value of the dial is set to 1-10 (0 = off)
 		if (compression_control_level >= 1 && compression_control_level <= 10)
-		{
-			float temp_input_mic[n_samples];
-			for (int i = 0; i < 5 && i < n_samples; i++)
-			{
-			}
-			// Convert input_mic (int32_t) to float for compression
-			for (int i = 0; i < n_samples; i++)
-			{
-				if (use_browser_mic) {
-					temp_input_mic[i] = (float)browser_mic_samples[i] / 2000000000.0;
-				} else {
-					temp_input_mic[i] = (float)input_mic[i] / 2000000000.0;
-				}
-			}
+			tx_meter.clipped_compressor += apply_fixed_compression(mic, n_samples, compression_control_level);
+		tx_meter_peak(TX_METER_COMPRESSOR, mic, n_samples);
 
-			for (int i = 0; i < 5 && i < n_samples; i++)
-			{
-			}
-			// Now we can call the apply_fixed_compression function with the parameters
-			apply_fixed_compression(temp_input_mic, n_samples, compression_control_level);
+		if (eq_is_enabled == 1)
+			apply_eq_float(&tx_eq, mic, n_samples, 96000.0);
+		tx_meter_peak(TX_METER_EQ, mic, n_samples);
 
-			for (int i = 0; i < 5 && i < n_samples; i++)
-			{
-			}
-			// Convert back the processed data to int32_t after compression
-			for (int i = 0; i < n_samples; i++)
-			{
-				if (use_browser_mic) {
-					browser_mic_samples[i] = (int32_t)(temp_input_mic[i] * 2000000000.0);
-				} else {
-					input_mic[i] = (int32_t)(temp_input_mic[i] * 2000000000.0);
-				}
-			}
-			for (int i = 0; i < 5 && i < n_samples; i++)
-			{
-			}
-		}
+		// apply CESSB processing if enabled (voice modes only)
+		if (cessb_enabled && (r->mode == MODE_USB || r->mode == MODE_LSB))
+			cessb_process_float(&cessb_processor, mic, n_samples, 2147483648.0 / TX_MIC_SCALE);
+		tx_meter_peak(TX_METER_CESSB, mic, n_samples);
+	}
 
-		if (eq_is_enabled == 1)
+	if (mute_count && (r->mode == MODE_USB || r->mode == MODE_LSB || r->mode == MODE_AM || r->mode == MODE_FM))
+	{
+		memset(mic, 0, n_samples * sizeof(float));
+		mute_count--;
+	}
+
+	// the recorder takes what we transmit, from input_mic
+	if (pf_record)
+		for (i = 0; i < n_samples; i++)
 		{
-			if (use_browser_mic) {
-				apply_eq(&tx_eq, browser_mic_samples, n_samples, 96000.0);
-			} else {
-				apply_eq(&tx_eq, input_mic, n_samples, 96000.0);
-			}
+			double v = mic[i] * TX_MIC_SCALE;
+			input_mic[i] = v > INT32_MAX ? INT32_MAX : (v < -INT32_MAX ? -INT32_MAX : v);
 		}
-    
-    // apply CESSB processing if enabled (voice modes only)
-    if (cessb_enabled && (r->mode == MODE_USB || r->mode == MODE_LSB)) {
-      if (use_browser_mic) {
-          cessb_process_int32(&cessb_processor, browser_mic_samples, n_samples);
-      } else {
-          cessb_process_int32(&cessb_processor, input_mic, n_samples);
-      }
-    }
-  }
 
-	if (mute_count && (r->mode == MODE_USB || r->mode == MODE_LSB || r->mode == MODE_AM || r->mode == MODE_FM))
+	// the constant envelope modes come ready made at the IF, with no
+	// SSB filter to go through
+	float if_signal[MAX_BINS / 2], if_audio[MAX_BINS / 2];
+	if (modem_next_if_block(r->mode, if_signal, if_audio, MAX_BINS / 2, tx_shift * 96000.0 / MAX_BINS))
 	{
-		memset(input_mic, 0, n_samples * sizeof(int32_t));
-		if (use_browser_mic) {
-			memset(browser_mic_samples, 0, n_samples * sizeof(int32_t));
+		// the same level as the filter path, which takes a third of the sample
+		// and, keeping one sideband of it, gains MAX_BINS / 2
+		double scale = volume * tx_amp * alc_level * MAX_BINS / 6;
+		for (i = 0; i < MAX_BINS / 2; i++)
+		{
+			output_speaker[i] = if_audio[i] / 3 * sidetone;
+			output_tx[i] = tx_dac(if_signal[i] * scale);
 		}
-		mute_count--;
+		for (i = 0; i < MAX_BINS / 2; i += 6)
+			q_write(&qremote, output_speaker[i]);
+		// don't leave these samples in the overlap for the filter path
+		tx_process_restart = 1;
+		tx_monitor(output_tx);
+		return;
 	}
+
 	// first add the previous M samples
 	for (i = 0; i < MAX_BINS / 2; i++)
 		fft_in[i] = fft_m[i];
@@ -1977,17 +2072,12 @@ void tx_process(
 			i_sample = (1.0 * (vfo_read(&tone_a) + vfo_read(&tone_b))) / 50000000000.0;
 		else if (r->mode == MODE_CALIBRATE)
 			i_sample = (1.0 * (vfo_read(&tone_a))) / 30000000000.0;
-		else if (r->mode == MODE_CW || r->mode == MODE_CWR || r->mode == MODE_FT8 || r->mode == MODE_FT4)
+		else if (r->mode == MODE_CW || r->mode == MODE_CWR || r->mode == MODE_PSK31)
 			i_sample = modem_next_sample(r->mode) / 3;
 		else if (r->mode == MODE_AM)
 		{
 			// double modulation = (1.0 * vfo_read(&tone_a)) / 1073741824.0;
-			double modulation;
-			if (use_browser_mic) {
-				modulation = (1.0 * browser_mic_samples[j]) / 200000000.0;
-			} else {
-				modulation = (1.0 * input_mic[j]) / 200000000.0;
-			}
+			double modulation = mic[j] * TX_MIC_SCALE / 200000000.0;
 			if (modulation < -1.0)
 				modulation = -1.0;
 			i_carrier = (1.0 * vfo_read(&am_carrier)) / 50000000000.0;
@@ -2029,11 +2119,7 @@ void tx_process(
 			// more drive than AM at the same mic setting:
 			//   input_mic / 2e8 × 2.17  ==  input_mic / 92000000
 			// This makes FM TX audio loudness track AM at the same MIC knob.
-			double mic_val;
-			if (use_browser_mic)
-				mic_val = (1.0 * browser_mic_samples[j]) / 92000000.0;
-			else
-				mic_val = (1.0 * input_mic[j]) / 92000000.0;
+			double mic_val = mic[j] * TX_MIC_SCALE / 92000000.0;
 
 			// 75 µs pre-emphasis: exact inverse of the RX de-emphasis IIR.
 			// RX de-emphasis:  H_de(z) = (1-α) / (1 - α·z⁻¹)
@@ -2082,13 +2168,7 @@ void tx_process(
 			q_sample = sin(fm_tx_phase) * FM_AMP;
 		}
 		else
-		{
-			if (use_browser_mic) {
-				i_sample = (1.0 * browser_mic_samples[j]) / 2000000000.0;
-			} else {
-				i_sample = (1.0 * input_mic[j]) / 2000000000.0;
-			}
-		}
+			i_sample = mic[j];
 
 		// clip the overdrive to prevent damage up the processing chain, PA
 		if (r->mode == MODE_USB || r->mode == MODE_LSB || r->mode == MODE_AM)
@@ -2098,9 +2178,15 @@ void tx_process(
 			i_sample_old =  i_sample_max;  // do exponential smoothing
 			
 			if (i_sample < (-1.0 * voice_clip_level))
+			{
 				i_sample = -1.0 * voice_clip_level;
+				tx_meter.clipped_voice++;
+			}
 			else if (i_sample > voice_clip_level)
+			{
 				i_sample = voice_clip_level;
+				tx_meter.clipped_voice++;
+			}
 		}
 
 		// Don't echo the voice modes
@@ -2208,8 +2294,7 @@ void tx_process(
 	scale = volume * tx_amp * alc_level * tx_mode_scale; // combine all scale factors
 	for (i = 0; i < MAX_BINS / 2; i++)
 	{
-		double s = creal(r->fft_time[i + (MAX_BINS / 2)]);
-		output_tx[i] = s * scale;
+		output_tx[i] = tx_dac(creal(r->fft_time[i + (MAX_BINS / 2)]) * scale);
 /*		if (min > output_tx[i])
 			min = output_tx[i];
 		if (max < output_tx[i])
@@ -2219,6 +2304,14 @@ void tx_process(
 	}
 	//	printf("min %d, max %d\n", min, max);
 
+	tx_monitor(output_tx);
+}
+
+// the power meter and the TX spectrum, from what went out to the DAC
+static void tx_monitor(int32_t *output_tx)
+{
+	int i;
+
 	read_power();
 
 	// Instead of using sdr_modulation_update, we'll update the spectrum data directly
@@ -2910,6 +3003,10 @@ void sdr_request(char *request, char *response)
 			rx_list->mode = MODE_AM;
 		else if (!strcmp(value, "FM"))
 			rx_list->mode = MODE_FM;
+		else if (!strcmp(value, "PSK31"))
+			rx_list->mode = MODE_PSK31;
+		else if (!strcmp(value, "RTTY"))
+			rx_list->mode = MODE_RTTY;
 		else if (!strcmp(value, "DIGI"))
 			rx_list->mode = MODE_DIGITAL;
 		else
@@ -46,11 +46,14 @@ The initial sync between the gui values, the core radio values, settings, et al
 #include "remote.h"
 #include "modem_ft8.h"
 #include "modem_cw.h"
+#include "modem_psk.h"
+#include "modem_rtty.h"
 #include "i2cbb.h"
 #include "adif_broadcast.h"
 #include "udp_broadcast.h"
 #include "webserver.h"
 #include "logbook.h"
+#include "scp.h"
 #include "hist_disp.h"
 #include "quick_options.h"
 #include "ntputil.h"
@@ -945,7 +948,7 @@ struct field main_controls[] = {
 
 	// Band Stuff.
 	{"r1:mode", do_mode_dropdown, 5, 5, 40, 40, "MODE", 40, "USB", FIELD_DROPDOWN, STYLE_FIELD_VALUE,
-	 "USB/LSB/AM/FM/CW/CWR/FT8/FT4/DIGI/2TONE", 0, 0, 0, COMMON_CONTROL},
+	 "USB/LSB/AM/FM/CW/CWR/FT8/FT4/PSK31/RTTY/DIGI/2TONE", 0, 0, 0, COMMON_CONTROL},
 	{"#band", do_band_dropdown, 45, 5, 40, 40, "80M", 40, "=---", FIELD_DROPDOWN, STYLE_FIELD_VALUE,
 	 "80M/60M/40M/30M/20M/17M/15M/12M/10M", 0, 0, 0, COMMON_CONTROL},
 	{"#band_stack_pos", do_band_stack_position, 85, 5, 45, 40, "", 1, "USB\n14200", FIELD_DROPDOWN, STYLE_FIELD_VALUE,
@@ -1078,6 +1081,8 @@ struct field main_controls[] = {
 	 "BLANK/LEFT/RIGHT/CROSSHAIR", 0, 0, 0, 0},
 	{"recent_qso_age", NULL, 1000, -1000, 50, 50, "RECENT_QSO_AGE", 40, "24", FIELD_NUMBER, STYLE_FIELD_VALUE,
 	 "", 0, 99999, 1, 0}, // age in hours that we consider "recent" enough to avoid calling again
+	{"#logbook_sync", NULL, 1000, -1000, 50, 50, "LOGBOOK_SYNC", 40, "NORMAL", FIELD_SELECTION, STYLE_FIELD_VALUE,
+	 "OFF/NORMAL/FULL", 0, 0, 0, 0}, // sqlite synchronous mode for logbook writes
 
 	// parametric 5-band eq controls  ( BX[F|G|B] = Band# Frequency | Gain | Bandwidth W2JON
 	{"#eq_b0f", do_eq_edit, 1000, -1000, 40, 40, "B0F", 40, "80", FIELD_NUMBER, STYLE_FIELD_VALUE,
@@ -1378,6 +1383,10 @@ struct field main_controls[] = {
 	 "", 100, 3000, 10, FT8_CONTROL | DIGITAL_CONTROL}, // substitute for rx_pitch only in FTx modes
 	{"#ftx_rules", NULL, 1000, -1000, 50, 50, "RULES", 40, "", FIELD_BUTTON, STYLE_FIELD_VALUE,
 	 "", 0, 0, 0, 0, FT8_CONTROL},
+	{"#ftx_both", NULL, 1000, -1000, 50, 50, "FTX_BOTH", 40, "OFF", FIELD_TOGGLE, STYLE_FIELD_VALUE,
+	 "ON/OFF", 0, 0, 0, 0}, // decode FT4 while in FT8, and vice versa
+	{"#ftx_budget", NULL, 1000, -1000, 50, 50, "FTX_BUDGET", 40, "1500", FIELD_NUMBER, STYLE_FIELD_VALUE,
+	 "", 300, 5000, 100, 0}, // ms after the end of an FT8 slot that decoding may take
 
 	{"#telneturl", NULL, 1000, -1000, 400, 149, "TELNETURL", 70, "dxc.nc7j.com:7373", FIELD_TEXT, STYLE_SMALL,
 	 "", 0, 32, 1, 0},
@@ -1391,6 +1400,20 @@ struct field main_controls[] = {
 	 "ON/OFF", 0, 0, 0, 0},
 	{"#udp_destinations", NULL, 1000, -1000, 300, 50, "UDP_DESTINATIONS", 140, "127.0.0.1:2237", FIELD_TEXT, STYLE_SMALL,
 	 "", 0, 255, 1, 0},
+	{"#ftx_skim", NULL, 1000, -1000, 300, 50, "FTX_SKIM", 140, "", FIELD_TEXT, STYLE_SMALL,
+	 "", 0, 64, 1, 0},
+	{"#cw_skim", NULL, 1000, -1000, 300, 50, "CW_SKIM", 140, "", FIELD_TEXT, STYLE_SMALL,
+	 "", 0, 32, 1, 0},
+	{"#psk", NULL, 1000, -1000, 300, 50, "PSK", 140, "31", FIELD_TEXT, STYLE_SMALL,
+	 "", 0, 8, 1, 0},
+	{"#psk_skim", NULL, 1000, -1000, 300, 50, "PSK_SKIM", 140, "", FIELD_TEXT, STYLE_SMALL,
+	 "", 0, 8, 1, 0},
+	{"#rtty", NULL, 1000, -1000, 300, 50, "RTTY", 140, "45", FIELD_TEXT, STYLE_SMALL,
+	 "", 0, 8, 1, 0},
+	{"#rtty_shift", NULL, 1000, -1000, 300, 50, "RTTY_SHIFT", 140, "AUTO", FIELD_TEXT, STYLE_SMALL,
+	 "", 0, 8, 1, 0},
+	{"#rtty_skim", NULL, 1000, -1000, 300, 50, "RTTY_SKIM", 140, "", FIELD_TEXT, STYLE_SMALL,
+	 "", 0, 8, 1, 0},
 
   // macros keyboard
 
@@ -1948,6 +1971,43 @@ uint32_t write_console_semantic(const char *text, const text_span_semantic *sem,
 	return newline ? console_last_row - 1 : console_last_row;
 }
 
+// super check partial candidates for what is typed into CALL (see scp.h)
+static char scp_line[MAX_LINE_LENGTH];
+static char scp_partial[SCP_CALL_LEN];
+static unsigned int scp_line_generation = 0;
+
+/*!
+	While the CALL field has focus and holds at least SCP_MIN_PARTIAL
+	characters, return the calls that contain it, best first, for the
+	bottom row of the console; otherwise NULL.
+	The lookup is only repeated when the text or the known calls change.
+*/
+static const char* scp_console_line()
+{
+	struct field* f = get_field("#contact_callsign");
+	if (!f || f_focus != f || strlen(f->value) < SCP_MIN_PARTIAL)
+		return NULL;
+	if (strcmp(f->value, scp_partial) || scp_generation() != scp_line_generation) {
+		scp_match matches[SCP_MAX_MATCHES];
+		int n = scp_query(f->value, matches, SCP_MAX_MATCHES);
+		int len = 0;
+		scp_line[0] = 0;
+		for (int i = 0; i < n && len < sizeof(scp_line); i++)
+			len += snprintf(scp_line + len, sizeof(scp_line) - len, "%s%s", i ? " " : "", matches[i].call);
+		strncpy(scp_partial, f->value, sizeof(scp_partial) - 1);
+		scp_line_generation = scp_generation();
+	}
+	return scp_line[0] ? scp_line : NULL;
+}
+
+// redraw the console if the focus moved to or from CALL, to show or hide the candidates
+static void scp_focus_changed(struct field* prev_focus)
+{
+	struct field* f = get_field("#contact_callsign");
+	if (prev_focus != f_focus && (prev_focus == f || f_focus == f))
+		soft_console_init();
+}
+
 void draw_console(cairo_t* gfx, struct field* f)
 {
 	// save then change console font heights when bigfont is enabled
@@ -1962,6 +2022,10 @@ void draw_console(cairo_t* gfx, struct field* f)
 
 	int line_height = font_table[f->font_index].height;
 	int n_lines = (f->height / line_height) - 1;
+	// keep the bottom row for the super check partial candidates
+	const char* scp = scp_console_line();
+	if (scp)
+		n_lines--;
 
 	rect(gfx, f->x, f->y, f->width, f->height, COLOR_CONTROL_BOX, 1);
 
@@ -2068,6 +2132,17 @@ void draw_console(cairo_t* gfx, struct field* f)
 			start_line = 0;
 	}
 
+	if (scp) {
+		char buf[MAX_LINE_LENGTH];
+		snprintf(buf, MIN(sizeof(buf), console_cols + 1), "%s", scp);
+		// don't show part of a call
+		char* space = strrchr(buf, ' ');
+		if (strlen(buf) < strlen(scp) && scp[strlen(buf)] != ' ' && space)
+			*space = 0;
+		fill_rect(gfx, f->x + 1, y + 1, f->width - 2, line_height, COLOR_BACKGROUND);
+		draw_text(gfx, f->x + 2, y, buf, STYLE_HIGHLIGHT);
+	}
+
 	// restore embiggen'd font height
 	if (bigfont_enabled) {
 		for (int i = STYLE_LOG; i <= STYLE_TELNET; i++) {
@@ -5456,6 +5531,8 @@ static void layout_ui()
   }
   break;
 
+  case MODE_PSK31:
+  case MODE_RTTY:
   case MODE_DIGITAL:
   {
     const int row_h   = SC(37);
@@ -5744,6 +5821,7 @@ static void focus_field(struct field *f)
 		focus_since = millis();
 	}
 	update_field(f_hover);
+	scp_focus_changed(prev_focus);
 
 	// is it a toggle field?
 	if (f_focus->value_type == FIELD_TOGGLE)
@@ -5775,6 +5853,7 @@ static void focus_field_without_toggle(struct field *f)
 		update_field(f_hover);
 		update_field(prev_focus);
 		update_field(prev_hover);
+		scp_focus_changed(prev_focus);
 		if (f_focus->value_type == FIELD_TEXT)
 			f_last_text = f_focus;
 	}
@@ -7909,6 +7988,7 @@ void modify_eq_band_frequency(parametriceq *eq, int band_index, double new_frequ
 	if (band_index >= 0 && band_index < NUM_BANDS)
 	{
 		eq->bands[band_index].frequency = new_frequency;
+		atomic_fetch_add_explicit(&eq->changes, 1, memory_order_release);
 		// print_eq_int(eq);
 	}
 	else
@@ -7933,6 +8013,7 @@ void modify_eq_band_gain(parametriceq *eq, int band_index, double new_gain)
 			new_gain = 16.0;
 		}
 		eq->bands[band_index].gain = new_gain;
+		atomic_fetch_add_explicit(&eq->changes, 1, memory_order_release);
 		// print_eq_int(eq);
 		// fflush(stdout);
 	}
@@ -7948,6 +8029,7 @@ void modify_eq_band_bandwidth(parametriceq *eq, int band_index, double new_bandw
 	if (band_index >= 0 && band_index < NUM_BANDS)
 	{
 		eq->bands[band_index].bandwidth = new_bandwidth;
+		atomic_fetch_add_explicit(&eq->changes, 1, memory_order_release);
 		//       print_eq_int(eq);
 	}
 	else
@@ -8405,6 +8487,10 @@ void tx_on(int trigger)
 			tx_mode = MODE_AM;
 		else if (!strcmp(f->value, "2TONE"))
 			tx_mode = MODE_2TONE;
+		else if (!strcmp(f->value, "PSK31"))
+			tx_mode = MODE_PSK31;
+		else if (!strcmp(f->value, "RTTY"))
+			tx_mode = MODE_RTTY;
 		else if (!strcmp(f->value, "DIGI"))
 			tx_mode = MODE_DIGITAL;
 		else if (!strcmp(f->value, "TUNE")) // Defined TUNE mode - W9JES
@@ -9609,6 +9695,9 @@ void hw_init()
 
 	wiringPiISR(ENC2_A, INT_EDGE_BOTH, tuning_isr);
 	wiringPiISR(ENC2_B, INT_EDGE_BOTH, tuning_isr);
+	// the CW paddles (or straight key) wake the keyer thread in modem_cw.c
+	wiringPiISR(PTT, INT_EDGE_BOTH, cw_key_isr);
+	wiringPiISR(DASH, INT_EDGE_BOTH, cw_key_isr);
 }
 
 void hamlib_tx(int tx_input)
@@ -11578,6 +11667,149 @@ else if (!strcasecmp(exec, "decode"))
 			write_console(STYLE_LOG, "Usage: \\decode on|off\n");
 		}
 	}
+	else if (!strcasecmp(exec, "import"))
+	{
+		// \import <file>: relative paths are in the data folder, where Export saves
+		char path[PATH_MAX];
+		if (!strlen(args))
+			write_console(STYLE_LOG, "Usage: \\import <file.adi>\n");
+		else {
+			if (args[0] == '/')
+				snprintf(path, sizeof(path), "%s", args);
+			else
+				snprintf(path, sizeof(path), "%s/sbitx/data/%s", getenv("HOME"), args);
+			logbook_import_start(path);
+		}
+	}
+	else if (!strcasecmp(exec, "scp"))
+	{
+		// \scp <partial>: super check partial; \scp bench: time lookups
+		char report[300];
+		if (!strcasecmp(args, "bench"))
+			scp_benchmark(report, sizeof(report));
+		else if (!strcasecmp(args, "reload")) {
+			scp_build_start();
+			snprintf(report, sizeof(report), "Reloading %s and the logbook calls\n", SCP_FILE);
+		} else {
+			scp_match matches[SCP_MAX_MATCHES];
+			int n = scp_query(args, matches, SCP_MAX_MATCHES);
+			int len = snprintf(report, sizeof(report), n ? "SCP %s:" : "SCP %s: no match", args);
+			for (int i = 0; i < n && len < sizeof(report); i++)
+				len += snprintf(report + len, sizeof(report) - len, " %s%s", matches[i].call,
+					(matches[i].flags & SCP_LOGGED) ? "*" : "");
+			if (len < sizeof(report) - 1)
+				strcat(report, "\n");
+		}
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "ftxboth"))
+	{
+		// \ftxboth on|off: decode the other of FT8/FT4 from the same audio too
+		if (!strcasecmp(args, "on"))
+			set_field("#ftx_both", "ON");
+		else if (!strcasecmp(args, "off"))
+			set_field("#ftx_both", "OFF");
+		char report[80];
+		snprintf(report, sizeof(report), "Decoding both FT8 and FT4: %s\n", field_str("FTX_BOTH"));
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "ftxbudget"))
+	{
+		// \ftxbudget [ms]: how long FT8 decoding may take before candidates are skipped
+		char report[100];
+		if (args[0])
+			set_field("#ftx_budget", args);
+		snprintf(report, sizeof(report), "FTx decode budget: %d ms for FT8, %d ms for FT4\n",
+			field_int("FTX_BUDGET"), field_int("FTX_BUDGET") / 2);
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "skim"))
+	{
+		// \skim <offset[:FT4]> ...: decode FTx on more channels of the IQ spectrum
+		char report[100];
+		if (!strcasecmp(args, "off"))
+			set_field("#ftx_skim", "");
+		else if (args[0])
+			set_field("#ftx_skim", args);
+		const char *channels = field_str("FTX_SKIM");
+		snprintf(report, sizeof(report), "FTx skimmer: %s\n", channels && channels[0] ? channels : "off");
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "cwkeyer"))
+	{
+		// \cwkeyer [reset]: keyer thread timing histograms
+		char report[2000];
+		cw_keyer_report(report, sizeof(report), !strcasecmp(args, "reset"));
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "cwskim"))
+	{
+		// \cwskim <low> <high>: decode CW on every bin from low to high Hz around the dial
+		char report[5000];
+		if (!strcasecmp(args, "off"))
+			set_field("#cw_skim", "");
+		else if (args[0])
+			set_field("#cw_skim", args);
+		cw_skim_report(report, sizeof(report));
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "psk"))
+	{
+		// \psk 31|63, \psk skim on|off: the baud rate, and decoding every signal in the passband
+		char report[2000];
+		if (!strcmp(args, "31") || !strcmp(args, "63"))
+			set_field("#psk", args);
+		else if (!strcasecmp(args, "skim on"))
+			set_field("#psk_skim", "ON");
+		else if (!strcasecmp(args, "skim off"))
+			set_field("#psk_skim", "");
+		else if (args[0])
+			write_console(STYLE_LOG, "Usage: \\psk 31|63 or \\psk skim on|off\n");
+		psk_report(report, sizeof(report));
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "rtty"))
+	{
+		// \rtty 45|50|75, \rtty shift auto|170|200|425|850, \rtty skim on|off
+		char report[2000];
+		if (!strcmp(args, "45") || !strcmp(args, "45.45"))
+			set_field("#rtty", "45");
+		else if (!strcmp(args, "50") || !strcmp(args, "75"))
+			set_field("#rtty", args);
+		else if (!strcasecmp(args, "shift auto"))
+			set_field("#rtty_shift", "AUTO");
+		else if (!strcmp(args, "shift 170") || !strcmp(args, "shift 200")
+			|| !strcmp(args, "shift 425") || !strcmp(args, "shift 850"))
+			set_field("#rtty_shift", args + 6);
+		else if (!strcasecmp(args, "skim on"))
+			set_field("#rtty_skim", "ON");
+		else if (!strcasecmp(args, "skim off"))
+			set_field("#rtty_skim", "");
+		else if (args[0])
+			write_console(STYLE_LOG, "Usage: \\rtty 45|50|75, \\rtty shift auto|170|200|425|850 or \\rtty skim on|off\n");
+		rtty_report(report, sizeof(report));
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "txmeter"))
+	{
+		// \txmeter [reset]: TX audio peaks and clipping along the chain
+		char report[1000];
+		if (!strcasecmp(args, "reset"))
+			tx_meter_reset();
+		else if (args[0])
+			write_console(STYLE_LOG, "Usage: \\txmeter or \\txmeter reset\n");
+		tx_meter_report(report, sizeof(report));
+		write_console(STYLE_LOG, report);
+	}
+	else if (!strcasecmp(exec, "awards"))
+	{
+		// \awards: DXCC entities and grids worked, per band
+		char report[1000];
+		if (logbook_awards_report(report, sizeof(report)))
+			write_console(STYLE_LOG, report);
+		else
+			write_console(STYLE_LOG, "The logbook is still loading\n");
+	}
   else if (!strcasecmp(exec, "bigfont")) {
     if (!strlen(args)) {
       char msg[64];
@@ -0,0 +1,533 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "scp.h"
+#include "qso_index.h"
+
+/*
+	The suffix array holds one entry per character of every call:
+	(call index << 4) | offset, sorted by the text from that offset on.
+	All the calls containing a partial string are then one contiguous
+	range of it, found with two binary searches, and only that range is
+	scored. A table is never changed once built (apart from the flags and
+	heard times of its calls), so it is built without holding the lock
+	and swapped in. Calls that are neither in the master file nor in the
+	log when the table is built go into the recent list, which is short
+	enough to scan with strstr().
+	A short partial can match tens of thousands of suffixes, so the length
+	and flags of the calls are kept in small arrays of their own: scoring
+	a suffix then doesn't have to touch the call text.
+*/
+
+#define SCP_HASH_INITIAL_SIZE 4096
+#define SCP_BENCHMARK_QUERIES 2000
+
+struct scp_entry {
+	char call[SCP_CALL_LEN];
+	uint8_t len;
+	uint8_t flags;
+	time_t heard;
+};
+
+struct scp_table {
+	struct scp_entry *entries;
+	uint8_t *lens, *flags;	// per entry, kept apart (see above); once built, these flags are the live ones
+	int n, cap;
+	uint32_t *suffixes;
+	int n_suffixes;
+	int32_t *hash;		// index in entries[], or -1 if the slot is empty
+	int hash_size;
+};
+
+static pthread_mutex_t scp_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t build_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct scp_table table;
+static struct scp_entry recent[SCP_RECENT_SIZE];
+static int recent_n = 0;
+static unsigned int generation = 0;
+static bool build_running = false;
+
+// the entries being sorted, for suffix_cmp() (builds are serialized by build_mutex)
+static const struct scp_entry *sort_entries;
+
+static uint32_t call_hash(const char *key)
+{
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	while (*key) {
+		h ^= (uint8_t)*key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/*!
+	Copy \a src into \a dst (SCP_CALL_LEN) uppercased, without the <> around
+	a hashed FTx callsign, stopping at a space. Returns the length, or 0 if
+	it has anything but letters, digits and / or doesn't fit.
+*/
+static int normalize(char *dst, const char *src)
+{
+	int len = 0;
+	if (!src)
+		return 0;
+	if (*src == '<')
+		src++;
+	for (; *src && *src != ' ' && *src != '>' && *src != '\n'; src++) {
+		char c = toupper((unsigned char)*src);
+		if (len >= SCP_CALL_LEN - 1 || !(isupper((unsigned char)c) || isdigit((unsigned char)c) || c == '/'))
+			return 0;
+		dst[len++] = c;
+	}
+	dst[len] = 0;
+	return len;
+}
+
+// Does \a call look like a callsign: at least 3 characters, with a letter and a digit?
+static bool is_callsign(const char *call, int len)
+{
+	bool letter = false, digit = false;
+	for (int i = 0; i < len; i++) {
+		letter |= isupper((unsigned char)call[i]) != 0;
+		digit |= isdigit((unsigned char)call[i]) != 0;
+	}
+	return len >= 3 && letter && digit;
+}
+
+static int table_find(const struct scp_table *t, const char *call)
+{
+	if (!t->hash_size)
+		return -1;
+	uint32_t i = call_hash(call) & (t->hash_size - 1);
+	while (t->hash[i] >= 0) {
+		if (!strcmp(t->entries[t->hash[i]].call, call))
+			return t->hash[i];
+		i = (i + 1) & (t->hash_size - 1);
+	}
+	return -1;
+}
+
+static void table_hash_insert(struct scp_table *t, int entry)
+{
+	uint32_t i = call_hash(t->entries[entry].call) & (t->hash_size - 1);
+	while (t->hash[i] >= 0)
+		i = (i + 1) & (t->hash_size - 1);
+	t->hash[i] = entry;
+}
+
+static void table_hash_grow(struct scp_table *t)
+{
+	free(t->hash);
+	t->hash_size = t->hash_size ? t->hash_size * 2 : SCP_HASH_INITIAL_SIZE;
+	t->hash = malloc(t->hash_size * sizeof(int32_t));
+	memset(t->hash, 0xff, t->hash_size * sizeof(int32_t));
+	for (int e = 0; e < t->n; e++)
+		table_hash_insert(t, e);
+}
+
+// Add \a callsign to \a t (while building it), or add \a flags to it if it is there already.
+static void table_add(struct scp_table *t, const char *callsign, int flags)
+{
+	char call[SCP_CALL_LEN];
+	int len = normalize(call, callsign);
+	if (!is_callsign(call, len))
+		return;
+	int e = table_find(t, call);
+	if (e >= 0) {
+		t->entries[e].flags |= flags;
+		return;
+	}
+	if ((t->n + 1) * 2 >= t->hash_size)
+		table_hash_grow(t);
+	if (t->n == t->cap) {
+		t->cap = t->cap ? t->cap * 2 : 1024;
+		t->entries = realloc(t->entries, t->cap * sizeof(struct scp_entry));
+	}
+	struct scp_entry *entry = &t->entries[t->n];
+	memset(entry, 0, sizeof(*entry));
+	memcpy(entry->call, call, len + 1);
+	entry->len = len;
+	entry->flags = flags;
+	table_hash_insert(t, t->n++);
+}
+
+static void table_free(struct scp_table *t)
+{
+	free(t->entries);
+	free(t->lens);
+	free(t->flags);
+	free(t->suffixes);
+	free(t->hash);
+	memset(t, 0, sizeof(*t));
+}
+
+static int suffix_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	int c = strcmp(sort_entries[x >> 4].call + (x & 15), sort_entries[y >> 4].call + (y & 15));
+	return c ? c : (x > y) - (x < y);
+}
+
+static void table_sort(struct scp_table *t)
+{
+	int n = 0;
+	t->lens = malloc(t->n ? t->n : 1);
+	t->flags = malloc(t->n ? t->n : 1);
+	for (int e = 0; e < t->n; e++) {
+		t->lens[e] = t->entries[e].len;
+		t->flags[e] = t->entries[e].flags;
+		n += t->entries[e].len;
+	}
+	t->suffixes = malloc((n ? n : 1) * sizeof(uint32_t));
+	for (int e = 0; e < t->n; e++)
+		for (int off = 0; off < t->entries[e].len; off++)
+			t->suffixes[t->n_suffixes++] = ((uint32_t)e << 4) | off;
+	sort_entries = t->entries;
+	qsort(t->suffixes, t->n_suffixes, sizeof(uint32_t), suffix_cmp);
+}
+
+static void table_add_logged(const char *callsign, void *user)
+{
+	table_add(user, callsign, SCP_LOGGED);
+}
+
+static int load_master(struct scp_table *t, const char *path)
+{
+	char line[100];
+	int count = 0;
+	FILE *pf = fopen(path, "r");
+	if (!pf)
+		return -1;
+	while (fgets(line, sizeof(line), pf)) {
+		if (line[0] == '#')
+			continue;
+		char *call = strtok(line, " \t\r\n");
+		if (call) {
+			table_add(t, call, SCP_MASTER);
+			count++;
+		}
+	}
+	fclose(pf);
+	return count;
+}
+
+/*!
+	Build the suffix array from the master call file at \a master_path
+	(which need not exist) and the calls in the QSO index, and start using it.
+	Heard and logged calls are carried over from the previous table.
+	Returns the number of distinct calls.
+*/
+int scp_build(const char *master_path)
+{
+	struct scp_table t, old;
+	struct timespec t0, t1;
+
+	pthread_mutex_lock(&build_mutex);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	memset(&t, 0, sizeof(t));
+	table_hash_grow(&t);
+	int master = load_master(&t, master_path);
+	qso_index_calls(table_add_logged, &t);
+	table_sort(&t);
+
+	pthread_mutex_lock(&scp_mutex);
+	old = table;
+	table = t;
+	// what was only known from this session stays in (or moves to) the recent list
+	int kept = 0;
+	for (int i = 0; i < recent_n; i++) {
+		int e = table_find(&table, recent[i].call);
+		if (e >= 0) {
+			table.flags[e] |= recent[i].flags;
+			table.entries[e].heard = recent[i].heard;
+		} else
+			recent[kept++] = recent[i];
+	}
+	recent_n = kept;
+	for (int i = 0; i < old.n; i++) {
+		if (!(old.flags[i] & SCP_HEARD))
+			continue;
+		int e = table_find(&table, old.entries[i].call);
+		if (e >= 0) {
+			table.flags[e] |= SCP_HEARD;
+			table.entries[e].heard = old.entries[i].heard;
+		} else if (recent_n < SCP_RECENT_SIZE) {
+			recent[recent_n] = old.entries[i];
+			recent[recent_n++].flags = old.flags[i];
+		}
+	}
+	generation++;
+	pthread_mutex_unlock(&scp_mutex);
+	table_free(&old);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	printf("Super check partial: %d calls (%d from %s), %d suffixes in %ld ms\n",
+		t.n, master > 0 ? master : 0, master_path, t.n_suffixes,
+		(t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000);
+	pthread_mutex_unlock(&build_mutex);
+	return t.n;
+}
+
+static void *scp_build_thread(void *arg)
+{
+	(void)arg;
+	scp_build(SCP_FILE);
+	pthread_mutex_lock(&scp_mutex);
+	build_running = false;
+	pthread_mutex_unlock(&scp_mutex);
+	return NULL;
+}
+
+// (Re)build the tables in a background thread, unless that is already going on.
+void scp_build_start()
+{
+	pthread_t thread;
+	pthread_mutex_lock(&scp_mutex);
+	bool start = !build_running;
+	build_running = true;
+	pthread_mutex_unlock(&scp_mutex);
+	if (!start)
+		return;
+	if (pthread_create(&thread, NULL, scp_build_thread, NULL)) {
+		pthread_mutex_lock(&scp_mutex);
+		build_running = false;
+		pthread_mutex_unlock(&scp_mutex);
+		return;
+	}
+	pthread_detach(thread);
+}
+
+/*!
+	Note that \a callsign was just logged (\a flag = SCP_LOGGED)
+	or heard (SCP_HEARD). Anything that doesn't look like a call is ignored.
+*/
+void scp_add(const char *callsign, int flag)
+{
+	char call[SCP_CALL_LEN];
+	int len = normalize(call, callsign);
+	if (!is_callsign(call, len))
+		return;
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&scp_mutex);
+	int e = table_find(&table, call);
+	if (e >= 0) {
+		if (!(table.flags[e] & flag))
+			generation++;
+		table.flags[e] |= flag;
+		if (flag == SCP_HEARD)
+			table.entries[e].heard = now;
+		pthread_mutex_unlock(&scp_mutex);
+		return;
+	}
+	struct scp_entry *entry = NULL;
+	for (int i = 0; !entry && i < recent_n; i++)
+		if (!strcmp(recent[i].call, call))
+			entry = &recent[i];
+	if (!entry) {
+		if (recent_n < SCP_RECENT_SIZE)
+			entry = &recent[recent_n++];
+		else {
+			// replace the call that was heard longest ago
+			entry = &recent[0];
+			for (int i = 1; i < recent_n; i++)
+				if (recent[i].heard < entry->heard)
+					entry = &recent[i];
+		}
+		memset(entry, 0, sizeof(*entry));
+		memcpy(entry->call, call, len + 1);
+		entry->len = len;
+	}
+	if (!(entry->flags & flag))
+		generation++;
+	entry->flags |= flag;
+	if (flag == SCP_HEARD)
+		entry->heard = now;
+	pthread_mutex_unlock(&scp_mutex);
+}
+
+static int scp_score(int len, int flags, time_t heard, int offset, int partial_len, time_t now)
+{
+	int score = 0;
+	if (!offset)
+		score += len == partial_len ? 1000 : 100;
+	if (flags & SCP_HEARD) {
+		int minutes = (now - heard) / 60;
+		score += minutes < 15 ? 600 : minutes < 120 ? 300 : 150;
+	}
+	if (flags & SCP_LOGGED)
+		score += 400;
+	if (flags & SCP_MASTER)
+		score += 50;
+	return score - (len - partial_len); // the closer in length the better
+}
+
+struct scp_candidates {
+	scp_match *matches;
+	int ids[SCP_MAX_MATCHES];	// entries[] index, or -1 - recent[] index
+	int n, max;
+	int worst;		// index in matches of the lowest score, once there are max
+};
+
+// call with scp_mutex locked
+static void candidate_add(struct scp_candidates *c, int id, const struct scp_entry *entry, int flags, int score)
+{
+	if (c->n == c->max && score <= c->matches[c->worst].score)
+		return;
+	// a call can contain the partial more than once: keep the best
+	for (int i = 0; i < c->n; i++)
+		if (c->ids[i] == id) {
+			if (score > c->matches[i].score)
+				c->matches[i].score = score;
+			return;
+		}
+	int slot = c->n < c->max ? c->n++ : c->worst;
+	scp_match *m = &c->matches[slot];
+	memcpy(m->call, entry->call, sizeof(m->call));
+	m->flags = flags;
+	m->heard = entry->heard;
+	m->score = score;
+	c->ids[slot] = id;
+	if (c->n == c->max) {
+		c->worst = 0;
+		for (int i = 1; i < c->n; i++)
+			if (c->matches[i].score < c->matches[c->worst].score)
+				c->worst = i;
+	}
+}
+
+static int match_cmp(const void *a, const void *b)
+{
+	const scp_match *x = a, *y = b;
+	if (x->score != y->score)
+		return y->score - x->score;
+	return strcmp(x->call, y->call);
+}
+
+/*!
+	Find up to \a max_matches (at most SCP_MAX_MATCHES) calls that contain
+	\a partial, best first: calls that start with it, or were heard just now,
+	or are in the log, rank above the rest. Returns the number found.
+*/
+int scp_query(const char *partial, scp_match *matches, int max_matches)
+{
+	char q[SCP_CALL_LEN];
+	int q_len = normalize(q, partial);
+	struct scp_candidates c;
+
+	if (q_len < SCP_MIN_PARTIAL || max_matches <= 0)
+		return 0;
+	c.matches = matches;
+	c.n = 0;
+	c.worst = 0;
+	c.max = max_matches < SCP_MAX_MATCHES ? max_matches : SCP_MAX_MATCHES;
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&scp_mutex);
+	// the first suffix that starts with q, and the first after those
+	int lo = 0, hi = table.n_suffixes;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		uint32_t s = table.suffixes[mid];
+		if (strncmp(table.entries[s >> 4].call + (s & 15), q, q_len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	int first = lo;
+	hi = table.n_suffixes;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		uint32_t s = table.suffixes[mid];
+		if (strncmp(table.entries[s >> 4].call + (s & 15), q, q_len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (int i = first; i < lo; i++) {
+		uint32_t s = table.suffixes[i];
+		int e = s >> 4, flags = table.flags[e];
+		int score = scp_score(table.lens[e], flags, (flags & SCP_HEARD) ? table.entries[e].heard : 0,
+			s & 15, q_len, now);
+		candidate_add(&c, e, &table.entries[e], flags, score);
+	}
+	for (int i = 0; i < recent_n; i++) {
+		const char *p = strstr(recent[i].call, q);
+		if (p)
+			candidate_add(&c, -1 - i, &recent[i], recent[i].flags,
+				scp_score(recent[i].len, recent[i].flags, recent[i].heard, p - recent[i].call, q_len, now));
+	}
+	pthread_mutex_unlock(&scp_mutex);
+
+	qsort(matches, c.n, sizeof(scp_match), match_cmp);
+	return c.n;
+}
+
+// Changes whenever the set of calls (or what is known about them) changes.
+unsigned int scp_generation()
+{
+	return generation;
+}
+
+void scp_stats(int *calls, int *recent_calls)
+{
+	pthread_mutex_lock(&scp_mutex);
+	if (calls)
+		*calls = table.n;
+	if (recent_calls)
+		*recent_calls = recent_n;
+	pthread_mutex_unlock(&scp_mutex);
+}
+
+static int long_cmp(const void *a, const void *b)
+{
+	long x = *(const long *)a, y = *(const long *)b;
+	return (x > y) - (x < y);
+}
+
+/*!
+	Time SCP_BENCHMARK_QUERIES lookups of 2 to 4 character pieces of the
+	known calls, picked the same way every time, and write a summary
+	into \a report (size \a len). Returns the length of the summary.
+*/
+int scp_benchmark(char *report, int len)
+{
+	static char partials[SCP_BENCHMARK_QUERIES][5];
+	static long ns[SCP_BENCHMARK_QUERIES];
+	scp_match matches[SCP_MAX_MATCHES];
+	long total = 0, found = 0;
+	int n = 0;
+
+	pthread_mutex_lock(&scp_mutex);
+	for (int i = 0; table.n && i < SCP_BENCHMARK_QUERIES; i++) {
+		const struct scp_entry *entry = &table.entries[(i * 7919L) % table.n];
+		int q_len = SCP_MIN_PARTIAL + i % 3;
+		if (q_len > entry->len)
+			q_len = entry->len;
+		int off = (i / 3) % (entry->len - q_len + 1);
+		memcpy(partials[n], entry->call + off, q_len);
+		partials[n++][q_len] = 0;
+	}
+	pthread_mutex_unlock(&scp_mutex);
+	if (!n)
+		return snprintf(report, len, "Super check partial: no calls loaded\n");
+
+	for (int i = 0; i < n; i++) {
+		struct timespec t0, t1;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		found += scp_query(partials[i], matches, SCP_MAX_MATCHES);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ns[i] = (t1.tv_sec - t0.tv_sec) * 1000000000L + (t1.tv_nsec - t0.tv_nsec);
+		total += ns[i];
+	}
+	qsort(ns, n, sizeof(long), long_cmp);
+	int calls, recent_calls;
+	scp_stats(&calls, &recent_calls);
+	return snprintf(report, len, "Super check partial: %d queries over %d + %d calls, %ld matches: "
+		"mean %ld us, median %ld us, 99%% %ld us, max %ld us\n",
+		n, calls, recent_calls, found, total / n / 1000, ns[n / 2] / 1000,
+		ns[n * 99 / 100] / 1000, ns[n - 1] / 1000);
+}
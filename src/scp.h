@@ -0,0 +1,42 @@
+#ifndef SCP_H
+#define SCP_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/*
+	Super check partial: given part of a callsign, find the known calls that
+	contain it. The known calls are the master call file (MASTER.SCP, one
+	call per line, as distributed for contest loggers), the calls in the
+	logbook, and the calls heard on FT8/FT4 and CW during this session.
+	The first two go into a suffix array, built in the background; calls
+	logged or heard after that are kept in a short list that is scanned.
+*/
+
+#define SCP_FILE "data/MASTER.SCP"
+#define SCP_CALL_LEN 16
+#define SCP_MIN_PARTIAL 2
+#define SCP_RECENT_SIZE 1024
+#define SCP_MAX_MATCHES 16
+
+// where a call is known from (scp_match.flags)
+#define SCP_MASTER 1
+#define SCP_LOGGED 2
+#define SCP_HEARD 4
+
+typedef struct {
+	char call[SCP_CALL_LEN];
+	int flags;
+	time_t heard;	// when it was last heard, if SCP_HEARD
+	int score;	// higher is a better candidate
+} scp_match;
+
+void scp_build_start();
+int scp_build(const char *master_path);
+void scp_add(const char *callsign, int flag);
+int scp_query(const char *partial, scp_match *matches, int max_matches);
+unsigned int scp_generation();
+void scp_stats(int *calls, int *recent);
+int scp_benchmark(char *report, int len);
+
+#endif /* SCP_H */
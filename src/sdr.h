@@ -213,8 +213,15 @@ int get_tx_data_byte(char *c);
 int	get_tx_data_length();
 void modem_poll(int mode);
 float modem_next_sample(int mode);
+int modem_next_if_block(int mode, float *if_signal, float *audio, int count, double if_freq);
 void modem_abort(bool terminate_qso);
 
+/* from modem_ft8.c */
+void ft8_skim_rx(fftw_complex *fft_out);
+
+/* from modem_cw.c */
+void cw_skim_rx(int mode, fftw_complex *spectrum);
+
 int is_in_tx();
 
 #define TX_OFF 0
@@ -222,6 +229,8 @@ int is_in_tx();
 #define TX_SOFT 2
 void tx_on(int trigger);
 void tx_off();
+int tx_meter_report(char *report, int len);
+void tx_meter_reset();
 long get_freq();
 int get_passband_bw();
 void hamlib_tx(int tx_on);
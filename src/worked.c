@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "worked.h"
+
+/*
+	The QSO counts are flat arrays indexed by entity (or grid), then band,
+	then mode class, where slot 0 of the band and mode dimensions is the
+	total over all of them. Adding a QSO touches four entity cells and two
+	grid cells; whenever a cell goes between 0 and 1, the matching count
+	of distinct entities or grids is adjusted too. Counts rather than bits,
+	so that a deleted QSO can be taken out again without a rescan.
+	Only the DXCC entities get a row: entity_row maps the entity numbers
+	of the country file to rows, or to -1 for the WAE-only entities.
+*/
+
+#define BAND_SLOTS (WORKED_MAX_BANDS + 1)
+#define MODE_SLOTS (WORKED_MODE_CLASSES + 1)
+
+static pthread_mutex_t worked_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int *entity_qsos = NULL;		// [row][band + 1][mode + 1]
+static int *entity_row = NULL;		// [entity]
+static int entity_count = 0;
+static int entity_totals[BAND_SLOTS * MODE_SLOTS];	// distinct entities per [band + 1][mode + 1]
+static int *grid_qsos = NULL;		// [grid][band + 1]
+static int grid_totals[BAND_SLOTS];	// distinct grids per [band + 1]
+static bool tables_ready = false;
+
+/*!
+	Empty the tables, and size them for \a n_entities entities
+	(the number in the country file; 0 to count only grids), of which
+	only those with \a is_dxcc set are counted (all of them if NULL).
+*/
+void worked_clear(int n_entities, const bool *is_dxcc)
+{
+	int rows = 0;
+
+	pthread_mutex_lock(&worked_mutex);
+	free(entity_qsos);
+	free(entity_row);
+	entity_count = n_entities > 0 ? n_entities : 0;
+	entity_row = entity_count ? malloc(entity_count * sizeof(int)) : NULL;
+	for (int i = 0; i < entity_count; i++)
+		entity_row[i] = (!is_dxcc || is_dxcc[i]) ? rows++ : -1;
+	entity_qsos = rows ? calloc(rows * BAND_SLOTS * MODE_SLOTS, sizeof(int)) : NULL;
+	if (!grid_qsos)
+		grid_qsos = malloc(WORKED_GRIDS * BAND_SLOTS * sizeof(int));
+	memset(grid_qsos, 0, WORKED_GRIDS * BAND_SLOTS * sizeof(int));
+	memset(entity_totals, 0, sizeof(entity_totals));
+	memset(grid_totals, 0, sizeof(grid_totals));
+	tables_ready = false;
+	pthread_mutex_unlock(&worked_mutex);
+}
+
+bool worked_ready()
+{
+	return tables_ready;
+}
+
+void worked_set_ready(bool ready)
+{
+	tables_ready = ready;
+}
+
+/*!
+	Map a logbook mode to the classes that DXCC and WAS are issued for:
+	CW, phone, and everything else counts as digital.
+*/
+int worked_mode_class(const char *mode)
+{
+	static const char *phone[] = {"USB", "LSB", "SSB", "AM", "FM", "NBFM", NULL};
+	if (!mode || !mode[0])
+		return WORKED_DIGITAL;
+	if (!strncasecmp(mode, "CW", 2))
+		return WORKED_CW;
+	for (int i = 0; phone[i]; i++)
+		if (!strcasecmp(mode, phone[i]))
+			return WORKED_PHONE;
+	return WORKED_DIGITAL;
+}
+
+/*!
+	Index of the 4-character Maidenhead square at the start of \a grid
+	(\a len characters, or -1 if null-terminated), or -1 if it isn't one.
+	RR73 looks like a grid but is always a sign-off, so it is rejected.
+*/
+int worked_grid_index(const char *grid, int len)
+{
+	if (!grid)
+		return -1;
+	if (len < 0)
+		len = strlen(grid);
+	if (len < 4)
+		return -1;
+	int f1 = toupper((unsigned char)grid[0]) - 'A';
+	int f2 = toupper((unsigned char)grid[1]) - 'A';
+	int s1 = grid[2] - '0';
+	int s2 = grid[3] - '0';
+	if (f1 < 0 || f1 >= 18 || f2 < 0 || f2 >= 18 || s1 < 0 || s1 > 9 || s2 < 0 || s2 > 9)
+		return -1;
+	if (f1 == 'R' - 'A' && f2 == 'R' - 'A' && s1 == 7 && s2 == 3)
+		return -1;
+	return ((f1 * 18 + f2) * 10 + s1) * 10 + s2;
+}
+
+// The row of \a entity, or -1 if it isn't counted; call with worked_mutex locked
+static int entity_row_of(int entity)
+{
+	return entity >= 0 && entity < entity_count ? entity_row[entity] : -1;
+}
+
+// call with worked_mutex locked
+static void entity_cell_add(int row, int band_slot, int mode_slot, int delta)
+{
+	int *cell = &entity_qsos[(row * BAND_SLOTS + band_slot) * MODE_SLOTS + mode_slot];
+	int before = *cell;
+	*cell += delta;
+	if (*cell < 0)
+		*cell = 0;
+	if (!before && *cell)
+		entity_totals[band_slot * MODE_SLOTS + mode_slot]++;
+	else if (before && !*cell)
+		entity_totals[band_slot * MODE_SLOTS + mode_slot]--;
+}
+
+// call with worked_mutex locked
+static void grid_cell_add(int grid, int band_slot, int delta)
+{
+	int *cell = &grid_qsos[grid * BAND_SLOTS + band_slot];
+	int before = *cell;
+	*cell += delta;
+	if (*cell < 0)
+		*cell = 0;
+	if (!before && *cell)
+		grid_totals[band_slot]++;
+	else if (before && !*cell)
+		grid_totals[band_slot]--;
+}
+
+/*!
+	Count one QSO in (\a delta = 1) or out of (\a delta = -1) the tables.
+	\a entity is cty_info.entity and \a grid comes from worked_grid_index();
+	either may be -1 if unknown. WAE-only entities aren't counted. \a band is an index into the logbook band
+	table, or -1 if the QSO was outside the bands.
+*/
+void worked_add(int entity, int grid, int band, int mode_class, int delta)
+{
+	int band_slot = (band >= 0 && band < WORKED_MAX_BANDS) ? band + 1 : 0;
+	int mode_slot = (mode_class >= 0 && mode_class < WORKED_MODE_CLASSES) ? mode_class + 1 : 0;
+
+	pthread_mutex_lock(&worked_mutex);
+	int row = entity_row_of(entity);
+	if (row >= 0) {
+		entity_cell_add(row, 0, 0, delta);
+		if (mode_slot)
+			entity_cell_add(row, 0, mode_slot, delta);
+		if (band_slot) {
+			entity_cell_add(row, band_slot, 0, delta);
+			if (mode_slot)
+				entity_cell_add(row, band_slot, mode_slot, delta);
+		}
+	}
+	if (grid >= 0 && grid < WORKED_GRIDS && grid_qsos) {
+		grid_cell_add(grid, 0, delta);
+		if (band_slot)
+			grid_cell_add(grid, band_slot, delta);
+	}
+	pthread_mutex_unlock(&worked_mutex);
+}
+
+/*!
+	Number of QSOs with \a entity on \a band in \a mode_class;
+	either can be WORKED_ANY.
+*/
+int worked_entity_qsos(int entity, int band, int mode_class)
+{
+	int ret = 0;
+	if (band < WORKED_ANY || band >= WORKED_MAX_BANDS || mode_class < WORKED_ANY || mode_class >= WORKED_MODE_CLASSES)
+		return 0;
+	pthread_mutex_lock(&worked_mutex);
+	int row = entity_row_of(entity);
+	if (row >= 0)
+		ret = entity_qsos[(row * BAND_SLOTS + band + 1) * MODE_SLOTS + mode_class + 1];
+	pthread_mutex_unlock(&worked_mutex);
+	return ret;
+}
+
+// Number of QSOs with \a grid (from worked_grid_index()) on \a band, or on any band.
+int worked_grid_qsos(int grid, int band)
+{
+	int ret = 0;
+	if (band < WORKED_ANY || band >= WORKED_MAX_BANDS)
+		return 0;
+	pthread_mutex_lock(&worked_mutex);
+	if (grid >= 0 && grid < WORKED_GRIDS && grid_qsos)
+		ret = grid_qsos[grid * BAND_SLOTS + band + 1];
+	pthread_mutex_unlock(&worked_mutex);
+	return ret;
+}
+
+// Number of distinct entities worked on \a band in \a mode_class (either can be WORKED_ANY).
+int worked_entities(int band, int mode_class)
+{
+	if (band < WORKED_ANY || band >= WORKED_MAX_BANDS || mode_class < WORKED_ANY || mode_class >= WORKED_MODE_CLASSES)
+		return 0;
+	return entity_totals[(band + 1) * MODE_SLOTS + mode_class + 1];
+}
+
+// Number of distinct grids worked on \a band, or on any band.
+int worked_grids(int band)
+{
+	if (band < WORKED_ANY || band >= WORKED_MAX_BANDS)
+		return 0;
+	return grid_totals[band + 1];
+}
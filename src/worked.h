@@ -0,0 +1,40 @@
+#ifndef WORKED_H
+#define WORKED_H
+
+#include <stdbool.h>
+
+/*
+	Worked-status tables for the awards: how many QSOs there are with each
+	DXCC entity per band and mode class, and with each 4-character grid
+	per band, along with how many distinct entities and grids that makes.
+	Every count has an "any band" / "any mode" slot kept alongside, so all
+	the queries are a single array read. logbook.c fills the tables in
+	logbook_open(), and adds or subtracts every QSO it inserts, edits or
+	deletes through the writer thread.
+*/
+
+#define WORKED_MAX_BANDS 12
+#define WORKED_GRIDS (18 * 18 * 10 * 10)
+
+// pass as the band or mode class to count all of them
+#define WORKED_ANY -1
+
+enum worked_mode_class {
+	WORKED_CW,
+	WORKED_PHONE,
+	WORKED_DIGITAL,
+	WORKED_MODE_CLASSES
+};
+
+void worked_clear(int n_entities, const bool *is_dxcc);
+bool worked_ready();
+void worked_set_ready(bool ready);
+int worked_mode_class(const char *mode);
+int worked_grid_index(const char *grid, int len);
+void worked_add(int entity, int grid, int band, int mode_class, int delta);
+int worked_entity_qsos(int entity, int band, int mode_class);
+int worked_grid_qsos(int grid, int band);
+int worked_entities(int band, int mode_class);
+int worked_grids(int band);
+
+#endif /* WORKED_H */